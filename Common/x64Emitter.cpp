@@ -864,7 +864,8 @@ void XEmitter::WriteBitTest(int bits, OpArg &dest, OpArg &index, int ext)
 		X64Reg operand = index.GetSimpleReg();
 		dest.WriteRex(this, bits, bits, operand);
 		Write8(0x0F); Write8(0x83 + 8*ext);
-		dest.WriteRest(this, 1, operand);
+		// No immediate follows, which matters for RIP relative addresses.
+		dest.WriteRest(this, 0, operand);
 	}
 }
 
@@ -192,7 +192,12 @@ void Config::Load(const char *iniFileName, const char *controllerIniFilename) {
 	cpu->Get("AtomicAudioLocks", &bAtomicAudioLocks, false);
 
 	cpu->Get("SeparateIOThread", &bSeparateIOThread, true);
+	cpu->Get("IOWorkerThreads", &iIOWorkerThreads, 1);
+	cpu->Get("VideoDecodeAhead", &iVideoDecodeAhead, 0);
+	cpu->Get("PrefetchModules", &bPrefetchModules, false);
 	cpu->Get("FastMemoryAccess", &bFastMemory, true);
+	cpu->Get("TrackDirtyPages", &bTrackDirtyPages, false);
+	cpu->Get("InlineReplacements", &bInlineReplacements, true);
 	cpu->Get("CPUSpeed", &iLockedCPUSpeed, 0);
 
 	IniFile::Section *graphics = iniFile.GetOrCreateSection("Graphics");
@@ -223,6 +228,7 @@ void Config::Load(const char *iniFileName, const char *controllerIniFilename) {
 #else
 	graphics->Get("FrameSkipUnthrottle", &bFrameSkipUnthrottle, true);
 #endif
+	graphics->Get("PreciseFramePacing", &bPreciseFramePacing, false);
 	graphics->Get("ForceMaxEmulatedFPS", &iForceMaxEmulatedFPS, 60);
 #ifdef USING_GLES2
 	graphics->Get("AnisotropyLevel", &iAnisotropyLevel, 0);
@@ -426,6 +432,7 @@ void Config::Load(const char *iniFileName, const char *controllerIniFilename) {
 	debugConfig->Get("ShowDeveloperMenu", &bShowDeveloperMenu, false);
 	debugConfig->Get("SkipDeadbeefFilling", &bSkipDeadbeefFilling, false);
 	debugConfig->Get("FuncHashMap", &bFuncHashMap, false);
+	debugConfig->Get("RecordInputMovie", &bRecordInputMovie, false);
 
 	IniFile::Section *speedhacks = iniFile.GetOrCreateSection("SpeedHacks");
 	speedhacks->Get("PrescaleUV", &bPrescaleUV, false);
@@ -536,7 +543,12 @@ void Config::Save() {
 		cpu->Set("SeparateCPUThread", bSeparateCPUThread);
 		cpu->Set("AtomicAudioLocks", bAtomicAudioLocks);
 		cpu->Set("SeparateIOThread", bSeparateIOThread);
+		cpu->Set("IOWorkerThreads", iIOWorkerThreads);
+		cpu->Set("VideoDecodeAhead", iVideoDecodeAhead);
+		cpu->Set("PrefetchModules", bPrefetchModules);
 		cpu->Set("FastMemoryAccess", bFastMemory);
+		cpu->Set("TrackDirtyPages", bTrackDirtyPages);
+		cpu->Set("InlineReplacements", bInlineReplacements);
 		cpu->Set("CPUSpeed", iLockedCPUSpeed);
 
 		IniFile::Section *graphics = iniFile.GetOrCreateSection("Graphics");
@@ -551,6 +563,7 @@ void Config::Save() {
 		graphics->Set("AutoFrameSkip", bAutoFrameSkip);
 		graphics->Set("FrameRate", iFpsLimit);
 		graphics->Set("FrameSkipUnthrottle", bFrameSkipUnthrottle);
+		graphics->Set("PreciseFramePacing", bPreciseFramePacing);
 		graphics->Set("ForceMaxEmulatedFPS", iForceMaxEmulatedFPS);
 		graphics->Set("AnisotropyLevel", iAnisotropyLevel);
 		graphics->Set("VertexCache", bVertexCache);
@@ -680,6 +693,7 @@ void Config::Save() {
 		debugConfig->Set("ShowDeveloperMenu", bShowDeveloperMenu);
 		debugConfig->Set("SkipDeadbeefFilling", bSkipDeadbeefFilling);
 		debugConfig->Set("FuncHashMap", bFuncHashMap);
+		debugConfig->Set("RecordInputMovie", bRecordInputMovie);
 
 		IniFile::Section *speedhacks = iniFile.GetOrCreateSection("SpeedHacks");
 		speedhacks->Set("PrescaleUV", bPrescaleUV);
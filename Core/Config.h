@@ -65,12 +65,23 @@ public:
 	// Core
 	bool bIgnoreBadMemAccess;
 	bool bFastMemory;
+	// Track which RAM pages are written, so rewind and the GPU caches can skip unchanged ones.
+	bool bTrackDirtyPages;
 	bool bJit;
+	// Let the x86 jit do memcpy, strlen and friends itself, rather than calling the C replacements.
+	bool bInlineReplacements;
 	bool bCheckForNewVersion;
 
 	// Definitely cannot be changed while game is running.
 	bool bSeparateCPUThread;
 	bool bSeparateIOThread;
+	// Threads the IO thread hands reads and writes to, so files on different devices load in parallel.
+	// 1 does them on the IO thread itself.
+	int iIOWorkerThreads;
+	// Frames of FMV to decode on a separate thread before the game asks for them, 0 to disable.
+	int iVideoDecodeAhead;
+	// Read the disc's encrypted modules at boot and decrypt them on several threads.
+	bool bPrefetchModules;
 	bool bAtomicAudioLocks;
 	int iLockedCPUSpeed;
 	bool bAutoSaveSymbolMap;
@@ -94,6 +105,8 @@ public:
 	int iFrameSkip;
 	bool bAutoFrameSkip;
 	bool bFrameSkipUnthrottle;
+	// Spin for the last bit of each frame wait, and only auto frameskip when late by more than the usual jitter.
+	bool bPreciseFramePacing;
 
 	int iWindowX;
 	int iWindowY;
@@ -274,6 +287,8 @@ public:
 	// Double edged sword: much easier debugging, but not accurate.
 	bool bSkipDeadbeefFilling;
 	bool bFuncHashMap;
+	// Record an input movie of each game played, to replay in headless for benchmarks.
+	bool bRecordInputMovie;
 
 	std::string currentDirectory;
 	std::string externalDirectory; 
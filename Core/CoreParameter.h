@@ -40,6 +40,9 @@ struct CoreParameter {
 
 	std::string fileToStart;
 	std::string mountIso;  // If non-empty, and fileToStart is an ELF or PBP, will mount this ISO in the background.
+	// If non-empty, an input movie to replay from boot, or to record into.
+	std::string inputMoviePlay;
+	std::string inputMovieRecord;
 	std::string errorString;
 
 	bool startPaused;
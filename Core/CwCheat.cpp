@@ -100,17 +100,45 @@ void hleCheat(u64 userdata, int cyclesLate) {
 	cheatEngine->Run();
 }
 
-CWCheatEngine::CWCheatEngine() {
+CWCheatEngine::CWCheatEngine() : cheatEnabled(false), addressOffset(0) {
 
 }
 
 void CWCheatEngine::Exit() {
 	exit2 = true;
 }
+
 void CWCheatEngine::CreateCodeList() { //Creates code list to be used in function GetNextCode
-	initialCodesList = GetCodesList();
+	CreateCodeList(GetCodesList());
+}
+
+inline std::vector<std::string> makeCodeParts(std::vector<std::string> CodesList) { //Takes a single code line and creates a two-part vector for each code. Feeds to CreateCodeList
+	std::string currentcode;
+	std::vector<std::string> finalList;
+	char split_char = '\n';
+	char empty = ' ';
+	for (size_t i = 0; i < CodesList.size(); i++) {
+		currentcode = CodesList[i];
+		for (size_t j=0; j < currentcode.length(); j++) {
+			if (currentcode[j] == empty) {
+				currentcode[j] = '\n';
+			}
+		}
+		trim2(currentcode);
+		std::istringstream iss(currentcode);
+		std::string each;
+		while (std::getline(iss, each, split_char)) {
+			finalList.push_back(each);
+		}
+	}
+	return finalList;
+}
+
+void CWCheatEngine::CreateCodeList(const std::vector<std::string> &initialCodesList) {
 	std::string currentcode, codename;
 	std::vector<std::string> codelist;
+	codeNameList.clear();
+	cheatEnabled = false;
 	for (size_t i = 0; i < initialCodesList.size(); i ++) {
 		if (initialCodesList[i].substr(0,2) == "_S") {
 			continue; //Line indicates Disc ID, not needed for cheats
@@ -144,76 +172,75 @@ void CWCheatEngine::CreateCodeList() { //Creates code list to be used in functio
 			continue;
 		}
 	}
-	parts = makeCodeParts(codelist);
-}
-inline std::vector<std::string> makeCodeParts(std::vector<std::string> CodesList) { //Takes a single code line and creates a two-part vector for each code. Feeds to CreateCodeList
-	std::string currentcode;
-	std::vector<std::string> finalList;
-	char split_char = '\n';
-	char empty = ' ';
-	for (size_t i = 0; i < CodesList.size(); i++) {
-		currentcode = CodesList[i];
-		for (size_t j=0; j < currentcode.length(); j++) {
-			if (currentcode[j] == empty) {
-				currentcode[j] = '\n';
-			}
-		}
-		trim2(currentcode);
-		std::istringstream iss(currentcode);
-		std::string each;
-		while (std::getline(iss, each, split_char)) {
-			finalList.push_back(each);
-		}
-	}
-	return finalList;
-}
-std::vector<int> CWCheatEngine::GetNextCode() { // Feeds a size-2 vector of ints to Run() which contains the address and value of one cheat.
-	std::string code1;
-	std::string code2;
-	std::vector<std::string> splitCode;
-	std::vector<int> finalCode;
-	std::string modifier2 = "0";
-	while (true)  {
-		if (currentCode >= parts.size()) {
-			code1.clear();
-			code2.clear();
-			break;
-		}
-		code1 = parts[currentCode++];
+	std::vector<std::string> parts = makeCodeParts(codelist);
+
+	//Offset to make God Eater Burst codes work
+	addressOffset = 0;
+	if (gameTitle == "ULUS10563" || gameTitle == "ULJS-00351" || gameTitle == "NPJH50352")
+		addressOffset = 0x7EF00;
+
+	// Each code is a pair of hex values.  A pair whose first value doesn't start with 0 (no 0x)
+	// swallows the following pairs, up to and including the next one that does.
+	operations.clear();
+	for (size_t i = 0; i + 1 < parts.size(); ) {
+		std::string code1 = parts[i++];
+		std::string code2 = parts[i++];
 		trim2(code1);
-		code2 = parts[currentCode++];
 		trim2(code2);
-		splitCode.push_back(code1);
-		splitCode.push_back(code2);
-
-		int var1 = (int) parseHexLong(splitCode[0]);
-		int var2 = (int) parseHexLong(splitCode[1]);
-		finalCode.push_back(var1);
-		finalCode.push_back(var2);
-		if (splitCode[0].substr(0,1) == modifier2) {
-			break;
+
+		CheatOperation op;
+		op.comm = (u32)parseHexLong(code1);
+		op.arg = (u32)parseHexLong(code2);
+		operations.push_back(op);
+
+		while (code1.substr(0, 1) != "0" && i + 1 < parts.size()) {
+			code1 = parts[i];
+			trim2(code1);
+			i += 2;
 		}
 	}
-	return finalCode;
-}
 
-void CWCheatEngine::SkipCodes(int count) {
-	for (int i = 0; i < count; i ++) {
-		if (GetNextCode()[0] == 0) {
+	// Now decode them, all addresses and line counts are static.
+	for (size_t i = 0; i < operations.size(); ++i) {
+		CheatOperation &op = operations[i];
+		op.type = op.comm >> 28;
+		op.addr = GetAddress(op.comm & 0x0FFFFFFF);
+		op.lines = 1;
+
+		switch (op.type) {
+		case 0x3:
+			op.addr = GetAddress(op.arg & 0x0FFFFFFF);
+			// The 32-bit forms take the increment from the next line.
+			if (((op.comm >> 20) & 0xF) == 5 || ((op.comm >> 20) & 0xF) == 6)
+				op.lines = 2;
+			break;
+		case 0x4:
+		case 0x5:
+		case 0x8:
+			op.lines = 2;
+			break;
+		case 0x6:
+			op.lines = 2;
+			if (i + 1 < operations.size()) {
+				int count = operations[i + 1].comm & 0xFFFF;
+				if (count > 2)
+					op.lines += count - 2;
+			}
+			break;
+		case 0xE:
+			op.addr = GetAddress(op.arg & 0x0FFFFFFF);
 			break;
 		}
-	}
-}
 
-void CWCheatEngine::SkipAllCodes() {
-	currentCode = codes.size();
+		op.valid = Memory::IsValidAddress(op.addr);
+		// If the code is cut off, it won't run (and neither will anything after it.)
+		if (i + op.lines > operations.size())
+			op.lines = 0;
+	}
 }
 
-int CWCheatEngine::GetAddress(int value) { //Returns static address used by ppsspp. Some games may not like this, and causes cheats to not work without offset
-	int address = (value + 0x08800000) & 0x3FFFFFFF;
-	if (gameTitle == "ULUS10563" || gameTitle == "ULJS-00351" || gameTitle == "NPJH50352" ) //Offset to make God Eater Burst codes work
-		address -= 0x7EF00;
-	return address;
+u32 CWCheatEngine::GetAddress(u32 value) const { //Returns static address used by ppsspp. Some games may not like this, and causes cheats to not work without offset
+	return ((value + 0x08800000) & 0x3FFFFFFF) - addressOffset;
 }
 
 
@@ -246,324 +273,322 @@ std::vector<std::string> CWCheatEngine::GetCodesList() { //Reads the entire chea
 	return codesList;
 }
 
-void CWCheatEngine::Run() {
-	exit2 = false;
-	while (!exit2) {
-		currentCode = 0;
+// Go through the regular accessors so memchecks and dirty tracking see cheat writes.
+template <typename T>
+static inline void CheatWrite(u32 addr, T value);
 
-		while (true) {
-			std::vector<int> code = GetNextCode();
-			if (code.size() < 2) {
-				Exit();
-				break;
-			}
+template <>
+inline void CheatWrite<u8>(u32 addr, u8 value) {
+	Memory::Write_U8(value, addr);
+}
+
+template <>
+inline void CheatWrite<u16>(u32 addr, u16 value) {
+	Memory::Write_U16(value, addr);
+}
+
+template <>
+inline void CheatWrite<u32>(u32 addr, u32 value) {
+	Memory::Write_U32(value, addr);
+}
+
+template <typename T>
+static inline T CheatRead(u32 addr);
+
+template <>
+inline u8 CheatRead<u8>(u32 addr) {
+	return Memory::Read_U8(addr);
+}
+
+template <>
+inline u16 CheatRead<u16>(u32 addr) {
+	return Memory::Read_U16(addr);
+}
 
-			int value;
-			unsigned int comm = code[0];
-			u32 arg = code[1];
-			int addr = GetAddress(comm & 0x0FFFFFFF);
-
-			switch (comm >> 28) {
-			case 0: // 8-bit write.But need more check
-				if (Memory::IsValidAddress(addr)){
-					if (arg < 0x00000100) // 8-bit 
-						Memory::Write_U8((u8) arg, addr);
-					else if (arg < 0x00010000) // 16-bit
-						Memory::Write_U16((u16) arg, addr);
-					else // 32-bit
-						Memory::Write_U32((u32) arg, addr);
+template <>
+inline u32 CheatRead<u32>(u32 addr) {
+	return Memory::Read_U32(addr);
+}
+
+void CWCheatEngine::RunPointerCommand(size_t i) {
+	const CheatOperation &op = operations[i];
+	u32 arg = op.arg;
+	u32 addr = op.addr;
+	int arg2 = operations[i + 1].comm;
+	int offset = operations[i + 1].arg;
+	int baseOffset = (arg2 >> 20) * 4;
+	int base = Memory::Read_U32(addr + baseOffset);
+	int count = arg2 & 0xFFFF;
+	int type = (arg2 >> 16) & 0xF;
+	for (int j = 1; j + 1 < count; j++) {
+		const CheatOperation &next = operations[i + 1 + j];
+		int arg3 = next.comm;
+		int arg4 = next.arg;
+		int comm3 = arg3 >> 28;
+		switch (comm3) {
+		case 0x1: // type copy byte
+			{
+				int srcAddr = Memory::Read_U32(addr) + offset;
+				int dstAddr = Memory::Read_U16(addr + baseOffset) + (arg3 & 0x0FFFFFFF);
+				Memory::Memcpy(dstAddr, Memory::GetPointer(srcAddr), arg);
+				type = -1; //Done
+				break; }
+		case 0x2:
+		case 0x3: // type pointer walk
+			{
+				int walkOffset = arg3 & 0x0FFFFFFF;
+				if (comm3 == 0x3) {
+					walkOffset = -walkOffset;
 				}
-				break;
-			case 0x1: // 16-bit write
-				if (Memory::IsValidAddress(addr)){
-					Memory::Write_U16((u16) arg, addr);
+				base = Memory::Read_U32(base + walkOffset);
+				int comm4 = arg4 >> 28;
+				switch (comm4) {
+				case 0x2:
+				case 0x3: // type pointer walk
+					walkOffset = arg4 & 0x0FFFFFFF;
+					if (comm4 == 0x3) {
+						walkOffset = -walkOffset;
+					}
+					base = Memory::Read_U32(base + walkOffset);
+					break;
 				}
-				break;
-			case 0x2: // 32-bit write
-				if (Memory::IsValidAddress(addr)){
-					Memory::Write_U32((u32) arg, addr);
+				break; }
+		case 0x9: // type multi address write
+			base += arg3 & 0x0FFFFFFF;
+			arg += arg4;
+			break;
+		default:
+			break;
+		}
+	}
+
+	switch (type) {
+	case 0: // 8 bit write
+		Memory::Write_U8((u8) arg, base + offset);
+		break;
+	case 1: // 16-bit write
+		Memory::Write_U16((u16) arg, base + offset);
+		break;
+	case 2: // 32-bit write
+		Memory::Write_U32((u32) arg, base + offset);
+		break;
+	case 3: // 8 bit inverse write
+		Memory::Write_U8((u8) arg, base - offset);
+		break;
+	case 4: // 16-bit inverse write
+		Memory::Write_U16((u16) arg, base - offset);
+		break;
+	case 5: // 32-bit inverse write
+		Memory::Write_U32((u32) arg, base - offset);
+		break;
+	case -1: // Operation already performed, nothing to do
+		break;
+	}
+}
+
+void CWCheatEngine::Run() {
+	exit2 = false;
+	const size_t numOperations = operations.size();
+	for (size_t i = 0; i < numOperations && !exit2; ) {
+		const CheatOperation &op = operations[i];
+		if (op.lines == 0)
+			break;
+		// Codes that take more lines get their data from the next entries.
+		const CheatOperation &next = operations[i + op.lines - 1];
+		const u32 comm = op.comm;
+		const u32 arg = op.arg;
+		size_t nextCode = i + op.lines;
+
+		switch (op.type) {
+		case 0: // 8-bit write.But need more check
+			if (op.valid) {
+				if (arg < 0x00000100) // 8-bit
+					CheatWrite<u8>(op.addr, (u8) arg);
+				else if (arg < 0x00010000) // 16-bit
+					CheatWrite<u16>(op.addr, (u16) arg);
+				else // 32-bit
+					CheatWrite<u32>(op.addr, arg);
+			}
+			break;
+		case 0x1: // 16-bit write
+			if (op.valid) {
+				CheatWrite<u16>(op.addr, (u16) arg);
+			}
+			break;
+		case 0x2: // 32-bit write
+			if (op.valid) {
+				CheatWrite<u32>(op.addr, arg);
+			}
+			break;
+		case 0x3: // Increment/Decrement
+			{
+				u32 addr = op.addr;
+				int value = 0;
+				int increment = 0;
+				// Read value from memory
+				switch ((comm >> 20) & 0xF) {
+				case 1:
+				case 2: // 8-bit
+					value = Memory::Read_U8(addr);
+					increment = comm & 0xFF;
+					break;
+				case 3:
+				case 4: // 16-bit
+					value = Memory::Read_U16(addr);
+					increment = comm & 0xFFFF;
+					break;
+				case 5:
+				case 6: // 32-bit
+					value = Memory::Read_U32(addr);
+					increment = next.comm;
+					break;
 				}
-				break;
-			case 0x3: // Increment/Decrement
-				{
-					addr = GetAddress(arg & 0x0FFFFFFF);
-					value = 0;
-					int increment = 0;
-					// Read value from memory
-					switch ((comm >> 20) & 0xF) {
-					case 1:
-					case 2: // 8-bit
-						value = Memory::Read_U8(addr);
-						increment = comm & 0xFF;
-						break;
-					case 3:
-					case 4: // 16-bit
-						value = Memory::Read_U16(addr);
-						increment = comm & 0xFFFF;
-						break;
-					case 5:
-					case 6: // 32-bit
-						value = Memory::Read_U32(addr);
-						code = GetNextCode();
-						if (code[0] != 0) {
-							increment = code[0];
-						}
-						break;
-					}
-					// Increment/Decrement value
-					switch ((comm >> 20) & 0xF) {
-					case 1:
-					case 3:
-					case 5: // increment
-						value += increment;
-						break;
-					case 2:
-					case 4:
-					case 6: // Decrement
-						value -= increment;
-						break;
-					}
-					// Write value back to memory
-					switch ((comm >> 20) & 0xF) {
-					case 1:
-					case 2: // 8-bit
-						Memory::Write_U8((u8) value, addr);
-						break;
-					case 3:
-					case 4: // 16-bit
-						Memory::Write_U16((u16) value, addr);
-						break;
-					case 5:
-					case 6: // 32-bit
-						Memory::Write_U32((u32) value, addr);
-						break;
-					}
+				// Increment/Decrement value
+				switch ((comm >> 20) & 0xF) {
+				case 1:
+				case 3:
+				case 5: // increment
+					value += increment;
+					break;
+				case 2:
+				case 4:
+				case 6: // Decrement
+					value -= increment;
 					break;
 				}
-			case 0x4: // 32-bit patch code
-				code = GetNextCode();
-				if (true) {
-					int data = code[0];
-					int dataAdd = code[1];
-
-					int maxAddr = (arg >> 16) & 0xFFFF;
-					int stepAddr = (arg & 0xFFFF) * 4;
-					for (int a  = 0; a < maxAddr; a++) {
-						if (Memory::IsValidAddress(addr)) {
-							Memory::Write_U32((u32) data, addr);
-						}
-						addr += stepAddr;
-						data += dataAdd;
-					}
+				// Write value back to memory
+				switch ((comm >> 20) & 0xF) {
+				case 1:
+				case 2: // 8-bit
+					Memory::Write_U8((u8) value, addr);
+					break;
+				case 3:
+				case 4: // 16-bit
+					Memory::Write_U16((u16) value, addr);
+					break;
+				case 5:
+				case 6: // 32-bit
+					Memory::Write_U32((u32) value, addr);
+					break;
 				}
 				break;
-			case 0x5: // Memcpy command
-				code = GetNextCode();
-				if (true) {
-					int destAddr = GetAddress(code[0]);
-					if (Memory::IsValidAddress(addr) && Memory::IsValidAddress(destAddr)) {
-						Memory::Memcpy(destAddr, Memory::GetPointer(addr), arg);
+			}
+		case 0x4: // 32-bit patch code
+			{
+				u32 addr = op.addr;
+				u32 data = next.comm;
+				u32 dataAdd = next.arg;
+
+				int maxAddr = (arg >> 16) & 0xFFFF;
+				int stepAddr = (arg & 0xFFFF) * 4;
+				for (int a = 0; a < maxAddr; a++) {
+					if (Memory::IsValidAddress(addr)) {
+						CheatWrite<u32>(addr, data);
 					}
+					addr += stepAddr;
+					data += dataAdd;
 				}
-				break;
-			case 0x6: // Pointer commands
-				code = GetNextCode();
-				if (true) {
-					int arg2 = code[0];
-					int offset = code[1];
-					int baseOffset = (arg2 >> 20) * 4;
-					int base = Memory::Read_U32(addr + baseOffset);
-					int count = arg2 & 0xFFFF;
-					int type = (arg2 >> 16) & 0xF;
-					for (int i = 1; i < count; i ++ ) {
-						if (i+1 < count) {
-							code = GetNextCode();
-							int arg3 = code[0];
-							int arg4 = code[1];
-							int comm3 = arg3 >> 28;
-							switch (comm3) {
-							case 0x1: // type copy byte
-								{
-									int srcAddr = Memory::Read_U32(addr) + offset;
-									int dstAddr = Memory::Read_U16(addr + baseOffset) + (arg3 & 0x0FFFFFFF);
-									Memory::Memcpy(dstAddr, Memory::GetPointer(srcAddr), arg);
-									type = -1; //Done
-									break; }
-							case 0x2:
-							case 0x3: // type pointer walk
-								{
-									int walkOffset = arg3 & 0x0FFFFFFF;
-									if (comm3 == 0x3) {
-										walkOffset = -walkOffset;
-									}
-									base = Memory::Read_U32(base + walkOffset);
-									int comm4 = arg4 >> 28;
-									switch (comm4) {
-									case 0x2:
-									case 0x3: // type pointer walk
-										walkOffset = arg4 & 0x0FFFFFFF;
-										if (comm4 == 0x3) {
-											walkOffset = -walkOffset;
-										}
-										base = Memory::Read_U32(base + walkOffset);
-										break;
-									}
-									break; }
-							case 0x9: // type multi address write
-								base += arg3 & 0x0FFFFFFF;
-								arg += arg4;
-								break;
-							default:
-								break;
-
-							}
-						}
-					}
-
-					switch (type) {
-					case 0: // 8 bit write
-						Memory::Write_U8((u8) arg, base + offset);
-						break;
-					case 1: // 16-bit write
-						Memory::Write_U16((u16) arg, base + offset);
-						break;
-					case 2: // 32-bit write
-						Memory::Write_U32((u32) arg, base + offset);
-						break;
-					case 3: // 8 bit inverse write
-						Memory::Write_U8((u8) arg, base - offset);
-						break;
-					case 4: // 16-bit inverse write
-						Memory::Write_U16((u16) arg, base - offset);
-						break;
-					case 5: // 32-bit inverse write
-						Memory::Write_U32((u32) arg, base - offset);
-						break;
-					case -1: // Operation already performed, nothing to do
-						break;
-					}
+			}
+			break;
+		case 0x5: // Memcpy command
+			{
+				u32 destAddr = GetAddress(next.comm);
+				if (op.valid && Memory::IsValidAddress(destAddr)) {
+					Memory::Memcpy(destAddr, Memory::GetPointer(op.addr), arg);
 				}
-				break;
-			case 0x7: // Boolean commands.
+			}
+			break;
+		case 0x6: // Pointer commands
+			RunPointerCommand(i);
+			break;
+		case 0x7: // Boolean commands.
+			if (op.valid) {
 				switch (arg >> 16) {
 				case 0x0000: // 8-bit OR.
-					if (Memory::IsValidAddress(addr)) {
-						int val1 = (int) (arg & 0xFF);
-						int val2 = (int) Memory::Read_U8(addr);
-						Memory::Write_U8((u8) (val1 | val2), addr);
-					}
+					CheatWrite<u8>(op.addr, CheatRead<u8>(op.addr) | (u8)arg);
 					break;
 				case 0x0002: // 8-bit AND.
-					if (Memory::IsValidAddress(addr)) {
-						int val1 = (int) (arg & 0xFF);
-						int val2 = (int) Memory::Read_U8(addr);
-						Memory::Write_U8((u8) (val1 & val2), addr);
-					}
+					CheatWrite<u8>(op.addr, CheatRead<u8>(op.addr) & (u8)arg);
 					break;
 				case 0x0004: // 8-bit XOR.
-					if (Memory::IsValidAddress(addr)) {
-						int val1 = (int) (arg & 0xFF);
-						int val2 = (int) Memory::Read_U8(addr);
-						Memory::Write_U8((u8) (val1 ^ val2), addr);
-					}
+					CheatWrite<u8>(op.addr, CheatRead<u8>(op.addr) ^ (u8)arg);
 					break;
 				case 0x0001: // 16-bit OR.
-					if (Memory::IsValidAddress(addr)) {
-						short val1 = (short) (arg & 0xFFFF);
-						short val2 = (short) Memory::Read_U16(addr);
-						Memory::Write_U16((u16) (val1 | val2), addr);
-					}
+					CheatWrite<u16>(op.addr, CheatRead<u16>(op.addr) | (u16)arg);
 					break;
 				case 0x0003: // 16-bit AND.
-					if (Memory::IsValidAddress(addr)) {
-						short val1 = (short) (arg & 0xFFFF);
-						short val2 = (short) Memory::Read_U16(addr);
-						Memory::Write_U16((u16) (val1 & val2), addr);
-					}
+					CheatWrite<u16>(op.addr, CheatRead<u16>(op.addr) & (u16)arg);
 					break;
-				case 0x0005: // 16-bit OR.
-					if (Memory::IsValidAddress(addr)) {
-						short val1 = (short) (arg & 0xFFFF);
-						short val2 = (short) Memory::Read_U16(addr);
-						Memory::Write_U16((u16) (val1 ^ val2), addr);
-					}
+				case 0x0005: // 16-bit XOR.
+					CheatWrite<u16>(op.addr, CheatRead<u16>(op.addr) ^ (u16)arg);
 					break;
 				}
-				break;
-			case 0x8: // 8-bit and 16-bit patch code
-				code = GetNextCode();
-				if (true) {
-					int data = code[0];
-					int dataAdd = code[1];
-
-					bool is8Bit = (data >> 16) == 0x0000;
-					int maxAddr = (arg >> 16) & 0xFFFF;
-					int stepAddr = (arg & 0xFFFF) * (is8Bit ? 1 : 2);
-					for (int a = 0; a < maxAddr; a++) {
-						if (Memory::IsValidAddress(addr)) {
-							if (is8Bit) {
-								Memory::Write_U8((u8) (data & 0xFF), addr);
-							}
-							else {
-								Memory::Write_U16((u16) (data & 0xFFFF), addr);
-							}
-						}
-						addr += stepAddr;
-						data += dataAdd;
-					}
-				}
-				break;
-			case 0xB: // Time command (not sure what to do?)
-				break;
-			case 0xC: // Code stopper
-				if (Memory::IsValidAddress(addr)) { 
-					value = Memory::Read_U32(addr);
-					if (value != arg) {
-						SkipAllCodes();
-					}
-				}
-				break;
-			case 0xD: // Test commands & Jocker codes ( Someone will have to help me with these)
-				break;
-			case 0xE: // Test commands, multiple skip
-				{
-					bool is8Bit = (comm >> 24) == 0xE1;
-					addr = GetAddress(arg & 0x0FFFFFFF);
+			}
+			break;
+		case 0x8: // 8-bit and 16-bit patch code
+			{
+				u32 addr = op.addr;
+				u32 data = next.comm;
+				u32 dataAdd = next.arg;
+
+				bool is8Bit = (data >> 16) == 0x0000;
+				int maxAddr = (arg >> 16) & 0xFFFF;
+				int stepAddr = (arg & 0xFFFF) * (is8Bit ? 1 : 2);
+				for (int a = 0; a < maxAddr; a++) {
 					if (Memory::IsValidAddress(addr)) {
-						int memoryValue = is8Bit ? Memory::Read_U8(addr) : Memory::Read_U16(addr);
-						int testValue = comm & (is8Bit ? 0xFF : 0xFFFF);
-						bool executeNextLines = false;
-						switch ( arg >> 28) {
-						case 0x0: // Equal
-							executeNextLines = memoryValue == testValue;
-							break;
-						case 0x1: // Not Equal
-							executeNextLines = memoryValue != testValue;
-							break;
-						case 0x2: // Less Than
-							executeNextLines = memoryValue < testValue;
-							break;
-						case 0x3: // Greater Than
-							executeNextLines = memoryValue > testValue;
-							break;
+						if (is8Bit) {
+							CheatWrite<u8>(addr, (u8) (data & 0xFF));
 						}
-						if (!executeNextLines) {
-							int skip = (comm >> 16) & (is8Bit ? 0xFF : 0xFFF);
-							SkipCodes(skip);
+						else {
+							CheatWrite<u16>(addr, (u16) (data & 0xFFFF));
 						}
 					}
-					break;
+					addr += stepAddr;
+					data += dataAdd;
 				}
-			default:
-				{
+			}
+			break;
+		case 0xB: // Time command (not sure what to do?)
+			break;
+		case 0xC: // Code stopper
+			if (op.valid && CheatRead<u32>(op.addr) != arg) {
+				nextCode = numOperations;
+			}
+			break;
+		case 0xD: // Test commands & Jocker codes ( Someone will have to help me with these)
+			break;
+		case 0xE: // Test commands, multiple skip
+			if (op.valid) {
+				bool is8Bit = (comm >> 24) == 0xE1;
+				int memoryValue = is8Bit ? CheatRead<u8>(op.addr) : CheatRead<u16>(op.addr);
+				int testValue = comm & (is8Bit ? 0xFF : 0xFFFF);
+				bool executeNextLines = false;
+				switch (arg >> 28) {
+				case 0x0: // Equal
+					executeNextLines = memoryValue == testValue;
+					break;
+				case 0x1: // Not Equal
+					executeNextLines = memoryValue != testValue;
+					break;
+				case 0x2: // Less Than
+					executeNextLines = memoryValue < testValue;
+					break;
+				case 0x3: // Greater Than
+					executeNextLines = memoryValue > testValue;
 					break;
 				}
+				if (!executeNextLines) {
+					int skip = (comm >> 16) & (is8Bit ? 0xFF : 0xFFF);
+					nextCode += skip;
+				}
 			}
+			break;
+		default:
+			break;
 		}
+
+		i = nextCode;
 	}
 	// exiting...
 	Exit();
 }
-
-
-
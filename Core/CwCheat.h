@@ -17,6 +17,21 @@ void __CheatDoState(PointerWrap &p);
 
 std::vector<std::string> makeCodeParts(std::vector<std::string> CodesList);
 
+// One decoded code line.  Codes that use the following lines (patches, pointers, etc.) read
+// them from the next entries, so skips still count lines exactly like the original format.
+struct CheatOperation {
+	u32 comm;
+	u32 arg;
+	// comm >> 28.
+	u8 type;
+	// Whether addr is a valid address, checked once at compile time.
+	bool valid;
+	// Lines this code uses, including itself.
+	int lines;
+	// The address this code targets, already offset for the game.
+	u32 addr;
+};
+
 class CWCheatEngine {
 public:
 	CWCheatEngine();
@@ -24,18 +39,19 @@ public:
 	void AddCheatLine(std::string& line);
 	std::vector<std::string> GetCodesList();
 	void CreateCodeList();
+	// Parses and decodes the enabled codes once, so Run() doesn't need to.
+	void CreateCodeList(const std::vector<std::string> &codesList);
 	void Exit();
 	void Run();
-	std::vector<int> GetNextCode();
-	
+
+	size_t GetNumOperations() const { return operations.size(); }
 
 private:
-	void SkipCodes(int count);
-	void SkipAllCodes();
 	bool cheatsOn, exit2, cheatEnabled;
-	int GetAddress(int value);
+	u32 GetAddress(u32 value) const;
+	void RunPointerCommand(size_t i);
 	std::vector<std::string> codeNameList;
 
-	std::vector<std::string> codes, initialCodesList, parts;
-	size_t currentCode;
+	std::vector<CheatOperation> operations;
+	u32 addressOffset;
 };
@@ -23,12 +23,108 @@
 #include "Core/MIPS/JitCommon/JitCommon.h"
 #include "Core/CoreTiming.h"
 #include <cstdio>
+#include <cstdlib>
+#include <cstring>
 
 std::vector<BreakPoint> CBreakPoints::breakPoints_;
 u32 CBreakPoints::breakSkipFirstAt_ = 0;
 u64 CBreakPoints::breakSkipFirstTicks_ = 0;
 std::vector<MemCheck> CBreakPoints::memChecks_;
 std::vector<MemCheck *> CBreakPoints::cleanupMemChecks_;
+u32 CBreakPoints::memCheckReadPages_[CBreakPoints::MEMCHECK_PAGE_WORDS];
+u32 CBreakPoints::memCheckWritePages_[CBreakPoints::MEMCHECK_PAGE_WORDS];
+
+static inline u32 NotCached(u32 val)
+{
+	// Remove the cached part of the address.
+	return val & ~0x40000000;
+}
+
+static bool ParseCondRegister(DebugInterface *debug, const char *str, int &reg)
+{
+	for (int i = 0; i < 32; i++)
+	{
+		char name[8];
+		sprintf(name, "r%d", i);
+		if (strcasecmp(str, name) == 0 || strcasecmp(str, debug->GetRegName(0, i)) == 0)
+		{
+			reg = i;
+			return true;
+		}
+	}
+	return false;
+}
+
+static bool ParseCondValue(const char *str, u32 &value)
+{
+	// The expression parser reads bare numbers as hex, so only accept what can't be misread.
+	if (str[0] == '0' && (str[1] == 'x' || str[1] == 'X') && str[2] != '\0')
+	{
+		char *end;
+		value = (u32)strtoul(str + 2, &end, 16);
+		return *end == '\0';
+	}
+	if (str[0] >= '0' && str[0] <= '9' && str[1] == '\0')
+	{
+		value = str[0] - '0';
+		return true;
+	}
+	return false;
+}
+
+void BreakPointCond::Compile()
+{
+	compiled = false;
+	if (debug == NULL)
+		return;
+
+	// Split into "lhs op rhs", ignoring spaces.
+	char lhs[64], op[3], rhs[64];
+	size_t lhsLen = 0, opLen = 0, rhsLen = 0;
+	for (const char *p = expressionString; *p != '\0'; ++p)
+	{
+		char c = *p;
+		if (c == ' ' || c == '\t')
+			continue;
+		bool opChar = c == '=' || c == '!' || c == '<' || c == '>';
+		if (opChar && rhsLen == 0 && opLen < sizeof(op) - 1)
+			op[opLen++] = c;
+		else if (opChar)
+			return;
+		else if (opLen == 0 && lhsLen < sizeof(lhs) - 1)
+			lhs[lhsLen++] = c;
+		else if (opLen != 0 && rhsLen < sizeof(rhs) - 1)
+			rhs[rhsLen++] = c;
+		else
+			return;
+	}
+	lhs[lhsLen] = '\0';
+	op[opLen] = '\0';
+	rhs[rhsLen] = '\0';
+
+	static const struct { const char *str; BreakPointCondOp op; BreakPointCondOp swapped; } ops[] = {
+		{"==", BREAKCOND_EQUAL, BREAKCOND_EQUAL},
+		{"!=", BREAKCOND_NOTEQUAL, BREAKCOND_NOTEQUAL},
+		{"<", BREAKCOND_LESS, BREAKCOND_GREATER},
+		{"<=", BREAKCOND_LESSEQUAL, BREAKCOND_GREATEREQUAL},
+		{">", BREAKCOND_GREATER, BREAKCOND_LESS},
+		{">=", BREAKCOND_GREATEREQUAL, BREAKCOND_LESSEQUAL},
+	};
+	for (size_t i = 0; i < sizeof(ops) / sizeof(ops[0]); ++i)
+	{
+		if (strcmp(op, ops[i].str) != 0)
+			continue;
+
+		if (ParseCondRegister(debug, lhs, compiledReg) && ParseCondValue(rhs, compiledValue))
+			compiledOp = ops[i].op;
+		else if (ParseCondRegister(debug, rhs, compiledReg) && ParseCondValue(lhs, compiledValue))
+			compiledOp = ops[i].swapped;
+		else
+			return;
+		compiled = true;
+		return;
+	}
+}
 
 MemCheck::MemCheck()
 {
@@ -224,6 +320,7 @@ void CBreakPoints::ChangeBreakPointAddCond(u32 addr, const BreakPointCond &cond)
 	{
 		breakPoints_[bp].hasCond = true;
 		breakPoints_[bp].cond = cond;
+		breakPoints_[bp].cond.Compile();
 		Update();
 	}
 }
@@ -261,12 +358,14 @@ void CBreakPoints::AddMemCheck(u32 start, u32 end, MemCheckCondition cond, MemCh
 		check.result = result;
 
 		memChecks_.push_back(check);
+		UpdateMemCheckPages();
 		Update();
 	}
 	else
 	{
 		memChecks_[mc].cond = (MemCheckCondition)(memChecks_[mc].cond | cond);
 		memChecks_[mc].result = (MemCheckResult)(memChecks_[mc].result | result);
+		UpdateMemCheckPages();
 		Update();
 	}
 }
@@ -280,6 +379,7 @@ void CBreakPoints::RemoveMemCheck(u32 start, u32 end)
 	if (mc != INVALID_MEMCHECK)
 	{
 		memChecks_.erase(memChecks_.begin() + mc);
+		UpdateMemCheckPages();
 		Update();
 	}
 }
@@ -291,6 +391,7 @@ void CBreakPoints::ChangeMemCheck(u32 start, u32 end, MemCheckCondition cond, Me
 	{
 		memChecks_[mc].cond = cond;
 		memChecks_[mc].result = result;
+		UpdateMemCheckPages();
 		Update();
 	}
 }
@@ -303,18 +404,80 @@ void CBreakPoints::ClearAllMemChecks()
 	if (!memChecks_.empty())
 	{
 		memChecks_.clear();
+		UpdateMemCheckPages();
 		Update();
 	}
 }
 
-static inline u32 NotCached(u32 val)
+static inline void SetMemCheckPages(u32 *pages, u32 start, u32 last)
 {
-	// Remove the cached part of the address.
-	return val & ~0x40000000;
+	// Page numbers wrap, so start may be "after" end if the slop went below 0.
+	u32 first = start >> CBreakPoints::MEMCHECK_PAGE_SHIFT;
+	u32 count = (((last >> CBreakPoints::MEMCHECK_PAGE_SHIFT) - first) & 0xFFFFF) + 1;
+	if (count > CBreakPoints::MEMCHECK_PAGE_MASK)
+		count = CBreakPoints::MEMCHECK_PAGE_MASK + 1;
+	for (u32 i = 0; i < count; ++i)
+	{
+		u32 page = (first + i) & CBreakPoints::MEMCHECK_PAGE_MASK;
+		pages[page >> 5] |= 1 << (page & 31);
+	}
+}
+
+void CBreakPoints::UpdateMemCheckPages()
+{
+	memset(memCheckReadPages_, 0, sizeof(memCheckReadPages_));
+	memset(memCheckWritePages_, 0, sizeof(memCheckWritePages_));
+
+	for (auto it = memChecks_.begin(), end = memChecks_.end(); it != end; ++it)
+	{
+		// The jit only looks at the start of an access, which can be up to 16 bytes (lv.q) before the range.
+		u32 start = NotCached(it->start) - 16;
+		u32 last = it->end != 0 ? NotCached(it->end - 1) : NotCached(it->start);
+		if (last < NotCached(it->start))
+			last = NotCached(it->start);
+
+		if (it->cond & MEMCHECK_READ)
+			SetMemCheckPages(memCheckReadPages_, start, last);
+		if (it->cond & (MEMCHECK_WRITE | MEMCHECK_WRITE_ONCHANGE))
+			SetMemCheckPages(memCheckWritePages_, start, last);
+	}
+}
+
+bool CBreakPoints::HasMemChecks(bool write)
+{
+	int mask = write ? (MEMCHECK_WRITE | MEMCHECK_WRITE_ONCHANGE) : MEMCHECK_READ;
+	for (auto it = memChecks_.begin(), end = memChecks_.end(); it != end; ++it)
+	{
+		if (it->cond & mask)
+			return true;
+	}
+	return false;
+}
+
+bool CBreakPoints::IsMemCheckPage(u32 address, int size, bool write)
+{
+	const u32 *pages = GetMemCheckPages(write);
+	u32 first = NotCached(address) >> MEMCHECK_PAGE_SHIFT;
+	u32 count = size <= 1 ? 1 : (((NotCached(address) & ((1 << MEMCHECK_PAGE_SHIFT) - 1)) + size - 1) >> MEMCHECK_PAGE_SHIFT) + 1;
+	if (count > MEMCHECK_PAGE_MASK)
+		count = MEMCHECK_PAGE_MASK + 1;
+	for (u32 i = 0; i < count; ++i)
+	{
+		u32 page = (first + i) & MEMCHECK_PAGE_MASK;
+		if (pages[page >> 5] & (1 << (page & 31)))
+			return true;
+	}
+	return false;
 }
 
 MemCheck *CBreakPoints::GetMemCheck(u32 address, int size)
 {
+	if (memChecks_.empty())
+		return 0;
+	// Most accesses are nowhere near a memcheck, skip the scan for those.
+	if (!IsMemCheckPage(address, size, false) && !IsMemCheckPage(address, size, true))
+		return 0;
+
 	std::vector<MemCheck>::iterator iter;
 	for (iter = memChecks_.begin(); iter != memChecks_.end(); ++iter)
 	{
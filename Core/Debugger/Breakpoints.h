@@ -21,23 +21,59 @@
 
 #include "Core/Debugger/DebugInterface.h"
 
+enum BreakPointCondOp
+{
+	BREAKCOND_EQUAL,
+	BREAKCOND_NOTEQUAL,
+	BREAKCOND_LESS,
+	BREAKCOND_LESSEQUAL,
+	BREAKCOND_GREATER,
+	BREAKCOND_GREATEREQUAL,
+};
+
 struct BreakPointCond
 {
 	DebugInterface *debug;
 	PostfixExpression expression;
 	char expressionString[128];
 
-	BreakPointCond() : debug(NULL)
+	// Conditions of the form "reg op const" are compiled by Compile(), so they skip the
+	// expression evaluator and the jit can test them inline.  Comparisons are unsigned.
+	bool compiled;
+	int compiledReg;
+	BreakPointCondOp compiledOp;
+	u32 compiledValue;
+
+	BreakPointCond() : debug(NULL), compiled(false)
 	{
 		expressionString[0] = '\0';
 	}
 
+	void Compile();
+
 	u32 Evaluate()
 	{
+		if (compiled)
+			return EvaluateCompiled(debug->GetRegValue(0, compiledReg));
+
 		u32 result;
 		if (debug->parseExpression(expression,result) == false) return 0;
 		return result;
 	}
+
+	u32 EvaluateCompiled(u32 regValue) const
+	{
+		switch (compiledOp)
+		{
+		case BREAKCOND_EQUAL: return regValue == compiledValue;
+		case BREAKCOND_NOTEQUAL: return regValue != compiledValue;
+		case BREAKCOND_LESS: return regValue < compiledValue;
+		case BREAKCOND_LESSEQUAL: return regValue <= compiledValue;
+		case BREAKCOND_GREATER: return regValue > compiledValue;
+		case BREAKCOND_GREATEREQUAL: return regValue >= compiledValue;
+		}
+		return 0;
+	}
 };
 
 struct BreakPoint
@@ -132,6 +168,8 @@ public:
 	static void ClearAllMemChecks();
 
 	static MemCheck *GetMemCheck(u32 address, int size);
+	static bool HasMemChecks() { return !memChecks_.empty(); }
+	static bool HasMemChecks(bool write);
 	static void ExecMemCheck(u32 address, bool write, int size, u32 pc);
 
 	// Executes memchecks but used by the jit.  Cleanup finalizes after jit is done.
@@ -149,10 +187,22 @@ public:
 
 	static void Update(u32 addr = 0);
 
+	// One bit per page that any read (or write) memcheck might cover, ignoring the cached bit.
+	// Includes a little slop before each range, so checking only the start of an access is safe.
+	// False positives are fine, GetMemCheck() does the exact test.
+	enum {
+		MEMCHECK_PAGE_SHIFT = 12,
+		MEMCHECK_PAGE_MASK = 0x3FFFF,
+		MEMCHECK_PAGE_WORDS = (MEMCHECK_PAGE_MASK + 1) / 32,
+	};
+	static const u32 *GetMemCheckPages(bool write) { return write ? memCheckWritePages_ : memCheckReadPages_; }
+	static bool IsMemCheckPage(u32 address, int size, bool write);
+
 private:
 	static size_t FindBreakpoint(u32 addr, bool matchTemp = false, bool temp = false);
 	// Finds exactly, not using a range check.
 	static size_t FindMemCheck(u32 start, u32 end);
+	static void UpdateMemCheckPages();
 
 	static std::vector<BreakPoint> breakPoints_;
 	static u32 breakSkipFirstAt_;
@@ -160,6 +210,8 @@ private:
 
 	static std::vector<MemCheck> memChecks_;
 	static std::vector<MemCheck *> cleanupMemChecks_;
+	static u32 memCheckReadPages_[MEMCHECK_PAGE_WORDS];
+	static u32 memCheckWritePages_[MEMCHECK_PAGE_WORDS];
 };
 
 
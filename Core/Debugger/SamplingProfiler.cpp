@@ -0,0 +1,217 @@
+// Copyright (c) 2012- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#include <algorithm>
+#include <cstdio>
+#include <map>
+#include <set>
+
+#include "base/timeutil.h"
+#include "Common/FileUtil.h"
+#include "Common/StdMutex.h"
+#include "Core/CoreTiming.h"
+#include "Core/MemMap.h"
+#include "Core/Debugger/SamplingProfiler.h"
+#include "Core/Debugger/SymbolMap.h"
+#include "Core/HLE/sceKernelThread.h"
+#include "Core/MIPS/MIPS.h"
+#include "Core/MIPS/MIPSStackWalk.h"
+
+namespace SamplingProfiler {
+
+// Function entries, outermost caller first.
+typedef std::vector<u32> Stack;
+
+struct StackStats {
+	u32 samples;
+	u64 cycles;
+	double seconds;
+};
+
+static std::recursive_mutex profileLock;
+static std::map<Stack, StackStats> stacks;
+static bool running = false;
+static int interval = 0;
+static s64 cyclesUntilSample = 0;
+static u64 lastSampleTicks = 0;
+static double lastSampleTime = 0.0;
+static u32 sampleCount = 0;
+
+static u32 EntryForPC(u32 pc) {
+	u32 entry = symbolMap.GetFunctionStart(pc);
+	return entry == SymbolMap::INVALID_ADDRESS ? pc : entry;
+}
+
+static std::string FunctionName(u32 entry) {
+	std::string name = symbolMap.GetLabelString(entry);
+	if (name.empty()) {
+		char temp[32];
+		sprintf(temp, "z_un_%08x", entry);
+		return temp;
+	}
+	return name;
+}
+
+static void TakeSample(u64 ticks, double now) {
+	const u32 pc = currentMIPS->pc;
+	Stack stack;
+
+	const u32 threadEntry = __KernelGetCurThreadEntry();
+	const u32 stackTop = __KernelGetCurThreadInitialStack();
+	if (threadEntry != 0 && Memory::IsValidAddress(pc)) {
+		auto frames = MIPSStackWalk::Walk(pc, currentMIPS->r[MIPS_REG_RA], currentMIPS->r[MIPS_REG_SP], threadEntry, stackTop);
+		stack.reserve(frames.size());
+		for (auto it = frames.rbegin(), end = frames.rend(); it != end; ++it) {
+			stack.push_back(it->entry);
+		}
+	}
+	// The walk may give up before reaching the current function, e.g. in HLE or idle code.
+	if (stack.empty()) {
+		stack.push_back(EntryForPC(pc));
+	}
+
+	std::lock_guard<std::recursive_mutex> guard(profileLock);
+	StackStats &stats = stacks[stack];
+	stats.samples++;
+	stats.cycles += ticks - lastSampleTicks;
+	stats.seconds += now - lastSampleTime;
+	sampleCount++;
+}
+
+static void AdvanceCallback(int cyclesExecuted) {
+	cyclesUntilSample -= cyclesExecuted;
+	if (cyclesUntilSample <= 0) {
+		const u64 ticks = CoreTiming::GetTicks();
+		const double now = time_now_d();
+		TakeSample(ticks, now);
+		lastSampleTicks = ticks;
+		lastSampleTime = now;
+		cyclesUntilSample = interval;
+	}
+
+	// Shorten the slice so we get back here in time, without adding an event to the savestate.
+	// This only moves where Advance() is called, it doesn't change when events run.
+	if (currentMIPS->downcount > cyclesUntilSample) {
+		CoreTiming::slicelength -= currentMIPS->downcount - (int)cyclesUntilSample;
+		currentMIPS->downcount = (int)cyclesUntilSample;
+	}
+}
+
+void Start(int intervalCycles) {
+	std::lock_guard<std::recursive_mutex> guard(profileLock);
+	interval = std::max(intervalCycles, 1000);
+	cyclesUntilSample = interval;
+	lastSampleTicks = CoreTiming::GetTicks();
+	lastSampleTime = time_now_d();
+	running = true;
+	CoreTiming::RegisterAdvanceCallback(&AdvanceCallback);
+	INFO_LOG(CPU, "Sampling profiler started, every %d cycles", interval);
+}
+
+void Stop() {
+	std::lock_guard<std::recursive_mutex> guard(profileLock);
+	if (running) {
+		CoreTiming::RegisterAdvanceCallback(NULL);
+		running = false;
+		INFO_LOG(CPU, "Sampling profiler stopped, %d samples", sampleCount);
+	}
+}
+
+void Reset() {
+	std::lock_guard<std::recursive_mutex> guard(profileLock);
+	stacks.clear();
+	sampleCount = 0;
+}
+
+bool IsRunning() {
+	return running;
+}
+
+u32 GetSampleCount() {
+	return sampleCount;
+}
+
+static bool CompareSelfCycles(const FunctionStats &a, const FunctionStats &b) {
+	return a.selfCycles > b.selfCycles;
+}
+
+std::vector<FunctionStats> GetFunctionStats() {
+	std::lock_guard<std::recursive_mutex> guard(profileLock);
+	std::map<u32, FunctionStats> functions;
+	for (auto it = stacks.begin(), end = stacks.end(); it != end; ++it) {
+		const Stack &stack = it->first;
+		const StackStats &stats = it->second;
+
+		// Recursion shouldn't count a function more than once per sample.
+		std::set<u32> seen;
+		for (size_t i = 0; i < stack.size(); ++i) {
+			FunctionStats &func = functions[stack[i]];
+			if (seen.insert(stack[i]).second) {
+				func.totalSamples += stats.samples;
+			}
+			if (i == stack.size() - 1) {
+				func.selfSamples += stats.samples;
+				func.selfCycles += stats.cycles;
+				func.selfSeconds += stats.seconds;
+			}
+		}
+	}
+
+	std::vector<FunctionStats> result;
+	result.reserve(functions.size());
+	for (auto it = functions.begin(), end = functions.end(); it != end; ++it) {
+		FunctionStats func = it->second;
+		func.entry = it->first;
+		func.name = FunctionName(it->first);
+		result.push_back(func);
+	}
+	std::sort(result.begin(), result.end(), CompareSelfCycles);
+	return result;
+}
+
+bool WriteFoldedStacks(const std::string &filename) {
+	FILE *f = File::OpenCFile(filename, "wb");
+	if (!f) {
+		ERROR_LOG(CPU, "Unable to write profile to %s", filename.c_str());
+		return false;
+	}
+
+	std::lock_guard<std::recursive_mutex> guard(profileLock);
+	std::map<u32, std::string> names;
+	for (auto it = stacks.begin(), end = stacks.end(); it != end; ++it) {
+		const Stack &stack = it->first;
+		std::string line;
+		for (size_t i = 0; i < stack.size(); ++i) {
+			auto name = names.find(stack[i]);
+			if (name == names.end()) {
+				name = names.insert(std::make_pair(stack[i], FunctionName(stack[i]))).first;
+			}
+			if (i != 0) {
+				line += ";";
+			}
+			line += name->second;
+		}
+		// Weight by cycles so functions that run while sampling is sparse still show right.
+		fprintf(f, "%s %lld\n", line.c_str(), (long long)it->second.cycles);
+	}
+
+	fclose(f);
+	INFO_LOG(CPU, "Wrote %d profiled stacks (%d samples) to %s", (int)stacks.size(), sampleCount, filename.c_str());
+	return true;
+}
+
+};
@@ -0,0 +1,52 @@
+// Copyright (c) 2012- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "Common/CommonTypes.h"
+
+// Periodically samples the guest PC (and a stack walk from it) while the emulator runs.
+// This is a debugging tool and not part of the emulated state, so it's not in savestates.
+namespace SamplingProfiler {
+	struct FunctionStats {
+		// Start of the function (as known by the symbol map or estimated by the stack walk.)
+		u32 entry;
+		std::string name;
+		// Samples where this function was at the top of the stack.
+		u32 selfSamples;
+		// Samples where this function was anywhere on the stack.
+		u32 totalSamples;
+		u64 selfCycles;
+		double selfSeconds;
+	};
+
+	// intervalCycles is how many emulated cycles to run between samples.
+	void Start(int intervalCycles);
+	void Stop();
+	void Reset();
+	bool IsRunning();
+
+	u32 GetSampleCount();
+	// Sorted by selfCycles, most expensive first.
+	std::vector<FunctionStats> GetFunctionStats();
+
+	// Writes "root;caller;callee count" lines, as expected by flamegraph.pl and similar tools.
+	bool WriteFoldedStacks(const std::string &filename);
+};
@@ -839,9 +839,12 @@ int PSPOskDialog::NativeKeyboard()
 			value = inputChars[i];
 		outText[i] = value;
 	}
+	Memory::MarkDirtyRange(oskParams->fields[0].outtext.ptr, (u32)(end * sizeof(u16_le)));
 
 	oskParams->base.result = 0;
 	oskParams->fields[0].result = PSP_UTILITY_OSK_RESULT_CHANGED;
+	Memory::MarkDirtyRange(oskParams.ptr, sizeof(SceUtilityOskParams));
+	Memory::MarkDirtyRange(oskParams->fields.ptr, sizeof(SceUtilityOskData));
 
 	return 0;
 }
@@ -1059,9 +1062,12 @@ int PSPOskDialog::Update(int animSpeed)
 			value = inputChars[i];
 		outText[i] = value;
 	}
+	Memory::MarkDirtyRange(oskParams->fields[0].outtext.ptr, (u32)(end * sizeof(u16_le)));
 
 	oskParams->base.result = 0;
 	oskParams->fields[0].result = PSP_UTILITY_OSK_RESULT_CHANGED;
+	Memory::MarkDirtyRange(oskParams.ptr, sizeof(SceUtilityOskParams));
+	Memory::MarkDirtyRange(oskParams->fields.ptr, sizeof(SceUtilityOskData));
 	lastButtons = buttons;
 	return 0;
 }
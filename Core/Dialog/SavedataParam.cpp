@@ -584,8 +584,10 @@ void SavedataParam::LoadDecryptedSave(SceUtilitySavedataParam *param, u8 *data,
 		}
 
 		if(DecryptSave(decryptMode, data_base, &saveSize, &align_len, ((param->key[0] != 0)?cryptKey:0)) == 0) {
-			if (param->dataBuf.IsValid())
+			if (param->dataBuf.IsValid()) {
 				memcpy(data, data_base, std::min((u32)saveSize, (u32)param->dataBufSize));
+				Memory::MarkDirtyRange(param->dataBuf.ptr, std::min((u32)saveSize, (u32)param->dataBufSize));
+			}
 			saveDone = true;
 		}
 		delete[] data_base;
@@ -593,8 +595,10 @@ void SavedataParam::LoadDecryptedSave(SceUtilitySavedataParam *param, u8 *data,
 }
 
 void SavedataParam::LoadNotCryptedSave(SceUtilitySavedataParam *param, u8 *data, u8 *saveData, int &saveSize) {
-	if (param->dataBuf.IsValid())
+	if (param->dataBuf.IsValid()) {
 		memcpy(data, saveData, std::min((u32)saveSize, (u32)param->dataBufSize));
+		Memory::MarkDirtyRange(param->dataBuf.ptr, std::min((u32)saveSize, (u32)param->dataBufSize));
+	}
 }
 
 void SavedataParam::LoadSFO(SceUtilitySavedataParam *param, const std::string dirPath) {
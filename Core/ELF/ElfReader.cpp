@@ -15,6 +15,8 @@
 // Official git repository and contact information can be found at
 // https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
 
+#include <vector>
+
 #include "Core/MemMap.h"
 #include "Core/Reporting.h"
 #include "../MIPS/MIPSTables.h"
@@ -55,6 +57,18 @@ bool ElfReader::LoadRelocations(Elf32_Rel *rels, int numRelocs)
 {
 	int numErrors = 0;
 	DEBUG_LOG(LOADER, "Loading %i relocations...", numRelocs);
+
+	// Each HI16 pairs with the next LO16 in the table.  Find them all in one pass backwards,
+	// rather than scanning forward from each HI16 (big modules have tens of thousands.)
+	std::vector<int> nextLo16(numRelocs);
+	int lastLo16 = -1;
+	for (int r = numRelocs - 1; r >= 0; r--)
+	{
+		nextLo16[r] = lastLo16;
+		if ((rels[r].r_info & 0xF) == R_MIPS_LO16)
+			lastLo16 = r;
+	}
+
 	for (int r = 0; r < numRelocs; r++)
 	{
 		// INFO_LOG(LOADER, "Loading reloc %i  (%p)...", r, rels + r);
@@ -125,24 +139,21 @@ bool ElfReader::LoadRelocations(Elf32_Rel *rels, int numRelocs)
 				u32 cur = (op & 0xFFFF) << 16;
 				u16 hi = 0;
 				bool found = false;
-				for (int t = r + 1; t<numRelocs; t++)
+				for (int t = nextLo16[r]; t != -1; t = nextLo16[t])
 				{
-					if ((rels[t].r_info & 0xF) == R_MIPS_LO16) 
-					{
-						u32 corrLoAddr = rels[t].r_offset + segmentVAddr[readwrite];
-						if (log) {
-							DEBUG_LOG(LOADER,"Corresponding lo found at %08x", corrLoAddr);
-						}
-						if (Memory::IsValidAddress(corrLoAddr)) {
-							s16 lo = (s32)(s16)(u16)(Memory::ReadUnchecked_U32(corrLoAddr) & 0xFFFF); //signed??
-							cur += lo;
-							cur += relocateTo;
-							addrToHiLo(cur, hi, lo);
-							found = true;
-							break;
-						} else {
-							ERROR_LOG(LOADER, "Bad corrLoAddr %08x", corrLoAddr);
-						}
+					u32 corrLoAddr = rels[t].r_offset + segmentVAddr[readwrite];
+					if (log) {
+						DEBUG_LOG(LOADER,"Corresponding lo found at %08x", corrLoAddr);
+					}
+					if (Memory::IsValidAddress(corrLoAddr)) {
+						s16 lo = (s32)(s16)(u16)(Memory::ReadUnchecked_U32(corrLoAddr) & 0xFFFF); //signed??
+						cur += lo;
+						cur += relocateTo;
+						addrToHiLo(cur, hi, lo);
+						found = true;
+						break;
+					} else {
+						ERROR_LOG(LOADER, "Bad corrLoAddr %08x", corrLoAddr);
 					}
 				}
 				if (!found) {
@@ -187,7 +198,8 @@ bool ElfReader::LoadRelocations(Elf32_Rel *rels, int numRelocs)
 			}
 			break;
 		}
-		Memory::Write_U32(op, addr);
+		// The address was validated above.  LoadInto() marks the whole image dirty once afterward.
+		*(u32_le *)Memory::GetPointerUnchecked(addr) = op;
 	}
 	if (numErrors) {
 		WARN_LOG(LOADER, "%i bad relocations found!!!", numErrors);
@@ -339,7 +351,11 @@ void ElfReader::LoadRelocations2(int rel_seg)
 				break;
 			}
 
-			Memory::Write_U32(op, rel_offset);
+			if (Memory::IsValidAddress(rel_offset)) {
+				*(u32_le *)Memory::GetPointerUnchecked(rel_offset) = op;
+			} else {
+				ERROR_LOG_REPORT(LOADER, "Rel2: bad relocation address %08x", rel_offset);
+			}
 			rcount += 1;
 		}
 	}
@@ -550,6 +566,9 @@ int ElfReader::LoadInto(u32 loadAddress)
 		}
 	}
 
+	// Segments and relocations were written straight to RAM, mark the image dirty in one go.
+	Memory::MarkDirtyRange(vaddr, totalSize);
+
 	return SCE_KERNEL_ERROR_OK;
 }
 
@@ -747,9 +747,29 @@ static int DecryptPRX2(const u8 *inbuf, u8 *outbuf, u32 size, u32 tag)
 	return retsize;
 }
 
+static recursive_mutex kirkLock;
+static bool kirkInitialized = false;
+
+recursive_mutex &GetKirkLock()
+{
+	return kirkLock;
+}
+
+void pspDecryptPRXInit()
+{
+	// Decrypting doesn't use kirk's PRNG, so once is enough.
+	lock_guard guard(kirkLock);
+	if (!kirkInitialized)
+	{
+		kirk_init();
+		kirkInitialized = true;
+	}
+}
+
 int pspDecryptPRX(const u8 *inbuf, u8 *outbuf, u32 size)
 {
-	kirk_init();
+	lock_guard guard(kirkLock);
+	pspDecryptPRXInit();
 	int retsize = DecryptPRX1(inbuf, outbuf, size, (u32)*(u32_le *)&inbuf[0xD0]);
 	if (retsize == MISSING_KEY)
 	{
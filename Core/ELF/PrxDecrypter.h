@@ -17,6 +17,7 @@
 
 #pragma once
 
+#include "native/base/mutex.h"
 #include "Common/Common.h"
 #include "Common/CommonTypes.h"
 
@@ -66,5 +67,11 @@ typedef struct
 #pragma pack(pop)
 #endif
 
+// Call before decrypting on other threads.
+void pspDecryptPRXInit();
 int pspDecryptPRX(const u8 *inbuf, u8 *outbuf, u32 size);
 
+// libkirk and amctrl keep their PRNG, ECDSA curve and scratch buffers in globals, and modules
+// are decrypted on the prefetch threads too.  Hold this around any call into them.
+recursive_mutex &GetKirkLock();
+
@@ -18,6 +18,7 @@
 
 #include "Common/FileUtil.h"
 #include "Core/FileSystems/BlockDevices.h"
+#include "Core/ELF/PrxDecrypter.h"
 #include <cstdio>
 #include <cstring>
 
@@ -237,6 +238,7 @@ NPDRMDemoBlockDevice::NPDRMDemoBlockDevice(FILE *file)
 		ERROR_LOG(LOADER, "Invalid NPUMDIMG header!");
 	}
 
+	lock_guard kirkGuard(GetKirkLock());
 	kirk_init();
 
 	// getkey
@@ -343,6 +345,7 @@ bool NPDRMDemoBlockDevice::ReadBlock(int blockNumber, u8 *outPtr)
 	}
 
 	if((table[block].flag&4)==0){
+		lock_guard kirkGuard(GetKirkLock());
 		sceDrmBBCipherInit(&ckey, 1, 2, hkey, vkey, table[block].offset>>4);
 		sceDrmBBCipherUpdate(&ckey, readBuf, table[block].size);
 		sceDrmBBCipherFinal(&ckey);
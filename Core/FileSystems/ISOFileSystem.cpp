@@ -25,6 +25,7 @@
 #include "Core/FileSystems/ISOFileSystem.h"
 #include "Core/HLE/sceKernel.h"
 #include "Core/MemMap.h"
+#include "Core/MemSnapshot.h"
 #include "Core/Reporting.h"
 
 
@@ -212,6 +213,7 @@ ISOFileSystem::ISOFileSystem(IHandleAllocator *_hAlloc, BlockDevice *_blockDevic
 	u32 rootSize = desc.root.dataLength();
 
 	ReadDirectory(rootSector, rootSize, treeroot, 0);
+	IndexDirectory(treeroot, "");
 }
 
 ISOFileSystem::~ISOFileSystem()
@@ -297,6 +299,28 @@ void ISOFileSystem::ReadDirectory(u32 startsector, u32 dirsize, TreeEntry *root,
 	}
 }
 
+static std::string LowerCase(const std::string &str)
+{
+	std::string lower = str;
+	for (size_t i = 0; i < lower.size(); ++i)
+		lower[i] = tolower(lower[i]);
+	return lower;
+}
+
+void ISOFileSystem::IndexDirectory(TreeEntry *dir, const std::string &prefix)
+{
+	for (size_t i = 0; i < dir->children.size(); ++i)
+	{
+		TreeEntry *e = dir->children[i];
+		const std::string path = prefix + LowerCase(e->name);
+		// Names only differing in case are possible.  Lookups always found the first one, keep it that way.
+		if (!pathIndex.insert(std::make_pair(path, e)).second)
+			continue;
+		if (!e->children.empty())
+			IndexDirectory(e, path + "/");
+	}
+}
+
 ISOFileSystem::TreeEntry *ISOFileSystem::GetFromPath(std::string path, bool catchError)
 {
 	if (path.length() == 0)
@@ -314,56 +338,51 @@ ISOFileSystem::TreeEntry *ISOFileSystem::GetFromPath(std::string path, bool catc
 	if (path == "umd0")
 		return &entireISO;
 
-	TreeEntry *e = treeroot;
 	if (path.length() == 0)
-		return e;
-
+		return treeroot;
+
+	// Normalize to the index's form: lowercase, and runs of slashes between names collapsed.
+	// Like the old per-level search, an empty first name or more than one trailing slash doesn't match.
+	std::string key;
+	key.reserve(path.length());
+	size_t pos = 0;
+	bool valid = true;
 	while (true)
 	{
-		TreeEntry *ne = 0;
-		std::string name = "";
-		if (path.length()>0)
-		{
-			for (size_t i=0; i<e->children.size(); i++)
-			{
-				std::string n = (e->children[i]->name);
-				for (size_t j = 0; j < n.size(); j++) {
-					n[j] = tolower(n[j]);
-				}
-				std::string curPath = path.substr(0, path.find_first_of('/'));
-				for (size_t j = 0; j < curPath.size(); j++) {
-					curPath[j] = tolower(curPath[j]);
-				}
-
-				if (curPath == n)
-				{
-					//yay we got it
-					ne = e->children[i];
-					name = n;
-					break;
-				}
-			}
-		}
-		if (ne)
+		size_t end = path.find('/', pos);
+		if (end == path.npos)
+			end = path.length();
+		if (end == pos)
 		{
-			e = ne;
-			size_t l = name.length();
-			path.erase(0, l);
-			if (path.length() == 0 || (path.length()==1 && path[0] == '/'))
-				return e;
-			path.erase(0, 1);
-			while (path[0] == '/')
-				path.erase(0, 1);
+			valid = false;
+			break;
 		}
-		else
+		for (size_t i = pos; i < end; ++i)
+			key.push_back(tolower(path[i]));
+
+		if (end == path.length() || end + 1 == path.length())
+			break;
+		pos = path.find_first_not_of('/', end);
+		if (pos == path.npos)
 		{
-			if (catchError)
-			{
-				ERROR_LOG(FILESYS,"File %s not found", path.c_str());
-			}
-			return 0;
+			valid = false;
+			break;
 		}
+		key.push_back('/');
+	}
+
+	if (valid)
+	{
+		auto found = pathIndex.find(key);
+		if (found != pathIndex.end())
+			return found->second;
+	}
+
+	if (catchError)
+	{
+		ERROR_LOG(FILESYS,"File %s not found", path.c_str());
 	}
+	return 0;
 }
 
 u32 ISOFileSystem::OpenFile(std::string filename, FileAccess access, const char *devicename)
@@ -479,7 +498,10 @@ int ISOFileSystem::Ioctl(u32 handle, u32 cmd, u32 indataPtr, u32 inlen, u32 outd
 		}
 
 		INFO_LOG(SCEIO, "sceIoIoctl: reading ISO9660 volume descriptor read");
-		blockDevice->ReadBlock(16, Memory::GetPointer(outdataPtr));
+		{
+			Memory::HostWriteGuard writeGuard(Memory::GetPointer(outdataPtr), 0x800);
+			blockDevice->ReadBlock(16, Memory::GetPointer(outdataPtr));
+		}
 		return 0;
 
 	// Get ISO9660 path table (from open ISO9660 file.)
@@ -678,6 +700,11 @@ std::vector<PSPFileInfo> ISOFileSystem::GetDirListing(std::string path)
 		return myVector;
 	}
 
+	auto cached = dirListingCache.find(entry);
+	if (cached != dirListingCache.end())
+		return cached->second;
+
+	myVector.reserve(entry->children.size());
 	for (size_t i=0; i<entry->children.size(); i++)
 	{
 		TreeEntry *e = entry->children[i];
@@ -694,6 +721,7 @@ std::vector<PSPFileInfo> ISOFileSystem::GetDirListing(std::string path)
 		x.startSector = e->startingPosition/2048;
 		myVector.push_back(x);
 	}
+	dirListingCache[entry] = myVector;
 	return myVector;
 }
 
@@ -19,6 +19,7 @@
 
 #include <map>
 #include <list>
+#include <unordered_map>
 
 #include "FileSystem.h"
 
@@ -92,7 +93,13 @@ private:
 	// Don't use this in the emu, not savestated.
 	std::vector<std::string> restrictTree;
 
+	// Lowercased paths ("dir/file.bin", no leading slash) of every entry, built once at mount.
+	std::unordered_map<std::string, TreeEntry *> pathIndex;
+	// The disc never changes, so listings are built on first use and kept.
+	std::map<const TreeEntry *, std::vector<PSPFileInfo> > dirListingCache;
+
 	void ReadDirectory(u32 startsector, u32 dirsize, TreeEntry *root, size_t level);
+	void IndexDirectory(TreeEntry *dir, const std::string &prefix);
 	TreeEntry *GetFromPath(std::string path, bool catchError=true);
 	std::string EntryFullPath(TreeEntry *e);
 };
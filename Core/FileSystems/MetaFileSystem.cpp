@@ -22,6 +22,7 @@
 #include "Common/StringUtils.h"
 #include "Core/FileSystems/MetaFileSystem.h"
 #include "Core/HLE/sceKernelThread.h"
+#include "Core/MemSnapshot.h"
 #include "Core/Reporting.h"
 
 static bool ApplyPathStringToComponentsVector(std::vector<std::string> &vector, const std::string &pathString)
@@ -239,6 +240,12 @@ bool MetaFileSystem::MapFilePath(const std::string &_inpath, std::string &outpat
 	return false;
 }
 
+recursive_mutex &MetaFileSystem::SystemLock(IFileSystem *system)
+{
+	lock_guard guard(lock);
+	return systemLocks[system];
+}
+
 void MetaFileSystem::Mount(std::string prefix, IFileSystem *system)
 {
 	lock_guard guard(lock);
@@ -255,6 +262,23 @@ void MetaFileSystem::Unmount(std::string prefix, IFileSystem *system)
 	x.prefix = prefix;
 	x.system = system;
 	fileSystems.erase(std::remove(fileSystems.begin(), fileSystems.end(), x), fileSystems.end());
+
+	auto systemLock = systemLocks.find(system);
+	if (systemLock == systemLocks.end()) {
+		return;
+	}
+
+	// Let any read or write still running on it finish.  New ones can't start while we hold lock.
+	{
+		lock_guard systemGuard(systemLock->second);
+	}
+
+	for (size_t i = 0; i < fileSystems.size(); i++) {
+		if (fileSystems[i].system == system) {
+			return;
+		}
+	}
+	systemLocks.erase(systemLock);
 }
 
 void MetaFileSystem::Remount(IFileSystem *oldSystem, IFileSystem *newSystem) {
@@ -287,10 +311,13 @@ void MetaFileSystem::Shutdown()
 
 	for (auto iter = toDelete.begin(); iter != toDelete.end(); ++iter)
 	{
+		// Let any read still running on it finish first.
+		lock_guard systemGuard(SystemLock(*iter));
 		delete *iter;
 	}
 
 	fileSystems.clear();
+	systemLocks.clear();
 	currentDir.clear();
 	startingDirectory = "";
 }
@@ -311,6 +338,7 @@ u32 MetaFileSystem::OpenFile(std::string filename, FileAccess access, const char
 	MountPoint *mount;
 	if (MapFilePath(filename, of, &mount))
 	{
+		lock_guard systemGuard(SystemLock(mount->system));
 		return mount->system->OpenFile(of, access, mount->prefix.c_str());
 	}
 	else
@@ -326,6 +354,7 @@ PSPFileInfo MetaFileSystem::GetFileInfo(std::string filename)
 	IFileSystem *system;
 	if (MapFilePath(filename, of, &system))
 	{
+		lock_guard systemGuard(SystemLock(system));
 		return system->GetFileInfo(of);
 	}
 	else
@@ -341,6 +370,7 @@ bool MetaFileSystem::GetHostPath(const std::string &inpath, std::string &outpath
 	std::string of;
 	IFileSystem *system;
 	if (MapFilePath(inpath, of, &system)) {
+		lock_guard systemGuard(SystemLock(system));
 		return system->GetHostPath(of, outpath);
 	} else {
 		return false;
@@ -354,6 +384,7 @@ std::vector<PSPFileInfo> MetaFileSystem::GetDirListing(std::string path)
 	IFileSystem *system;
 	if (MapFilePath(path, of, &system))
 	{
+		lock_guard systemGuard(SystemLock(system));
 		return system->GetDirListing(of);
 	}
 	else
@@ -411,6 +442,7 @@ bool MetaFileSystem::MkDir(const std::string &dirname)
 	IFileSystem *system;
 	if (MapFilePath(dirname, of, &system))
 	{
+		lock_guard systemGuard(SystemLock(system));
 		return system->MkDir(of);
 	}
 	else
@@ -426,6 +458,7 @@ bool MetaFileSystem::RmDir(const std::string &dirname)
 	IFileSystem *system;
 	if (MapFilePath(dirname, of, &system))
 	{
+		lock_guard systemGuard(SystemLock(system));
 		return system->RmDir(of);
 	}
 	else
@@ -458,6 +491,7 @@ int MetaFileSystem::RenameFile(const std::string &from, const std::string &to)
 		if (osystem != rsystem)
 			return SCE_KERNEL_ERROR_XDEV;
 
+		lock_guard systemGuard(SystemLock(osystem));
 		return osystem->RenameFile(of, rf);
 	}
 	else
@@ -473,6 +507,7 @@ bool MetaFileSystem::RemoveFile(const std::string &filename)
 	IFileSystem *system;
 	if (MapFilePath(filename, of, &system))
 	{
+		lock_guard systemGuard(SystemLock(system));
 		return system->RemoveFile(of);
 	}
 	else
@@ -485,8 +520,10 @@ int MetaFileSystem::Ioctl(u32 handle, u32 cmd, u32 indataPtr, u32 inlen, u32 out
 {
 	lock_guard guard(lock);
 	IFileSystem *sys = GetHandleOwner(handle);
-	if (sys)
+	if (sys) {
+		lock_guard systemGuard(SystemLock(sys));
 		return sys->Ioctl(handle, cmd, indataPtr, inlen, outdataPtr, outlen, usec);
+	}
 	return SCE_KERNEL_ERROR_ERROR;
 }
 
@@ -494,8 +531,10 @@ int MetaFileSystem::DevType(u32 handle)
 {
 	lock_guard guard(lock);
 	IFileSystem *sys = GetHandleOwner(handle);
-	if (sys)
+	if (sys) {
+		lock_guard systemGuard(SystemLock(sys));
 		return sys->DevType(handle);
+	}
 	return SCE_KERNEL_ERROR_ERROR;
 }
 
@@ -503,38 +542,54 @@ void MetaFileSystem::CloseFile(u32 handle)
 {
 	lock_guard guard(lock);
 	IFileSystem *sys = GetHandleOwner(handle);
-	if (sys)
+	if (sys) {
+		lock_guard systemGuard(SystemLock(sys));
 		sys->CloseFile(handle);
+	}
 }
 
 size_t MetaFileSystem::ReadFile(u32 handle, u8 *pointer, s64 size)
 {
-	lock_guard guard(lock);
+	// Not a lock_guard: the device lock is taken before this one is released.
+	lock.lock();
 	IFileSystem *sys = GetHandleOwner(handle);
-	if (sys)
-		return sys->ReadFile(handle,pointer,size);
-	else
+	if (!sys) {
+		lock.unlock();
 		return 0;
+	}
+	lock_guard systemGuard(SystemLock(sys));
+	lock.unlock();
+
+	// Filesystems often read() straight into emulated memory.
+	Memory::HostWriteGuard writeGuard(pointer, size > 0 ? (size_t)size : 0);
+	return sys->ReadFile(handle, pointer, size);
 }
 
 size_t MetaFileSystem::WriteFile(u32 handle, const u8 *pointer, s64 size)
 {
-	lock_guard guard(lock);
+	// Not a lock_guard: the device lock is taken before this one is released.
+	lock.lock();
 	IFileSystem *sys = GetHandleOwner(handle);
-	if (sys)
-		return sys->WriteFile(handle,pointer,size);
-	else
+	if (!sys) {
+		lock.unlock();
 		return 0;
+	}
+	lock_guard systemGuard(SystemLock(sys));
+	lock.unlock();
+
+	return sys->WriteFile(handle, pointer, size);
 }
 
 size_t MetaFileSystem::SeekFile(u32 handle, s32 position, FileMove type)
 {
 	lock_guard guard(lock);
 	IFileSystem *sys = GetHandleOwner(handle);
-	if (sys)
+	if (sys) {
+		lock_guard systemGuard(SystemLock(sys));
 		return sys->SeekFile(handle,position,type);
-	else
+	} else {
 		return 0;
+	}
 }
 
 int MetaFileSystem::ReadEntireFile(const std::string &filename, std::vector<u8> &data) {
@@ -583,6 +638,7 @@ void MetaFileSystem::DoState(PointerWrap &p)
 
 	for (u32 i = 0; i < n; ++i) {
 		if (!skipPfat0 || fileSystems[i].prefix != "pfat0:") {
+			lock_guard systemGuard(SystemLock(fileSystems[i].system));
 			fileSystems[i].system->DoState(p);
 		}
 	}
@@ -17,6 +17,8 @@
 
 #pragma once
 
+#include <map>
+
 #include "native/base/mutex.h"
 #include "Core/FileSystems/FileSystem.h"
 
@@ -42,6 +44,11 @@ private:
 	std::string startingDirectory;
 	int lastOpenError;
 	recursive_mutex lock;
+	// One per mounted file system, always taken after lock.  Reads and writes only hold this one
+	// while they run, so the IO workers can read from the UMD and the memory stick at once.
+	std::map<IFileSystem *, recursive_mutex> systemLocks;
+
+	recursive_mutex &SystemLock(IFileSystem *system);
 
 public:
 	MetaFileSystem()
@@ -20,6 +20,8 @@
 // Thanks to the JPCSP project! This sceFont implementation is basically a C++ take on JPCSP's font code.
 // Some parts, especially in this file, were simply copied, so I guess this really makes this file GPL3.
 
+#include <algorithm>
+
 #include "Core/MemMap.h"
 #include "Core/Reporting.h"
 #include "Core/Font/PGF.h"
@@ -71,8 +73,13 @@ static std::vector<int> getTable(const u8 *buf, int bpe, size_t length) {
 	return vec;
 }
 
+// Glyphs not drawn in the last this many draws get decoded again next time.
+static const u32 GLYPH_CACHE_MAX_AGE = 512;
+
+static const u8 fontPixelSizeInBytes[] = { 0, 0, 1, 3, 4 }; // 0 means 2 pixels per byte
+
 PGF::PGF()
-	: fontData(0) {
+	: fontData(0), glyphCacheTick(0) {
 
 }
 
@@ -129,6 +136,10 @@ void PGF::DoState(PointerWrap &p) {
 	p.Do(header);
 	p.Do(rev3extra);
 
+	if (p.mode == p.MODE_READ) {
+		ClearGlyphCache();
+	}
+
 	// Don't savestate size_t directly, 32-bit and 64-bit are different.
 	u32 fontDataSizeTemp = (u32)fontDataSize;
 	p.Do(fontDataSizeTemp);
@@ -178,6 +189,7 @@ void PGF::ReadPtr(const u8 *ptr, size_t dataSize) {
 	const u8 *const startPtr = ptr;
 
 	INFO_LOG(SCEFONT, "Reading %d bytes of PGF header", (int)sizeof(header));
+	ClearGlyphCache();
 	memcpy(&header, ptr, sizeof(header));
 	ptr += sizeof(header);
 
@@ -516,25 +528,85 @@ bool PGF::GetCharGlyph(int charCode, int glyphType, Glyph &glyph) {
 	return true;
 }
 
-void PGF::DrawCharacter(const GlyphImage *image, int clipX, int clipY, int clipWidth, int clipHeight, int charCode, int altCharCode, int glyphType) {
-	Glyph glyph;
+bool PGF::GetDrawableGlyph(int charCode, int altCharCode, int glyphType, Glyph &glyph) {
 	if (!GetCharGlyph(charCode, glyphType, glyph)) {
 		// No Glyph available for this charCode, try to use the alternate char.
 		charCode = altCharCode;
 		if (!GetCharGlyph(charCode, glyphType, glyph)) {
-			return;
+			return false;
 		}
 	}
 
 	if (glyph.w <= 0 || glyph.h <= 0) {
-		return;
+		return false;
 	}
 
 	if (((glyph.flags & FONT_PGF_BMP_OVERLAY) != FONT_PGF_BMP_H_ROWS) &&
 		((glyph.flags & FONT_PGF_BMP_OVERLAY) != FONT_PGF_BMP_V_ROWS)) {
-			return;
+			return false;
+	}
+
+	return true;
+}
+
+void PGF::DrawCharacter(const GlyphImage *image, int clipX, int clipY, int clipWidth, int clipHeight, int charCode, int altCharCode, int glyphType) {
+	Glyph glyph;
+	if (!GetDrawableGlyph(charCode, altCharCode, glyphType, glyph)) {
+		return;
+	}
+
+	const FontPixelFormat pixelformat = (FontPixelFormat)(u32)image->pixelFormat;
+	if ((u32)pixelformat >= ARRAY_SIZE(fontPixelSizeInBytes)) {
+		ERROR_LOG_REPORT(SCEFONT, "Unhandled font pixel format: %d", (u32)image->pixelFormat);
+		return;
+	}
+
+	const DecodedGlyph &decoded = GetDecodedGlyph(glyph);
+	if (!decoded.complete) {
+		// Pixels past the end of the data are left alone, so draw only the ones there are.
+		DrawGlyphPixels(image, clipX, clipY, clipWidth, clipHeight, glyph);
+		gpu->InvalidateCache(image->bufferPtr, image->bytesPerLine * image->bufHeight, GPU_INVALIDATE_SAFE);
+		return;
+	}
+
+	int x = image->xPos64 >> 6;
+	int y = image->yPos64 >> 6;
+
+	// Clip to the rect, the buffer, and the line width all at once, so rows can be drawn without checks.
+	const int bpl = image->bytesPerLine;
+	const int pixelBytes = fontPixelSizeInBytes[pixelformat];
+	const int bufMaxWidth = pixelBytes == 0 ? bpl * 2 : bpl / pixelBytes;
+	const int minX = std::max(std::max(x, clipX), 0);
+	const int maxX = std::min(std::min(x + glyph.w, clipX + clipWidth), std::min((int)image->bufWidth, bufMaxWidth));
+	const int minY = std::max(std::max(y, clipY), 0);
+	const int maxY = std::min(std::min(y + glyph.h, clipY + clipHeight), (int)image->bufHeight);
+
+	if (minX < maxX) {
+		for (int pixelY = minY; pixelY < maxY; ++pixelY) {
+			const u8 *alpha = &decoded.alpha[(pixelY - y) * glyph.w + (minX - x)];
+			DrawGlyphRow(image->bufferPtr + pixelY * bpl, bpl, minX, maxX - minX, alpha, pixelformat);
+		}
 	}
 
+	gpu->InvalidateCache(image->bufferPtr, image->bytesPerLine * image->bufHeight, GPU_INVALIDATE_SAFE);
+}
+
+void PGF::DrawCharacterPerPixel(const GlyphImage *image, int clipX, int clipY, int clipWidth, int clipHeight, int charCode, int altCharCode, int glyphType) {
+	Glyph glyph;
+	if (!GetDrawableGlyph(charCode, altCharCode, glyphType, glyph)) {
+		return;
+	}
+
+	if ((u32)image->pixelFormat >= ARRAY_SIZE(fontPixelSizeInBytes)) {
+		ERROR_LOG_REPORT(SCEFONT, "Unhandled font pixel format: %d", (u32)image->pixelFormat);
+		return;
+	}
+
+	DrawGlyphPixels(image, clipX, clipY, clipWidth, clipHeight, glyph);
+	gpu->InvalidateCache(image->bufferPtr, image->bytesPerLine * image->bufHeight, GPU_INVALIDATE_SAFE);
+}
+
+void PGF::DrawGlyphPixels(const GlyphImage *image, int clipX, int clipY, int clipWidth, int clipHeight, const Glyph &glyph) {
 	size_t bitPtr = glyph.ptr * 8;
 	int numberPixels = glyph.w * glyph.h;
 	int pixelIndex = 0;
@@ -575,29 +647,11 @@ void PGF::DrawCharacter(const GlyphImage *image, int clipX, int clipY, int clipW
 			if (pixelX >= clipX && pixelX < clipX + clipWidth && pixelY >= clipY && pixelY < clipY + clipHeight) {
 				// 4-bit color value
 				int pixelColor = value;
-				switch ((FontPixelFormat)(u32)image->pixelFormat) {
-				case PSP_FONT_PIXELFORMAT_8:
-					// 8-bit color value
-					pixelColor |= pixelColor << 4;
-					break;
-				case PSP_FONT_PIXELFORMAT_24:
-					// 24-bit color value
-					pixelColor |= pixelColor << 4;
-					pixelColor |= pixelColor << 8;
-					pixelColor |= pixelColor << 8;
-					break;
-				case PSP_FONT_PIXELFORMAT_32:
-					// 32-bit color value
+				if (image->pixelFormat != PSP_FONT_PIXELFORMAT_4 && image->pixelFormat != PSP_FONT_PIXELFORMAT_4_REV) {
+					// All the wider formats are just the alpha repeated in every byte.
 					pixelColor |= pixelColor << 4;
 					pixelColor |= pixelColor << 8;
 					pixelColor |= pixelColor << 16;
-					break;
-				case PSP_FONT_PIXELFORMAT_4:
-				case PSP_FONT_PIXELFORMAT_4_REV:
-					break;
-				default:
-					ERROR_LOG_REPORT(SCEFONT, "Unhandled font pixel format: %d", (u32)image->pixelFormat);
-					break;
 				}
 
 				SetFontPixel(image->bufferPtr, image->bytesPerLine, image->bufWidth, image->bufHeight, pixelX, pixelY, pixelColor, image->pixelFormat);
@@ -606,8 +660,136 @@ void PGF::DrawCharacter(const GlyphImage *image, int clipX, int clipY, int clipW
 			pixelIndex++;
 		}
 	}
+}
 
-	gpu->InvalidateCache(image->bufferPtr, image->bytesPerLine * image->bufHeight, GPU_INVALIDATE_SAFE);
+void PGF::ClearGlyphCache() {
+	glyphCache.clear();
+}
+
+const PGF::DecodedGlyph &PGF::GetDecodedGlyph(const Glyph &glyph) {
+	++glyphCacheTick;
+
+	auto it = glyphCache.find(glyph.ptr);
+	if (it == glyphCache.end()) {
+		if (glyphCache.size() >= GLYPH_CACHE_MAX_AGE) {
+			DecimateGlyphCache();
+		}
+		it = glyphCache.insert(std::make_pair(glyph.ptr, DecodedGlyph())).first;
+		DecodeGlyph(glyph, it->second);
+	}
+
+	it->second.lastUsed = glyphCacheTick;
+	return it->second;
+}
+
+void PGF::DecimateGlyphCache() {
+	for (auto it = glyphCache.begin(); it != glyphCache.end(); ) {
+		if (glyphCacheTick - it->second.lastUsed >= GLYPH_CACHE_MAX_AGE / 2) {
+			glyphCache.erase(it++);
+		} else {
+			++it;
+		}
+	}
+}
+
+void PGF::DecodeGlyph(const Glyph &glyph, DecodedGlyph &decoded) const {
+	size_t bitPtr = glyph.ptr * 8;
+	int numberPixels = glyph.w * glyph.h;
+	int pixelIndex = 0;
+
+	decoded.alpha.clear();
+	decoded.alpha.resize(numberPixels, 0);
+
+	const bool hRows = (glyph.flags & FONT_PGF_BMP_OVERLAY) == FONT_PGF_BMP_H_ROWS;
+	while (pixelIndex < numberPixels && bitPtr + 8 < fontDataSize * 8) {
+		// This is some kind of nibble based RLE compression.
+		int nibble = consumeBits(4, fontData, bitPtr);
+
+		int count;
+		int value = 0;
+		if (nibble < 8) {
+			value = consumeBits(4, fontData, bitPtr);
+			count = nibble + 1;
+		} else {
+			count = 16 - nibble;
+		}
+
+		for (int i = 0; i < count && pixelIndex < numberPixels; i++) {
+			if (nibble >= 8) {
+				value = consumeBits(4, fontData, bitPtr);
+			}
+
+			if (hRows) {
+				decoded.alpha[pixelIndex] = (u8)value;
+			} else {
+				int xx = pixelIndex / glyph.h;
+				int yy = pixelIndex % glyph.h;
+				decoded.alpha[yy * glyph.w + xx] = (u8)value;
+			}
+
+			pixelIndex++;
+		}
+	}
+	decoded.complete = pixelIndex == numberPixels;
+}
+
+void PGF::DrawGlyphRow(u32 rowAddr, int bpl, int x, int count, const u8 *alpha, FontPixelFormat pixelformat) {
+	const int pixelBytes = fontPixelSizeInBytes[pixelformat];
+	const u32 firstAddr = rowAddr + (pixelBytes == 0 ? x / 2 : x * pixelBytes);
+	const u32 lastAddr = rowAddr + (pixelBytes == 0 ? (x + count - 1) / 2 : (x + count) * pixelBytes - 1);
+
+	if (!Memory::IsValidAddress(firstAddr) || !Memory::IsValidAddress(lastAddr)) {
+		// Go the slow way, which will report the bad address.
+		for (int i = 0; i < count; ++i) {
+			int pixelColor = alpha[i];
+			if (pixelformat != PSP_FONT_PIXELFORMAT_4 && pixelformat != PSP_FONT_PIXELFORMAT_4_REV) {
+				// All the wider formats are just the alpha repeated in every byte.
+				pixelColor |= pixelColor << 4;
+				pixelColor |= pixelColor << 8;
+				pixelColor |= pixelColor << 16;
+			}
+			SetFontPixel(rowAddr, bpl, x + count, 1, x + i, 0, pixelColor, pixelformat);
+		}
+		return;
+	}
+
+	u8 *dst = Memory::GetPointerUnchecked(firstAddr);
+	switch (pixelformat) {
+	case PSP_FONT_PIXELFORMAT_4:
+	case PSP_FONT_PIXELFORMAT_4_REV:
+		for (int i = 0; i < count; ++i) {
+			const int pixelX = x + i;
+			u8 &pair = dst[pixelX / 2 - x / 2];
+			if ((pixelX & 1) != pixelformat) {
+				pair = (alpha[i] << 4) | (pair & 0x0F);
+			} else {
+				pair = (pair & 0xF0) | alpha[i];
+			}
+		}
+		break;
+
+	case PSP_FONT_PIXELFORMAT_8:
+		for (int i = 0; i < count; ++i) {
+			dst[i] = alpha[i] | (alpha[i] << 4);
+		}
+		break;
+
+	case PSP_FONT_PIXELFORMAT_24:
+		for (int i = 0; i < count; ++i) {
+			const u8 value = alpha[i] | (alpha[i] << 4);
+			dst[i * 3 + 0] = value;
+			dst[i * 3 + 1] = value;
+			dst[i * 3 + 2] = value;
+		}
+		break;
+
+	case PSP_FONT_PIXELFORMAT_32:
+		for (int i = 0; i < count; ++i) {
+			memset(dst + i * 4, alpha[i] | (alpha[i] << 4), 4);
+		}
+		break;
+	}
+	Memory::MarkDirtyRange(firstAddr, lastAddr - firstAddr + 1);
 }
 
 void PGF::SetFontPixel(u32 base, int bpl, int bufWidth, int bufHeight, int x, int y, int pixelColor, int pixelformat) {
@@ -615,7 +797,6 @@ void PGF::SetFontPixel(u32 base, int bpl, int bufWidth, int bufHeight, int x, in
 		return;
 	}
 
-	static const u8 fontPixelSizeInBytes[] = { 0, 0, 1, 3, 4 }; // 0 means 2 pixels per byte
 	int pixelBytes = fontPixelSizeInBytes[pixelformat];
 	int bufMaxWidth = (pixelBytes == 0 ? bpl * 2 : bpl / pixelBytes);
 	if (x >= bufMaxWidth) {
@@ -19,6 +19,7 @@
 
 #pragma once
 
+#include <map>
 #include <string>
 #include <vector>
 
@@ -267,6 +268,11 @@ public:
 	bool GetCharInfo(int charCode, PGFCharInfo *ci, int altCharCode);
 	void GetFontInfo(PGFFontInfo *fi);
 	void DrawCharacter(const GlyphImage *image, int clipX, int clipY, int clipWidth, int clipHeight, int charCode, int altCharCode, int glyphType);
+	// Same, but decodes and writes one pixel at a time, without the glyph cache.  Much slower.
+	void DrawCharacterPerPixel(const GlyphImage *image, int clipX, int clipY, int clipWidth, int clipHeight, int charCode, int altCharCode, int glyphType);
+
+	// Forgets all decoded glyph bitmaps.  They'll be decoded again as they're drawn.
+	void ClearGlyphCache();
 
 	void DoState(PointerWrap &p);
 
@@ -275,12 +281,27 @@ public:
 private:
 	bool GetGlyph(const u8 *fontdata, size_t charPtr, int glyphType, Glyph &glyph);
 	bool GetCharGlyph(int charCode, int glyphType, Glyph &glyph);
+	bool GetDrawableGlyph(int charCode, int altCharCode, int glyphType, Glyph &glyph);
 
 	// Unused
 	int GetCharIndex(int charCode, const std::vector<int> &charmapCompressed);
 
 	void SetFontPixel(u32 base, int bpl, int bufWidth, int bufHeight, int x, int y, int pixelColor, int pixelformat);
 
+	struct DecodedGlyph {
+		u32 lastUsed;
+		// One 4-bit alpha value per byte, always row by row (even for FONT_PGF_BMP_V_ROWS.)
+		std::vector<u8> alpha;
+		// False if the data ran out before every pixel was decoded (broken font?)
+		bool complete;
+	};
+
+	const DecodedGlyph &GetDecodedGlyph(const Glyph &glyph);
+	void DecodeGlyph(const Glyph &glyph, DecodedGlyph &decoded) const;
+	void DecimateGlyphCache();
+	void DrawGlyphRow(u32 rowAddr, int bpl, int x, int count, const u8 *alpha, FontPixelFormat pixelformat);
+	void DrawGlyphPixels(const GlyphImage *image, int clipX, int clipY, int clipWidth, int clipHeight, const Glyph &glyph);
+
 	PGFHeaderRev3Extra rev3extra;
 
 	// Font character image data
@@ -304,4 +325,9 @@ private:
 	std::vector<Glyph> glyphs;
 	std::vector<Glyph> shadowGlyphs;
 	int firstGlyph;
+
+	// Decoded bitmaps keyed by glyph.ptr, which is unique per glyph (including shadows.)
+	// Not saved in states, since it's all derived from fontData.
+	std::map<u32, DecodedGlyph> glyphCache;
+	u32 glyphCacheTick;
 };
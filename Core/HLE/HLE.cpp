@@ -18,6 +18,7 @@
 #include <map>
 #include <vector>
 #include <string>
+#include <cstring>
 
 #include "base/timeutil.h"
 
@@ -40,6 +41,14 @@
 #include "Core/HLE/sceKernelInterrupt.h"
 #include "Core/HLE/HLE.h"
 
+#if defined(_M_IX86) || defined(_M_X64)
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#endif
+
 enum
 {
 	// Do nothing after the syscall.
@@ -68,6 +77,44 @@ static int delayedResultEvent = -1;
 static int hleAfterSyscall = HLE_AFTER_NOTHING;
 static const char *hleAfterSyscallReschedReason;
 
+struct SyscallStat {
+	u64 ticks;
+	u64 calls;
+};
+
+// Syscalls are numbered flat, in module order, so stats can live in an array.
+// These are sized once in HLEInit(), after all modules are registered.
+static std::vector<int> moduleSyscallBase;
+static std::vector<const HLEFunction *> syscallInfos;
+static std::vector<SyscallStat> syscallStats;
+static u64 slowestSyscallTicks;
+static int slowestSyscallIndex;
+static u64 statsStartTicks;
+static double statsStartTime;
+static u32 idleSyscallOp;
+// Set by hleBeginSyscall(), syscalls don't nest.
+static u64 syscallStartTicks;
+
+// Cheap enough to read around every syscall, the units are calibrated when stats are collected.
+static inline u64 SyscallTicks()
+{
+#if defined(_M_IX86) || defined(_M_X64)
+	return __rdtsc();
+#else
+	return (u64)(real_time_now() * 1000000.0);
+#endif
+}
+
+static void ResetSyscallStats()
+{
+	if (!syscallStats.empty())
+		memset(&syscallStats[0], 0, syscallStats.size() * sizeof(SyscallStat));
+	slowestSyscallTicks = 0;
+	slowestSyscallIndex = -1;
+	statsStartTicks = SyscallTicks();
+	statsStartTime = real_time_now();
+}
+
 void hleDelayResultFinish(u64 userdata, int cycleslate)
 {
 	u32 error;
@@ -86,6 +133,19 @@ void hleDelayResultFinish(u64 userdata, int cycleslate)
 void HLEInit()
 {
 	RegisterAllModules();
+
+	moduleSyscallBase.resize(moduleDB.size());
+	syscallInfos.clear();
+	for (size_t i = 0; i < moduleDB.size(); i++)
+	{
+		moduleSyscallBase[i] = (int)syscallInfos.size();
+		for (int j = 0; j < moduleDB[i].numFunctions; j++)
+			syscallInfos.push_back(&moduleDB[i].funcTable[j]);
+	}
+	syscallStats.resize(syscallInfos.size());
+	ResetSyscallStats();
+	idleSyscallOp = GetSyscallOp("FakeSysCalls", NID_IDLE);
+
 	delayedResultEvent = CoreTiming::RegisterEvent("HLEDelayedResult", hleDelayResultFinish);
 }
 
@@ -103,6 +163,9 @@ void HLEShutdown()
 {
 	hleAfterSyscall = HLE_AFTER_NOTHING;
 	moduleDB.clear();
+	moduleSyscallBase.clear();
+	syscallInfos.clear();
+	syscallStats.clear();
 }
 
 void RegisterModule(const char *name, int numFunctions, const HLEFunction *funcTable)
@@ -403,72 +466,60 @@ inline void hleFinishSyscall(const HLEFunction &info)
 	hleAfterSyscallReschedReason = 0;
 }
 
-inline void updateSyscallStats(int modulenum, int funcnum, double total)
+static inline void UpdateSyscallStats(u32 index, u64 ticks)
 {
-	const char *name = moduleDB[modulenum].funcTable[funcnum].name;
-	// Ignore this one, especially for msInSyscalls (although that ignores CoreTiming events.)
-	if (0 == strcmp(name, "_sceKernelIdle"))
-		return;
-
-	if (total > kernelStats.slowestSyscallTime)
+	SyscallStat &stat = syscallStats[index];
+	stat.ticks += ticks;
+	stat.calls++;
+	if (ticks > slowestSyscallTicks)
 	{
-		kernelStats.slowestSyscallTime = total;
-		kernelStats.slowestSyscallName = name;
+		slowestSyscallTicks = ticks;
+		slowestSyscallIndex = index;
 	}
-	kernelStats.msInSyscalls += total;
+}
 
-	KernelStatsSyscall statCall(modulenum, funcnum);
-	auto summedStat = kernelStats.summedMsInSyscalls.find(statCall);
-	if (summedStat == kernelStats.summedMsInSyscalls.end())
-	{
-		kernelStats.summedMsInSyscalls[statCall] = total;
-		if (total > kernelStats.summedSlowestSyscallTime)
-		{
-			kernelStats.summedSlowestSyscallTime = total;
-			kernelStats.summedSlowestSyscallName = name;
-		}
-	}
-	else
-	{
-		double newTotal = kernelStats.summedMsInSyscalls[statCall] += total;
-		if (newTotal > kernelStats.summedSlowestSyscallTime)
-		{
-			kernelStats.summedSlowestSyscallTime = newTotal;
-			kernelStats.summedSlowestSyscallName = name;
-		}
-	}
+// The jit calls these around a direct call to the HLE function, see GetSyscallDispatch().
+void hleBeginSyscall()
+{
+	syscallStartTicks = SyscallTicks();
 }
 
-inline void CallSyscallWithFlags(const HLEFunction *info)
+u32 hleCheckSyscallFlags(u32 index)
 {
-	const u32 flags = info->flags;
-	if ((flags & HLE_NOT_DISPATCH_SUSPENDED) && !__KernelIsDispatchEnabled())
+	const HLEFunction *info = syscallInfos[index];
+	if ((info->flags & HLE_NOT_DISPATCH_SUSPENDED) && !__KernelIsDispatchEnabled())
 	{
 		DEBUG_LOG(HLE, "%s: dispatch suspended", info->name);
 		RETURN(SCE_KERNEL_ERROR_CAN_NOT_WAIT);
+		return 0;
 	}
-	else if ((flags & HLE_NOT_IN_INTERRUPT) && __IsInInterrupt())
+	if ((info->flags & HLE_NOT_IN_INTERRUPT) && __IsInInterrupt())
 	{
 		DEBUG_LOG(HLE, "%s: in interrupt", info->name);
 		RETURN(SCE_KERNEL_ERROR_ILLEGAL_CONTEXT);
+		return 0;
 	}
-	else
-		info->func();
+	return 1;
+}
 
+void hleEndSyscall(u32 index)
+{
 	if (hleAfterSyscall != HLE_AFTER_NOTHING)
-		hleFinishSyscall(*info);
+		hleFinishSyscall(*syscallInfos[index]);
 	else
 		SetDeadbeefRegs();
+
+	UpdateSyscallStats(index, SyscallTicks() - syscallStartTicks);
 }
 
-inline void CallSyscallWithoutFlags(const HLEFunction *info)
+int GetSyscallIndex(MIPSOpcode op)
 {
-	info->func();
-
-	if (hleAfterSyscall != HLE_AFTER_NOTHING)
-		hleFinishSyscall(*info);
-	else
-		SetDeadbeefRegs();
+	u32 callno = (op >> 6) & 0xFFFFF; //20 bits
+	int funcnum = callno & 0xFFF;
+	int modulenum = (callno & 0xFF000) >> 12;
+	if (funcnum == 0xfff || modulenum >= (int)moduleDB.size() || funcnum >= moduleDB[modulenum].numFunctions)
+		return -1;
+	return moduleSyscallBase[modulenum] + funcnum;
 }
 
 const HLEFunction *GetSyscallInfo(MIPSOpcode op)
@@ -484,54 +535,74 @@ const HLEFunction *GetSyscallInfo(MIPSOpcode op)
 	return &moduleDB[modulenum].funcTable[funcnum];
 }
 
-void *GetQuickSyscallFunc(MIPSOpcode op)
+bool GetSyscallDispatch(MIPSOpcode op, SyscallDispatch *dispatch)
 {
-	// TODO: Clear jit cache on g_Config.bShowDebugStats change?
-	if (g_Config.bShowDebugStats)
-		return NULL;
-
 	const HLEFunction *info = GetSyscallInfo(op);
-	if (!info || !info->func)
-		return NULL;
+	const int index = GetSyscallIndex(op);
+	if (!info || !info->func || index < 0)
+		return false;
 
-	// TODO: Do this with a flag?
-	if (op == GetSyscallOp("FakeSysCalls", NID_IDLE))
-		return (void *)info->func;
-	if (info->flags != 0)
-		return (void *)&CallSyscallWithFlags;
-	return (void *)&CallSyscallWithoutFlags;
+	dispatch->func = info->func;
+	dispatch->index = (u32)index;
+	dispatch->checkFlags = (info->flags & (HLE_NOT_DISPATCH_SUSPENDED | HLE_NOT_IN_INTERRUPT)) != 0;
+	dispatch->idle = op == idleSyscallOp;
+	return true;
 }
 
 void CallSyscall(MIPSOpcode op)
 {
-	double start = 0.0;  // need to initialize to fix the race condition where g_Config.bShowDebugStats is enabled in the middle of this func.
-	if (g_Config.bShowDebugStats)
+	SyscallDispatch dispatch;
+	if (!GetSyscallDispatch(op, &dispatch))
 	{
-		time_update();
-		start = time_now_d();
-	}
-	const HLEFunction *info = GetSyscallInfo(op);
-	if (!info)
+		const HLEFunction *info = GetSyscallInfo(op);
+		if (info)
+			ERROR_LOG_REPORT(HLE, "Unimplemented HLE function %s", info->name);
 		return;
+	}
 
-	if (info->func)
+	// Idle isn't counted, especially for time in syscalls (although that ignores CoreTiming events.)
+	if (dispatch.idle)
 	{
-		if (op == GetSyscallOp("FakeSysCalls", NID_IDLE))
-			info->func();
-		else if (info->flags != 0)
-			CallSyscallWithFlags(info);
-		else
-			CallSyscallWithoutFlags(info);
+		dispatch.func();
+		return;
 	}
-	else
-		ERROR_LOG_REPORT(HLE, "Unimplemented HLE function %s", info->name);
 
-	if (g_Config.bShowDebugStats)
+	hleBeginSyscall();
+	if (!dispatch.checkFlags || hleCheckSyscallFlags(dispatch.index))
+		dispatch.func();
+	hleEndSyscall(dispatch.index);
+}
+
+void hleCollectSyscallStats()
+{
+	const u64 elapsedTicks = SyscallTicks() - statsStartTicks;
+	const double elapsed = real_time_now() - statsStartTime;
+	const double secondsPerTick = elapsedTicks > 0 ? elapsed / (double)elapsedTicks : 0.0;
+
+	u64 totalTicks = 0;
+	u64 summedSlowestTicks = 0;
+	for (size_t i = 0; i < syscallStats.size(); i++)
 	{
-		time_update();
-		u32 callno = (op >> 6) & 0xFFFFF; //20 bits
-		int funcnum = callno & 0xFFF;
-		int modulenum = (callno & 0xFF000) >> 12;
-		updateSyscallStats(modulenum, funcnum, time_now_d() - start);
+		totalTicks += syscallStats[i].ticks;
+		if (syscallStats[i].ticks > summedSlowestTicks)
+		{
+			summedSlowestTicks = syscallStats[i].ticks;
+			kernelStats.summedSlowestSyscallName = syscallInfos[i]->name;
+		}
 	}
+
+	kernelStats.msInSyscalls = totalTicks * secondsPerTick;
+	kernelStats.summedSlowestSyscallTime = summedSlowestTicks * secondsPerTick;
+	kernelStats.slowestSyscallTime = slowestSyscallTicks * secondsPerTick;
+	kernelStats.slowestSyscallName = slowestSyscallIndex >= 0 ? syscallInfos[slowestSyscallIndex]->name : 0;
+
+	ResetSyscallStats();
+}
+
+u64 hleGetSyscallCount()
+{
+	u64 calls = 0;
+	for (size_t i = 0; i < syscallStats.size(); i++)
+		calls += syscallStats[i].calls;
+	return calls;
 }
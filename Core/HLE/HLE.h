@@ -122,6 +122,28 @@ void WriteFuncStub(u32 stubAddr, u32 symAddr);
 void WriteFuncMissingStub(u32 stubAddr, u32 nid);
 
 const HLEFunction *GetSyscallInfo(MIPSOpcode op);
-// For jit, takes arg: const HLEFunction *
-void *GetQuickSyscallFunc(MIPSOpcode op);
+// Flat syscall number, or -1 if the op isn't a known syscall.
+int GetSyscallIndex(MIPSOpcode op);
+
+// What the jit needs to call a syscall's HLE function directly, instead of through CallSyscall():
+//   hleBeginSyscall(), then only if checkFlags, hleCheckSyscallFlags(index) which returns 0 to skip func,
+//   then func(), then hleEndSyscall(index).  The idle syscall is just func().
+// The HLE functions still read their arguments from currentMIPS, so registers must be flushed first.
+struct SyscallDispatch
+{
+	HLEFunc func;
+	u32 index;
+	bool checkFlags;
+	bool idle;
+};
+// False if there's no HLE function to call, then use CallSyscall().
+bool GetSyscallDispatch(MIPSOpcode op, SyscallDispatch *dispatch);
+void hleBeginSyscall();
+u32 hleCheckSyscallFlags(u32 index);
+void hleEndSyscall(u32 index);
+
+// Fills kernelStats with syscall times since the last collect, and starts over.
+void hleCollectSyscallStats();
+// Syscalls made since the last collect, not counting idle.
+u64 hleGetSyscallCount();
 
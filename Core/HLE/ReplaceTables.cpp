@@ -16,6 +16,7 @@
 // https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
 
 #include <map>
+#include <string>
 
 #include "base/basictypes.h"
 #include "base/logging.h"
@@ -23,6 +24,7 @@
 #include "Core/MIPS/MIPSAnalyst.h"
 #include "Core/HLE/ReplaceTables.h"
 #include "Core/HLE/FunctionWrappers.h"
+#include "Core/HLE/sceDeflt.h"
 
 #include "GPU/Math3D.h"
 
@@ -82,6 +84,38 @@ static int Replace_atan2f() {
 	return 120;  // guess number of cycles
 }
 
+static int Replace_powf() {
+	float f1 = PARAMF(0);
+	float f2 = PARAMF(1);
+	RETURNF(powf(f1, f2));
+	return 120;  // guess number of cycles
+}
+
+static int Replace_expf() {
+	float f = PARAMF(0);
+	RETURNF(expf(f));
+	return 80;  // guess number of cycles
+}
+
+static int Replace_logf() {
+	float f = PARAMF(0);
+	RETURNF(logf(f));
+	return 80;  // guess number of cycles
+}
+
+static int Replace_log10f() {
+	float f = PARAMF(0);
+	RETURNF(log10f(f));
+	return 80;  // guess number of cycles
+}
+
+static int Replace_fmodf() {
+	float f1 = PARAMF(0);
+	float f2 = PARAMF(1);
+	RETURNF(fmodf(f1, f2));
+	return 60;  // guess number of cycles
+}
+
 static int Replace_floorf() {
 	float f1 = PARAMF(0);
 	RETURNF(floorf(f1));
@@ -94,8 +128,7 @@ static int Replace_ceilf() {
 	return 30;  // guess number of cycles
 }
 
-// Should probably do JIT versions of this, possibly ones that only delegate
-// large copies to a C function.
+// The x86 jit does small copies itself, and calls these for large ones.
 static int Replace_memcpy() {
 	u32 destPtr = PARAM(0);
 	u32 srcPtr = PARAM(1);
@@ -104,6 +137,7 @@ static int Replace_memcpy() {
 		u8 *dst = Memory::GetPointerUnchecked(destPtr);
 		u8 *src = Memory::GetPointerUnchecked(srcPtr);
 		memmove(dst, src, bytes);
+		Memory::MarkDirtyRange(destPtr, bytes);
 	}
 	RETURN(destPtr);
 	return 10 + bytes / 4;  // approximation
@@ -117,6 +151,7 @@ static int Replace_memcpy16() {
 		u8 *dst = Memory::GetPointerUnchecked(destPtr);
 		u8 *src = Memory::GetPointerUnchecked(srcPtr);
 		memmove(dst, src, bytes);
+		Memory::MarkDirtyRange(destPtr, bytes);
 	}
 	RETURN(destPtr);
 	return 10 + bytes / 4;  // approximation
@@ -130,6 +165,7 @@ static int Replace_memmove() {
 		u8 *dst = Memory::GetPointerUnchecked(destPtr);
 		u8 *src = Memory::GetPointerUnchecked(srcPtr);
 		memmove(dst, src, bytes);
+		Memory::MarkDirtyRange(destPtr, bytes);
 	}
 	RETURN(destPtr);
 	return 10 + bytes / 4;  // approximation
@@ -141,10 +177,54 @@ static int Replace_memset() {
 	u8 value = PARAM(1);
 	u32 bytes = PARAM(2);
 	memset(dst, value, bytes);
+	Memory::MarkDirtyRange(destPtr, bytes);
 	RETURN(destPtr);
 	return 10 + bytes / 4;  // approximation
 }
 
+static int Replace_memcmp() {
+	const u8 *a = Memory::GetPointerUnchecked(PARAM(0));
+	const u8 *b = Memory::GetPointerUnchecked(PARAM(1));
+	u32 bytes = PARAM(2);
+	// Like the PSP's libc, return the difference of the first mismatching bytes.
+	int result = 0;
+	u32 i = 0;
+	while (i < bytes && a[i] == b[i])
+		++i;
+	if (i < bytes)
+		result = (int)a[i] - (int)b[i];
+	RETURN(result);
+	return 10 + i / 4;  // approximation
+}
+
+static int Replace_memchr() {
+	u32 srcPtr = PARAM(0);
+	const u8 *src = Memory::GetPointerUnchecked(srcPtr);
+	u8 value = PARAM(1);
+	u32 bytes = PARAM(2);
+	const u8 *found = bytes != 0 ? (const u8 *)memchr(src, value, bytes) : 0;
+	RETURN(found ? srcPtr + (u32)(found - src) : 0);
+	return 10 + (found ? (u32)(found - src) : bytes) / 4;  // approximation
+}
+
+static int Replace_strchr() {
+	u32 srcPtr = PARAM(0);
+	const char *src = (const char *)Memory::GetPointerUnchecked(srcPtr);
+	char value = (char)PARAM(1);
+	const char *found = strchr(src, value);
+	RETURN(found ? srcPtr + (u32)(found - src) : 0);
+	return 10 + (found ? (u32)(found - src) : 0);  // approximation
+}
+
+static int Replace_strrchr() {
+	u32 srcPtr = PARAM(0);
+	const char *src = (const char *)Memory::GetPointerUnchecked(srcPtr);
+	char value = (char)PARAM(1);
+	const char *found = strrchr(src, value);
+	RETURN(found ? srcPtr + (u32)(found - src) : 0);
+	return 10 + (u32)strlen(src);  // approximation
+}
+
 static int Replace_strlen() {
 	u32 srcPtr = PARAM(0);
 	const char *src = (const char *)Memory::GetPointerUnchecked(srcPtr);
@@ -158,6 +238,7 @@ static int Replace_strcpy() {
 	char *dst = (char *)Memory::GetPointerUnchecked(destPtr);
 	const char *src = (const char *)Memory::GetPointerUnchecked(PARAM(1));
 	strcpy(dst, src);
+	Memory::MarkDirtyRange(destPtr, (u32)strlen(src) + 1);
 	RETURN(destPtr);
 	return 10;  // approximation
 }
@@ -168,23 +249,55 @@ static int Replace_strncpy() {
 	const char *src = (const char *)Memory::GetPointerUnchecked(PARAM(1));
 	u32 bytes = PARAM(2);
 	strncpy(dst, src, bytes);
+	Memory::MarkDirtyRange(destPtr, bytes);
 	RETURN(destPtr);
 	return 10;  // approximation
 }
 
 static int Replace_strcmp() {
-	const char *a = (const char *)Memory::GetPointerUnchecked(PARAM(0));
-	const char *b = (const char *)Memory::GetPointerUnchecked(PARAM(1));
-	RETURN(strcmp(a, b));
-	return 10;  // approximation
+	const u8 *a = Memory::GetPointerUnchecked(PARAM(0));
+	const u8 *b = Memory::GetPointerUnchecked(PARAM(1));
+	// Like the PSP's libc (and the jit's version), the difference of the first mismatching bytes.
+	u32 i = 0;
+	while (a[i] != 0 && a[i] == b[i])
+		++i;
+	RETURN((int)a[i] - (int)b[i]);
+	return 10 + i / 4;  // approximation
 }
 
 static int Replace_strncmp() {
-	const char *a = (const char *)Memory::GetPointerUnchecked(PARAM(0));
-	const char *b = (const char *)Memory::GetPointerUnchecked(PARAM(1));
+	const u8 *a = Memory::GetPointerUnchecked(PARAM(0));
+	const u8 *b = Memory::GetPointerUnchecked(PARAM(1));
 	u32 bytes = PARAM(2);
-	RETURN(strncmp(a, b, bytes));
-	return 10 + bytes / 4;  // approximation
+	int result = 0;
+	u32 i = 0;
+	while (i < bytes && a[i] != 0 && a[i] == b[i])
+		++i;
+	if (i < bytes)
+		result = (int)a[i] - (int)b[i];
+	RETURN(result);
+	return 10 + i / 4;  // approximation
+}
+
+// zlib's uncompress(dest, destLen, source, sourceLen), which many games link statically.
+// Interpreted, it's often most of a loading screen.
+static int Replace_uncompress() {
+	u32 destPtr = PARAM(0);
+	u32 destLenPtr = PARAM(1);
+	u32 srcPtr = PARAM(2);
+	u32 srcLen = PARAM(3);
+
+	u32 destLen = Memory::Read_U32(destLenPtr);
+	int written = DeflateDecompressMemory(destPtr, destLen, srcPtr, srcLen, DEFLATE_FORMAT_ZLIB, NULL);
+	if (written < 0) {
+		// Already zlib's result, like Z_BUF_ERROR when destLen is too small.
+		RETURN(written);
+		return 100;
+	}
+	Memory::Write_U32(written, destLenPtr);
+	RETURN(0);
+	// Roughly what the PSP would take natively with a good inflate.
+	return 100 + written * 4;
 }
 
 static int Replace_vmmul_q_transp() {
@@ -194,6 +307,7 @@ static int Replace_vmmul_q_transp() {
 
 	// TODO: Actually use an optimized matrix multiply here...
 	Matrix4ByMatrix4(out, b, a);
+	Memory::MarkDirtyRange(PARAM(0), 16 * sizeof(float));
 	return 16;
 }
 
@@ -240,14 +354,15 @@ static int Replace_gta_dl_write_matrix() {
 	dest[11] = matrix | (src[14] >> 8);
 #endif
 
+	Memory::MarkDirtyRange(ptr[0], 0x30);
+	Memory::MarkDirty(PARAM(0));
 	(*ptr) += 0x30;
 	RETURN(0);
 	return 38;
 }
 
 
-// TODO: Inline into a few NEON or SSE instructions - especially if a1 is a known immediate!
-// Anyway, not sure if worth it. There's not that many matrices written per frame normally.
+// The x86 jit inlines this when a1 is a known immediate, which it usually is.
 static int Replace_dl_write_matrix() {
 	u32 *dlStruct = (u32 *)Memory::GetPointerUnchecked(PARAM(0));
 	u32 *dest = (u32 *)Memory::GetPointerUnchecked(dlStruct[2]);
@@ -348,11 +463,20 @@ static int Replace_dl_write_matrix() {
 #endif
 	}
 
+	Memory::MarkDirtyRange(dlStruct[2], (1 + count) * 4);
+	Memory::MarkDirtyRange(PARAM(0) + 8, 4);
 	dlStruct[2] += (1 + count) * 4;
 	RETURN(dlStruct[2]);
 	return 60;
 }
 
+// Only the x86 jit has its own versions of these so far, the others just use the C ones.
+#if defined(_M_IX86) || defined(_M_X64)
+#define X86_JIT_REPLACE(name) &MIPSComp::Jit::name
+#else
+#define X86_JIT_REPLACE(name) 0
+#endif
+
 // Can either replace with C functions or functions emitted in Asm/ArmAsm.
 static const ReplacementTableEntry entries[] = {
 	// TODO: I think some games can be helped quite a bit by implementing the
@@ -372,22 +496,34 @@ static const ReplacementTableEntry entries[] = {
 	{ "atanf", &Replace_atanf, 0, 0},
 	{ "sqrtf", &Replace_sqrtf, 0, 0},
 	{ "atan2f", &Replace_atan2f, 0, 0},
+	{ "powf", &Replace_powf, 0, 0},
+	{ "expf", &Replace_expf, 0, 0},
+	{ "logf", &Replace_logf, 0, 0},
+	{ "log10f", &Replace_log10f, 0, 0},
+	{ "fmodf", &Replace_fmodf, 0, 0},
 	{ "floorf", &Replace_floorf, 0, 0},
 	{ "ceilf", &Replace_ceilf, 0, 0},
 
-	{ "memcpy", &Replace_memcpy, 0, 0},
+	{ "memcpy", &Replace_memcpy, X86_JIT_REPLACE(Replace_memcpy), 0},
 	{ "memcpy16", &Replace_memcpy16, 0, 0},
-	{ "memmove", &Replace_memmove, 0, 0},
-	{ "memset", &Replace_memset, 0, 0},
-	{ "strlen", &Replace_strlen, 0, 0},
+	// The jit's memcpy handles overlap.
+	{ "memmove", &Replace_memmove, X86_JIT_REPLACE(Replace_memcpy), 0},
+	{ "memset", &Replace_memset, X86_JIT_REPLACE(Replace_memset), 0},
+	{ "memcmp", &Replace_memcmp, 0, 0},
+	{ "memchr", &Replace_memchr, 0, 0},
+	{ "strchr", &Replace_strchr, 0, 0},
+	{ "strrchr", &Replace_strrchr, 0, 0},
+	{ "strlen", &Replace_strlen, X86_JIT_REPLACE(Replace_strlen), 0},
 	{ "strcpy", &Replace_strcpy, 0, 0},
 	{ "strncpy", &Replace_strncpy, 0, 0},
-	{ "strcmp", &Replace_strcmp, 0, 0},
+	{ "strcmp", &Replace_strcmp, X86_JIT_REPLACE(Replace_strcmp), 0},
 	{ "strncmp", &Replace_strncmp, 0, 0},
 
+	{ "uncompress", &Replace_uncompress, 0, 0},
+
 	{ "fabsf", 0, &MIPSComp::Jit::Replace_fabsf, REPFLAG_ALLOWINLINE},
-	{ "dl_write_matrix", &Replace_dl_write_matrix, 0, 0}, // &MIPSComp::Jit::Replace_dl_write_matrix, 0},
-	{ "dl_write_matrix_2", &Replace_dl_write_matrix, 0, 0},
+	{ "dl_write_matrix", &Replace_dl_write_matrix, X86_JIT_REPLACE(Replace_dl_write_matrix), 0},
+	{ "dl_write_matrix_2", &Replace_dl_write_matrix, X86_JIT_REPLACE(Replace_dl_write_matrix), 0},
 	{ "gta_dl_write_matrix", &Replace_gta_dl_write_matrix, 0, 0},
 	// dl_write_matrix_3 doesn't take the dl as a parameter, it accesses a global instead. Need to extract the address of the global from the code when replacing...
 	// Haven't investigated write_matrix_4 and 5 but I think they are similar to 1 and 2.
@@ -397,12 +533,25 @@ static const ReplacementTableEntry entries[] = {
 };
 
 static std::map<u32, u32> replacedInstructions;
+// Built once, so matching a module's functions is a lookup per function rather than a scan.
+static std::map<std::string, int> replacementNameLookup;
+static ReplacementStats replacementStats[ARRAY_SIZE(entries)];
 
 void Replacement_Init() {
+	replacementNameLookup.clear();
+	for (int i = 0; i < ARRAY_SIZE(entries); i++) {
+		if (!entries[i].name)
+			continue;
+		replacementNameLookup[entries[i].name] = i;
+	}
+	memset(replacementStats, 0, sizeof(replacementStats));
+	ResetDeflateStats();
 }
 
 void Replacement_Shutdown() {
+	LogReplacementReport();
 	replacedInstructions.clear();
+	replacementNameLookup.clear();
 }
 
 // TODO: Do something on load state?
@@ -417,36 +566,69 @@ int GetReplacementFuncIndex(u64 hash, int funcSize) {
 		return -1;
 	}
 
-	// TODO: Build a lookup and keep it around
+	auto iter = replacementNameLookup.find(name);
+	if (iter == replacementNameLookup.end()) {
+		return -1;
+	}
+	return iter->second;
+}
+
+int CallReplacementFunc(int index) {
+	int cycles = entries[index].replaceFunc();
+	replacementStats[index].calls++;
+	replacementStats[index].cycles += cycles;
+	return cycles;
+}
+
+const ReplacementStats *GetReplacementStats(int index) {
+	return &replacementStats[index];
+}
+
+void LogReplacementReport() {
+	DeflateStats deflate;
+	GetDeflateStats(deflate);
+	if (deflate.calls != 0) {
+		INFO_LOG(HLE, "Native inflate: %u calls, %0.2f MB to %0.2f MB in %0.1f ms", deflate.calls, deflate.bytesIn / 1048576.0, deflate.bytesOut / 1048576.0, deflate.seconds * 1000.0);
+	}
+
 	for (int i = 0; i < ARRAY_SIZE(entries); i++) {
-		if (!entries[i].name)
+		const ReplacementStats &stats = replacementStats[i];
+		if (stats.sites == 0) {
 			continue;
-		if (!strcmp(name, entries[i].name)) {
-			return i;
+		}
+		if (entries[i].replaceFunc && entries[i].jitReplaceFunc) {
+			// Only the calls that went to the C version are counted.
+			INFO_LOG(HLE, "Replacement %s: %d copies, %u calls to C, %llu cycles (%0.1f per call)", entries[i].name, stats.sites, stats.calls, stats.cycles, stats.calls ? (double)stats.cycles / stats.calls : 0.0);
+		} else if (entries[i].replaceFunc) {
+			INFO_LOG(HLE, "Replacement %s: %d copies, %u calls, %llu cycles (%0.1f per call)", entries[i].name, stats.sites, stats.calls, stats.cycles, stats.calls ? (double)stats.cycles / stats.calls : 0.0);
+		} else {
+			INFO_LOG(HLE, "Replacement %s: %d copies, jit only", entries[i].name, stats.sites);
 		}
 	}
-	return -1;
 }
 
 const ReplacementTableEntry *GetReplacementFunc(int i) {
 	return &entries[i];
 }
 
-void WriteReplaceInstruction(u32 address, u64 hash, int size) {
+bool WriteReplaceInstruction(u32 address, u64 hash, int size) {
 	int index = GetReplacementFuncIndex(hash, size);
 	if (index >= 0) {
 		u32 prevInstr = Memory::Read_U32(address);
 		if (MIPS_IS_REPLACEMENT(prevInstr)) {
-			return;
+			return false;
 		}
 		if (MIPS_IS_RUNBLOCK(prevInstr)) {
 			// Likely already both replaced and jitted. Ignore.
-			return;
+			return false;
 		}
 		replacedInstructions[address] = prevInstr;
+		replacementStats[index].sites++;
 		INFO_LOG(HLE, "Replaced %s at %08x with hash %016llx", entries[index].name, address, hash);
 		Memory::Write_U32(MIPS_EMUHACK_CALL_REPLACEMENT | (int)index, address);
+		return true;
 	}
+	return false;
 }
 
 bool GetReplacedOpAt(u32 address, u32 *op) {
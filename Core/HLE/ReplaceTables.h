@@ -50,6 +50,13 @@ struct ReplacementTableEntry {
 	int flags;
 };
 
+// Counted for the report at shutdown.  Inlined jit replacements only count sites.
+struct ReplacementStats {
+	int sites;
+	u32 calls;
+	u64 cycles;
+};
+
 void Replacement_Init();
 void Replacement_Shutdown();
 
@@ -57,5 +64,12 @@ int GetNumReplacementFuncs();
 int GetReplacementFuncIndex(u64 hash, int funcSize);
 const ReplacementTableEntry *GetReplacementFunc(int index);
 
-void WriteReplaceInstruction(u32 address, u64 hash, int size);
+// Runs the C implementation and updates its stats.  Returns the cycles to eat.
+int CallReplacementFunc(int index);
+const ReplacementStats *GetReplacementStats(int index);
+// Logs which functions were replaced, and how often they ran.
+void LogReplacementReport();
+
+// Returns true if a replacement was written.
+bool WriteReplaceInstruction(u32 address, u64 hash, int size);
 bool GetReplacedOpAt(u32 address, u32 *op);
@@ -1,5 +1,8 @@
 // TODO: Add license
 
+#include <unordered_map>
+#include <vector>
+
 #include "util/text/parsers.h"
 #include "proAdhoc.h" 
 
@@ -13,12 +16,47 @@ int eventHandlerUpdate                = -1;
 int threadStatus                      = ADHOCCTL_STATE_DISCONNECTED;
 
 int metasocket;
+// Own Loopback Address while the Adhoc Server runs on this Machine, or 0
+static uint32_t localLoopbackIp = 0;
 SceNetAdhocctlParameter parameter;
 std::thread friendFinderThread;
 recursive_mutex peerlock;
 SceNetAdhocPdpStat * pdp[255];
 SceNetAdhocPtpStat * ptp[255];
 
+// Peer Lookup Tables (protected by peerlock, like the friends list they index)
+static std::unordered_map<uint32_t, SceNetAdhocctlPeerInfo *> friendsByIP;
+static std::unordered_map<uint64_t, SceNetAdhocctlPeerInfo *> friendsByMAC;
+
+// Shared Reactor: the Friend Finder Thread polls the Metasocket together with every adhoc Socket
+// somebody is blocked on (protected by reactorLock), and wakes the waiters through reactorCond
+struct AdhocReactorSocket {
+  int events;   // ADHOC_WAIT_* Flags somebody waits for
+  int revents;  // ADHOC_WAIT_* Flags found ready and not picked up yet
+  int waiters;
+};
+static recursive_mutex reactorLock;
+static condition_variable reactorCond;
+static std::unordered_map<int, AdhocReactorSocket> reactorSockets;
+// Loopback UDP Socket the Reactor also polls, so new waiters don't wait out the current Poll
+static int reactorWakeSocket = (int)INVALID_SOCKET;
+static sockaddr_in reactorWakeAddr;
+
+static uint64_t macToKey(const SceNetEtherAddr * mac) {
+  uint64_t key = 0;
+  memcpy(&key, mac->data, ETHER_ADDR_LEN);
+  return key;
+}
+
+// Point the Lookup Tables at whichever remaining Peer now owns a removed Peer's IP or MAC
+static void reindexFriend(uint32_t ip, uint64_t mackey) {
+  SceNetAdhocctlPeerInfo * peer = friends;
+  for(; peer != NULL; peer = peer->next) {
+    if(peer->ip_addr == ip && friendsByIP.find(ip) == friendsByIP.end()) friendsByIP[ip] = peer;
+    if(macToKey(&peer->mac_addr) == mackey && friendsByMAC.find(mackey) == friendsByMAC.end()) friendsByMAC[mackey] = peer;
+  }
+}
+
 int isLocalMAC(const SceNetEtherAddr * addr) {
   SceNetEtherAddr saddr;
   getLocalMac(&saddr);
@@ -54,9 +92,6 @@ void addFriend(SceNetAdhocctlConnectPacketS2C * packet) {
     // Clear Memory
     memset(peer, 0, sizeof(SceNetAdhocctlPeerInfo));
 
-    // Link to existing Peers
-    peer->next = friends;
-
     // Save Nickname
     peer->nickname = packet->name;
 
@@ -69,9 +104,16 @@ void addFriend(SceNetAdhocctlConnectPacketS2C * packet) {
     // Multithreading Lock
     peerlock.lock();
 
+    // Link to existing Peers
+    peer->next = friends;
+
     // Link into Peerlist
     friends = peer;
 
+    // Newest Peer wins Lookups, like it did when searching the List
+    friendsByIP[peer->ip_addr] = peer;
+    friendsByMAC[macToKey(&peer->mac_addr)] = peer;
+
     // Multithreading Unlock
     peerlock.unlock();
   }
@@ -148,38 +190,32 @@ void deleteAllPTP(void) {
 }
 
 void deleteFriendByIP(uint32_t ip) {
-  // Previous Peer Reference
-  SceNetAdhocctlPeerInfo * prev = NULL;
-
-  // Peer Pointer
-  SceNetAdhocctlPeerInfo * peer = friends;
-
-  // Iterate Peers
-  for(; peer != NULL; peer = peer->next) {
-    // Found Peer
-    if(peer->ip_addr == ip) {
-      // Multithreading Lock
-      peerlock.lock();
-
-      // Unlink Left (Beginning)
-      if(prev == NULL)friends = peer->next;
-
-      // Unlink Left (Other)
-      else prev->next = peer->next;
-
-      // Multithreading Unlock
-      peerlock.unlock();
-
-      // Free Memory
-      free(peer);
-
-      // Stop Search
-      break;
-    }
+  // Multithreading Lock
+  peerlock.lock();
 
-    // Set Previous Reference
-    prev = peer;
+  // Find Peer
+  auto found = friendsByIP.find(ip);
+  if(found != friendsByIP.end()) {
+    SceNetAdhocctlPeerInfo * peer = found->second;
+    uint64_t mackey = macToKey(&peer->mac_addr);
+
+    // Unlink from Peerlist
+    SceNetAdhocctlPeerInfo ** link = &friends;
+    while(*link != NULL && *link != peer) link = &(*link)->next;
+    if(*link != NULL) *link = peer->next;
+
+    // Unlink from Lookup Tables
+    friendsByIP.erase(found);
+    auto macfound = friendsByMAC.find(mackey);
+    if(macfound != friendsByMAC.end() && macfound->second == peer) friendsByMAC.erase(macfound);
+    reindexFriend(ip, mackey);
+
+    // Free Memory
+    free(peer);
   }
+
+  // Multithreading Unlock
+  peerlock.unlock();
 }
 
 int findFreeMatchingID(void) {
@@ -222,10 +258,114 @@ void freeFriendsRecursive(SceNetAdhocctlPeerInfo * node) {
   // Increase Recursion Depth
   freeFriendsRecursive(node->next);
 
+  // Unlink from Lookup Tables
+  auto ipfound = friendsByIP.find(node->ip_addr);
+  if(ipfound != friendsByIP.end() && ipfound->second == node) friendsByIP.erase(ipfound);
+  auto macfound = friendsByMAC.find(macToKey(&node->mac_addr));
+  if(macfound != friendsByMAC.end() && macfound->second == node) friendsByMAC.erase(macfound);
+
   // Free Memory
   free(node);
 }
 
+static void openReactorWakeSocket() {
+  int fd = (int)socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+  if(fd == (int)INVALID_SOCKET) {
+    WARN_LOG(SCENET, "FriendFinder: Reactor has no Wake Socket, blocked adhoc Calls wait on their own");
+    return;
+  }
+
+  sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = 0;
+  socklen_t addrlen = sizeof(addr);
+  if(bind(fd, (sockaddr *)&addr, sizeof(addr)) != 0 || getsockname(fd, (sockaddr *)&addr, &addrlen) != 0) {
+    WARN_LOG(SCENET, "FriendFinder: Reactor has no Wake Socket, blocked adhoc Calls wait on their own");
+    closesocket(fd);
+    return;
+  }
+  changeBlockingMode(fd, 1);
+
+  lock_guard guard(reactorLock);
+  reactorWakeAddr = addr;
+  reactorWakeSocket = fd;
+}
+
+static void closeReactorWakeSocket() {
+  lock_guard guard(reactorLock);
+  if(reactorWakeSocket != (int)INVALID_SOCKET) {
+    closesocket(reactorWakeSocket);
+    reactorWakeSocket = (int)INVALID_SOCKET;
+  }
+  // Anybody still waiting falls back to waiting on their own Socket
+  reactorCond.notify_all();
+}
+
+// One Reactor Pass over the Wake Socket, the Metasocket (unless INVALID_SOCKET) and every waited on Socket
+// Returns whether the Metasocket is readable
+static bool pollReactor(int metafd, int timeoutMs) {
+  // Only the Friend Finder Thread polls, so the Lists can be reused
+  static std::vector<int> fds;
+  static std::vector<int> events;
+  static std::vector<int> revents;
+  fds.clear();
+  events.clear();
+
+  int wakeIndex = -1, metaIndex = -1;
+  {
+    lock_guard guard(reactorLock);
+    if(reactorWakeSocket != (int)INVALID_SOCKET) {
+      wakeIndex = (int)fds.size();
+      fds.push_back(reactorWakeSocket);
+      events.push_back(ADHOC_WAIT_READ);
+    }
+    // Sockets already reported ready stay out until the waiter picks that up, or they'd spin the Poll
+    for(auto it = reactorSockets.begin(); it != reactorSockets.end(); ++it) {
+      int wanted = it->second.events & ~it->second.revents;
+      if(wanted != 0) {
+        fds.push_back(it->first);
+        events.push_back(wanted);
+      }
+    }
+  }
+  if(metafd != (int)INVALID_SOCKET) {
+    metaIndex = (int)fds.size();
+    fds.push_back(metafd);
+    events.push_back(ADHOC_WAIT_READ);
+  }
+
+  if(fds.empty()) {
+    sleep_ms(timeoutMs);
+    return false;
+  }
+
+  revents.resize(fds.size());
+  if(waitForSockets(&fds[0], &events[0], &revents[0], (int)fds.size(), timeoutMs) <= 0) return false;
+
+  // Drain the Wakeups, they only exist to end the Poll early
+  if(wakeIndex >= 0 && revents[wakeIndex] != 0) {
+    char drain[16];
+    while(recv(fds[wakeIndex], drain, sizeof(drain), 0) > 0) {}
+  }
+
+  // Hand the ready Flags to the Waiters
+  lock_guard guard(reactorLock);
+  bool ready = false;
+  int i = 0; for(; i < (int)fds.size(); i++) {
+    if(i == wakeIndex || i == metaIndex || revents[i] == 0) continue;
+    auto found = reactorSockets.find(fds[i]);
+    if(found != reactorSockets.end()) {
+      found->second.revents |= revents[i];
+      ready = true;
+    }
+  }
+  if(ready) reactorCond.notify_all();
+
+  return metaIndex >= 0 && revents[metaIndex] != 0;
+}
+
 int friendFinder(){
   // Receive Buffer
   int rxpos = 0;
@@ -240,17 +380,23 @@ int friendFinder(){
 
   // Last Time Reception got updated
   uint64_t lastreceptionupdate = 0;
+
+  // Server closed the Connection
+  bool serverClosed = false;
   
   uint64_t now;
 
+  // The Finder Loop doubles as the Reactor for blocking adhoc Calls
+  openReactorWakeSocket();
+
   // Finder Loop
   while(friendFinderRunning) {
     // Acquire Network Lock
     //_acquireNetworkLock();
 
-    // Ping Server
+    // Ping Server (unless it went away)
     now = real_time_now()*1000.0;
-    if(now - lastping >= 100) {
+    if(!serverClosed && now - lastping >= 100) {
       // Update Ping Time
       lastping = now;
 
@@ -268,8 +414,20 @@ int friendFinder(){
     //  sceNetInetSend(metasocket, (const char *)&chat, sizeof(chat), 0);
     //}
 
-    // Wait for Incoming Data
-    int received = recv(metasocket, (char *)(rx + rxpos), sizeof(rx) - rxpos,0);
+    // Wait for Incoming Data (or any other waited on adhoc Socket), but no longer than until the next Ping
+    uint64_t sinceping = (uint64_t)(real_time_now()*1000.0) - lastping;
+    int wait = sinceping >= 100 ? 0 : (int)(100 - sinceping);
+    int received = 0;
+    // The closed Socket always polls ready, so stop polling it until sceNetAdhocctlTerm closes it
+    if(pollReactor(serverClosed ? (int)INVALID_SOCKET : metasocket, serverClosed ? 100 : wait)) {
+      received = recv(metasocket, (char *)(rx + rxpos), sizeof(rx) - rxpos,0);
+
+      // Server went away (or reset the Connection)
+      if((received == 0 && rxpos < (int)sizeof(rx)) || (received < 0 && errno != EAGAIN)) {
+        ERROR_LOG(SCENET, "FriendFinder: Adhoc Server closed the Connection");
+        serverClosed = true;
+      }
+    }
 
     // Free Network Lock
     //_freeNetworkLock();
@@ -281,11 +439,13 @@ int friendFinder(){
 
       // Log Incoming Traffic
       //printf("Received %d Bytes of Data from Server\n", received);
-      INFO_LOG(SCENET, "Received %d Bytes of Data from Adhoc Server", received);
+      DEBUG_LOG(SCENET, "Received %d Bytes of Data from Adhoc Server", received);
     }
 
-    // Handle Packets
-    if(rxpos > 0) {
+    // Handle every complete Packet, not just one per Wakeup
+    int handled = -1;
+    while(rxpos > 0 && rxpos != handled) {
+      handled = rxpos;
       // BSSID Packet
       if(rx[0] == OPCODE_CONNECT_BSSID) {
         // Enough Data available
@@ -446,10 +606,10 @@ int friendFinder(){
         rxpos -= 1;
       }
     }
-    // Original value was 10 ms, I think 100 is just fine
-    sleep_ms(100);
   }
 
+  closeReactorWakeSocket();
+
   // Log Shutdown
   INFO_LOG(SCENET, "FriendFinder: End of Friend Finder Thread");
 
@@ -457,6 +617,97 @@ int friendFinder(){
   return 0;
 }
 
+int waitForSockets(const int * fds, const int * events, int * revents, int count, int timeoutMs) {
+#ifdef _MSC_VER
+  // Windows (before Vista) has no poll, but select is fine for a handful of Sockets
+  fd_set readfds, writefds;
+  FD_ZERO(&readfds);
+  FD_ZERO(&writefds);
+  int i = 0; for(; i < count; i++) {
+    if(events[i] & ADHOC_WAIT_READ) FD_SET(fds[i], &readfds);
+    if(events[i] & ADHOC_WAIT_WRITE) FD_SET(fds[i], &writefds);
+  }
+
+  timeval tv;
+  tv.tv_sec = timeoutMs / 1000;
+  tv.tv_usec = (timeoutMs % 1000) * 1000;
+  int result = select(0, &readfds, &writefds, NULL, timeoutMs < 0 ? NULL : &tv);
+  if(result <= 0) return result;
+
+  int ready = 0;
+  for(i = 0; i < count; i++) {
+    int flags = 0;
+    if(FD_ISSET(fds[i], &readfds)) flags |= ADHOC_WAIT_READ;
+    if(FD_ISSET(fds[i], &writefds)) flags |= ADHOC_WAIT_WRITE;
+    if(revents != NULL) revents[i] = flags;
+    if(flags != 0) ready++;
+  }
+  return ready;
+#else
+  pollfd stackfds[16];
+  std::vector<pollfd> heapfds;
+  pollfd * pfds = stackfds;
+  if(count > (int)ARRAY_SIZE(stackfds)) {
+    heapfds.resize(count);
+    pfds = &heapfds[0];
+  }
+
+  int i = 0; for(; i < count; i++) {
+    pfds[i].fd = fds[i];
+    pfds[i].events = ((events[i] & ADHOC_WAIT_READ) ? POLLIN : 0) | ((events[i] & ADHOC_WAIT_WRITE) ? POLLOUT : 0);
+    pfds[i].revents = 0;
+  }
+
+  int result = poll(pfds, count, timeoutMs);
+  if(result <= 0) return result;
+
+  if(revents != NULL) {
+    for(i = 0; i < count; i++) {
+      // Errors and Hangups count as ready, so the caller's recv/send sees them
+      int flags = 0;
+      if(pfds[i].revents & (POLLIN | POLLERR | POLLHUP)) flags |= (events[i] & ADHOC_WAIT_READ);
+      if(pfds[i].revents & (POLLOUT | POLLERR | POLLHUP)) flags |= (events[i] & ADHOC_WAIT_WRITE);
+      revents[i] = flags;
+    }
+  }
+  return result;
+#endif
+}
+
+int waitForSocket(int fd, int events, int timeoutMs) {
+  reactorLock.lock();
+
+  // No Reactor running (or just checking), wait on the Socket directly
+  if(timeoutMs == 0 || reactorWakeSocket == (int)INVALID_SOCKET) {
+    reactorLock.unlock();
+    return waitForSockets(&fd, &events, NULL, 1, timeoutMs);
+  }
+
+  // Register the Wait and kick the Reactor, so it polls this Socket right away
+  AdhocReactorSocket & entry = reactorSockets[fd];
+  entry.events |= events;
+  entry.waiters++;
+  char wake = 0;
+  sendto(reactorWakeSocket, &wake, 1, 0, (sockaddr *)&reactorWakeAddr, sizeof(reactorWakeAddr));
+
+  uint64_t starttime = (uint64_t)(real_time_now()*1000.0);
+  while((entry.revents & events) == 0 && reactorWakeSocket != (int)INVALID_SOCKET) {
+    if(timeoutMs < 0) {
+      reactorCond.wait(reactorLock);
+    } else {
+      int remaining = timeoutMs - (int)((uint64_t)(real_time_now()*1000.0) - starttime);
+      if(remaining <= 0) break;
+      reactorCond.wait_for(reactorLock, remaining);
+    }
+  }
+
+  int result = (entry.revents & events) != 0 ? 1 : 0;
+  entry.revents &= ~events;
+  if(--entry.waiters == 0) reactorSockets.erase(fd);
+  reactorLock.unlock();
+  return result;
+}
+
 int getActivePeerCount(void) {
   // Counter
   int count = 0;
@@ -480,6 +731,11 @@ int getActivePeerCount(void) {
 }
 
 int getLocalIp(sockaddr_in * SocketAddress){
+  // Talking to a Server on this Machine, from our own Loopback Address
+  if(localLoopbackIp != 0) {
+    SocketAddress->sin_addr.s_addr = localLoopbackIp;
+    return 0;
+  }
 #ifdef _MSC_VER
 	// Get local host name
 	char szHostName[128] = "";
@@ -501,6 +757,10 @@ int getLocalIp(sockaddr_in * SocketAddress){
 #endif
 }
 
+uint32_t getLocalBindIp(void) {
+  return localLoopbackIp != 0 ? localLoopbackIp : htonl(INADDR_ANY);
+}
+
 void getLocalMac(SceNetEtherAddr * addr){
 	// Read MAC Address from config
 	uint8_t mac[ETHER_ADDR_LEN] = {0};
@@ -557,6 +817,24 @@ int initNetwork(SceNetAdhocctlAdhocId *adhoc_id){
 		}
 	}
 	server_addr.sin_addr = serverIp;
+
+	// Instances on one Machine would all be 127.0.0.1 to the Server and each other, so each connects from
+	// its own Loopback Address, derived from its MAC (which has to differ between Instances anyway)
+	localLoopbackIp = 0;
+	if((ntohl(serverIp.s_addr) >> 24) == 127) {
+		SceNetEtherAddr mac;
+		getLocalMac(&mac);
+		sockaddr_in local;
+		memset(&local, 0, sizeof(local));
+		local.sin_family = AF_INET;
+		local.sin_addr.s_addr = htonl(0x7F010000 | (mac.data[4] << 8) | mac.data[5]);
+		local.sin_port = 0;
+		if(bind(metasocket, (sockaddr *)&local, sizeof(local)) == 0)
+			localLoopbackIp = local.sin_addr.s_addr;
+		else
+			WARN_LOG(SCENET, "Couldn't bind to own loopback address %s, other local instances will look alike", inet_ntoa(local.sin_addr));
+	}
+
 	iResult = connect(metasocket,(sockaddr *)&server_addr,sizeof(server_addr));
 	if(iResult == SOCKET_ERROR){
 		ERROR_LOG(SCENET,"Socket error");
@@ -604,22 +882,17 @@ int resolveIP(uint32_t ip, SceNetEtherAddr * mac) {
   // Multithreading Lock
   peerlock.lock();
 
-  // Peer Reference
-  SceNetAdhocctlPeerInfo * peer = friends;
-
-  // Iterate Peers
-  for(; peer != NULL; peer = peer->next) {
-    // Found Matching Peer
-    if(peer->ip_addr == ip) {
-      // Copy Data
-      *mac = peer->mac_addr;
+  // Find Peer
+  auto found = friendsByIP.find(ip);
+  if(found != friendsByIP.end()) {
+    // Copy Data
+    *mac = found->second->mac_addr;
 
-      // Multithreading Unlock
-      peerlock.unlock();
+    // Multithreading Unlock
+    peerlock.unlock();
 
-      // Return Success
-      return 0;
-    }
+    // Return Success
+    return 0;
   }
 
   // Multithreading Unlock
@@ -645,22 +918,17 @@ int resolveMAC(SceNetEtherAddr * mac, uint32_t * ip) {
   // Multithreading Lock
   peerlock.lock();
 
-  // Peer Reference
-  SceNetAdhocctlPeerInfo * peer = friends;
-
-  // Iterate Peers
-  for(; peer != NULL; peer = peer->next) {
-    // Found Matching Peer
-    if(memcmp(&peer->mac_addr, mac, sizeof(SceNetEtherAddr)) == 0) {
-      // Copy Data
-      *ip = peer->ip_addr;
+  // Find Peer
+  auto found = friendsByMAC.find(macToKey(mac));
+  if(found != friendsByMAC.end()) {
+    // Copy Data
+    *ip = found->second->ip_addr;
 
-      // Multithreading Unlock
-      peerlock.unlock();
+    // Multithreading Unlock
+    peerlock.unlock();
 
-      // Return Success
-      return 0;
-    }
+    // Return Success
+    return 0;
   }
 
   // Multithreading Unlock
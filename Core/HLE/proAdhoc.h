@@ -26,6 +26,7 @@
 #include <arpa/inet.h>
 #include <fcntl.h>
 #include <errno.h>
+#include <poll.h>
 #endif
 #ifdef _MSC_VER
 #define PACK
@@ -465,6 +466,32 @@ void addFriend(SceNetAdhocctlConnectPacketS2C * packet);
  */
 void changeBlockingMode(int fd, int nonblocking);
 
+// Events for waitForSockets
+#define ADHOC_WAIT_READ 1
+#define ADHOC_WAIT_WRITE 2
+
+/**
+ * Wait until any of the Sockets is ready (poll, or select on Windows)
+ * @param fds Sockets to wait on
+ * @param events ADHOC_WAIT_* Flags for each Socket
+ * @param revents OUT: Ready ADHOC_WAIT_* Flags for each Socket (may be NULL)
+ * @param count Number of Sockets
+ * @param timeoutMs Timeout in Milliseconds, 0 to just check, or -1 to wait forever
+ * @return Number of ready Sockets, 0 on timeout or... -1 on error
+ */
+int waitForSockets(const int * fds, const int * events, int * revents, int count, int timeoutMs);
+
+/**
+ * Wait until a Socket is ready, instead of polling it in a sleep loop
+ * While the Friend Finder runs, its Reactor polls the Socket together with the Metasocket
+ * and every other adhoc Socket somebody waits on, and wakes the caller up.
+ * @param fd Socket to wait on
+ * @param events ADHOC_WAIT_* Flags
+ * @param timeoutMs Timeout in Milliseconds, 0 to just check, or -1 to wait forever
+ * @return 1 if ready, 0 on timeout or... -1 on error
+ */
+int waitForSocket(int fd, int events, int timeoutMs);
+
 /**
  * Count Virtual Networks by analyzing the Friend List
  * @return Number of Virtual Networks
@@ -526,6 +553,13 @@ int getActivePeerCount(void);
  */
 int getLocalIp(sockaddr_in * SocketAddress);
 
+/**
+ * Address to bind PDP/PTP Sockets to: this Instance's own Loopback Address when the Adhoc Server
+ * runs on the same Machine (so several Instances can use the same Ports), INADDR_ANY otherwise
+ * @return Address in Network Byte Order
+ */
+uint32_t getLocalBindIp(void);
+
 /**
  * Joins two 32 bits number into a 64 bit one
  * @param num1: first number
@@ -631,6 +631,7 @@ u32 _AtracDecodeData(int atracID, u8* outbuf, u32 *SamplesNum, u32* finish, int
 								ERROR_LOG(ME, "swr_convert: Error while converting %d", avret);
 							}
 							__AdjustBGMVolume((s16 *)out, numSamples * atrac->atracOutputChannels);
+					Memory::MarkDirtyRange(samplesAddr, numSamples * atrac->atracOutputChannels * sizeof(s16));
 						}
 					}
 					av_free_packet(&packet);
@@ -676,6 +677,8 @@ u32 sceAtracDecodeData(int atracID, u32 outAddr, u32 numSamplesAddr, u32 finishF
 	int remains = 0;
 	int ret = _AtracDecodeData(atracID, Memory::GetPointer(outAddr), &numSamples, &finish, &remains);
 	if (ret != (int)ATRAC_ERROR_BAD_ATRACID && ret != (int)ATRAC_ERROR_NO_DATA) {
+		// At most stereo 16-bit.
+		Memory::MarkDirtyRange(outAddr, numSamples * 4);
 		Memory::Write_U32(numSamples, numSamplesAddr);
 		Memory::Write_U32(finish, finishFlagAddr);
 		Memory::Write_U32(remains, remainAddr);
@@ -1789,6 +1792,7 @@ int sceAtracLowLevelDecode(int atracID, u32 sourceAddr, u32 sourceBytesConsumedA
 						ERROR_LOG(ME, "swr_convert: Error while converting %d", avret);
 					}
 					__AdjustBGMVolume((s16 *)out, numSamples * atrac->atracOutputChannels);
+					Memory::MarkDirtyRange(samplesAddr, numSamples * atrac->atracOutputChannels * sizeof(s16));
 				}
 				av_free_packet(&packet);
 				if (got_frame)
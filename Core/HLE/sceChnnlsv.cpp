@@ -19,6 +19,7 @@
 
 #include "sceChnnlsv.h"
 #include "sceKernel.h"
+#include "Core/ELF/PrxDecrypter.h"
 extern "C"
 {
 #include "ext/libkirk/kirk_engine.h"
@@ -97,6 +98,7 @@ int kirkSendCmd(u8* data, int length, int num, bool encrypt)
 	*(int*)(data+12) = num;
 	*(int*)(data+16) = length;
 
+	lock_guard guard(GetKirkLock());
 	if (sceUtilsBufferCopyWithRange(data, length + 20, data, length + 20, encrypt ? KIRK_CMD_ENCRYPT_IV_0 : KIRK_CMD_DECRYPT_IV_0))
 		return -257;
 
@@ -112,6 +114,7 @@ int kirkSendFuseCmd(u8* data, int length, bool encrypt)
 	*(int*)(data+16) = length;
 
 	// Note: CMD 5 and 8 are not available, will always return -1
+	lock_guard guard(GetKirkLock());
 	if (sceUtilsBufferCopyWithRange(data, length + 20, data, length + 20, encrypt ? KIRK_CMD_ENCRYPT_IV_FUSE : KIRK_CMD_DECRYPT_IV_FUSE))
 		return -258;
 
@@ -207,6 +210,7 @@ int sub_1510(u8* data, int size, u8* result , int num)
 
 int sub_17A8(u8* data)
 {
+	lock_guard guard(GetKirkLock());
 	if (sceUtilsBufferCopyWithRange(data, 20, 0, 0, 14) == 0)
 		return 0;
 	return -261;
@@ -217,6 +221,7 @@ int sceSdGetLastIndex(u32 addressCtx, u32 addressHash, u32 addressKey)
 	pspChnnlsvContext1 ctx;
 	Memory::ReadStruct(addressCtx, &ctx);
 	int res = sceSdGetLastIndex_(ctx, Memory::GetPointer(addressHash), Memory::GetPointer(addressKey));
+	Memory::MarkDirtyRange(addressHash, 16);
 	Memory::WriteStruct(addressCtx, &ctx);
 	return res;
 }
@@ -402,6 +407,7 @@ int sceSdCreateList(u32 ctx2Addr, int mode, int unkwn, u32 dataAddr, u32 cryptke
 	u8* cryptkey = Memory::GetPointer(cryptkeyAddr);
 
 	int res = sceSdCreateList_(ctx2, mode, unkwn, data, cryptkey);
+	Memory::MarkDirtyRange(dataAddr, 16);
 
 	Memory::WriteStruct(ctx2Addr, &ctx2);
 
@@ -469,6 +475,8 @@ int sceSdSetMember(u32 ctxAddr, u32 dataAddr, int alignedLen)
 	u8* data = Memory::GetPointer(dataAddr);
 
 	int res = sceSdSetMember_(ctx, data, alignedLen);
+	if (alignedLen > 0)
+		Memory::MarkDirtyRange(dataAddr, alignedLen);
 
 	Memory::WriteStruct(ctxAddr, &ctx);
 
@@ -542,5 +550,6 @@ const HLEFunction sceChnnlsv[] =
 void Register_sceChnnlsv()
 {
 	RegisterModule("sceChnnlsv", ARRAY_SIZE(sceChnnlsv), sceChnnlsv);
+	lock_guard guard(GetKirkLock());
 	kirk_init();
 }
@@ -19,6 +19,7 @@
 #include "Core/HLE/HLE.h"
 #include "Core/MIPS/MIPS.h"
 #include "Core/CoreTiming.h"
+#include "Core/InputMovie.h"
 #include "Common/ChunkFile.h"
 #include "Common/StdMutex.h"
 #include "Core/HLE/sceCtrl.h"
@@ -93,6 +94,8 @@ static int ctrlTimer = -1;
 // Not related to sceCtrl*RapidFire(), although it may do the same thing.
 static bool emuRapidFire = false;
 static u32 emuRapidFireFrames = 0;
+// What the host is pressing.  While an input movie is active, this only reaches ctrlCurrent at vblank.
+static _ctrl_data ctrlHost;
 
 // These buttons are not affected by rapid fire (neither is analog.)
 const u32 CTRL_EMU_RAPIDFIRE_MASK = CTRL_UP | CTRL_DOWN | CTRL_LEFT | CTRL_RIGHT;
@@ -104,7 +107,8 @@ void __CtrlUpdateLatch()
 	// Copy in the current data to the current buffer.
 	ctrlBufs[ctrlBuf] = ctrlCurrent;
 	u32 buttons = ctrlCurrent.buttons;
-	if (emuRapidFire && (emuRapidFireFrames % 10) < 5)
+	// Movies record buttons as pressed, so rapid fire would make them desync.
+	if (emuRapidFire && !InputMovie::IsActive() && (emuRapidFireFrames % 10) < 5)
 	{
 		ctrlBufs[ctrlBuf].buttons &= CTRL_EMU_RAPIDFIRE_MASK;
 		buttons &= CTRL_EMU_RAPIDFIRE_MASK;
@@ -166,28 +170,41 @@ u32 __CtrlReadLatch()
 // Functions so that the rest of the emulator can control what the sceCtrl interface should return
 // to the game:
 
+static void __CtrlHostChanged()
+{
+	if (!InputMovie::IsActive())
+	{
+		ctrlCurrent.buttons = ctrlHost.buttons;
+		memcpy(ctrlCurrent.analog, ctrlHost.analog, sizeof(ctrlCurrent.analog));
+	}
+}
+
 void __CtrlButtonDown(u32 buttonBit)
 {
 	std::lock_guard<std::recursive_mutex> guard(ctrlMutex);
-	ctrlCurrent.buttons |= buttonBit;
+	ctrlHost.buttons |= buttonBit;
+	__CtrlHostChanged();
 }
 
 void __CtrlButtonUp(u32 buttonBit)
 {
 	std::lock_guard<std::recursive_mutex> guard(ctrlMutex);
-	ctrlCurrent.buttons &= ~buttonBit;
+	ctrlHost.buttons &= ~buttonBit;
+	__CtrlHostChanged();
 }
 
 void __CtrlSetAnalogX(float x, int stick)
 {
 	std::lock_guard<std::recursive_mutex> guard(ctrlMutex);
-	ctrlCurrent.analog[stick][CTRL_ANALOG_X] = (u8)ceilf(x * 127.5f + 127.5f);
+	ctrlHost.analog[stick][CTRL_ANALOG_X] = (u8)ceilf(x * 127.5f + 127.5f);
+	__CtrlHostChanged();
 }
 
 void __CtrlSetAnalogY(float y, int stick)
 {
 	std::lock_guard<std::recursive_mutex> guard(ctrlMutex);
-	ctrlCurrent.analog[stick][CTRL_ANALOG_Y] = (u8)ceilf(-y * 127.5f + 127.5f);
+	ctrlHost.analog[stick][CTRL_ANALOG_Y] = (u8)ceilf(-y * 127.5f + 127.5f);
+	__CtrlHostChanged();
 }
 
 void __CtrlSetRapidFire(bool state)
@@ -275,6 +292,17 @@ void __CtrlVblank()
 {
 	emuRapidFireFrames++;
 
+	{
+		std::lock_guard<std::recursive_mutex> guard(ctrlMutex);
+		// Records the host's input, or replaces it with a movie's.  Without a movie, nothing changes.
+		InputMovie::Frame frame;
+		frame.buttons = ctrlHost.buttons;
+		memcpy(frame.analog, ctrlHost.analog, sizeof(frame.analog));
+		InputMovie::Vblank(frame);
+		ctrlCurrent.buttons = frame.buttons;
+		memcpy(ctrlCurrent.analog, frame.analog, sizeof(ctrlCurrent.analog));
+	}
+
 	// This always runs, so make sure we're in vblank mode.
 	if (ctrlCycle == 0)
 		__CtrlDoSample();
@@ -312,6 +340,7 @@ void __CtrlInit()
 
 	memset(&ctrlCurrent, 0, sizeof(ctrlCurrent));
 	memset(ctrlCurrent.analog, CTRL_ANALOG_CENTER, sizeof(ctrlCurrent.analog));
+	ctrlHost = ctrlCurrent;
 	analogEnabled = false;
 
 	for (u32 i = 0; i < NUM_CTRL_BUFFERS; i++)
@@ -17,52 +17,127 @@
 
 #include "zlib.h"
 
+#include "base/timeutil.h"
 #include "Common/CommonTypes.h"
 #include "Core/HLE/HLE.h"
+#include "Core/HLE/sceDeflt.h"
+#include "Core/MemMap.h"
+
+static DeflateStats deflateStats;
+
+// How many bytes are valid starting at address, up to size.
+static u32 ClampToValidMemory(u32 address, u32 size) {
+	u32 end;
+	if ((address & 0x3F000000) >= 0x08000000 && (address & 0x3F000000) < 0x08000000 + Memory::g_MemorySize) {
+		end = 0x08000000 + Memory::g_MemorySize;
+	} else if ((address & 0x3F800000) == 0x04000000) {
+		end = 0x04800000;
+	} else if ((address & 0xBFFF0000) == 0x00010000) {
+		end = 0x00014000;
+	} else {
+		return 0;
+	}
+	u32 available = end > (address & 0x3FFFFFFF) ? end - (address & 0x3FFFFFFF) : 0;
+	return size < available ? size : available;
+}
+
+int DeflateDecompressMemory(u32 dst, u32 dstSize, u32 src, u32 srcSize, DeflateFormat format, u32 *consumed) {
+	if (!Memory::IsValidAddress(dst) || !Memory::IsValidAddress(src)) {
+		ERROR_LOG(HLE, "DeflateDecompressMemory: Bad address %08x %08x", dst, src);
+		return Z_STREAM_ERROR;
+	}
+
+	time_update();
+	double startTime = real_time_now();
+
+	static const int windowBits[] = { -MAX_WBITS, MAX_WBITS, 16 + MAX_WBITS };
+	z_stream stream;
+	memset(&stream, 0, sizeof(stream));
+	stream.next_in = (Bytef *)Memory::GetPointerUnchecked(src);
+	stream.avail_in = (uInt)ClampToValidMemory(src, srcSize);
+	stream.next_out = (Bytef *)Memory::GetPointerUnchecked(dst);
+	stream.avail_out = (uInt)ClampToValidMemory(dst, dstSize);
+
+	int err = inflateInit2(&stream, windowBits[format]);
+	if (err != Z_OK) {
+		ERROR_LOG(HLE, "DeflateDecompressMemory: inflateInit failed %08x", err);
+		return err;
+	}
+	err = inflate(&stream, Z_FINISH);
+	inflateEnd(&stream);
+	if (err != Z_STREAM_END) {
+		ERROR_LOG(HLE, "DeflateDecompressMemory: inflate failed %08x", err);
+		// Out of input isn't a full buffer, and there's no way to supply a dictionary.
+		if (err == Z_NEED_DICT || (err == Z_BUF_ERROR && stream.avail_in == 0)) {
+			return Z_DATA_ERROR;
+		}
+		return err;
+	}
+
+	Memory::MarkDirtyRange(dst, (u32)stream.total_out);
+
+	time_update();
+	deflateStats.calls++;
+	deflateStats.bytesIn += stream.total_in;
+	deflateStats.bytesOut += stream.total_out;
+	deflateStats.seconds += real_time_now() - startTime;
+
+	if (consumed) {
+		*consumed = (u32)stream.total_in;
+	}
+	return (int)stream.total_out;
+}
+
+void GetDeflateStats(DeflateStats &stats) {
+	stats = deflateStats;
+}
+
+void ResetDeflateStats() {
+	memset(&deflateStats, 0, sizeof(deflateStats));
+}
 
 int sceZlibDecompress(u32 OutBuffer, int OutBufferLength, u32 InBuffer, u32 Crc32Addr) {
 	DEBUG_LOG(HLE, "sceZlibDecompress(%08x, %x, %08x, %08x)", OutBuffer, OutBufferLength, InBuffer, Crc32Addr);
-	int err;
-	uLong crc;
-	z_stream stream;
-	u8 *outBufferPtr;
-	u32 *crc32AddrPtr = 0;
 
 	if (!Memory::IsValidAddress(OutBuffer) || !Memory::IsValidAddress(InBuffer)) {
 		ERROR_LOG(HLE, "sceZlibDecompress: Bad address %08x %08x", OutBuffer, InBuffer);
 		return 0;
 	}
+	if (Crc32Addr && !Memory::IsValidAddress(Crc32Addr)) {
+		ERROR_LOG(HLE, "sceZlibDecompress: Bad address %08x", Crc32Addr);
+		return 0;
+	}
+
+	// The input size isn't passed, so let it run to the end of the stream.
+	int written = DeflateDecompressMemory(OutBuffer, OutBufferLength, InBuffer, 0xFFFFFFFF, DEFLATE_FORMAT_ZLIB, NULL);
+	if (written < 0) {
+		return 0;
+	}
 	if (Crc32Addr) {
-		if (!Memory::IsValidAddress(Crc32Addr)) {
-			ERROR_LOG(HLE, "sceZlibDecompress: Bad address %08x", Crc32Addr);
-			return 0;
-		}
-		crc32AddrPtr = (u32 *)Memory::GetPointer(Crc32Addr);
+		uLong crc = crc32(0L, Z_NULL, 0);
+		Memory::Write_U32((u32)crc32(crc, Memory::GetPointerUnchecked(OutBuffer), written), Crc32Addr);
 	}
-	outBufferPtr = Memory::GetPointer(OutBuffer);
-	stream.next_in = (Bytef*)Memory::GetPointer(InBuffer);
-	stream.avail_in = (uInt)OutBufferLength;
-	stream.next_out = outBufferPtr;
-	stream.avail_out = (uInt)OutBufferLength;
-	stream.zalloc = (alloc_func)0;
-	stream.zfree = (free_func)0;
-	err = inflateInit(&stream);
-	if (err != Z_OK) {
-		ERROR_LOG(HLE, "sceZlibDecompress: inflateInit failed %08x", err);
+	return written;
+}
+
+int sceDeflateDecompress(u32 OutBuffer, int OutBufferLength, u32 InBuffer, u32 CursorAddr) {
+	DEBUG_LOG(HLE, "sceDeflateDecompress(%08x, %x, %08x, %08x)", OutBuffer, OutBufferLength, InBuffer, CursorAddr);
+
+	if (!Memory::IsValidAddress(OutBuffer) || !Memory::IsValidAddress(InBuffer)) {
+		ERROR_LOG(HLE, "sceDeflateDecompress: Bad address %08x %08x", OutBuffer, InBuffer);
 		return 0;
 	}
-	err = inflate(&stream, Z_FINISH);
-	if (err != Z_STREAM_END) {
-		inflateEnd(&stream);
-		ERROR_LOG(HLE, "sceZlibDecompress: inflate failed %08x", err);
+
+	u32 consumed = 0;
+	int written = DeflateDecompressMemory(OutBuffer, OutBufferLength, InBuffer, 0xFFFFFFFF, DEFLATE_FORMAT_RAW, &consumed);
+	if (written < 0) {
 		return 0;
 	}
-	inflateEnd(&stream);
-	if (crc32AddrPtr) {
-		crc = crc32(0L, Z_NULL, 0);
-		*crc32AddrPtr = crc32(crc, outBufferPtr, stream.total_out);
+	// The cursor is where the compressed data ended.
+	if (Memory::IsValidAddress(CursorAddr)) {
+		Memory::Write_U32(InBuffer + consumed, CursorAddr);
 	}
-	return stream.total_out;
+	return written;
 }
 
 const HLEFunction sceDeflt[] = {
@@ -70,7 +145,7 @@ const HLEFunction sceDeflt[] = {
 	{0x106A3552, 0,	"sceGzipGetName"},
 	{0x1B5B82BC, 0,	"sceGzipIsValid"},
 	{0x2EE39A64, 0, "sceZlibAdler32"},
-	{0x44054E03, 0, "sceDeflateDecompress"},
+	{0x44054E03, WrapI_UIUU<sceDeflateDecompress>, "sceDeflateDecompress"},
 	{0x6A548477, 0,	"sceZlibGetCompressedData"},
 	{0x6DBCF897, 0, "sceGzipDecompress"},
 	{0x8AA82C92, 0,	"sceGzipGetInfo"},
@@ -17,4 +17,30 @@
 
 #pragma once
 
+#include "Common/CommonTypes.h"
+
+enum DeflateFormat {
+	DEFLATE_FORMAT_RAW,
+	DEFLATE_FORMAT_ZLIB,
+	DEFLATE_FORMAT_GZIP,
+};
+
+struct DeflateStats {
+	u32 calls;
+	u64 bytesIn;
+	u64 bytesOut;
+	double seconds;
+};
+
+// Inflates directly from and to PSP memory, without copying.  srcSize may be larger than the
+// stream, and is clamped to valid memory.  Returns the number of bytes written, or a negative zlib
+// error, mapped like zlib's uncompress() does: Z_BUF_ERROR if dst is too small, Z_DATA_ERROR if the
+// stream is corrupt or cut short.
+// If consumed is not NULL, it receives the number of input bytes used.
+int DeflateDecompressMemory(u32 dst, u32 dstSize, u32 src, u32 srcSize, DeflateFormat format, u32 *consumed);
+
+// Totals for everything decompressed through the above, for timing loads.
+void GetDeflateStats(DeflateStats &stats);
+void ResetDeflateStats();
+
 void Register_sceDeflt();
@@ -31,19 +31,27 @@
 #endif
 
 #include "Common/ChunkFile.h"
+#include "Common/FileUtil.h"
 #include "Core/CoreTiming.h"
 #include "Core/CoreParameter.h"
 #include "Core/Reporting.h"
 #include "Core/Config.h"
 #include "Core/System.h"
+#include "Core/MemMap.h"
 #include "Core/HLE/HLE.h"
 #include "Core/HLE/sceDisplay.h"
+#include "Core/HLE/sceIo.h"
 #include "Core/HLE/sceKernel.h"
 #include "Core/HLE/sceKernelThread.h"
 #include "Core/HLE/sceKernelInterrupt.h"
+#include "Core/MIPS/JitCommon/JitBlockCache.h"
+#include "Core/HW/AsyncIOManager.h"
+#include "Core/HW/MediaEngine.h"
+#include "Core/ThreadEventQueue.h"
 
 #include "GPU/GPUState.h"
 #include "GPU/GPUInterface.h"
+#include "GPU/Debugger/Record.h"
 
 struct FrameBufferState {
 	u32 topaddr;
@@ -134,6 +142,26 @@ static u64 lastFlipCycles = 0;
 // For the "max 60 fps" setting.
 static int lastFlipsTooFrequent = 0;
 
+// Per-flip timing, for the debug stats and headless.  Not part of the state either.
+struct FrameTimingSample {
+	int flip;
+	// Wall time since the previous flip, split into the parts below.
+	double frameSeconds;
+	double emuSeconds;
+	double gpuSeconds;
+	double sleepSeconds;
+	bool skipped;
+};
+
+static FrameTimingSample frameTimingHistory[1024];
+static size_t frameTimingPos = 0;
+static size_t frameTimingValid = 0;
+static double lastFrameTimingTime = 0.0;
+static double lastFrameGPUSeconds = 0.0;
+static double frameSleepSeconds = 0.0;
+// How much longer than asked sleep_ms(1) tends to take, for precise pacing.
+static double sleepOvershoot = 0.001;
+
 void hleEnterVblank(u64 userdata, int cyclesLate);
 void hleLeaveVblank(u64 userdata, int cyclesLate);
 void hleAfterFlip(u64 userdata, int cyclesLate);
@@ -179,6 +207,11 @@ void __DisplayInit() {
 	fpsHistoryValid = 0;
 	fpsHistoryPos = 0;
 	fpsHistoryValid = 0;
+	frameTimingPos = 0;
+	frameTimingValid = 0;
+	lastFrameTimingTime = 0.0;
+	lastFrameGPUSeconds = gpuTotalSecondsProcessingDisplayLists;
+	frameSleepSeconds = 0.0;
 
 	InitGfxState();
 
@@ -358,17 +391,124 @@ void CalculateFPS() {
 	}
 }
 
+static void RecordFrameTiming(bool skipped) {
+	double now = real_time_now();
+	// Not msProcessingDisplayLists, which the debug stats reset whenever they're shown.
+	double gpuTotal = gpuTotalSecondsProcessingDisplayLists;
+	double gpuSeconds = gpuTotal - lastFrameGPUSeconds;
+	lastFrameGPUSeconds = gpuTotal;
+
+	if (lastFrameTimingTime != 0.0) {
+		FrameTimingSample &sample = frameTimingHistory[frameTimingPos];
+		sample.flip = gpuStats.numFlips;
+		sample.frameSeconds = now - lastFrameTimingTime;
+		sample.gpuSeconds = gpuSeconds;
+		sample.sleepSeconds = frameSleepSeconds;
+		sample.emuSeconds = std::max(0.0, sample.frameSeconds - gpuSeconds - frameSleepSeconds);
+		sample.skipped = skipped;
+
+		frameTimingPos = (frameTimingPos + 1) % ARRAY_SIZE(frameTimingHistory);
+		frameTimingValid = std::min(frameTimingValid + 1, ARRAY_SIZE(frameTimingHistory));
+	}
+	lastFrameTimingTime = now;
+}
+
+// Index 0 is the oldest sample still kept.
+static const FrameTimingSample &GetFrameTimingSample(size_t i) {
+	size_t start = frameTimingValid < ARRAY_SIZE(frameTimingHistory) ? 0 : frameTimingPos;
+	return frameTimingHistory[(start + i) % ARRAY_SIZE(frameTimingHistory)];
+}
+
+static double Percentile(std::vector<double> &values, double p) {
+	if (values.empty())
+		return 0.0;
+	size_t index = (size_t)((values.size() - 1) * p + 0.5);
+	std::nth_element(values.begin(), values.begin() + index, values.end());
+	return values[index];
+}
+
+void __DisplayGetFrameTimingStats(FrameTimingStats &stats) {
+	std::vector<double> frame, emu, gpu, sleep;
+	frame.reserve(frameTimingValid);
+	emu.reserve(frameTimingValid);
+	gpu.reserve(frameTimingValid);
+	sleep.reserve(frameTimingValid);
+	stats.frames = (int)frameTimingValid;
+	stats.skipped = 0;
+	for (size_t i = 0; i < frameTimingValid; ++i) {
+		const FrameTimingSample &sample = frameTimingHistory[i];
+		frame.push_back(sample.frameSeconds);
+		emu.push_back(sample.emuSeconds);
+		gpu.push_back(sample.gpuSeconds);
+		sleep.push_back(sample.sleepSeconds);
+		if (sample.skipped)
+			stats.skipped++;
+	}
+
+	static const double percentiles[FrameTimingStats::COUNT] = { 0.5, 0.9, 0.99, 1.0 };
+	for (int i = 0; i < FrameTimingStats::COUNT; ++i) {
+		stats.frameSeconds[i] = Percentile(frame, percentiles[i]);
+		stats.emuSeconds[i] = Percentile(emu, percentiles[i]);
+		stats.gpuSeconds[i] = Percentile(gpu, percentiles[i]);
+		stats.sleepSeconds[i] = Percentile(sleep, percentiles[i]);
+	}
+}
+
+bool __DisplayWriteFrameTimingCSV(const std::string &filename) {
+	FILE *f = File::OpenCFile(filename, "wb");
+	if (!f) {
+		ERROR_LOG(SCEDISPLAY, "Unable to write frame timing to %s", filename.c_str());
+		return false;
+	}
+
+	fprintf(f, "flip,frame_ms,emu_ms,gpu_ms,sleep_ms,skipped\n");
+	for (size_t i = 0; i < frameTimingValid; ++i) {
+		const FrameTimingSample &sample = GetFrameTimingSample(i);
+		fprintf(f, "%d,%0.3f,%0.3f,%0.3f,%0.3f,%d\n", sample.flip, sample.frameSeconds * 1000.0, sample.emuSeconds * 1000.0, sample.gpuSeconds * 1000.0, sample.sleepSeconds * 1000.0, sample.skipped ? 1 : 0);
+	}
+	fclose(f);
+	INFO_LOG(SCEDISPLAY, "Wrote timing for %d frames to %s", (int)frameTimingValid, filename.c_str());
+	return true;
+}
+
 void __DisplayGetDebugStats(char stats[2048]) {
 	gpu->UpdateStats();
+	hleCollectSyscallStats();
 
 	float vertexAverageCycles = gpuStats.numVertsSubmitted > 0 ? (float)gpuStats.vertexGPUCycles / (float)gpuStats.numVertsSubmitted : 0.0f;
-
-	sprintf(stats,
+	const JitIndirectTargetStats &indirect = jitIndirectTargetStats;
+	u32 indirectTotal = indirect.hits + indirect.misses;
+	float indirectHitRate = indirectTotal > 0 ? (float)indirect.hits * 100.0f / (float)indirectTotal : 0.0f;
+	AsyncIOStats ioReads, ioWrites;
+	int ioMaxInFlight;
+	__IoGetAsyncStats(ioReads, ioWrites, ioMaxInFlight);
+	float ioReadAverage = ioReads.count > 0 ? (float)(ioReads.totalSeconds * 1000.0 / ioReads.count) : 0.0f;
+	VideoDecodeStats videoDecode;
+	GetVideoDecodeStats(videoDecode);
+	float videoDecodeAverage = videoDecode.framesDecoded > 0 ? (float)(videoDecode.totalSeconds * 1000.0 / videoDecode.framesDecoded) : 0.0f;
+	FrameTimingStats frameTiming;
+	__DisplayGetFrameTimingStats(frameTiming);
+	ThreadEventQueueStats gpuQueue;
+	// Reset along with the per frame stats below, so the rate is since the last time they were shown.
+	gpu->GetQueueStats(gpuQueue, true);
+	float gpuQueueRate = gpuQueue.seconds > 0.0 ? (float)(gpuQueue.events / gpuQueue.seconds) : 0.0f;
+	float gpuQueueSyncAverage = gpuQueue.syncs > 0 ? (float)(gpuQueue.syncSeconds * 1000.0 / gpuQueue.syncs) : 0.0f;
+	const Memory::DirtyStats &dirtyTextures = Memory::GetDirtyStats(Memory::DIRTY_TEXTURES);
+	const Memory::DirtyStats &dirtyVertices = Memory::GetDirtyStats(Memory::DIRTY_VERTICES);
+	const Memory::DirtyStats &dirtyRewind = Memory::GetDirtyStats(Memory::DIRTY_REWIND);
+
+	snprintf(stats, 2048,
 		"Frames: %i\n"
+		"Frame time: %0.2f / %0.2f / %0.2f ms (50/90/99%%), %0.2f max\n"
+		"Frame 90%%: emu %0.2f, gpu %0.2f, sleep %0.2f ms, %i of %i skipped\n"
 		"DL processing time: %0.2f ms\n"
 		"Kernel processing time: %0.2f ms\n"
 		"Slowest syscall: %s : %0.2f ms\n"
 		"Most active syscall: %s : %0.2f ms\n"
+		"Indirect jump cache: %0.1f%% of %i hit, %i filled, %i invalidated\n"
+		"Async IO: %i reads (%0.2f ms avg, %0.2f ms max), %i writes, %i in flight max\n"
+		"Video decode: %i frames (%0.2f ms avg, %0.2f ms max), %i ahead, %i queued max\n"
+		"GPU queue: %0.0f events/sec, %i wakeups, %i overflowed, %i syncs (%0.3f ms avg wait)\n"
 		"Draw calls: %i, flushes %i\n"
 		"Cached Draw calls: %i\n"
 		"Alpha Tested draws: %i\n"
@@ -382,16 +522,45 @@ void __DisplayGetDebugStats(char stats[2048]) {
 		"FBOs active: %i\n"
 		"Textures active: %i, decoded: %i\n"
 		"Texture invalidations: %i\n"
+		"Unchanged RAM not hashed: textures %i of %i (%0.1f MB), vertices %i of %i (%0.1f MB), rewind %0.1f MB\n"
 		"Vertex shaders loaded: %i\n"
 		"Fragment shaders loaded: %i\n"
 		"Combined shaders loaded: %i\n",
 		gpuStats.numVBlanks,
+		frameTiming.frameSeconds[FrameTimingStats::P50] * 1000.0,
+		frameTiming.frameSeconds[FrameTimingStats::P90] * 1000.0,
+		frameTiming.frameSeconds[FrameTimingStats::P99] * 1000.0,
+		frameTiming.frameSeconds[FrameTimingStats::MAX] * 1000.0,
+		frameTiming.emuSeconds[FrameTimingStats::P90] * 1000.0,
+		frameTiming.gpuSeconds[FrameTimingStats::P90] * 1000.0,
+		frameTiming.sleepSeconds[FrameTimingStats::P90] * 1000.0,
+		frameTiming.skipped,
+		frameTiming.frames,
 		gpuStats.msProcessingDisplayLists * 1000.0f,
 		kernelStats.msInSyscalls * 1000.0f,
 		kernelStats.slowestSyscallName ? kernelStats.slowestSyscallName : "(none)",
 		kernelStats.slowestSyscallTime * 1000.0f,
 		kernelStats.summedSlowestSyscallName ? kernelStats.summedSlowestSyscallName : "(none)",
 		kernelStats.summedSlowestSyscallTime * 1000.0f,
+		indirectHitRate,
+		indirectTotal,
+		indirect.fills,
+		indirect.invalidations,
+		ioReads.count,
+		ioReadAverage,
+		(float)(ioReads.maxSeconds * 1000.0),
+		ioWrites.count,
+		ioMaxInFlight,
+		videoDecode.framesDecoded,
+		videoDecodeAverage,
+		(float)(videoDecode.maxSeconds * 1000.0),
+		videoDecode.framesAhead,
+		videoDecode.maxQueueDepth,
+		gpuQueueRate,
+		gpuQueue.wakeups,
+		gpuQueue.overflows,
+		gpuQueue.syncs,
+		gpuQueueSyncAverage,
 		gpuStats.numDrawCalls,
 		gpuStats.numFlushes,
 		gpuStats.numCachedDrawCalls,
@@ -408,13 +577,23 @@ void __DisplayGetDebugStats(char stats[2048]) {
 		gpuStats.numTextures,
 		gpuStats.numTexturesDecoded,
 		gpuStats.numTextureInvalidations,
+		(int)dirtyTextures.skips,
+		(int)dirtyTextures.checks,
+		(float)dirtyTextures.bytesSkipped / (1024.0f * 1024.0f),
+		(int)dirtyVertices.skips,
+		(int)dirtyVertices.checks,
+		(float)dirtyVertices.bytesSkipped / (1024.0f * 1024.0f),
+		(float)dirtyRewind.bytesSkipped / (1024.0f * 1024.0f),
 		gpuStats.numVertexShaders,
 		gpuStats.numFragmentShaders,
 		gpuStats.numShaders
 		);
+	// _snprintf on Windows doesn't terminate when it truncates.
+	stats[2047] = '\0';
 
 	gpuStats.ResetFrame();
 	kernelStats.ResetFrame();
+	memset(&jitIndirectTargetStats, 0, sizeof(jitIndirectTargetStats));
 }
 
 enum {
@@ -444,6 +623,42 @@ static float CalculateSmoothTimestep(float lastTimestep) {
 }
 
 // Let's collect all the throttling and frameskipping logic here.
+// Sleeps while there's clearly time left, then spins, so the deadline isn't overshot by a scheduler tick.
+static void WaitUntilPrecise(double deadline) {
+	double now = real_time_now();
+	while (deadline - now > sleepOvershoot + 0.001) {
+		double before = now;
+		sleep_ms(1);
+		now = real_time_now();
+		// Remember the worst recent overshoot, letting it decay slowly.
+		double overshoot = now - before - 0.001;
+		sleepOvershoot = std::min(std::max(overshoot, sleepOvershoot * 0.99), 0.02);
+	}
+	while (now < deadline) {
+		now = real_time_now();
+	}
+	time_update();
+}
+
+// How late a frame can be before precise pacing skips, based on how much recent frame times vary.
+static double FrameSkipTolerance(double timestep) {
+	const size_t count = std::min(frameTimingValid, (size_t)60);
+	if (count < 2)
+		return 0.0;
+
+	double sum = 0.0, sumSquares = 0.0;
+	for (size_t i = frameTimingValid - count; i < frameTimingValid; ++i) {
+		const FrameTimingSample &sample = GetFrameTimingSample(i);
+		double work = sample.frameSeconds - sample.sleepSeconds;
+		sum += work;
+		sumSquares += work * work;
+	}
+	double mean = sum / count;
+	double variance = std::max(0.0, sumSquares / count - mean * mean);
+	// Being late by normal jitter will even out, only skip when it's more than that.
+	return std::min(2.0 * sqrt(variance), timestep);
+}
+
 void DoFrameTiming(bool &throttle, bool &skipFrame, float lastTimestep) {
 	float timestep = CalculateSmoothTimestep(lastTimestep);
 	int fpsLimiter = PSP_CoreParameter().fpsLimit;
@@ -451,6 +666,7 @@ void DoFrameTiming(bool &throttle, bool &skipFrame, float lastTimestep) {
 	if (fpsLimiter == FPS_LIMIT_CUSTOM && g_Config.iFpsLimit == 0)
 		throttle = false;
 	skipFrame = false;
+	frameSleepSeconds = 0.0;
 
 	// Check if the frameskipping code should be enabled. If neither throttling or frameskipping is on,
 	// we have nothing to do here.
@@ -483,7 +699,11 @@ void DoFrameTiming(bool &throttle, bool &skipFrame, float lastTimestep) {
 	if (g_Config.bAutoFrameSkip || (g_Config.iFrameSkip == 0 && fpsLimiter == FPS_LIMIT_CUSTOM && g_Config.iFpsLimit > 60)) {
 		// autoframeskip
 		if (curFrameTime > nextFrameTime && doFrameSkip) {
-			skipFrame = true;
+			if (g_Config.bPreciseFramePacing) {
+				skipFrame = curFrameTime - nextFrameTime > FrameSkipTolerance(timestep);
+			} else {
+				skipFrame = true;
+			}
 		}
 	} else if (g_Config.iFrameSkip >= 1)	{
 		// fixed frameskip
@@ -499,10 +719,15 @@ void DoFrameTiming(bool &throttle, bool &skipFrame, float lastTimestep) {
 			nextFrameTime = curFrameTime + timestep;
 		} else {
 			// Wait until we've caught up.
-			while (time_now_d() < nextFrameTime) {
-				sleep_ms(1); // Sleep for 1ms on this thread
-				time_update();
+			if (g_Config.bPreciseFramePacing) {
+				WaitUntilPrecise(nextFrameTime);
+			} else {
+				while (time_now_d() < nextFrameTime) {
+					sleep_ms(1); // Sleep for 1ms on this thread
+					time_update();
+				}
 			}
+			frameSleepSeconds = time_now_d() - curFrameTime;
 		}
 		curFrameTime = time_now_d();
 	}
@@ -603,6 +828,7 @@ void hleEnterVblank(u64 userdata, int cyclesLate) {
 			gstate_c.skipDrawReason &= ~SKIPDRAW_SKIPFRAME;
 			numSkippedFrames = 0;
 		}
+		RecordFrameTiming(skipFrame);
 
 		// Returning here with coreState == CORE_NEXTFRAME causes a buffer flip to happen (next frame).
 		// Right after, we regain control for a little bit in hleAfterFlip. I think that's a great
@@ -614,6 +840,7 @@ void hleEnterVblank(u64 userdata, int cyclesLate) {
 
 void hleAfterFlip(u64 userdata, int cyclesLate)
 {
+	GPURecord::NotifyBeginFrame(framebuf.topaddr, framebuf.pspFramebufLinesize, framebuf.pspFramebufFormat);
 	gpu->BeginFrame();  // doesn't really matter if begin or end of frame.
 }
 
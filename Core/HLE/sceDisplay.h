@@ -17,6 +17,8 @@
 
 #pragma once
 
+#include <string>
+
 void __DisplayInit();
 void __DisplayDoState(PointerWrap &p);
 void __DisplayShutdown();
@@ -34,6 +36,27 @@ typedef void (*VblankCallback)();
 void __DisplayListenVblank(VblankCallback callback);
 
 void __DisplayGetDebugStats(char stats[2048]);
+
+// Percentiles over the last 1024 flips.
+struct FrameTimingStats {
+	enum {
+		P50,
+		P90,
+		P99,
+		MAX,
+		COUNT,
+	};
+	double frameSeconds[COUNT];
+	double emuSeconds[COUNT];
+	double gpuSeconds[COUNT];
+	double sleepSeconds[COUNT];
+	int frames;
+	int skipped;
+};
+
+void __DisplayGetFrameTimingStats(FrameTimingStats &stats);
+// Writes the same flips as CSV, oldest first.
+bool __DisplayWriteFrameTimingCSV(const std::string &filename);
 void __DisplayGetFPS(float *out_vps, float *out_fps, float *out_actual_fps);
 void __DisplayGetVPS(float *out_vps);
 void __DisplayGetAveragedFPS(float *out_vps, float *out_fps);
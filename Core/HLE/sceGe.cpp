@@ -509,6 +509,7 @@ u32 sceGeSaveContext(u32 ctxAddr)
 	if (Memory::IsValidAddress(ctxAddr))
 	{
 		gstate.Save((u32_le *)Memory::GetPointer(ctxAddr));
+		Memory::MarkDirtyRange(ctxAddr, 512 * 4);
 	}
 
 	// This action should probably be pushed to the end of the queue of the display thread -
@@ -32,6 +32,7 @@
 #include "Core/CoreTiming.h"
 #include "Core/Reporting.h"
 
+#include "Core/ELF/PrxDecrypter.h"
 #include "Core/FileSystems/FileSystem.h"
 #include "Core/FileSystems/MetaFileSystem.h"
 #include "Core/FileSystems/ISOFileSystem.h"
@@ -472,8 +473,10 @@ void __IoInit() {
 
 	ioManagerThreadEnabled = g_Config.bSeparateIOThread;
 	ioManager.SetThreadEnabled(ioManagerThreadEnabled);
+	ioManager.ResetStats();
 	if (ioManagerThreadEnabled) {
 		Core_ListenShutdown(&__IoWakeManager);
+		ioManager.StartWorkers(g_Config.iIOWorkerThreads);
 		ioManagerThread = new std::thread(&__IoManagerThread);
 		ioManagerThread->detach();
 	}
@@ -496,6 +499,31 @@ void __IoDoState(PointerWrap &p) {
 	p.Do(memStickFatCallbacks);
 }
 
+static void __IoLogAsyncStats(const char *name, const AsyncIOStats &stats) {
+	if (stats.count == 0) {
+		return;
+	}
+
+	std::string buckets;
+	for (int i = 0; i < IO_LATENCY_BUCKETS; ++i) {
+		if (stats.latency[i] == 0) {
+			continue;
+		}
+		char temp[64];
+		if (i == IO_LATENCY_BUCKETS - 1) {
+			sprintf(temp, " >=%dus:%d", 1 << (i - 1), stats.latency[i]);
+		} else {
+			sprintf(temp, " <%dus:%d", 1 << i, stats.latency[i]);
+		}
+		buckets += temp;
+	}
+	INFO_LOG(SCEIO, "Async %s: %d ops, %lld bytes, %0.3f ms avg, %0.3f ms max,%s", name, stats.count, (long long)stats.bytes, stats.totalSeconds * 1000.0 / stats.count, stats.maxSeconds * 1000.0, buckets.c_str());
+}
+
+void __IoGetAsyncStats(AsyncIOStats &reads, AsyncIOStats &writes, int &maxInFlight) {
+	ioManager.GetStats(reads, writes, maxInFlight);
+}
+
 void __IoShutdown() {
 	ioManagerThreadEnabled = false;
 	ioManager.SyncThread();
@@ -506,6 +534,12 @@ void __IoShutdown() {
 		ioManager.Shutdown();
 	}
 
+	AsyncIOStats readStats, writeStats;
+	int maxInFlight;
+	ioManager.GetStats(readStats, writeStats, maxInFlight);
+	__IoLogAsyncStats("reads", readStats);
+	__IoLogAsyncStats("writes", writeStats);
+
 	pspFileSystem.Unmount("ms0:", memstickSystem);
 	pspFileSystem.Unmount("fatms0:", memstickSystem);
 	pspFileSystem.Unmount("fatms:", memstickSystem);
@@ -699,7 +733,10 @@ u32 npdrmRead(FileNode *f, u8 *data, int size) {
 			blockPos = block*pgd->block_size;
 			pspFileSystem.SeekFile(f->handle, (s32)pgd->data_offset+blockPos, FILEMOVE_BEGIN);
 			pspFileSystem.ReadFile(f->handle, pgd->block_buf, pgd->block_size);
-			pgd_decrypt_block(pgd, block);
+			{
+				lock_guard kirkGuard(GetKirkLock());
+				pgd_decrypt_block(pgd, block);
+			}
 			pgd->current_block = block;
 		}
 
@@ -741,6 +778,7 @@ bool __IoRead(int &result, int id, u32 data_addr, int size) {
 			u8 *data = (u8*) Memory::GetPointer(data_addr);
 			if (f->npdrm) {
 				result = npdrmRead(f, data, size);
+				Memory::MarkDirtyRange(data_addr, size);
 				return true;
 			} else if (__KernelIsDispatchEnabled() && ioManagerThreadEnabled && size > IO_THREAD_MIN_DATA_SIZE) {
 				AsyncIOEvent ev = IO_EVENT_READ;
@@ -1888,6 +1926,7 @@ u32 sceIoDread(int id, u32 dirent_addr) {
 	DirListing *dir = kernelObjects.Get<DirListing>(id, error);
 	if (dir) {
 		SceIoDirEnt *entry = (SceIoDirEnt*) Memory::GetPointer(dirent_addr);
+		Memory::MarkDirtyRange(dirent_addr, sizeof(SceIoDirEnt));
 
 		if (dir->index == (int) dir->listing.size()) {
 			DEBUG_LOG(SCEIO, "sceIoDread( %d %08x ) - end of the line", id, dirent_addr);
@@ -1959,7 +1998,10 @@ int __IoIoctl(u32 id, u32 cmd, u32 indataPtr, u32 inlen, u32 outdataPtr, u32 out
 		DEBUG_LOG(SCEIO, "Decrypting PGD DRM files");
 		pspFileSystem.SeekFile(f->handle, (s32)f->pgd_offset, FILEMOVE_BEGIN);
 		pspFileSystem.ReadFile(f->handle, pgd_header, 0x90);
-		f->pgdInfo = pgd_open(pgd_header, 2, key_ptr);
+		{
+			lock_guard kirkGuard(GetKirkLock());
+			f->pgdInfo = pgd_open(pgd_header, 2, key_ptr);
+		}
 		if(f->pgdInfo==NULL){
 			ERROR_LOG(SCEIO, "Not a valid PGD file. Open as normal file.");
 			f->npdrm = false;
@@ -28,9 +28,12 @@ void __IoDoState(PointerWrap &p);
 void __IoShutdown();
 
 struct ScePspDateTime;
+struct AsyncIOStats;
 
 u32 __IoGetFileHandleFromId(u32 id, u32 &outError);
 void __IoCopyDate(ScePspDateTime& date_out, const tm& date_in);
+// Only covers operations run on the separate IO thread.
+void __IoGetAsyncStats(AsyncIOStats &reads, AsyncIOStats &writes, int &maxInFlight);
 
 KernelObject *__KernelFileNodeObject();
 KernelObject *__KernelDirListingObject();
@@ -21,6 +21,7 @@
 #include "Common/ChunkFile.h"
 #include "Core/HLE/HLE.h"
 #include "Core/Reporting.h"
+#include "Core/HW/ColorConvert.h"
 
 //Uncomment if you want to dump JPEGs loaded through sceJpeg to a file
 //#define JPEG_DEBUG
@@ -46,22 +47,6 @@ void __JpegDoState(PointerWrap &p) {
 	p.Do(mjpegHeight);
 }
 
-u32 convertYCbCrToABGR (int y, int cb, int cr) {
-	//see http://en.wikipedia.org/wiki/Yuv#Y.27UV444_to_RGB888_conversion for more information.
-	cb = cb - 128;
-	cr = cr - 128;
-	int r = y + cr + (cr >> 2) + (cr >> 3) + (cr >> 5);
-	int g = y - ((cb >> 2) + (cb >> 4) + (cb >> 5)) - ((cr >> 1) + (cr >> 3) + (cr >> 4) + (cr >> 5));
-	int b = y + cb + (cb >> 1) + (cb >> 2) + (cb >> 6);
-
-	// check rgb value.
-	if (r > 0xFF) r = 0xFF; if(r < 0) r = 0;
-	if (g > 0xFF) g = 0xFF; if(g < 0) g = 0;
-	if (b > 0xFF) b = 0xFF; if(b < 0) b = 0;
-
-	return 0xFF000000 | (b << 16) | (g << 8) | (r << 0);
-}
-
 int sceJpegDecompressAllImage()
 {
 	ERROR_LOG_REPORT(ME, "UNIMPL sceJpegDecompressAllImage()");
@@ -80,27 +65,14 @@ void __JpegCsc(u32 imageAddr, u32 yCbCrAddr, int widthHeight, int bufferWidth) {
 	u8 *Cb = Y + sizeY;
 	u8 *Cr = Cb + sizeCb;
 
+	// Each row has one Cb and Cr per 4 pixels, and writes whole groups of 4.
+	int groupedWidth = (width + 3) & ~3;
+	if (height > 0)
+		Memory::MarkDirtyRange(imageAddr, ((width + skipEndOfLine) * (height - 1) + groupedWidth) * 4);
 	for (int y = 0; y < height; ++y) {
-		for (int x = 0; x < width; x += 4) {
-			u8 y0 =  Y[x + 0];
-			u8 y1 =  Y[x + 1];
-			u8 y2 =  Y[x + 2];
-			u8 y3 =  Y[x + 3];
-			u8 cb = *Cb++;
-			u8 cr = *Cr++;
-
-			// Convert to ABGR
-			u32 abgr0 = convertYCbCrToABGR(y0, cb, cr);
-			u32 abgr1 = convertYCbCrToABGR(y1, cb, cr);
-			u32 abgr2 = convertYCbCrToABGR(y2, cb, cr);
-			u32 abgr3 = convertYCbCrToABGR(y3, cb, cr);
-
-			// Write ABGR
-			imageBuffer[x + 0] = abgr0;
-			imageBuffer[x + 1] = abgr1;
-			imageBuffer[x + 2] = abgr2;
-			imageBuffer[x + 3] = abgr3;
-		}
+		ConvertYCbCrToABGR8888(imageBuffer, Y, Cb, Cr, groupedWidth);
+		Cb += groupedWidth >> 2;
+		Cr += groupedWidth >> 2;
 		Y += width;
 		imageBuffer += width;
 		imageBuffer += skipEndOfLine;
@@ -240,6 +212,7 @@ int __JpegConvertRGBToYCbCr (const void *data, u32 bufferOutputAddr, int width,
 	u8 *Y = (u8*)Memory::GetPointer(bufferOutputAddr);
 	u8 *Cb = Y + sizeY;
 	u8 *Cr = Cb + sizeCb;
+	Memory::MarkDirtyRange(bufferOutputAddr, sizeY + sizeCb * 2);
 
 	for (int y = 0; y < height; ++y) {
 		for (int x = 0; x < width; x += 4) {
@@ -428,6 +428,7 @@ void KernelObject::GetQuickInfo(char *ptr, int size)
 KernelObjectPool::KernelObjectPool()
 {
 	memset(occupied, 0, sizeof(bool)*maxCount);
+	memset(types, 0, sizeof(types));
 	nextID = initialNextID;
 }
 
@@ -443,6 +444,7 @@ SceUID KernelObjectPool::Create(KernelObject *obj, int rangeBottom, int rangeTop
 		if (!occupied[i])
 		{
 			occupied[i] = true;
+			types[i] = obj->GetIDType();
 			pool[i] = obj;
 			pool[i]->uid = i + handleOffset;
 			return i + handleOffset;
@@ -464,6 +466,20 @@ bool KernelObjectPool::IsValid(SceUID handle)
 	return occupied[index];
 }
 
+void KernelObjectPool::ReportBadHandle(SceUID handle) const
+{
+	const int index = handle - handleOffset;
+	if (index >= 0 && index < maxCount && occupied[index])
+	{
+		WARN_LOG(SCEKERNEL, "Kernel: Wrong object type for %i (%08x)", handle, handle);
+	}
+	// Tekken 6 spams 0x80020001 gets wrong with no ill effects, also on the real PSP
+	else if (handle != 0 && (u32)handle != 0x80020001)
+	{
+		WARN_LOG(SCEKERNEL, "Kernel: Bad object handle %i (%08x)", handle, handle);
+	}
+}
+
 void KernelObjectPool::Clear()
 {
 	for (int i=0; i<maxCount; i++)
@@ -474,6 +490,7 @@ void KernelObjectPool::Clear()
 		occupied[i]=false;
 	}
 	memset(pool, 0, sizeof(KernelObject*)*maxCount);
+	memset(types, 0, sizeof(types));
 	nextID = initialNextID;
 }
 
@@ -554,6 +571,7 @@ void KernelObjectPool::DoState(PointerWrap &p)
 				return;
 
 			pool[i]->uid = i + handleOffset;
+			types[i] = type;
 		}
 		else
 		{
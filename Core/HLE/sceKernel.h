@@ -438,6 +438,7 @@ public:
 		if (Get<T>(handle, error))
 		{
 			occupied[handle-handleOffset] = false;
+			types[handle-handleOffset] = 0;
 			delete pool[handle-handleOffset];
 		}
 		return error;
@@ -445,34 +446,21 @@ public:
 
 	bool IsValid(SceUID handle);
 
+	// Called for nearly every kernel syscall, so this avoids the virtual GetIDType().
+	// The type is kept next to the pointer when the object is created.
 	template <class T>
 	T* Get(SceUID handle, u32 &outError)
 	{
-		if (handle < handleOffset || handle >= handleOffset+maxCount || !occupied[handle-handleOffset])
-		{
-			// Tekken 6 spams 0x80020001 gets wrong with no ill effects, also on the real PSP
-			if (handle != 0 && (u32)handle != 0x80020001)
-			{
-				WARN_LOG(SCEKERNEL, "Kernel: Bad object handle %i (%08x)", handle, handle);
-			}
-			outError = T::GetMissingErrorCode();
-			return 0;
-		}
-		else
+		const u32 index = (u32)(handle - handleOffset);
+		if (index < (u32)maxCount && types[index] == T::GetStaticIDType())
 		{
-			// Previously we had a dynamic_cast here, but since RTTI was disabled traditionally,
-			// it just acted as a static case and everything worked. This means that we will never
-			// see the Wrong type object error below, but we'll just have to live with that danger.
-			T* t = static_cast<T*>(pool[handle - handleOffset]);
-			if (t == 0 || t->GetIDType() != T::GetStaticIDType())
-			{
-				WARN_LOG(SCEKERNEL, "Kernel: Wrong object type for %i (%08x)", handle, handle);
-				outError = T::GetMissingErrorCode();
-				return 0;
-			}
 			outError = SCE_KERNEL_ERROR_OK;
-			return t;
+			return static_cast<T *>(pool[index]);
 		}
+
+		ReportBadHandle(handle);
+		outError = T::GetMissingErrorCode();
+		return 0;
 	}
 
 	// ONLY use this when you know the handle is valid.
@@ -490,11 +478,9 @@ public:
 		int type = T::GetStaticIDType();
 		for (int i = 0; i < maxCount; i++)
 		{
-			if (!occupied[i])
-				continue;
-			T *t = static_cast<T *>(pool[i]);
-			if (t->GetIDType() == type) {
-				if (!func(t, arg))
+			if (types[i] == type)
+			{
+				if (!func(static_cast<T *>(pool[i]), arg))
 					break;
 			}
 		}
@@ -507,8 +493,7 @@ public:
 			ERROR_LOG(SCEKERNEL, "Kernel: Bad object handle %i (%08x)", handle, handle);
 			return false;
 		}
-		KernelObject *t = pool[handle - handleOffset];
-		*type = t->GetIDType();
+		*type = types[handle - handleOffset];
 		return true;
 	}
 
@@ -518,6 +503,9 @@ public:
 	int GetCount();
 
 private:
+	// Out of line, to keep Get() small.
+	void ReportBadHandle(SceUID handle) const;
+
 	enum {
 		maxCount = 4096,
 		handleOffset = 0x100,
@@ -525,13 +513,13 @@ private:
 	};
 	KernelObject *pool[maxCount];
 	bool occupied[maxCount];
+	// GetIDType() of each object, or 0 if the slot is free.
+	int types[maxCount];
 	int nextID;
 };
 
 extern KernelObjectPool kernelObjects;
 
-typedef std::pair<int, int> KernelStatsSyscall;
-
 struct KernelStats {
 	void Reset() {
 		ResetFrame();
@@ -540,7 +528,6 @@ struct KernelStats {
 		msInSyscalls = 0;
 		slowestSyscallTime = 0;
 		slowestSyscallName = 0;
-		summedMsInSyscalls.clear();
 		summedSlowestSyscallTime = 0;
 		summedSlowestSyscallName = 0;
 	}
@@ -548,7 +535,6 @@ struct KernelStats {
 	double msInSyscalls;
 	double slowestSyscallTime;
 	const char *slowestSyscallName;
-	std::map<KernelStatsSyscall, double> summedMsInSyscalls;
 	double summedSlowestSyscallTime;
 	const char *summedSlowestSyscallName;
 };
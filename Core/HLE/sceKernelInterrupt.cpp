@@ -583,6 +583,7 @@ u32 sceKernelMemcpy(u32 dst, u32 src, u32 size)
 			for (u32 size8 = size % 8; size8 > 0; --size8)
 				*dstp++ = *srcp++;
 		}
+		Memory::MarkDirtyRange(dst, size);
 	}
 #ifndef USING_GLES2
 	CBreakPoints::ExecMemCheck(src, false, size, currentMIPS->pc);
@@ -17,9 +17,14 @@
 
 #include <fstream>
 #include <algorithm>
+#include <atomic>
 #include <set>
 
+#include "base/timeutil.h"
+#include "native/base/mutex.h"
 #include "native/base/stringutil.h"
+#include "native/thread/thread.h"
+#include "native/thread/threadutil.h"
 #include "Common/ChunkFile.h"
 #include "Common/FileUtil.h"
 #include "Core/Config.h"
@@ -439,8 +444,216 @@ void __KernelModuleDoState(PointerWrap &p)
 	}
 }
 
+// Modules found at boot, read and (if encrypted) decrypted on workers, which the per device
+// locks in MetaFileSystem allow.  sceKernelLoadModule() then only has to relocate them.
+struct ModulePrefetch {
+	std::string filename;
+	s64 size;
+	std::vector<u8> data;
+	// Where the ~PSP header starts in data, what __KernelLoadELFFromPtr() will decrypt.
+	const u8 *decryptInput;
+	u8 *decrypted;
+	int decryptResult;
+	// Protected by modulePrefetchLock, like everything above once the workers start.
+	bool done;
+	double readSeconds;
+	double decryptSeconds;
+};
+
+static std::vector<ModulePrefetch *> modulePrefetches;
+static std::vector<std::thread *> modulePrefetchThreads;
+static std::atomic<int> nextModulePrefetch;
+static recursive_mutex modulePrefetchLock;
+static condition_variable modulePrefetchDone;
+// Set by whoever read the module file, and picked up by __KernelLoadELFFromPtr() for the log.
+static double moduleReadSeconds;
+
+static const size_t MAX_PREFETCH_BYTES = 64 * 1024 * 1024;
+static const size_t MAX_PREFETCH_THREADS = 4;
+
+static void __KernelModulePrefetchThread()
+{
+	setCurrentThreadName("ModulePrefetch");
+
+	for (int i = nextModulePrefetch++; i < (int)modulePrefetches.size(); i = nextModulePrefetch++)
+	{
+		ModulePrefetch *prefetch = modulePrefetches[i];
+		std::vector<u8> data((size_t)prefetch->size);
+
+		time_update();
+		double startTime = real_time_now();
+		u32 handle = pspFileSystem.OpenFile(prefetch->filename, FILEACCESS_READ);
+		size_t readSize = handle ? (size_t)pspFileSystem.ReadFile(handle, &data[0], data.size()) : 0;
+		if (handle)
+			pspFileSystem.CloseFile(handle);
+		time_update();
+		double readSeconds = real_time_now() - startTime;
+
+		// Only worth keeping if there's decrypting to do.
+		const u8 *ptr = &data[0];
+		if (readSize == data.size() && *(const u32_le *)ptr == 0x4543537e) // "~SCE"
+		{
+			u32 offset = *(const u32_le *)(ptr + 4);
+			ptr = offset + sizeof(PSP_Header) <= readSize ? ptr + offset : 0;
+		}
+
+		u8 *decrypted = 0;
+		int decryptResult = 0;
+		double decryptSeconds = 0.0;
+		if (readSize == data.size() && ptr && *(const u32_le *)ptr == 0x5053507e) // "~PSP"
+		{
+			time_update();
+			startTime = real_time_now();
+			const PSP_Header *head = (const PSP_Header *)ptr;
+			decrypted = new u8[head->elf_size + head->psp_size];
+			decryptResult = pspDecryptPRX(ptr, decrypted, head->psp_size);
+			time_update();
+			decryptSeconds = real_time_now() - startTime;
+		}
+		else
+		{
+			// Leaves data empty, so the load just reads the file as usual.
+			std::vector<u8>().swap(data);
+			ptr = 0;
+		}
+
+		lock_guard guard(modulePrefetchLock);
+		prefetch->data.swap(data);
+		prefetch->decryptInput = ptr;
+		prefetch->decrypted = decrypted;
+		prefetch->decryptResult = decryptResult;
+		prefetch->readSeconds = readSeconds;
+		prefetch->decryptSeconds = decryptSeconds;
+		prefetch->done = true;
+		modulePrefetchDone.notify_all();
+	}
+}
+
+static void __KernelFindPrefetchModules(const std::string &dir, int depth, std::vector<std::string> &found)
+{
+	std::vector<PSPFileInfo> files = pspFileSystem.GetDirListing(dir);
+	for (auto it = files.begin(), end = files.end(); it != end; ++it)
+	{
+		if (it->name == "." || it->name == "..")
+			continue;
+		if (it->type == FILETYPE_DIRECTORY)
+		{
+			if (depth > 0)
+				__KernelFindPrefetchModules(dir + it->name + "/", depth - 1, found);
+		}
+		else if (it->size > (s64)sizeof(PSP_Header) && it->name.size() > 4)
+		{
+			std::string ext = it->name.substr(it->name.size() - 4);
+			std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+			if (ext == ".prx")
+				found.push_back(dir + it->name);
+		}
+	}
+}
+
+static void __KernelPrefetchModules(const std::string &execFilename)
+{
+	std::vector<std::string> dirs;
+	dirs.push_back(execFilename.substr(0, execFilename.find_last_of('/') + 1));
+	// Discs keep their modules under USRDIR, not next to the EBOOT.
+	if (startsWith(execFilename, "disc0:/PSP_GAME/") && dirs[0] != "disc0:/PSP_GAME/USRDIR/")
+		dirs.push_back("disc0:/PSP_GAME/USRDIR/");
+
+	std::vector<std::string> filenames;
+	for (size_t i = 0; i < dirs.size(); ++i)
+		__KernelFindPrefetchModules(dirs[i], 2, filenames);
+
+	size_t totalBytes = 0;
+	for (auto it = filenames.begin(), end = filenames.end(); it != end; ++it)
+	{
+		PSPFileInfo info = pspFileSystem.GetFileInfo(*it);
+		if (!info.exists || totalBytes + (size_t)info.size > MAX_PREFETCH_BYTES)
+			continue;
+
+		ModulePrefetch *prefetch = new ModulePrefetch;
+		prefetch->filename = *it;
+		prefetch->size = info.size;
+		prefetch->decryptInput = 0;
+		prefetch->decrypted = 0;
+		prefetch->decryptResult = 0;
+		prefetch->done = false;
+		prefetch->readSeconds = 0.0;
+		prefetch->decryptSeconds = 0.0;
+
+		totalBytes += (size_t)info.size;
+		modulePrefetches.push_back(prefetch);
+	}
+
+	if (modulePrefetches.empty())
+		return;
+
+	INFO_LOG(LOADER, "Prefetching %d modules (%d KB)", (int)modulePrefetches.size(), (int)(totalBytes / 1024));
+	pspDecryptPRXInit();
+	nextModulePrefetch = 0;
+	size_t threads = std::min(modulePrefetches.size(), MAX_PREFETCH_THREADS);
+	for (size_t i = 0; i < threads; ++i)
+		modulePrefetchThreads.push_back(new std::thread(&__KernelModulePrefetchThread));
+}
+
+// Returns a prefetched module's file data, waiting for it to be decrypted, or NULL.
+static ModulePrefetch *__KernelGetPrefetchedModule(const std::string &filename, s64 size)
+{
+	for (auto it = modulePrefetches.begin(), end = modulePrefetches.end(); it != end; ++it)
+	{
+		ModulePrefetch *prefetch = *it;
+		if (prefetch->size != size || strcasecmp(prefetch->filename.c_str(), filename.c_str()) != 0)
+			continue;
+
+		lock_guard guard(modulePrefetchLock);
+		while (!prefetch->done)
+			modulePrefetchDone.wait(modulePrefetchLock);
+		return prefetch->data.empty() ? 0 : prefetch;
+	}
+	return 0;
+}
+
+// Hands over the decrypted module, if in was prefetched (and not already used.)
+static ModulePrefetch *__KernelTakePrefetchedDecrypt(const u8 *in)
+{
+	lock_guard guard(modulePrefetchLock);
+	for (auto it = modulePrefetches.begin(), end = modulePrefetches.end(); it != end; ++it)
+	{
+		ModulePrefetch *prefetch = *it;
+		if (prefetch->done && prefetch->decryptInput == in && prefetch->decrypted)
+			return prefetch;
+	}
+	return 0;
+}
+
+// Frees the file data once loaded, so it's only used once.  Later loads read the file again.
+static void __KernelReleasePrefetchedModule(ModulePrefetch *prefetch)
+{
+	delete [] prefetch->decrypted;
+	prefetch->decrypted = 0;
+	std::vector<u8>().swap(prefetch->data);
+	prefetch->decryptInput = 0;
+}
+
+static void __KernelClearModulePrefetches()
+{
+	for (auto it = modulePrefetchThreads.begin(), end = modulePrefetchThreads.end(); it != end; ++it)
+	{
+		(*it)->join();
+		delete *it;
+	}
+	modulePrefetchThreads.clear();
+
+	for (auto it = modulePrefetches.begin(), end = modulePrefetches.end(); it != end; ++it)
+	{
+		__KernelReleasePrefetchedModule(*it);
+		delete *it;
+	}
+	modulePrefetches.clear();
+}
+
 void __KernelModuleShutdown()
 {
+	__KernelClearModulePrefetches();
 	loadedModules.clear();
 	MIPSAnalyst::Reset();
 }
@@ -725,6 +938,10 @@ Module *__KernelLoadELFFromPtr(const u8 *ptr, u32 loadAddress, std::string *erro
 	loadedModules.insert(module->GetUID());
 	memset(&module->nm, 0, sizeof(module->nm));
 
+	double readSeconds = moduleReadSeconds, decryptSeconds = 0.0, relocateSeconds = 0.0, scanSeconds = 0.0;
+	bool prefetched = false;
+	moduleReadSeconds = 0.0;
+
 	u8 *newptr = 0;
 	u32_le *magicPtr = (u32_le *) ptr;
 	if (*magicPtr == 0x4543537e) { // "~SCE"
@@ -742,10 +959,25 @@ Module *__KernelLoadELFFromPtr(const u8 *ptr, u32 loadAddress, std::string *erro
 		{
 			size = head->psp_size;
 		}
-		newptr = new u8[head->elf_size + head->psp_size];
+		int ret;
+		ModulePrefetch *prefetch = __KernelTakePrefetchedDecrypt(in);
+		if (prefetch) {
+			newptr = prefetch->decrypted;
+			prefetch->decrypted = 0;
+			ret = prefetch->decryptResult;
+			readSeconds = prefetch->readSeconds;
+			decryptSeconds = prefetch->decryptSeconds;
+			prefetched = true;
+		} else {
+			newptr = new u8[head->elf_size + head->psp_size];
+			time_update();
+			double startTime = real_time_now();
+			ret = pspDecryptPRX(in, newptr, head->psp_size);
+			time_update();
+			decryptSeconds = real_time_now() - startTime;
+		}
 		ptr = newptr;
 		magicPtr = (u32_le *)ptr;
-		int ret = pspDecryptPRX(in, (u8*)ptr, head->psp_size);
 		if (ret == MISSING_KEY) {
 			// This should happen for all "kernel" modules so disabling.
 			// Reporting::ReportMessage("Missing PRX decryption key!");
@@ -779,7 +1011,11 @@ Module *__KernelLoadELFFromPtr(const u8 *ptr, u32 loadAddress, std::string *erro
 	// Open ELF reader
 	ElfReader reader((void*)ptr);
 
+	time_update();
+	double relocateStart = real_time_now();
 	int result = reader.LoadInto(loadAddress);
+	time_update();
+	relocateSeconds = real_time_now() - relocateStart;
 	if (result != SCE_KERNEL_ERROR_OK) 	{
 		ERROR_LOG(SCEMODULE, "LoadInto failed with error %08x",result);
 		if (newptr)
@@ -857,6 +1093,8 @@ Module *__KernelLoadELFFromPtr(const u8 *ptr, u32 loadAddress, std::string *erro
 		// TODO: It seems like the data size excludes the text size, which kinda makes sense?
 		module->nm.data_size -= textSize;
 
+		time_update();
+		double scanStart = real_time_now();
 #if !defined(USING_GLES2)
 		bool gotSymbols = reader.LoadSymbols();
 		MIPSAnalyst::ScanForFunctions(textStart, textStart + textSize, !gotSymbols);
@@ -866,6 +1104,8 @@ Module *__KernelLoadELFFromPtr(const u8 *ptr, u32 loadAddress, std::string *erro
 			MIPSAnalyst::ScanForFunctions(textStart, textStart + textSize, !gotSymbols);
 		}
 #endif
+		time_update();
+		scanSeconds += real_time_now() - scanStart;
 	}
 
 	INFO_LOG(LOADER,"Module %s: %08x %08x %08x", modinfo->name, modinfo->gp, modinfo->libent,modinfo->libstub);
@@ -1018,6 +1258,8 @@ Module *__KernelLoadELFFromPtr(const u8 *ptr, u32 loadAddress, std::string *erro
 	if (textSection == -1) {
 		u32 textStart = reader.GetVaddr();
 		u32 textEnd = firstImportStubAddr - 4;
+		time_update();
+		double scanStart = real_time_now();
 #if !defined(USING_GLES2)
 		bool gotSymbols = reader.LoadSymbols();
 		MIPSAnalyst::ScanForFunctions(textStart, textEnd, !gotSymbols);
@@ -1027,6 +1269,8 @@ Module *__KernelLoadELFFromPtr(const u8 *ptr, u32 loadAddress, std::string *erro
 			MIPSAnalyst::ScanForFunctions(textStart, textEnd, !gotSymbols);
 		}
 #endif
+		time_update();
+		scanSeconds += real_time_now() - scanStart;
 	}
 
 	// Look at the exports, too.
@@ -1176,6 +1420,10 @@ Module *__KernelLoadELFFromPtr(const u8 *ptr, u32 loadAddress, std::string *erro
 	if (newptr)
 		delete [] newptr;
 
+	INFO_LOG(LOADER, "Loaded module %s: read %0.1f ms, decrypt %0.1f ms%s, relocate %0.1f ms, scan %0.1f ms",
+		moduleName, readSeconds * 1000.0, decryptSeconds * 1000.0, prefetched ? " (prefetched)" : "",
+		relocateSeconds * 1000.0, scanSeconds * 1000.0);
+
 	return module;
 }
 
@@ -1202,6 +1450,8 @@ bool __KernelLoadPBP(const char *filename, std::string *error_string)
 		delete [] elfData;
 		return false;
 	}
+	// Replacements change the code, so they must be in place before it runs, not whenever the scan is done.
+	MIPSAnalyst::FinishFunctionScans();
 	mipsr4k.pc = module->nm.entry_addr;
 	delete [] elfData;
 	return true;
@@ -1253,6 +1503,7 @@ Module *__KernelLoadModule(u8 *fileptr, SceKernelLMOption *options, std::string
 
 void __KernelStartModule(Module *m, int args, const char *argp, SceKernelSMOption *options)
 {
+	MIPSAnalyst::FinishFunctionScans();
 	m->nm.status = MODULE_STATUS_STARTED;
 	if (m->nm.module_start_func != 0 && m->nm.module_start_func != (u32)-1)
 	{
@@ -1330,7 +1581,11 @@ bool __KernelLoadExec(const char *filename, u32 paramPtr, std::string *error_str
 
 	u8 *temp = new u8[(int)info.size + 0x01000000];
 
+	time_update();
+	double readStart = real_time_now();
 	pspFileSystem.ReadFile(handle, temp, (size_t)info.size);
+	time_update();
+	moduleReadSeconds = real_time_now() - readStart;
 
 	Module *module = __KernelLoadModule(temp, 0, error_string);
 
@@ -1349,6 +1604,7 @@ bool __KernelLoadExec(const char *filename, u32 paramPtr, std::string *error_str
 		return false;
 	}
 
+	MIPSAnalyst::FinishFunctionScans();
 	mipsr4k.pc = module->nm.entry_addr;
 
 	INFO_LOG(LOADER, "Module entry: %08x", mipsr4k.pc);
@@ -1357,6 +1613,9 @@ bool __KernelLoadExec(const char *filename, u32 paramPtr, std::string *error_str
 
 	pspFileSystem.CloseFile(handle);
 
+	if (g_Config.bPrefetchModules)
+		__KernelPrefetchModules(filename);
+
 	SceKernelSMOption option;
 	option.size = sizeof(SceKernelSMOption);
 	option.attribute = PSP_THREAD_ATTR_USER;
@@ -1467,13 +1726,23 @@ u32 sceKernelLoadModule(const char *name, u32 flags, u32 optionAddr)
 	}
 
 	Module *module = 0;
-	u8 *temp = new u8[(int)size];
-	u32 handle = pspFileSystem.OpenFile(name, FILEACCESS_READ);
-	pspFileSystem.ReadFile(handle, temp, (size_t)size);
 	u32 magic;
-	module = __KernelLoadELFFromPtr(temp, 0, &error_string, &magic);
-	delete [] temp;
-	pspFileSystem.CloseFile(handle);
+	ModulePrefetch *prefetch = __KernelGetPrefetchedModule(name, size);
+	if (prefetch) {
+		module = __KernelLoadELFFromPtr(&prefetch->data[0], 0, &error_string, &magic);
+		__KernelReleasePrefetchedModule(prefetch);
+	} else {
+		u8 *temp = new u8[(int)size];
+		time_update();
+		double readStart = real_time_now();
+		u32 handle = pspFileSystem.OpenFile(name, FILEACCESS_READ);
+		pspFileSystem.ReadFile(handle, temp, (size_t)size);
+		time_update();
+		moduleReadSeconds = real_time_now() - readStart;
+		module = __KernelLoadELFFromPtr(temp, 0, &error_string, &magic);
+		delete [] temp;
+		pspFileSystem.CloseFile(handle);
+	}
 
 	if (!module) {
 		if (magic == 0x46535000) {
@@ -1578,6 +1847,7 @@ void sceKernelStartModule(u32 moduleId, u32 argsize, u32 argAddr, u32 returnValu
 				stacksize = module->nm.module_start_thread_stacksize;
 			}
 
+			MIPSAnalyst::FinishFunctionScans();
 			SceUID threadID = __KernelCreateThread(module->nm.name, moduleId, entryAddr, priority, stacksize, attribute, 0);
 			sceKernelStartThread(threadID, argsize, argAddr);
 			__KernelSetThreadRA(threadID, NID_MODULERETURN);
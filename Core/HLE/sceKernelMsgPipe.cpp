@@ -103,6 +103,7 @@ struct MsgPipeWaitingThread
 	void ReadBuffer(u8 *dest, u32 len)
 	{
 		Memory::Memcpy(dest, bufAddr + bufSize - freeSize, len);
+		Memory::MarkDirtyPtr(dest, len);
 		freeSize -= len;
 		if (transferredBytes.IsValid())
 			*transferredBytes += len;
@@ -218,6 +219,7 @@ struct MsgPipe : public KernelObject
 			// Put the unused data at the start of the buffer.
 			nmp.freeSize += bytesToSend;
 			memmove(Memory::GetPointer(buffer), Memory::GetPointer(buffer) + bytesToSend, GetUsedSize());
+			Memory::MarkDirtyRange(buffer, GetUsedSize());
 			freedSpace = true;
 
 			if (thread->waitMode == SCE_KERNEL_MPW_ASAP || thread->freeSize == 0)
@@ -490,6 +492,7 @@ int __KernelReceiveMsgPipe(MsgPipe *m, u32 receiveBufAddr, u32 receiveSize, int
 				Memory::Memcpy(curReceiveAddr, Memory::GetPointer(m->buffer), bytesToReceive);
 				m->nmp.freeSize += bytesToReceive;
 				memmove(Memory::GetPointer(m->buffer), Memory::GetPointer(m->buffer) + bytesToReceive, m->GetUsedSize());
+				Memory::MarkDirtyRange(m->buffer, m->GetUsedSize());
 				curReceiveAddr += bytesToReceive;
 				receiveSize -= bytesToReceive;
 
@@ -153,9 +153,6 @@ struct LwMutex : public KernelObject
 
 static int mutexWaitTimer = -1;
 static int lwMutexWaitTimer = -1;
-// Thread -> Mutex locks for thread end.
-typedef std::multimap<SceUID, SceUID> MutexMap;
-static MutexMap mutexHeldLocks;
 
 void __KernelMutexBeginCallback(SceUID threadID, SceUID prevCallbackId);
 void __KernelMutexEndCallback(SceUID threadID, SceUID prevCallbackId);
@@ -174,7 +171,7 @@ void __KernelMutexInit()
 
 void __KernelMutexDoState(PointerWrap &p)
 {
-	auto s = p.Section("sceKernelMutex", 1);
+	auto s = p.Section("sceKernelMutex", 1, 2);
 	if (!s)
 		return;
 
@@ -182,7 +179,12 @@ void __KernelMutexDoState(PointerWrap &p)
 	CoreTiming::RestoreRegisterEvent(mutexWaitTimer, "MutexTimeout", __KernelMutexTimeout);
 	p.Do(lwMutexWaitTimer);
 	CoreTiming::RestoreRegisterEvent(lwMutexWaitTimer, "LwMutexTimeout", __KernelLwMutexTimeout);
-	p.Do(mutexHeldLocks);
+	if (s < 2)
+	{
+		// Held locks used to be tracked per thread, they're found from the mutexes now.
+		std::multimap<SceUID, SceUID> mutexHeldLocks;
+		p.Do(mutexHeldLocks);
+	}
 }
 
 KernelObject *__KernelMutexObject()
@@ -197,19 +199,11 @@ KernelObject *__KernelLwMutexObject()
 
 void __KernelMutexShutdown()
 {
-	mutexHeldLocks.clear();
 }
 
+// Locking and unlocking are hot, thread end isn't, so nothing else tracks who holds what.
 void __KernelMutexAcquireLock(Mutex *mutex, int count, SceUID thread)
 {
-#if defined(_DEBUG)
-	std::pair<MutexMap::iterator, MutexMap::iterator> locked = mutexHeldLocks.equal_range(thread);
-	for (MutexMap::iterator iter = locked.first; iter != locked.second; ++iter)
-		_dbg_assert_msg_(SCEKERNEL, (*iter).second != mutex->GetUID(), "Thread %d / mutex %d wasn't removed from mutexHeldLocks properly.", thread, mutex->GetUID());
-#endif
-
-	mutexHeldLocks.insert(std::make_pair(thread, mutex->GetUID()));
-
 	mutex->nm.lockLevel = count;
 	mutex->nm.lockThread = thread;
 }
@@ -221,19 +215,6 @@ void __KernelMutexAcquireLock(Mutex *mutex, int count)
 
 void __KernelMutexEraseLock(Mutex *mutex)
 {
-	if (mutex->nm.lockThread != -1)
-	{
-		SceUID id = mutex->GetUID();
-		std::pair<MutexMap::iterator, MutexMap::iterator> locked = mutexHeldLocks.equal_range(mutex->nm.lockThread);
-		for (MutexMap::iterator iter = locked.first; iter != locked.second; ++iter)
-		{
-			if ((*iter).second == id)
-			{
-				mutexHeldLocks.erase(iter);
-				break;
-			}
-		}
-	}
 	mutex->nm.lockThread = -1;
 }
 
@@ -460,6 +441,17 @@ void __KernelMutexTimeout(u64 userdata, int cyclesLate)
 	HLEKernel::WaitExecTimeout<Mutex, WAITTYPE_MUTEX>(threadID);
 }
 
+static bool __KernelMutexUnlockForThreadEnd(Mutex *mutex, SceUID threadID)
+{
+	if (mutex->nm.lockThread == threadID)
+	{
+		u32 error = 0;
+		mutex->nm.lockLevel = 0;
+		__KernelUnlockMutex(mutex, error);
+	}
+	return true;
+}
+
 void __KernelMutexThreadEnd(SceUID threadID)
 {
 	u32 error;
@@ -474,19 +466,7 @@ void __KernelMutexThreadEnd(SceUID threadID)
 	}
 
 	// Unlock all mutexes the thread had locked.
-	std::pair<MutexMap::iterator, MutexMap::iterator> locked = mutexHeldLocks.equal_range(threadID);
-	for (MutexMap::iterator iter = locked.first; iter != locked.second; )
-	{
-		// Need to increment early so erase() doesn't invalidate.
-		SceUID mutexID = (*iter++).second;
-		Mutex *mutex = kernelObjects.Get<Mutex>(mutexID, error);
-
-		if (mutex)
-		{
-			mutex->nm.lockLevel = 0;
-			__KernelUnlockMutex(mutex, error);
-		}
-	}
+	kernelObjects.Iterate(&__KernelMutexUnlockForThreadEnd, threadID);
 }
 
 void __KernelWaitMutex(Mutex *mutex, u32 timeoutPtr)
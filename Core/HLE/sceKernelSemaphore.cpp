@@ -302,6 +302,10 @@ int sceKernelSignalSema(SceUID id, int signal)
 		s->ns.currentCount += signal;
 		DEBUG_LOG(SCEKERNEL, "sceKernelSignalSema(%i, %i) (count: %i -> %i)", id, signal, oldval, s->ns.currentCount);
 
+		// Nobody to wake, the common case.
+		if (s->waitingThreads.empty())
+			return 0;
+
 		if ((s->ns.attr & PSP_SEMA_ATTR_PRIORITY) != 0)
 			std::stable_sort(s->waitingThreads.begin(), s->waitingThreads.end(), __KernelThreadSortPriority);
 
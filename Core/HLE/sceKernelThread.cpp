@@ -2490,6 +2490,22 @@ u32 __KernelGetCurThreadStack()
 	return 0;
 }
 
+u32 __KernelGetCurThreadEntry()
+{
+	Thread *t = __GetCurrentThread();
+	if (t)
+		return t->nt.entrypoint;
+	return 0;
+}
+
+u32 __KernelGetCurThreadInitialStack()
+{
+	Thread *t = __GetCurrentThread();
+	if (t)
+		return t->nt.initialStack;
+	return 0;
+}
+
 SceUID sceKernelGetThreadId()
 {
 	VERBOSE_LOG(SCEKERNEL, "%i = sceKernelGetThreadId()", currentThread);
@@ -153,6 +153,8 @@ KernelObject *__KernelCallbackObject();
 void __KernelScheduleWakeup(int threadnumber, s64 usFromNow);
 SceUID __KernelGetCurThread();
 u32 __KernelGetCurThreadStack();
+u32 __KernelGetCurThreadEntry();
+u32 __KernelGetCurThreadInitialStack();
 const char *__KernelGetThreadName(SceUID threadID);
 
 void __KernelSaveContext(ThreadContext *ctx, bool vfpuEnabled);
@@ -162,6 +162,7 @@ u32 sceKernelLibcGettimeofday(u32 timeAddr, u32 tzAddr)
 	{
 		PSPTimeval *tv = (PSPTimeval *)Memory::GetPointer(timeAddr);
 		__RtcTimeOfDay(tv);
+		Memory::MarkDirtyRange(timeAddr, sizeof(PSPTimeval));
 	}
 
 	DEBUG_LOG(SCEKERNEL,"sceKernelLibcGettimeofday(%08x, %08x)", timeAddr, tzAddr);
@@ -29,6 +29,7 @@ u32 sceKernelUtilsMt19937Init(u32 ctx, u32 seed) {
 	// This is made to match the memory layout of a PSP MT structure exactly.
 	// Let's just construct it in place with placement new. Elite C++ hackery FTW.
 	new (ptr) MersenneTwister(seed);
+	Memory::MarkDirtyRange(ctx, sizeof(MersenneTwister));
 	return 0;
 }
 
@@ -37,6 +38,7 @@ u32 sceKernelUtilsMt19937UInt(u32 ctx) {
 	if (!Memory::IsValidAddress(ctx))
 		return -1;
 	MersenneTwister *mt = (MersenneTwister *)Memory::GetPointer(ctx);
+	Memory::MarkDirtyRange(ctx, sizeof(MersenneTwister));
 	return mt->R32();
 }
 
@@ -51,6 +53,7 @@ int sceMd5Digest(u32 dataAddr, u32 len, u32 digestAddr) {
 		return -1;
 
 	md5(Memory::GetPointer(dataAddr), (int)len, Memory::GetPointer(digestAddr));
+	Memory::MarkDirtyRange(digestAddr, 16);
 	return 0;
 }
 
@@ -81,6 +84,7 @@ int sceMd5BlockResult(u32 ctxAddr, u32 digestAddr) {
 		return -1;
 
 	md5_finish(&md5_ctx, Memory::GetPointer(digestAddr));
+	Memory::MarkDirtyRange(digestAddr, 16);
 	return 0;
 }
 
@@ -91,6 +95,7 @@ int sceKernelUtilsMd5Digest(u32 dataAddr, int len, u32 digestAddr) {
 		return -1;
 
 	md5(Memory::GetPointer(dataAddr), (int)len, Memory::GetPointer(digestAddr));
+	Memory::MarkDirtyRange(digestAddr, 16);
 	return 0;
 }
 
@@ -121,6 +126,7 @@ int sceKernelUtilsMd5BlockResult(u32 ctxAddr, u32 digestAddr) {
 		return -1;
 
 	md5_finish(&md5_ctx, Memory::GetPointer(digestAddr));
+	Memory::MarkDirtyRange(digestAddr, 16);
 	return 0;
 }
 
@@ -134,6 +140,7 @@ int sceKernelUtilsSha1Digest(u32 dataAddr, int len, u32 digestAddr) {
 		return -1;
 
 	sha1(Memory::GetPointer(dataAddr), (int)len, Memory::GetPointer(digestAddr));
+	Memory::MarkDirtyRange(digestAddr, 20);
 	return 0;
 }
 
@@ -165,6 +172,7 @@ int sceKernelUtilsSha1BlockResult(u32 ctxAddr, u32 digestAddr) {
 		return -1;
 
 	sha1_finish(&sha1_ctx, Memory::GetPointer(digestAddr));
+	Memory::MarkDirtyRange(digestAddr, 20);
 	return 0;
 }
 
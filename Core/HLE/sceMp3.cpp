@@ -213,6 +213,7 @@ int sceMp3Decode(u32 mp3, u32 outPcmPtr) {
 					return -1;
 				}
 				__AdjustBGMVolume((s16 *)out, frame.nb_samples * frame.channels);
+				Memory::MarkDirtyRange(ctx->mp3PcmBuf + bytesdecoded, frame.nb_samples * frame.channels * sizeof(s16));
 
 				//av_samples_copy(&audio_dst_data, frame.data, 0, 0, frame.nb_samples, frame.channels, (AVSampleFormat)frame.format);
 
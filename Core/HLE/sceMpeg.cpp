@@ -326,6 +326,7 @@ void __MpegInit() {
 	isCurrentMpegAnalyzed = false;
 	isMpegInit = false;
 	actionPostPut = __KernelRegisterActionType(PostPutAction::Create);
+	ResetVideoDecodeStats();
 
 #ifdef USING_FFMPEG
 	avcodec_register_all();
@@ -1534,6 +1535,7 @@ int __MpegAvcConvertToYuv420(const void *data, u32 bufferOutputAddr, int width,
 	u8 *Y = (u8*)Memory::GetPointer(bufferOutputAddr);
 	u8 *Cb = Y + sizeY;
 	u8 *Cr = Cb + sizeCb;
+	Memory::MarkDirtyRange(bufferOutputAddr, sizeY + sizeCb * 2);
 
 	for (int y = 0; y < height; ++y) {
 		for (int x = 0; x < width; x += 4) {
@@ -27,6 +27,7 @@ u32 sceMt19937Init(u32 mt19937Addr, u32 seed)
 	// This is made to match the memory layout of a PSP MT structure exactly.
 	// Let's just construct it in place with placement new. Elite C++ hackery FTW.
 	new (ptr) MersenneTwister(seed);
+	Memory::MarkDirtyRange(mt19937Addr, sizeof(MersenneTwister));
 	return 0;
 }
 
@@ -36,6 +37,7 @@ u32 sceMt19937UInt(u32 mt19937Addr)
 	if (!Memory::IsValidAddress(mt19937Addr))
 		return -1;
 	MersenneTwister *mt = (MersenneTwister *)Memory::GetPointer(mt19937Addr);
+	Memory::MarkDirtyRange(mt19937Addr, sizeof(MersenneTwister));
 	return mt->R32();
 }
 
@@ -166,8 +166,10 @@ int sceNetEtherNtostr(u32 macPtr, u32 bufferPtr) {
 		const u8 *mac = Memory::GetPointer(macPtr);
 
 		// MAC address is always 6 bytes / 48 bits.
-		return sprintf(buffer, "%02x:%02x:%02x:%02x:%02x:%02x",
+		int len = sprintf(buffer, "%02x:%02x:%02x:%02x:%02x:%02x",
 			mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+		Memory::MarkDirtyRange(bufferPtr, len + 1);
+		return len;
 	} else {
 		// Possibly a void function, seems to return this on bad args.
 		return 0x09d40000;
@@ -216,6 +218,7 @@ int sceNetEtherStrton(u32 bufferPtr, u32 macPtr) {
 			}
 		}
 
+		Memory::MarkDirtyRange(macPtr, 6);
 		// Seems to maybe kinda return the last value.  Probably returns void.
 		return value;
 	} else {
@@ -20,7 +20,10 @@
 
 // This is a direct port of Coldbird's code from http://code.google.com/p/aemu/
 // All credit goes to him!
+#include <algorithm>
+
 #include "proAdhoc.h"
+#include "Core/MemSnapshot.h"
 
 enum {
 	ERROR_NET_ADHOC_INVALID_SOCKET_ID            = 0x80410701,
@@ -257,7 +260,7 @@ int sceNetAdhocPdpCreate(const char *mac, u32 port, int bufferSize, u32 unknown)
 					// Binding Information for local Port
 					sockaddr_in addr;
 					addr.sin_family = AF_INET;
-					addr.sin_addr.s_addr = INADDR_ANY;
+					addr.sin_addr.s_addr = getLocalBindIp();
 
 					addr.sin_port = htons(port); // This not safe in any way...
 
@@ -562,6 +565,7 @@ int sceNetAdhocPdpRecv(int id, void *addr, void * port, void *buf, void *dataLen
 
 				// Receive Data
 				changeBlockingMode(socket->id,flag);
+				Memory::HostWriteGuard writeGuard((const u8 *)buf, *len);
 				int received = recvfrom(socket->id, (char *)buf, *len,0,(sockaddr *)&sin, &sinlen);
 				changeBlockingMode(socket->id,0);
 
@@ -1171,7 +1175,7 @@ int sceNetAdhocPtpOpen(const char *srcmac, int sport, const char *dstmac, int dp
 						sockaddr_in addr;
 						// addr.sin_len = sizeof(addr);
 						addr.sin_family = AF_INET;
-						addr.sin_addr.s_addr = INADDR_ANY;
+						addr.sin_addr.s_addr = getLocalBindIp();
 						addr.sin_port = htons(sport);
 						
 						// Bound Socket to local Port
@@ -1305,11 +1309,13 @@ int sceNetAdhocPtpAccept(int id, u32 peerMacAddrPtr, u32 peerPortPtr, int timeou
 						
 						// Retry until Timeout hits
 						while ((timeout == 0 ||((uint32_t)(real_time_now()*1000.0) - starttime) < (uint32_t)timeout) && newsocket == -1) {
+							// Wait for a Connection Attempt, rather than polling
+							int remaining = timeout == 0 ? 100 : (int)((uint32_t)timeout - ((uint32_t)(real_time_now()*1000.0) - starttime));
+							if (waitForSocket(socket->id, ADHOC_WAIT_READ, std::max(std::min(remaining, 100), 0)) < 0)
+								break;
+
 							// Accept Connection
 							newsocket = accept(socket->id, (sockaddr *)&peeraddr, &peeraddrlen);
-							
-							// Wait a bit...
-							sleep_ms(1);
 						}
 					}
 					
@@ -1485,8 +1491,17 @@ int sceNetAdhocPtpConnect(int id, int timeout, int flag) {
 							socklen_t peerlen = sizeof(peer);
 							// Wait for Connection
 							while ((timeout == 0 || ( (uint32_t)(real_time_now()*1000.0) - starttime) < (uint32_t)timeout) && getpeername(socket->id, (sockaddr *)&peer, &peerlen) != 0) {
-								// Wait 1ms
-								sleep_ms(1);
+								// The Socket becomes writable once the Connection completes (or fails)
+								int remaining = timeout == 0 ? 100 : (int)((uint32_t)timeout - ((uint32_t)(real_time_now()*1000.0) - starttime));
+								int ready = waitForSocket(socket->id, ADHOC_WAIT_WRITE, std::max(std::min(remaining, 100), 0));
+								if (ready < 0)
+									break;
+
+								// Refused or unreachable, no point waiting out the Timeout
+								int sockerror = 0;
+								socklen_t sockerrorlen = sizeof(sockerror);
+								if (ready > 0 && getsockopt(socket->id, SOL_SOCKET, SO_ERROR, (char *)&sockerror, &sockerrorlen) == 0 && sockerror != 0)
+									break;
 							}
 							
 							// Connected in Time
@@ -1612,7 +1627,7 @@ int sceNetAdhocPtpListen(const char *srcmac, int sport, int bufsize, int rexmt_i
 						// Binding Information for local Port
 						sockaddr_in addr;
 						addr.sin_family = AF_INET;
-						addr.sin_addr.s_addr = INADDR_ANY;
+						addr.sin_addr.s_addr = getLocalBindIp();
 						addr.sin_port = htons(sport);
 						
 						// Bound Socket to local Port
@@ -1808,6 +1823,7 @@ int sceNetAdhocPtpRecv(int id, u32 dataAddr, u32 dataSizeAddr, int timeout, int
 				
 				// Receive Data
 				changeBlockingMode(socket->id, flag);
+				Memory::HostWriteGuard writeGuard((const u8 *)buf, *len);
 				int received = recv(socket->id, (char *)buf, *len, 0);
 				int error = errno;
 				changeBlockingMode(socket->id, 0);
@@ -47,6 +47,7 @@ u32 sceP3daBridgeCore(u32 p3daCoreAddr, u32 channelsNum, u32 samplesNum, u32 inp
 		int scaleval = getScaleValue(channelsNum);
 		s16* outbuf = (s16*)Memory::GetPointer(outputAddr);
 		memset(outbuf, 0, samplesNum * sizeof(s16) * 2);
+		Memory::MarkDirtyRange(outputAddr, samplesNum * sizeof(s16) * 2);
 		for (u32 k = 0; k < channelsNum; k++) {
 			u32 inaddr = Memory::Read_U32(inputAddr + k * 4);
 			s16 *inbuf = (s16*)Memory::GetPointer(inaddr);
@@ -134,6 +134,17 @@ void __RtcDoState(PointerWrap &p)
 	rtcBaseTicks = 1000000ULL * rtcBaseTime.tv_sec + rtcBaseTime.tv_usec + rtcMagicOffset;
 }
 
+void __RtcGetBaseTime(PSPTimeval *tv)
+{
+	*tv = rtcBaseTime;
+}
+
+void __RtcSetBaseTime(const PSPTimeval &tv)
+{
+	rtcBaseTime = tv;
+	rtcBaseTicks = 1000000ULL * rtcBaseTime.tv_sec + rtcBaseTime.tv_usec + rtcMagicOffset;
+}
+
 void __RtcTimeOfDay(PSPTimeval *tv)
 {
 	s64 additionalUs = CoreTiming::GetGlobalTimeUs();
@@ -23,6 +23,9 @@ struct PSPTimeval {
 };
 
 void __RtcTimeOfDay(PSPTimeval *tv);
+// The host time at boot, which all emulated time counts from.  Set before the game runs to replay a run.
+void __RtcGetBaseTime(PSPTimeval *tv);
+void __RtcSetBaseTime(const PSPTimeval &tv);
 
 void Register_sceRtc();
 void __RtcInit();
@@ -559,6 +559,7 @@ u32 sceUtilityGetSystemParamString(u32 id, u32 destaddr, int destSize)
 		if (destSize <= (int)g_Config.sNickName.length())
 			return PSP_SYSTEMPARAM_RETVAL_STRING_TOO_LONG;
 		strncpy(buf, g_Config.sNickName.c_str(), destSize);
+		Memory::MarkDirtyRange(destaddr, destSize);
 		break;
 
 	default:
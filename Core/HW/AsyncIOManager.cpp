@@ -15,6 +15,10 @@
 // Official git repository and contact information can be found at
 // https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
 
+#include <cstring>
+
+#include "base/timeutil.h"
+#include "native/thread/threadutil.h"
 #include "Common/ChunkFile.h"
 #include "Core/Reporting.h"
 #include "Core/System.h"
@@ -26,10 +30,40 @@ void AsyncIOManager::ScheduleOperation(AsyncIOEvent ev) {
 	if (!resultsPending_.insert(ev.handle).second) {
 		ERROR_LOG_REPORT(SCEIO, "Scheduling operation for file %d while one is pending (type %d)", ev.handle, ev.type);
 	}
+	if ((int)resultsPending_.size() > maxInFlight_) {
+		maxInFlight_ = (int)resultsPending_.size();
+	}
+	ev.scheduledTime = real_time_now();
 	ScheduleEvent(ev);
 }
 
+void AsyncIOManager::StartWorkers(int count) {
+	StopWorkers();
+	if (count <= 1) {
+		return;
+	}
+
+	workersStop_ = false;
+	for (int i = 0; i < count; ++i) {
+		workers_.push_back(new std::thread(&AsyncIOManager::WorkerLoop, this));
+	}
+}
+
+void AsyncIOManager::StopWorkers() {
+	{
+		lock_guard guard(jobsLock_);
+		workersStop_ = true;
+		jobsWait_.notify_all();
+	}
+	for (size_t i = 0; i < workers_.size(); ++i) {
+		workers_[i]->join();
+		delete workers_[i];
+	}
+	workers_.clear();
+}
+
 void AsyncIOManager::Shutdown() {
+	StopWorkers();
 	lock_guard guard(resultsLock_);
 	resultsPending_.clear();
 	results_.clear();
@@ -50,7 +84,8 @@ bool AsyncIOManager::PopResult(u32 handle, AsyncIOResult &result) {
 bool AsyncIOManager::WaitResult(u32 handle, AsyncIOResult &result) {
 	lock_guard guard(resultsLock_);
 	ScheduleEvent(IO_EVENT_SYNC);
-	while (HasEvents() && ThreadEnabled() && resultsPending_.find(handle) != resultsPending_.end()) {
+	// The event loop hands the operation to a worker before it gets to the sync.
+	while ((HasEvents() || WorkersBusy()) && ThreadEnabled() && resultsPending_.find(handle) != resultsPending_.end()) {
 		if (PopResult(handle, result)) {
 			return true;
 		}
@@ -66,11 +101,16 @@ bool AsyncIOManager::WaitResult(u32 handle, AsyncIOResult &result) {
 void AsyncIOManager::ProcessEvent(AsyncIOEvent ev) {
 	switch (ev.type) {
 	case IO_EVENT_READ:
-		Read(ev.handle, ev.buf, ev.bytes);
-		break;
-
 	case IO_EVENT_WRITE:
-		Write(ev.handle, ev.buf, ev.bytes);
+		if (workers_.empty() || !ThreadEnabled()) {
+			RunOperation(ev);
+		} else {
+			// sceIo only allows one pending operation per file, so there's nothing to keep in order here.
+			lock_guard guard(jobsLock_);
+			jobs_.push_back(ev);
+			jobsActive_++;
+			jobsWait_.notify_one();
+		}
 		break;
 
 	default:
@@ -78,6 +118,53 @@ void AsyncIOManager::ProcessEvent(AsyncIOEvent ev) {
 	}
 }
 
+void AsyncIOManager::RunOperation(const AsyncIOEvent &ev) {
+	if (ev.type == IO_EVENT_READ) {
+		Read(ev.handle, ev.buf, ev.bytes);
+		RecordStats(readStats_, ev);
+	} else {
+		Write(ev.handle, ev.buf, ev.bytes);
+		RecordStats(writeStats_, ev);
+	}
+}
+
+void AsyncIOManager::WorkerLoop() {
+	setCurrentThreadName("IOWorker");
+
+	lock_guard guard(jobsLock_);
+	while (true) {
+		while (jobs_.empty() && !workersStop_) {
+			jobsWait_.wait(jobsLock_);
+		}
+		// Finish whatever is queued before stopping, someone may be waiting on it.
+		if (jobs_.empty()) {
+			break;
+		}
+
+		AsyncIOEvent ev = jobs_.front();
+		jobs_.pop_front();
+
+		jobsLock_.unlock();
+		RunOperation(ev);
+		jobsLock_.lock();
+
+		jobsActive_--;
+		jobsDone_.notify_all();
+	}
+}
+
+bool AsyncIOManager::WorkersBusy() {
+	lock_guard guard(jobsLock_);
+	return jobsActive_ != 0;
+}
+
+void AsyncIOManager::WaitForWorkers() {
+	lock_guard guard(jobsLock_);
+	while (jobsActive_ != 0) {
+		jobsDone_.wait(jobsLock_);
+	}
+}
+
 void AsyncIOManager::Read(u32 handle, u8 *buf, size_t bytes) {
 	size_t result = pspFileSystem.ReadFile(handle, buf, bytes);
 	EventResult(handle, result);
@@ -97,12 +184,45 @@ void AsyncIOManager::EventResult(u32 handle, AsyncIOResult result) {
 	resultsWait_.notify_one();
 }
 
+void AsyncIOManager::RecordStats(AsyncIOStats &stats, const AsyncIOEvent &ev) {
+	const double elapsed = real_time_now() - ev.scheduledTime;
+	const double micros = elapsed * 1000000.0;
+	int bucket = 0;
+	while (bucket < IO_LATENCY_BUCKETS - 1 && micros >= (double)(1 << bucket)) {
+		++bucket;
+	}
+
+	lock_guard guard(resultsLock_);
+	stats.count++;
+	stats.bytes += ev.bytes;
+	stats.totalSeconds += elapsed;
+	if (elapsed > stats.maxSeconds) {
+		stats.maxSeconds = elapsed;
+	}
+	stats.latency[bucket]++;
+}
+
+void AsyncIOManager::GetStats(AsyncIOStats &reads, AsyncIOStats &writes, int &maxInFlight) {
+	lock_guard guard(resultsLock_);
+	reads = readStats_;
+	writes = writeStats_;
+	maxInFlight = maxInFlight_;
+}
+
+void AsyncIOManager::ResetStats() {
+	lock_guard guard(resultsLock_);
+	memset(&readStats_, 0, sizeof(readStats_));
+	memset(&writeStats_, 0, sizeof(writeStats_));
+	maxInFlight_ = 0;
+}
+
 void AsyncIOManager::DoState(PointerWrap &p) {
 	auto s = p.Section("AsyncIoManager", 1);
 	if (!s)
 		return;
 
 	SyncThread();
+	WaitForWorkers();
 	lock_guard guard(resultsLock_);
 	p.Do(resultsPending_);
 	p.Do(results_);
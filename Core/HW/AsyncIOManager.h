@@ -15,8 +15,13 @@
 // Official git repository and contact information can be found at
 // https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
 
+#pragma once
+
+#include <deque>
 #include <map>
 #include <set>
+#include <thread>
+#include <vector>
 #include "native/base/mutex.h"
 #include "Core/ThreadEventQueue.h"
 
@@ -37,6 +42,8 @@ struct AsyncIOEvent {
 	u32 handle;
 	u8 *buf;
 	size_t bytes;
+	// real_time_now() when scheduled, for the latency stats.
+	double scheduledTime;
 
 	operator AsyncIOEventType() const {
 		return type;
@@ -46,17 +53,41 @@ struct AsyncIOEvent {
 // TODO: Something better.
 typedef size_t AsyncIOResult;
 
+enum {
+	// Bucket i counts requests that took under 2^i microseconds, the last one everything slower.
+	IO_LATENCY_BUCKETS = 24,
+};
+
+struct AsyncIOStats {
+	u32 count;
+	u64 bytes;
+	double totalSeconds;
+	double maxSeconds;
+	u32 latency[IO_LATENCY_BUCKETS];
+};
+
 typedef ThreadEventQueue<NoBase, AsyncIOEvent, AsyncIOEventType, IO_EVENT_INVALID, IO_EVENT_SYNC, IO_EVENT_FINISH> IOThreadEventQueue;
 class AsyncIOManager : public IOThreadEventQueue {
 public:
+	AsyncIOManager() : jobsActive_(0), workersStop_(false) {
+		ResetStats();
+	}
+
 	void DoState(PointerWrap &p);
 
 	void ScheduleOperation(AsyncIOEvent ev);
+	// Reads and writes are handed from the event loop to this many threads, so operations on
+	// different files can be in flight together.  1 or less runs them on the event loop itself.
+	void StartWorkers(int count);
 	void Shutdown();
 
 	bool PopResult(u32 handle, AsyncIOResult &result);
 	bool WaitResult(u32 handle, AsyncIOResult &result);
 
+	// Latency is measured from ScheduleOperation() to the result being available, not savestated.
+	void GetStats(AsyncIOStats &reads, AsyncIOStats &writes, int &maxInFlight);
+	void ResetStats();
+
 protected:
 	virtual void ProcessEvent(AsyncIOEvent ref);
 	virtual bool ShouldExitEventLoop() {
@@ -64,13 +95,33 @@ protected:
 	}
 
 private:
+	void RunOperation(const AsyncIOEvent &ev);
 	void Read(u32 handle, u8 *buf, size_t bytes);
 	void Write(u32 handle, u8 *buf, size_t bytes);
 
+	void WorkerLoop();
+	bool WorkersBusy();
+	void WaitForWorkers();
+	void StopWorkers();
+
 	void EventResult(u32 handle, AsyncIOResult result);
+	void RecordStats(AsyncIOStats &stats, const AsyncIOEvent &ev);
 
 	recursive_mutex resultsLock_;
 	condition_variable resultsWait_;
 	std::set<u32> resultsPending_;
 	std::map<u32, AsyncIOResult> results_;
+
+	std::vector<std::thread *> workers_;
+	recursive_mutex jobsLock_;
+	condition_variable jobsWait_;
+	condition_variable jobsDone_;
+	std::deque<AsyncIOEvent> jobs_;
+	// Queued plus currently running, protected by jobsLock_.
+	int jobsActive_;
+	bool workersStop_;
+
+	AsyncIOStats readStats_;
+	AsyncIOStats writeStats_;
+	int maxInFlight_;
 };
\ No newline at end of file
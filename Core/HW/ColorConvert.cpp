@@ -0,0 +1,207 @@
+// Copyright (c) 2012- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#include <cstring>
+
+#include "Common/Common.h"
+#include "Common/Swap.h"
+#include "Core/HW/ColorConvert.h"
+
+#ifdef _M_SSE
+#include <emmintrin.h>
+#endif
+
+// TODO: NEON versions.  These loops are simple enough that compilers often vectorize the scalar parts.
+
+static inline u32 YCbCrToABGR8888(int y, int cb, int cr) {
+	//see http://en.wikipedia.org/wiki/Yuv#Y.27UV444_to_RGB888_conversion for more information.
+	cb = cb - 128;
+	cr = cr - 128;
+	int r = y + cr + (cr >> 2) + (cr >> 3) + (cr >> 5);
+	int g = y - ((cb >> 2) + (cb >> 4) + (cb >> 5)) - ((cr >> 1) + (cr >> 3) + (cr >> 4) + (cr >> 5));
+	int b = y + cb + (cb >> 1) + (cb >> 2) + (cb >> 6);
+
+	// check rgb value.
+	if (r > 0xFF) r = 0xFF; if(r < 0) r = 0;
+	if (g > 0xFF) g = 0xFF; if(g < 0) g = 0;
+	if (b > 0xFF) b = 0xFF; if(b < 0) b = 0;
+
+	return 0xFF000000 | (b << 16) | (g << 8) | (r << 0);
+}
+
+static inline u16 ABGR8888ToBGR565(u32 px) {
+	return ((px >> 3) & 0x001F) | ((px >> 5) & 0x07E0) | ((px >> 8) & 0xF800);
+}
+
+static inline u16 ABGR8888ToABGR5551(u32 px) {
+	return ((px >> 3) & 0x001F) | ((px >> 6) & 0x03E0) | ((px >> 9) & 0x7C00) | ((px >> 16) & 0x8000);
+}
+
+static inline u16 ABGR8888ToABGR4444(u32 px) {
+	return ((px >> 4) & 0x000F) | ((px >> 8) & 0x00F0) | ((px >> 12) & 0x0F00) | ((px >> 16) & 0xF000);
+}
+
+#ifdef _M_SSE
+// Packs the low 16 bits of each 32-bit lane, without packs_epi32's signed saturation getting in the way.
+static inline __m128i PackLow16(__m128i lo, __m128i hi) {
+	lo = _mm_srai_epi32(_mm_slli_epi32(lo, 16), 16);
+	hi = _mm_srai_epi32(_mm_slli_epi32(hi, 16), 16);
+	return _mm_packs_epi32(lo, hi);
+}
+
+template <int shift>
+static inline __m128i MaskShiftRight(__m128i px, u32 mask) {
+	return _mm_and_si128(_mm_srli_epi32(px, shift), _mm_set1_epi32(mask));
+}
+#endif
+
+void ConvertYCbCrToABGR8888(u32 *dst, const u8 *y, const u8 *cb, const u8 *cr, int width) {
+	int x = 0;
+#ifdef _M_SSE
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i c128 = _mm_set1_epi16(128);
+	const __m128i alpha = _mm_set1_epi8((char)0xFF);
+	// The PSP's math fits in 16 bits, and srai matches the >> on negative values above.
+	for (; x + 8 <= width; x += 8) {
+		const int c = x >> 2;
+		__m128i yv = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(y + x)), zero);
+		__m128i cbv = _mm_sub_epi16(_mm_set_epi16(cb[c + 1], cb[c + 1], cb[c + 1], cb[c + 1], cb[c], cb[c], cb[c], cb[c]), c128);
+		__m128i crv = _mm_sub_epi16(_mm_set_epi16(cr[c + 1], cr[c + 1], cr[c + 1], cr[c + 1], cr[c], cr[c], cr[c], cr[c]), c128);
+
+		__m128i r = _mm_add_epi16(_mm_add_epi16(yv, crv), _mm_srai_epi16(crv, 2));
+		r = _mm_add_epi16(r, _mm_add_epi16(_mm_srai_epi16(crv, 3), _mm_srai_epi16(crv, 5)));
+
+		__m128i gcb = _mm_add_epi16(_mm_add_epi16(_mm_srai_epi16(cbv, 2), _mm_srai_epi16(cbv, 4)), _mm_srai_epi16(cbv, 5));
+		__m128i gcr = _mm_add_epi16(_mm_add_epi16(_mm_srai_epi16(crv, 1), _mm_srai_epi16(crv, 3)), _mm_add_epi16(_mm_srai_epi16(crv, 4), _mm_srai_epi16(crv, 5)));
+		__m128i g = _mm_sub_epi16(_mm_sub_epi16(yv, gcb), gcr);
+
+		__m128i b = _mm_add_epi16(_mm_add_epi16(yv, cbv), _mm_srai_epi16(cbv, 1));
+		b = _mm_add_epi16(b, _mm_add_epi16(_mm_srai_epi16(cbv, 2), _mm_srai_epi16(cbv, 6)));
+
+		// Saturating to unsigned bytes is the same as the clamp.
+		__m128i rg = _mm_unpacklo_epi8(_mm_packus_epi16(r, r), _mm_packus_epi16(g, g));
+		__m128i ba = _mm_unpacklo_epi8(_mm_packus_epi16(b, b), alpha);
+		_mm_storeu_si128((__m128i *)(dst + x), _mm_unpacklo_epi16(rg, ba));
+		_mm_storeu_si128((__m128i *)(dst + x + 4), _mm_unpackhi_epi16(rg, ba));
+	}
+#endif
+	for (; x < width; ++x) {
+		dst[x] = YCbCrToABGR8888(y[x], cb[x >> 2], cr[x >> 2]);
+	}
+}
+
+void ConvertABGR8888ToBGR565(u16 *dst, const u32 *src, int width) {
+	int x = 0;
+#ifdef _M_SSE
+	for (; x + 8 <= width; x += 8) {
+		__m128i px0 = _mm_loadu_si128((const __m128i *)(src + x));
+		__m128i px1 = _mm_loadu_si128((const __m128i *)(src + x + 4));
+		__m128i c0 = _mm_or_si128(_mm_or_si128(MaskShiftRight<3>(px0, 0x001F), MaskShiftRight<5>(px0, 0x07E0)), MaskShiftRight<8>(px0, 0xF800));
+		__m128i c1 = _mm_or_si128(_mm_or_si128(MaskShiftRight<3>(px1, 0x001F), MaskShiftRight<5>(px1, 0x07E0)), MaskShiftRight<8>(px1, 0xF800));
+		_mm_storeu_si128((__m128i *)(dst + x), PackLow16(c0, c1));
+	}
+#endif
+	for (; x < width; ++x) {
+		dst[x] = ABGR8888ToBGR565(src[x]);
+	}
+}
+
+void ConvertABGR8888ToABGR5551(u16 *dst, const u32 *src, int width) {
+	int x = 0;
+#ifdef _M_SSE
+	for (; x + 8 <= width; x += 8) {
+		__m128i px0 = _mm_loadu_si128((const __m128i *)(src + x));
+		__m128i px1 = _mm_loadu_si128((const __m128i *)(src + x + 4));
+		__m128i c0 = _mm_or_si128(_mm_or_si128(MaskShiftRight<3>(px0, 0x001F), MaskShiftRight<6>(px0, 0x03E0)), _mm_or_si128(MaskShiftRight<9>(px0, 0x7C00), MaskShiftRight<16>(px0, 0x8000)));
+		__m128i c1 = _mm_or_si128(_mm_or_si128(MaskShiftRight<3>(px1, 0x001F), MaskShiftRight<6>(px1, 0x03E0)), _mm_or_si128(MaskShiftRight<9>(px1, 0x7C00), MaskShiftRight<16>(px1, 0x8000)));
+		_mm_storeu_si128((__m128i *)(dst + x), PackLow16(c0, c1));
+	}
+#endif
+	for (; x < width; ++x) {
+		dst[x] = ABGR8888ToABGR5551(src[x]);
+	}
+}
+
+void ConvertABGR8888ToABGR4444(u16 *dst, const u32 *src, int width) {
+	int x = 0;
+#ifdef _M_SSE
+	for (; x + 8 <= width; x += 8) {
+		__m128i px0 = _mm_loadu_si128((const __m128i *)(src + x));
+		__m128i px1 = _mm_loadu_si128((const __m128i *)(src + x + 4));
+		__m128i c0 = _mm_or_si128(_mm_or_si128(MaskShiftRight<4>(px0, 0x000F), MaskShiftRight<8>(px0, 0x00F0)), _mm_or_si128(MaskShiftRight<12>(px0, 0x0F00), MaskShiftRight<16>(px0, 0xF000)));
+		__m128i c1 = _mm_or_si128(_mm_or_si128(MaskShiftRight<4>(px1, 0x000F), MaskShiftRight<8>(px1, 0x00F0)), _mm_or_si128(MaskShiftRight<12>(px1, 0x0F00), MaskShiftRight<16>(px1, 0xF000)));
+		_mm_storeu_si128((__m128i *)(dst + x), PackLow16(c0, c1));
+	}
+#endif
+	for (; x < width; ++x) {
+		dst[x] = ABGR8888ToABGR4444(src[x]);
+	}
+}
+
+static void MaskCopy32(u32 *dst, const u32 *src, int count, u32 mask) {
+	int i = 0;
+#ifdef _M_SSE
+	const __m128i maskv = _mm_set1_epi32(mask);
+	for (; i + 4 <= count; i += 4) {
+		_mm_storeu_si128((__m128i *)(dst + i), _mm_and_si128(_mm_loadu_si128((const __m128i *)(src + i)), maskv));
+	}
+#endif
+	u32_le *dest = (u32_le *)dst;
+	const u32_le *source = (const u32_le *)src;
+	for (; i < count; ++i) {
+		dest[i] = source[i] & mask;
+	}
+}
+
+static void MaskCopy16(u16 *dst, const u16 *src, int count, u16 mask) {
+	int i = 0;
+#ifdef _M_SSE
+	const __m128i maskv = _mm_set1_epi16(mask);
+	for (; i + 8 <= count; i += 8) {
+		_mm_storeu_si128((__m128i *)(dst + i), _mm_and_si128(_mm_loadu_si128((const __m128i *)(src + i)), maskv));
+	}
+#endif
+	u16_le *dest = (u16_le *)dst;
+	const u16_le *source = (const u16_le *)src;
+	for (; i < count; ++i) {
+		dest[i] = source[i] & mask;
+	}
+}
+
+void CopyVideoImage(u8 *dst, int dstStride, const u8 *src, int srcStride, int width, int height, GEBufferFormat format) {
+	const int bpp = format == GE_FORMAT_8888 ? 4 : 2;
+	for (int y = 0; y < height; ++y) {
+		switch (format) {
+		case GE_FORMAT_8888:
+			MaskCopy32((u32 *)dst, (const u32 *)src, width, 0x00FFFFFF);
+			break;
+		case GE_FORMAT_565:
+			memcpy(dst, src, width * sizeof(u16));
+			break;
+		case GE_FORMAT_5551:
+			MaskCopy16((u16 *)dst, (const u16 *)src, width, 0x7FFF);
+			break;
+		case GE_FORMAT_4444:
+			MaskCopy16((u16 *)dst, (const u16 *)src, width, 0x0FFF);
+			break;
+		default:
+			return;
+		}
+		dst += dstStride * bpp;
+		src += srcStride * bpp;
+	}
+}
@@ -0,0 +1,38 @@
+// Copyright (c) 2012- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#pragma once
+
+#include "Common/CommonTypes.h"
+#include "GPU/ge_constants.h"
+
+// Pixel conversions for the video and image decoders (MediaEngine, sceJpeg.)
+// Everything is in PSP order, with red in the low bits.  Uses SSE2 when available.
+
+// Y has one sample per pixel, Cb and Cr one per 4 pixels horizontally (like sceJpegMJpegCsc.)
+// Rounds exactly like the PSP's fixed point conversion.  Alpha is set to 0xFF.
+void ConvertYCbCrToABGR8888(u32 *dst, const u8 *y, const u8 *cb, const u8 *cr, int width);
+
+// Alpha is kept (the top bit, or top 4 bits, for 5551 and 4444.)
+void ConvertABGR8888ToBGR565(u16 *dst, const u32 *src, int width);
+void ConvertABGR8888ToABGR5551(u16 *dst, const u32 *src, int width);
+void ConvertABGR8888ToABGR4444(u16 *dst, const u32 *src, int width);
+
+// Copies rows of format pixels, clearing alpha, since decoded video never has any on the PSP.
+// Some games depend on this, for example Sword Art Online (doesn't clear A's from buffer.)
+// Strides are in pixels.
+void CopyVideoImage(u8 *dst, int dstStride, const u8 *src, int srcStride, int width, int height, GEBufferFormat format);
@@ -15,7 +15,10 @@
 // Official git repository and contact information can be found at
 // https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
 
+#include "base/timeutil.h"
+#include "native/thread/threadutil.h"
 #include "Core/Config.h"
+#include "Core/HW/ColorConvert.h"
 #include "Core/HW/MediaEngine.h"
 #include "Core/MemMap.h"
 #include "Core/Reporting.h"
@@ -42,6 +45,32 @@ static const int TPSM_PIXEL_STORAGE_MODE_32BIT_ABGR8888 = 0x03;
 
 int g_iNumVideos = 0;
 
+// Below this much buffered data, decoding ahead could run the demuxer dry before the game adds more.
+// Running dry looks like the end of the stream to ffmpeg, so leave that to stepVideo() to handle.
+static const int DECODE_AHEAD_MIN_QUEUED = 0x20000;
+static const int DECODE_AHEAD_MAX_FRAMES = 8;
+
+static recursive_mutex videoDecodeStatsLock;
+static VideoDecodeStats videoDecodeStats;
+
+static void RecordVideoDecode(double seconds, int queueDepth) {
+	lock_guard guard(videoDecodeStatsLock);
+	videoDecodeStats.framesDecoded++;
+	videoDecodeStats.totalSeconds += seconds;
+	videoDecodeStats.maxSeconds = std::max(videoDecodeStats.maxSeconds, seconds);
+	videoDecodeStats.maxQueueDepth = std::max(videoDecodeStats.maxQueueDepth, queueDepth);
+}
+
+void GetVideoDecodeStats(VideoDecodeStats &stats) {
+	lock_guard guard(videoDecodeStatsLock);
+	stats = videoDecodeStats;
+}
+
+void ResetVideoDecodeStats() {
+	lock_guard guard(videoDecodeStatsLock);
+	memset(&videoDecodeStats, 0, sizeof(videoDecodeStats));
+}
+
 #ifdef USE_FFMPEG
 static AVPixelFormat getSwsFormat(int pspFormat)
 {
@@ -157,6 +186,15 @@ MediaEngine::MediaEngine(): m_pdata(0) {
 
 	m_ringbuffersize = 0;
 	m_mpegheaderReadPos = 0;
+	m_decodePts = 0;
+
+	m_aheadThread = 0;
+	m_aheadPixelMode = TPSM_PIXEL_STORAGE_MODE_32BIT_ABGR8888;
+	m_aheadStop = false;
+	m_aheadStalled = false;
+	m_poppedBytes = 0;
+	m_visiblePoppedBytes = 0;
+	m_visibleDecodingSize = 0;
 	g_iNumVideos++;
 }
 
@@ -179,10 +217,13 @@ void MediaEngine::closeMedia() {
 }
 
 void MediaEngine::DoState(PointerWrap &p){
-	auto s = p.Section("MediaEngine", 1, 2);
+	auto s = p.Section("MediaEngine", 1, 4);
 	if (!s)
 		return;
 
+	// Frames already decoded ahead are saved below, so just let the worker finish its current one.
+	stopDecodeAhead(false);
+
 	p.Do(m_videoStream);
 	p.Do(m_audioStream);
 
@@ -217,6 +258,39 @@ void MediaEngine::DoState(PointerWrap &p){
 
 	p.Do(m_isVideoEnd);
 	p.Do(m_noAudioData);
+
+	// The data for these frames is already gone from m_pdata, so they have to be kept.
+	u32 aheadCount = (u32)m_aheadFrames.size();
+	if (s >= 3) {
+		p.Do(aheadCount);
+		if (p.mode == p.MODE_READ)
+			m_aheadFrames.resize(aheadCount);
+		for (u32 i = 0; i < aheadCount; ++i) {
+			p.Do(m_aheadFrames[i].data);
+			p.Do(m_aheadFrames[i].pts);
+			p.Do(m_aheadFrames[i].pixelMode);
+			if (s >= 4) {
+				p.Do(m_aheadFrames[i].poppedBytes);
+				p.Do(m_aheadFrames[i].decodingSize);
+			} else {
+				m_aheadFrames[i].poppedBytes = 0;
+				m_aheadFrames[i].decodingSize = m_decodingsize;
+			}
+		}
+	} else if (p.mode == p.MODE_READ) {
+		m_aheadFrames.clear();
+	}
+	if (s >= 4) {
+		p.Do(m_poppedBytes);
+		p.Do(m_visiblePoppedBytes);
+		p.Do(m_visibleDecodingSize);
+	} else if (p.mode == p.MODE_READ) {
+		m_poppedBytes = 0;
+		m_visiblePoppedBytes = 0;
+		m_visibleDecodingSize = m_decodingsize;
+	}
+	if (p.mode == p.MODE_READ)
+		m_decodePts = m_aheadFrames.empty() ? m_videopts : m_aheadFrames.back().pts;
 }
 
 int _MpegReadbuffer(void *opaque, uint8_t *buf, int buf_size)
@@ -232,9 +306,12 @@ int _MpegReadbuffer(void *opaque, uint8_t *buf, int buf_size)
 	} else if (mpeg->m_mpegheaderReadPos == mpegheaderSize) {
 		return 0;
 	} else {
+		lock_guard guard(mpeg->m_queueLock);
 		size = mpeg->m_pdata->pop_front(buf, buf_size);
-		if (size > 0)
+		if (size > 0) {
 			mpeg->m_decodingsize = size;
+			mpeg->m_poppedBytes += size;
+		}
 	}
 	return size;
 }
@@ -289,12 +366,14 @@ bool MediaEngine::openContext() {
 	m_noAudioData = false;
 	m_mpegheaderReadPos++;
 	av_seek_frame(m_pFormatCtx, m_videoStream, 0, 0);
+	syncVisibleRemain();
 #endif // USE_FFMPEG
 	return true;
 }
 
 void MediaEngine::closeContext()
 {
+	stopDecodeAhead(true);
 #ifdef USE_FFMPEG
 	if (m_buffer)
 		av_free(m_buffer);
@@ -324,10 +403,14 @@ bool MediaEngine::loadStream(u8* buffer, int readSize, int RingbufferSize)
 	closeMedia();
 
 	m_videopts = 0;
+	m_decodePts = 0;
 	m_audiopts = 0;
 	m_ringbuffersize = RingbufferSize;
 	m_pdata = new BufferQueue(RingbufferSize + 2048);
 	m_pdata->push(buffer, readSize);
+	m_poppedBytes = 0;
+	m_visiblePoppedBytes = 0;
+	m_visibleDecodingSize = 0;
 	m_firstTimeStamp = getMpegTimeStamp(buffer + PSMF_FIRST_TIMESTAMP_OFFSET);
 	m_lastTimeStamp = getMpegTimeStamp(buffer + PSMF_LAST_TIMESTAMP_OFFSET);
 	int mpegoffset = (int)(*(s32_be*)(buffer + 8));
@@ -339,8 +422,13 @@ bool MediaEngine::loadStream(u8* buffer, int readSize, int RingbufferSize)
 int MediaEngine::addStreamData(u8* buffer, int addSize) {
 	int size = addSize;
 	if (size > 0 && m_pdata) {
-		if (!m_pdata->push(buffer, size)) 
-			size  = 0;
+		{
+			lock_guard guard(m_queueLock);
+			if (!m_pdata->push(buffer, size))
+				size = 0;
+			m_aheadStalled = false;
+			m_aheadWait.notify_one();
+		}
 		if (m_demux) {
 			m_noAudioData = false;
 			m_demux->addStreamData(buffer, addSize);
@@ -366,6 +454,8 @@ bool MediaEngine::setVideoStream(int streamNum, bool force) {
 		return true;
 	}
 
+	// Anything decoded ahead was from the old stream.
+	stopDecodeAhead(true);
 	m_videoStream = streamNum;
 #ifdef USE_FFMPEG
 	if (m_pFormatCtx && m_pCodecCtxs.find(m_videoStream) == m_pCodecCtxs.end()) {
@@ -392,6 +482,7 @@ bool MediaEngine::setVideoStream(int streamNum, bool force) {
 
 bool MediaEngine::setVideoDim(int width, int height)
 {
+	stopDecodeAhead(true);
 #ifdef USE_FFMPEG
 	auto codecIter = m_pCodecCtxs.find(m_videoStream);
 	if (codecIter == m_pCodecCtxs.end())
@@ -454,57 +545,100 @@ void MediaEngine::updateSwsFormat(int videoPixelMode) {
 #endif
 }
 
-bool MediaEngine::stepVideo(int videoPixelMode) {
+bool MediaEngine::decodeFrame(u8 *dest, int destStride, bool &dataEnd) {
 #ifdef USE_FFMPEG
+	// Called with m_decodeLock held.  The map only changes after decode-ahead is stopped.
 	auto codecIter = m_pCodecCtxs.find(m_videoStream);
-	AVCodecContext *m_pCodecCtx = codecIter == m_pCodecCtxs.end() ? 0 : codecIter->second;
-
-	if (!m_pFormatCtx)
-		return false;
-	if (!m_pCodecCtx)
-		return false;
-	if ((!m_pFrame)||(!m_pFrameRGB))
+	if (codecIter == m_pCodecCtxs.end()) {
+		dataEnd = false;
 		return false;
-
-	updateSwsFormat(videoPixelMode);
-	// TODO: Technically we could set this to frameWidth instead of m_desWidth for better perf.
-	// Update the linesize for the new format too.  We started with the largest size, so it should fit.
-	m_pFrameRGB->linesize[0] = getPixelFormatBytes(videoPixelMode) * m_desWidth;
+	}
+	AVCodecContext *m_pCodecCtx = codecIter->second;
+	u8 *destData[4] = { dest, 0, 0, 0 };
+	int destLinesize[4] = { destStride, 0, 0, 0 };
 
 	AVPacket packet;
 	int frameFinished;
 	bool bGetFrame = false;
+	dataEnd = false;
 	while (!bGetFrame) {
-		bool dataEnd = av_read_frame(m_pFormatCtx, &packet) < 0;
+		bool readEnd = av_read_frame(m_pFormatCtx, &packet) < 0;
 		// Even if we've read all frames, some may have been re-ordered frames at the end.
 		// Still need to decode those, so keep calling avcodec_decode_video2().
-		if (dataEnd || packet.stream_index == m_videoStream) {
+		if (readEnd || packet.stream_index == m_videoStream) {
 			// avcodec_decode_video2() gives us the re-ordered frames with a NULL packet.
-			if (dataEnd)
+			if (readEnd)
 				av_free_packet(&packet);
 
 			int result = avcodec_decode_video2(m_pCodecCtx, m_pFrame, &frameFinished, &packet);
 			if (frameFinished) {
 				sws_scale(m_sws_ctx, m_pFrame->data, m_pFrame->linesize, 0,
-					m_pCodecCtx->height, m_pFrameRGB->data, m_pFrameRGB->linesize);
+					m_pCodecCtx->height, destData, destLinesize);
 
 				if (av_frame_get_best_effort_timestamp(m_pFrame) != AV_NOPTS_VALUE)
-					m_videopts = av_frame_get_best_effort_timestamp(m_pFrame) + av_frame_get_pkt_duration(m_pFrame) - m_firstTimeStamp;
+					m_decodePts = av_frame_get_best_effort_timestamp(m_pFrame) + av_frame_get_pkt_duration(m_pFrame) - m_firstTimeStamp;
 				else
-					m_videopts += av_frame_get_pkt_duration(m_pFrame);
+					m_decodePts += av_frame_get_pkt_duration(m_pFrame);
 				bGetFrame = true;
 			}
-			if (result <= 0 && dataEnd) {
+			if (result <= 0 && readEnd) {
+				dataEnd = true;
+				break;
+			}
+		}
+		av_free_packet(&packet);
+	}
+	return bGetFrame;
+#else
+	dataEnd = false;
+	return false;
+#endif // USE_FFMPEG
+}
+
+bool MediaEngine::stepVideo(int videoPixelMode) {
+#ifdef USE_FFMPEG
+	auto codecIter = m_pCodecCtxs.find(m_videoStream);
+	AVCodecContext *m_pCodecCtx = codecIter == m_pCodecCtxs.end() ? 0 : codecIter->second;
+
+	if (!m_pFormatCtx)
+		return false;
+	if (!m_pCodecCtx)
+		return false;
+	if ((!m_pFrame)||(!m_pFrameRGB))
+		return false;
+
+	bool bGetFrame = popAheadFrame(videoPixelMode);
+	if (!bGetFrame) {
+		lock_guard guard(m_decodeLock);
+		// The worker may have just finished one while we waited for it.
+		bGetFrame = popAheadFrame(videoPixelMode);
+		if (!bGetFrame) {
+			updateSwsFormat(videoPixelMode);
+			// TODO: Technically we could set this to frameWidth instead of m_desWidth for better perf.
+			// Update the linesize for the new format too.  We started with the largest size, so it should fit.
+			m_pFrameRGB->linesize[0] = getPixelFormatBytes(videoPixelMode) * m_desWidth;
+
+			double startTime = real_time_now();
+			bool dataEnd;
+			bGetFrame = decodeFrame(m_pFrameRGB->data[0], m_pFrameRGB->linesize[0], dataEnd);
+			if (bGetFrame) {
+				m_videopts = m_decodePts;
+				RecordVideoDecode(real_time_now() - startTime, 0);
+			}
+			lock_guard queueGuard(m_queueLock);
+			if (dataEnd) {
 				// Sometimes, m_readSize is less than m_streamSize at the end, but not by much.
 				// This is kinda a hack, but the ringbuffer would have to be prematurely empty too.
 				m_isVideoEnd = !bGetFrame && (m_pdata->getQueueSize() == 0);
 				if (m_isVideoEnd)
 					m_decodingsize = 0;
-				break;
 			}
+			syncVisibleRemain();
 		}
-		av_free_packet(&packet);
 	}
+
+	if (bGetFrame)
+		startDecodeAhead(videoPixelMode);
 	return bGetFrame;
 #else
 	// If video engine is not available, just add to the timestamp at least.
@@ -513,43 +647,151 @@ bool MediaEngine::stepVideo(int videoPixelMode) {
 #endif // USE_FFMPEG
 }
 
-// Helpers that null out alpha (which seems to be the case on the PSP.)
-// Some games depend on this, for example Sword Art Online (doesn't clear A's from buffer.)
-inline void writeVideoLineRGBA(void *destp, const void *srcp, int width) {
-	// TODO: Use SSE/NEON, investigate why AV_PIX_FMT_RGB0 does not work.
-	u32_le *dest = (u32_le *)destp;
-	const u32_le *src = (u32_le *)srcp;
-
-	u32 mask = 0x00FFFFFF;
-	for (int i = 0; i < width; ++i) {
-		dest[i] = src[i] & mask;
+bool MediaEngine::popAheadFrame(int videoPixelMode) {
+#ifdef USE_FFMPEG
+	lock_guard guard(m_queueLock);
+	while (!m_aheadFrames.empty()) {
+		AheadFrame &frame = m_aheadFrames.front();
+		bool matches = frame.pixelMode == videoPixelMode;
+		m_pFrameRGB->linesize[0] = getPixelFormatBytes(videoPixelMode) * m_desWidth;
+		if (matches) {
+			memcpy(m_pFrameRGB->data[0], &frame.data[0], std::min((int)frame.data.size(), m_pFrameRGB->linesize[0] * m_desHeight));
+		} else if (frame.pixelMode == TPSM_PIXEL_STORAGE_MODE_32BIT_ABGR8888) {
+			// Games don't normally switch formats mid-video, but going down from 8888 is easy.
+			const u32 *src = (const u32 *)&frame.data[0];
+			u16 *dst = (u16 *)m_pFrameRGB->data[0];
+			for (int y = 0; y < m_desHeight; ++y) {
+				switch (videoPixelMode) {
+				case TPSM_PIXEL_STORAGE_MODE_16BIT_BGR5650: ConvertABGR8888ToBGR565(dst, src, m_desWidth); break;
+				case TPSM_PIXEL_STORAGE_MODE_16BIT_ABGR5551: ConvertABGR8888ToABGR5551(dst, src, m_desWidth); break;
+				case TPSM_PIXEL_STORAGE_MODE_16BIT_ABGR4444: ConvertABGR8888ToABGR4444(dst, src, m_desWidth); break;
+				}
+				src += m_desWidth;
+				dst += m_desWidth;
+			}
+			matches = true;
+		} else {
+			// Can't convert it back up, so this frame is lost.
+			WARN_LOG_REPORT(ME, "Dropping video frame decoded ahead as %d, game wants %d", frame.pixelMode, videoPixelMode);
+		}
+		m_videopts = frame.pts;
+		m_visiblePoppedBytes = frame.poppedBytes;
+		m_visibleDecodingSize = frame.decodingSize;
+		m_aheadFreeBuffers.push_back(std::vector<u8>());
+		m_aheadFreeBuffers.back().swap(frame.data);
+		m_aheadFrames.pop_front();
+		m_aheadWait.notify_one();
+
+		if (matches) {
+			lock_guard statsGuard(videoDecodeStatsLock);
+			videoDecodeStats.framesAhead++;
+			return true;
+		}
 	}
+#endif // USE_FFMPEG
+	return false;
 }
 
-inline void writeVideoLineABGR5650(void *destp, const void *srcp, int width) {
-	memcpy(destp, srcp, width * sizeof(u16));
+void MediaEngine::syncVisibleRemain() {
+	lock_guard guard(m_queueLock);
+	m_visiblePoppedBytes = m_poppedBytes;
+	m_visibleDecodingSize = m_decodingsize;
 }
 
-inline void writeVideoLineABGR5551(void *destp, const void *srcp, int width) {
-	// TODO: Use SSE/NEON.
-	u16_le *dest = (u16_le *)destp;
-	const u16_le *src = (u16_le *)srcp;
+bool MediaEngine::canDecodeAhead() {
+	int maxFrames = std::min(g_Config.iVideoDecodeAhead, DECODE_AHEAD_MAX_FRAMES);
+	if (m_aheadStalled || (int)m_aheadFrames.size() >= maxFrames)
+		return false;
+	return m_pdata && m_pdata->getQueueSize() >= DECODE_AHEAD_MIN_QUEUED;
+}
+
+void MediaEngine::startDecodeAhead(int videoPixelMode) {
+#ifdef USE_FFMPEG
+	if (g_Config.iVideoDecodeAhead <= 0 || !m_pFormatCtx)
+		return;
 
-	u16 mask = 0x7FFF;
-	for (int i = 0; i < width; ++i) {
-		dest[i] = src[i] & mask;
+	lock_guard guard(m_queueLock);
+	m_aheadPixelMode = videoPixelMode;
+	if (!m_aheadThread) {
+		m_aheadStop = false;
+		m_aheadThread = new std::thread(&MediaEngine::decodeAheadThread, this);
 	}
+	m_aheadWait.notify_one();
+#endif // USE_FFMPEG
 }
 
-inline void writeVideoLineABGR4444(void *destp, const void *srcp, int width) {
-	// TODO: Use SSE/NEON.
-	u16_le *dest = (u16_le *)destp;
-	const u16_le *src = (u16_le *)srcp;
+void MediaEngine::stopDecodeAhead(bool discard) {
+	// Must not be called with m_decodeLock held, or the worker can't finish its frame.
+	if (m_aheadThread) {
+		{
+			lock_guard guard(m_queueLock);
+			m_aheadStop = true;
+			m_aheadWait.notify_one();
+		}
+		m_aheadThread->join();
+		delete m_aheadThread;
+		m_aheadThread = 0;
+	}
 
-	u16 mask = 0x0FFF;
-	for (int i = 0; i < width; ++i) {
-		dest[i] = src[i] & mask;
+	lock_guard guard(m_queueLock);
+	if (discard && !m_aheadFrames.empty()) {
+		m_aheadFrames.clear();
+		m_decodePts = m_videopts;
 	}
+	m_aheadFreeBuffers.clear();
+	m_aheadStalled = false;
+}
+
+void MediaEngine::decodeAheadThread(MediaEngine *engine) {
+	setCurrentThreadName("VideoDecodeAhead");
+	engine->decodeAheadLoop();
+}
+
+void MediaEngine::decodeAheadLoop() {
+#ifdef USE_FFMPEG
+	while (true) {
+		std::vector<u8> buffer;
+		int pixelMode;
+		{
+			lock_guard guard(m_queueLock);
+			while (!m_aheadStop && !canDecodeAhead())
+				m_aheadWait.wait(m_queueLock);
+			if (m_aheadStop)
+				break;
+			pixelMode = m_aheadPixelMode;
+			if (!m_aheadFreeBuffers.empty()) {
+				buffer.swap(m_aheadFreeBuffers.back());
+				m_aheadFreeBuffers.pop_back();
+			}
+		}
+
+		// Queue the frame before letting go of the decode lock, so a synchronous decode can't jump ahead of it.
+		lock_guard guard(m_decodeLock);
+		updateSwsFormat(pixelMode);
+		int stride = getPixelFormatBytes(pixelMode) * m_desWidth;
+		buffer.resize(stride * m_desHeight);
+
+		double startTime = real_time_now();
+		bool dataEnd;
+		bool gotFrame = decodeFrame(&buffer[0], stride, dataEnd);
+		double elapsed = real_time_now() - startTime;
+
+		lock_guard queueGuard(m_queueLock);
+		if (gotFrame) {
+			m_aheadFrames.push_back(AheadFrame());
+			AheadFrame &frame = m_aheadFrames.back();
+			frame.data.swap(buffer);
+			frame.pts = m_decodePts;
+			frame.pixelMode = pixelMode;
+			frame.poppedBytes = m_poppedBytes;
+			frame.decodingSize = m_decodingsize;
+			RecordVideoDecode(elapsed, (int)m_aheadFrames.size());
+		} else {
+			// Let stepVideo() decide if this is really the end.
+			m_aheadStalled = true;
+		}
+	}
+#endif // USE_FFMPEG
 }
 
 int MediaEngine::writeVideoImage(u32 bufferPtr, int frameWidth, int videoPixelMode) {
@@ -564,55 +806,25 @@ int MediaEngine::writeVideoImage(u32 bufferPtr, int frameWidth, int videoPixelMo
 #ifdef USE_FFMPEG
 	if ((!m_pFrame)||(!m_pFrameRGB))
 		return false;
-	int videoImageSize = 0;
 	// lock the image size
 	int height = m_desHeight;
 	int width = m_desWidth;
-	u8 *imgbuf = buffer;
 	const u8 *data = m_pFrameRGB->data[0];
 
 	switch (videoPixelMode) {
 	case TPSM_PIXEL_STORAGE_MODE_32BIT_ABGR8888:
-		for (int y = 0; y < height; y++) {
-			writeVideoLineRGBA(imgbuf, data, width);
-			data += width * sizeof(u32);
-			imgbuf += frameWidth * sizeof(u32);
-		}
-		videoImageSize = frameWidth * sizeof(u32) * height;
-		break;
-
 	case TPSM_PIXEL_STORAGE_MODE_16BIT_BGR5650:
-		for (int y = 0; y < height; y++) {
-			writeVideoLineABGR5650(imgbuf, data, width);
-			data += width * sizeof(u16);
-			imgbuf += frameWidth * sizeof(u16);
-		}
-		videoImageSize = frameWidth * sizeof(u16) * height;
-		break;
-
 	case TPSM_PIXEL_STORAGE_MODE_16BIT_ABGR5551:
-		for (int y = 0; y < height; y++) {
-			writeVideoLineABGR5551(imgbuf, data, width);
-			data += width * sizeof(u16);
-			imgbuf += frameWidth * sizeof(u16);
-		}
-		videoImageSize = frameWidth * sizeof(u16) * height;
-		break;
-
 	case TPSM_PIXEL_STORAGE_MODE_16BIT_ABGR4444:
-		for (int y = 0; y < height; y++) {
-			writeVideoLineABGR4444(imgbuf, data, width);
-			data += width * sizeof(u16);
-			imgbuf += frameWidth * sizeof(u16);
-		}
-		videoImageSize = frameWidth * sizeof(u16) * height;
-		break;
+		// The video pixel modes match the GE's buffer formats.
+		CopyVideoImage(buffer, frameWidth, data, width, width, height, (GEBufferFormat)videoPixelMode);
+		Memory::MarkDirtyRange(bufferPtr, frameWidth * getPixelFormatBytes(videoPixelMode) * height);
+		return frameWidth * getPixelFormatBytes(videoPixelMode) * height;
 
 	default:
 		ERROR_LOG_REPORT(ME, "Unsupported video pixel format %d", videoPixelMode);
-		break;
+		return 0;
 	}
-	return videoImageSize;
 #endif // USE_FFMPEG
 	return 0;
 }
@@ -630,9 +842,7 @@ int MediaEngine::writeVideoImageWithRange(u32 bufferPtr, int frameWidth, int vid
 #ifdef USE_FFMPEG
 	if ((!m_pFrame)||(!m_pFrameRGB))
 		return false;
-	int videoImageSize = 0;
 	// lock the image size
-	u8 *imgbuf = buffer;
 	const u8 *data = m_pFrameRGB->data[0];
 
 	if (width > m_desWidth - xpos)
@@ -642,50 +852,21 @@ int MediaEngine::writeVideoImageWithRange(u32 bufferPtr, int frameWidth, int vid
 
 	switch (videoPixelMode) {
 	case TPSM_PIXEL_STORAGE_MODE_32BIT_ABGR8888:
-		data += (ypos * m_desWidth + xpos) * sizeof(u32);
-		for (int y = 0; y < height; y++) {
-			writeVideoLineRGBA(imgbuf, data, width);
-			data += m_desWidth * sizeof(u32);
-			imgbuf += frameWidth * sizeof(u32);
-		}
-		videoImageSize = frameWidth * sizeof(u32) * m_desHeight;
-		break;
-
 	case TPSM_PIXEL_STORAGE_MODE_16BIT_BGR5650:
-		data += (ypos * m_desWidth + xpos) * sizeof(u16);
-		for (int y = 0; y < height; y++) {
-			writeVideoLineABGR5650(imgbuf, data, width);
-			data += m_desWidth * sizeof(u16);
-			imgbuf += frameWidth * sizeof(u16);
-		}
-		videoImageSize = frameWidth * sizeof(u16) * m_desHeight;
-		break;
-
 	case TPSM_PIXEL_STORAGE_MODE_16BIT_ABGR5551:
-		data += (ypos * m_desWidth + xpos) * sizeof(u16);
-		for (int y = 0; y < height; y++) {
-			writeVideoLineABGR5551(imgbuf, data, width);
-			data += m_desWidth * sizeof(u16);
-			imgbuf += frameWidth * sizeof(u16);
-		}
-		videoImageSize = frameWidth * sizeof(u16) * m_desHeight;
-		break;
-
 	case TPSM_PIXEL_STORAGE_MODE_16BIT_ABGR4444:
-		data += (ypos * m_desWidth + xpos) * sizeof(u16);
-		for (int y = 0; y < height; y++) {
-			writeVideoLineABGR4444(imgbuf, data, width);
-			data += m_desWidth * sizeof(u16);
-			imgbuf += frameWidth * sizeof(u16);
+		{
+			int bpp = getPixelFormatBytes(videoPixelMode);
+			data += (ypos * m_desWidth + xpos) * bpp;
+			CopyVideoImage(buffer, frameWidth, data, m_desWidth, width, height, (GEBufferFormat)videoPixelMode);
+			Memory::MarkDirtyRange(bufferPtr, frameWidth * bpp * height);
+			return frameWidth * bpp * m_desHeight;
 		}
-		videoImageSize = frameWidth * sizeof(u16) * m_desHeight;
-		break;
 
 	default:
 		ERROR_LOG(ME, "Unsupported video pixel format %d", videoPixelMode);
-		break;
+		return 0;
 	}
-	return videoImageSize;
 #endif // USE_FFMPEG
 	return 0;
 }
@@ -701,7 +882,10 @@ u8 *MediaEngine::getFrameImage() {
 int MediaEngine::getRemainSize() {
 	if (!m_pdata)
 		return 0;
-	return std::max(m_pdata->getRemainSize() - m_decodingsize - 2048, 0);
+	lock_guard guard(m_queueLock);
+	// As if nothing had been decoded ahead, see m_visiblePoppedBytes.
+	const int aheadBytes = (int)(m_poppedBytes - m_visiblePoppedBytes);
+	return std::max(m_pdata->getRemainSize() - aheadBytes - m_visibleDecodingSize - 2048, 0);
 }
 
 int MediaEngine::getAudioRemainSize() {
@@ -751,6 +935,7 @@ int MediaEngine::getAudioSamples(u32 bufferPtr) {
 			outbuf[i * 2 + 1] = sample;
 		}
 	}
+	Memory::MarkDirtyRange(bufferPtr, 0x2000);
 	m_audiopts += 4180;
 	m_noAudioData = false;
 	return 0x2000;
@@ -24,7 +24,11 @@
 
 // An approximation of what the interface will look like. Similar to JPCSP's.
 
+#include <deque>
 #include <map>
+#include <vector>
+#include "native/base/mutex.h"
+#include "native/thread/thread.h"
 #include "Common/CommonTypes.h"
 #include "Common/ChunkFile.h"
 #include "Core/HLE/sceMpeg.h"
@@ -51,6 +55,19 @@ bool InitFFmpeg();
 
 void __AdjustBGMVolume(s16 *samples, u32 count);
 
+// Totals across all videos since the last reset.
+struct VideoDecodeStats {
+	int framesDecoded;
+	// Frames that were already waiting in a decode-ahead queue when the game asked for them.
+	int framesAhead;
+	double totalSeconds;
+	double maxSeconds;
+	int maxQueueDepth;
+};
+
+void GetVideoDecodeStats(VideoDecodeStats &stats);
+void ResetVideoDecodeStats();
+
 class MediaEngine
 {
 public:
@@ -91,6 +108,25 @@ public:
 
 private:
 	void updateSwsFormat(int videoPixelMode);
+	bool decodeFrame(u8 *dest, int destStride, bool &dataEnd);
+
+	// Decode-ahead runs stepVideo's work on a thread, up to g_Config.iVideoDecodeAhead frames early.
+	struct AheadFrame {
+		std::vector<u8> data;
+		s64 pts;
+		int pixelMode;
+		// m_poppedBytes and m_decodingsize right after it was decoded.
+		s64 poppedBytes;
+		int decodingSize;
+	};
+
+	void startDecodeAhead(int videoPixelMode);
+	void stopDecodeAhead(bool discard);
+	bool canDecodeAhead();
+	bool popAheadFrame(int videoPixelMode);
+	void syncVisibleRemain();
+	void decodeAheadLoop();
+	static void decodeAheadThread(MediaEngine *engine);
 
 public:  // TODO: Very little of this below should be public.
 
@@ -131,4 +167,27 @@ public:  // TODO: Very little of this below should be public.
 	int m_ringbuffersize;
 	u8 m_mpegheader[0x10000];  // TODO: Allocate separately
 	int m_mpegheaderReadPos;
+
+	// Last pts that came out of the decoder.  m_videopts is the last one the game saw.
+	s64 m_decodePts;
+
+	// Protects the ffmpeg contexts (and m_decodePts) while a frame is being decoded.
+	recursive_mutex m_decodeLock;
+	// Protects m_pdata, m_decodingsize, and the decode-ahead queue.  Take m_decodeLock first.
+	recursive_mutex m_queueLock;
+	condition_variable m_aheadWait;
+	std::thread *m_aheadThread;
+	std::deque<AheadFrame> m_aheadFrames;
+	std::vector<std::vector<u8> > m_aheadFreeBuffers;
+	int m_aheadPixelMode;
+	bool m_aheadStop;
+	// Set when the worker couldn't get a frame, until more data is added.
+	bool m_aheadStalled;
+
+	// Bytes the decoder has taken from m_pdata.  Decoding ahead takes them before the game asks
+	// for the frame, so getRemainSize() reports the queue as of the last frame the game got,
+	// which doesn't depend on how far the worker happens to be.  Protected by m_queueLock.
+	s64 m_poppedBytes;
+	s64 m_visiblePoppedBytes;
+	int m_visibleDecodingSize;
 };
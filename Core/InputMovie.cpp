@@ -0,0 +1,376 @@
+// Copyright (c) 2012- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include "Common/FileUtil.h"
+#include "Core/Config.h"
+#include "Core/InputMovie.h"
+#include "Core/MemMap.h"
+#include "Core/System.h"
+#include "Core/ELF/ParamSFO.h"
+#include "Core/HLE/sceRtc.h"
+#include "Core/HLE/ReplaceTables.h"
+#include "Core/MIPS/MIPS.h"
+#include "Core/MIPS/JitCommon/JitCommon.h"
+#include "Core/MIPS/JitCommon/JitBlockCache.h"
+#include "ext/xxhash.h"
+
+namespace InputMovie
+{
+
+static const char MOVIE_MAGIC[4] = { 'P', 'P', 'M', 'V' };
+static const u32 MOVIE_VERSION = 1;
+
+struct MovieHeader {
+	char magic[4];
+	u32_le version;
+	char gameID[16];
+	PSPTimeval rtcBase;
+	s32_le pspModel;
+	u32_le hashInterval;
+	u32_le frames;
+	u32_le reserved;
+};
+
+// Each frame is a flags byte, followed by what changed.  Runs of unchanged frames are one byte.
+enum {
+	MOVIE_FRAME_BUTTONS = 0x01,
+	MOVIE_FRAME_ANALOG = 0x02,
+	MOVIE_FRAME_HASH = 0x04,
+	// The low bits are a count of unchanged frames.
+	MOVIE_FRAME_IDLE = 0x80,
+	MOVIE_FRAME_IDLE_MAX = 0x7F,
+};
+
+enum MovieMode {
+	MOVIE_NONE,
+	MOVIE_RECORD,
+	MOVIE_PLAY,
+};
+
+static MovieMode mode = MOVIE_NONE;
+// Set before boot, takes effect on Begin().
+static MovieMode pendingMode = MOVIE_NONE;
+static bool finished = false;
+static std::string recordFilename;
+static MovieHeader header;
+static std::vector<u8> data;
+static size_t pos;
+static u32 idleFrames;
+static Frame lastFrame;
+static Stats stats;
+
+static void ResetFrame(Frame &frame) {
+	frame.buttons = 0;
+	memset(frame.analog, 128, sizeof(frame.analog));
+}
+
+// Hashes RAM as the game sees it: replacement emuhacks are swapped back for
+// the original opcodes, so the hash doesn't depend on jit vs. interpreter.
+static u32 HashMemory(u32 seed) {
+	XXH32_stateSpace_t state;
+	XXH32_resetState(&state, seed);
+
+	static const u32 CHUNK_WORDS = 1024;
+	u32_le chunk[CHUNK_WORDS];
+	const u32 base = PSP_GetKernelMemoryBase();
+	const u32 end = base + Memory::g_MemorySize;
+	for (u32 addr = base; addr < end; addr += sizeof(chunk)) {
+		const u32 words = std::min(CHUNK_WORDS, (end - addr) / 4);
+		memcpy(chunk, Memory::GetPointerUnchecked(addr), words * 4);
+		for (u32 i = 0; i < words; ++i) {
+			u32 op;
+			if (MIPS_IS_REPLACEMENT(chunk[i]) && GetReplacedOpAt(addr + i * 4, &op)) {
+				chunk[i] = op;
+			}
+		}
+		XXH32_update(&state, chunk, words * 4);
+	}
+	// XXH32_digest() would free the state, which lives on the stack here.
+	return XXH32_intermediateDigest(&state);
+}
+
+static u32 ComputeStateHash() {
+	u32 hash = XXH32(currentMIPS->r, sizeof(currentMIPS->r), 0x4D564945);
+	hash = XXH32(currentMIPS->f, sizeof(currentMIPS->f), hash);
+	hash = XXH32(currentMIPS->v, sizeof(currentMIPS->v), hash);
+	const u32 regs[3] = { currentMIPS->pc, currentMIPS->hi, currentMIPS->lo };
+	hash = XXH32(regs, sizeof(regs), hash);
+
+	// Same as savestates: block emuhacks are jit-only, so take them out first.
+	if (MIPSComp::jit) {
+		JitBlockCache *blocks = MIPSComp::jit->GetBlockCache();
+		auto saved = blocks->SaveAndClearEmuHackOps();
+		hash = HashMemory(hash);
+		blocks->RestoreSavedEmuHackOps(saved);
+	} else {
+		hash = HashMemory(hash);
+	}
+	return hash;
+}
+
+static void PushU32(u32 value) {
+	u32_le le = value;
+	const u8 *p = (const u8 *)&le;
+	data.insert(data.end(), p, p + sizeof(le));
+}
+
+static bool Read(void *dest, size_t size) {
+	if (data.size() - pos < size) {
+		return false;
+	}
+	memcpy(dest, &data[pos], size);
+	pos += size;
+	return true;
+}
+
+static void FlushIdle() {
+	if (idleFrames != 0) {
+		data.push_back((u8)(MOVIE_FRAME_IDLE | idleFrames));
+		idleFrames = 0;
+	}
+}
+
+void StartRecording(const std::string &filename, int hashInterval) {
+	recordFilename = filename;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, MOVIE_MAGIC, sizeof(header.magic));
+	header.version = MOVIE_VERSION;
+	header.hashInterval = hashInterval < 0 ? 0 : hashInterval;
+	data.clear();
+	pendingMode = MOVIE_RECORD;
+	finished = false;
+}
+
+bool StartPlayback(const std::string &filename, std::string *error_string) {
+	pendingMode = MOVIE_NONE;
+	finished = false;
+	data.clear();
+
+	FILE *f = File::OpenCFile(filename, "rb");
+	if (!f) {
+		*error_string = "Unable to open input movie " + filename;
+		return false;
+	}
+
+	bool success = fread(&header, sizeof(header), 1, f) == 1;
+	if (success && (memcmp(header.magic, MOVIE_MAGIC, sizeof(header.magic)) != 0 || header.version != MOVIE_VERSION)) {
+		*error_string = "Not a supported input movie: " + filename;
+		fclose(f);
+		return false;
+	}
+
+	u8 buf[4096];
+	size_t read;
+	while (success && (read = fread(buf, 1, sizeof(buf), f)) != 0) {
+		data.insert(data.end(), buf, buf + read);
+	}
+	success = success && !ferror(f);
+	fclose(f);
+
+	if (!success) {
+		*error_string = "Unable to read input movie " + filename;
+		data.clear();
+		return false;
+	}
+
+	pendingMode = MOVIE_PLAY;
+	return true;
+}
+
+void Begin() {
+	mode = pendingMode;
+	pendingMode = MOVIE_NONE;
+	if (mode == MOVIE_NONE) {
+		return;
+	}
+
+	memset(&stats, 0, sizeof(stats));
+	pos = 0;
+	idleFrames = 0;
+	ResetFrame(lastFrame);
+
+	const std::string gameID = g_paramSFO.GetValueString("DISC_ID");
+	if (mode == MOVIE_RECORD) {
+		strncpy(header.gameID, gameID.c_str(), sizeof(header.gameID) - 1);
+		__RtcGetBaseTime(&header.rtcBase);
+		header.pspModel = g_Config.iPSPModel;
+		INFO_LOG(SCECTRL, "Recording input movie to %s", recordFilename.c_str());
+	} else {
+		char movieID[sizeof(header.gameID) + 1] = {0};
+		memcpy(movieID, header.gameID, sizeof(header.gameID));
+		if (gameID.compare(0, sizeof(header.gameID), movieID) != 0) {
+			WARN_LOG(SCECTRL, "Input movie was recorded on %s, not %s", movieID, gameID.c_str());
+		}
+		if (header.pspModel != g_Config.iPSPModel) {
+			WARN_LOG(SCECTRL, "Input movie was recorded with a different PSP model, it will likely desync");
+		}
+		__RtcSetBaseTime(header.rtcBase);
+		stats.totalFrames = header.frames;
+		INFO_LOG(SCECTRL, "Playing input movie, %d frames", header.frames);
+	}
+}
+
+static void WriteRecording() {
+	FlushIdle();
+	header.frames = stats.frames;
+
+	FILE *f = File::OpenCFile(recordFilename, "wb");
+	bool success = f != NULL;
+	if (f) {
+		success = fwrite(&header, sizeof(header), 1, f) == 1;
+		success = success && (data.empty() || fwrite(&data[0], 1, data.size(), f) == data.size());
+		fclose(f);
+	}
+
+	if (success) {
+		NOTICE_LOG(SCECTRL, "Recorded input movie %s: %d frames, %d bytes", recordFilename.c_str(), stats.frames, (int)(sizeof(header) + data.size()));
+	} else {
+		ERROR_LOG(SCECTRL, "Unable to write input movie %s", recordFilename.c_str());
+	}
+}
+
+static void FinishPlayback() {
+	NOTICE_LOG(SCECTRL, "Input movie ended after %d frames, %d of %d hashes didn't match", stats.frames, stats.desyncs, stats.hashesChecked);
+	mode = MOVIE_NONE;
+	finished = true;
+	data.clear();
+}
+
+void Stop() {
+	pendingMode = MOVIE_NONE;
+	if (mode == MOVIE_RECORD) {
+		WriteRecording();
+	} else if (mode == MOVIE_PLAY) {
+		WARN_LOG(SCECTRL, "Input movie stopped at frame %d of %d", stats.frames, stats.totalFrames);
+	}
+	mode = MOVIE_NONE;
+	data.clear();
+}
+
+bool IsActive() {
+	return mode != MOVIE_NONE;
+}
+
+bool IsRecording() {
+	return mode == MOVIE_RECORD;
+}
+
+bool IsPlaying() {
+	return mode == MOVIE_PLAY;
+}
+
+bool IsFinished() {
+	return finished;
+}
+
+static void RecordFrame(const Frame &frame) {
+	u8 flags = 0;
+	if (frame.buttons != lastFrame.buttons)
+		flags |= MOVIE_FRAME_BUTTONS;
+	if (memcmp(frame.analog, lastFrame.analog, sizeof(frame.analog)) != 0)
+		flags |= MOVIE_FRAME_ANALOG;
+	if (header.hashInterval != 0 && (stats.frames + 1) % header.hashInterval == 0)
+		flags |= MOVIE_FRAME_HASH;
+
+	if (flags == 0) {
+		if (++idleFrames == MOVIE_FRAME_IDLE_MAX) {
+			FlushIdle();
+		}
+	} else {
+		FlushIdle();
+		data.push_back(flags);
+		if (flags & MOVIE_FRAME_BUTTONS)
+			PushU32(frame.buttons);
+		if (flags & MOVIE_FRAME_ANALOG)
+			data.insert(data.end(), &frame.analog[0][0], &frame.analog[0][0] + sizeof(frame.analog));
+		if (flags & MOVIE_FRAME_HASH)
+			PushU32(ComputeStateHash());
+	}
+
+	lastFrame = frame;
+	stats.frames++;
+}
+
+static void PlayFrame(Frame &frame) {
+	if (idleFrames != 0) {
+		idleFrames--;
+	} else if (pos >= data.size()) {
+		// Leave the host's input alone from here on.
+		FinishPlayback();
+		return;
+	} else {
+		const u8 flags = data[pos++];
+		bool success = true;
+		if (flags & MOVIE_FRAME_IDLE) {
+			success = (flags & MOVIE_FRAME_IDLE_MAX) != 0;
+			idleFrames = success ? (flags & MOVIE_FRAME_IDLE_MAX) - 1 : 0;
+		} else {
+			if (flags & MOVIE_FRAME_BUTTONS) {
+				u32_le buttons;
+				success = Read(&buttons, sizeof(buttons));
+				lastFrame.buttons = buttons;
+			}
+			if (flags & MOVIE_FRAME_ANALOG)
+				success = success && Read(lastFrame.analog, sizeof(lastFrame.analog));
+			if (flags & MOVIE_FRAME_HASH) {
+				u32_le expected;
+				success = success && Read(&expected, sizeof(expected));
+				if (success) {
+					stats.hashesChecked++;
+					if (ComputeStateHash() != expected) {
+						if (stats.desyncs++ == 0) {
+							stats.firstDesyncFrame = stats.frames;
+							ERROR_LOG(SCECTRL, "Input movie desynced at frame %d", stats.frames);
+						}
+					}
+				}
+			}
+		}
+
+		if (!success) {
+			ERROR_LOG(SCECTRL, "Input movie is corrupt at frame %d", stats.frames);
+			FinishPlayback();
+			return;
+		}
+	}
+
+	frame = lastFrame;
+	stats.frames++;
+}
+
+void Vblank(Frame &frame) {
+	switch (mode) {
+	case MOVIE_RECORD:
+		RecordFrame(frame);
+		break;
+	case MOVIE_PLAY:
+		PlayFrame(frame);
+		break;
+	default:
+		break;
+	}
+}
+
+const Stats &GetStats() {
+	return stats;
+}
+
+};
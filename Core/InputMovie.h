@@ -0,0 +1,61 @@
+// Copyright (c) 2012- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#pragma once
+
+#include <string>
+
+#include "Common/CommonTypes.h"
+
+// Records controller input at each vblank from boot, and plays it back.  With the RTC base
+// time, that's enough to run a real play session again, unthrottled, to benchmark with.
+// Every so often a hash of RAM and the CPU is stored too, so playback can tell when it desyncs.
+namespace InputMovie
+{
+	struct Frame {
+		u32 buttons;
+		u8 analog[2][2];
+	};
+
+	struct Stats {
+		u32 frames;
+		// In the movie being played.
+		u32 totalFrames;
+		u32 hashesChecked;
+		u32 desyncs;
+		u32 firstDesyncFrame;
+	};
+
+	// Both before boot.  Recording is written out on Stop().
+	void StartRecording(const std::string &filename, int hashInterval = 60);
+	bool StartPlayback(const std::string &filename, std::string *error_string);
+	// After the game is loaded, but before it runs.  Records or applies the RTC base time.
+	void Begin();
+	// Also stops when a state is loaded, since the input no longer lines up.
+	void Stop();
+
+	bool IsActive();
+	bool IsRecording();
+	bool IsPlaying();
+	// Playback got to the end of the movie.
+	bool IsFinished();
+
+	// Called by sceCtrl at each vblank with host input, which playback replaces.
+	void Vblank(Frame &frame);
+
+	const Stats &GetStats();
+};
@@ -545,12 +545,28 @@ void Jit::Comp_Syscall(MIPSOpcode op)
 	FlushAll();
 
 	SaveDowncount();
-	// Skip the CallSyscall where possible.
-	void *quickFunc = GetQuickSyscallFunc(op);
-	if (quickFunc)
+	// Skip the CallSyscall where possible, and call this syscall's HLE function directly.
+	SyscallDispatch dispatch;
+	if (GetSyscallDispatch(op, &dispatch))
 	{
-		gpr.SetRegImm(R0, (u32)(intptr_t)GetSyscallInfo(op));
-		QuickCallFunction(R1, quickFunc);
+		if (!dispatch.idle)
+			QuickCallFunction(R1, (void *)&hleBeginSyscall);
+		FixupBranch skip;
+		if (dispatch.checkFlags)
+		{
+			gpr.SetRegImm(R0, dispatch.index);
+			QuickCallFunction(R1, (void *)&hleCheckSyscallFlags);
+			CMP(R0, 0);
+			skip = B_CC(CC_EQ);
+		}
+		QuickCallFunction(R1, (void *)dispatch.func);
+		if (dispatch.checkFlags)
+			SetJumpTarget(skip);
+		if (!dispatch.idle)
+		{
+			gpr.SetRegImm(R0, dispatch.index);
+			QuickCallFunction(R1, (void *)&hleEndSyscall);
+		}
 	}
 	else
 	{
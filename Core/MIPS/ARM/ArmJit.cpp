@@ -403,12 +403,13 @@ void Jit::Comp_ReplacementFunc(MIPSOpcode op)
 	} else if (entry->replaceFunc) {
 		FlushAll();
 		// Standard function call, nothing fancy.
-		// The function returns the number of cycles it took in EAX.
-		if (BLInRange((const void *)(entry->replaceFunc))) {
-			BL((const void *)(entry->replaceFunc));
+		// The function returns the number of cycles it took in R0.
+		MOVI2R(R0, index);
+		if (BLInRange((const void *)&CallReplacementFunc)) {
+			BL((const void *)&CallReplacementFunc);
 		} else {
-			MOVI2R(R0, (u32)entry->replaceFunc);
-			BL(R0);
+			MOVI2R(R1, (u32)&CallReplacementFunc);
+			BL(R1);
 		}
 		// Alternatively, we could inline it here, instead of calling out, if it's a function
 		// we can emit.
@@ -74,8 +74,10 @@ op_agent_t agent;
 const u32 INVALID_EXIT = 0xFFFFFFFF;
 const MIPSOpcode INVALID_ORIGINAL_OP = MIPSOpcode(0x00000001);
 
+JitIndirectTargetStats jitIndirectTargetStats;
+
 JitBlockCache::JitBlockCache(MIPSState *mips, CodeBlock *codeBlock) :
-	mips_(mips), codeBlock_(codeBlock), blocks_(0), num_blocks_(0) {
+	mips_(mips), codeBlock_(codeBlock), blocks_(0), indirectTargets_(0), num_blocks_(0) {
 }
 
 JitBlockCache::~JitBlockCache() {
@@ -97,12 +99,15 @@ void JitBlockCache::Init() {
 	agent = op_open_agent();
 #endif
 	blocks_ = new JitBlock[MAX_NUM_BLOCKS];
+	indirectTargets_ = new JitIndirectTarget[INDIRECT_TARGET_CACHE_SIZE];
 	Clear();
 }
 
 void JitBlockCache::Shutdown() {
 	delete [] blocks_;
 	blocks_ = 0;
+	delete [] indirectTargets_;
+	indirectTargets_ = 0;
 	num_blocks_ = 0;
 #if defined USE_OPROFILE && USE_OPROFILE
 	op_close_agent(agent);
@@ -122,6 +127,25 @@ void JitBlockCache::Clear() {
 	block_map_.clear();
 	proxyBlockIndices_.clear();
 	num_blocks_ = 0;
+	ClearIndirectTargets();
+}
+
+void JitBlockCache::ClearIndirectTargets() {
+	// An empty slot holds an address that belongs in the neighboring slot, so it can never match.
+	// This way the generated code doesn't need to check for empty slots at all.
+	for (u32 i = 0; i < INDIRECT_TARGET_CACHE_SIZE; ++i) {
+		indirectTargets_[i].em_address = (i ^ 1) << 2;
+		indirectTargets_[i].entry = 0;
+	}
+}
+
+void JitBlockCache::InvalidateIndirectTarget(u32 em_address) {
+	const u32 i = (em_address & INDIRECT_TARGET_INDEX_MASK) >> 2;
+	if (indirectTargets_[i].em_address == em_address) {
+		indirectTargets_[i].em_address = (i ^ 1) << 2;
+		indirectTargets_[i].entry = 0;
+		jitIndirectTargetStats.invalidations++;
+	}
 }
 
 void JitBlockCache::Reset() {
@@ -451,6 +475,7 @@ void JitBlockCache::DestroyBlock(int block_num, bool invalidate) {
 	}
 
 	b->invalid = true;
+	InvalidateIndirectTarget(b->originalAddress);
 	if (Memory::ReadUnchecked_U32(b->originalAddress) == GetEmuHackOpForBlock(block_num).encoding)
 		Memory::Write_Opcode_JIT(b->originalAddress, b->originalFirstOpcode);
 
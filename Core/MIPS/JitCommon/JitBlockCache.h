@@ -89,6 +89,23 @@ struct JitBlock {
 
 typedef void (*CompiledCode)();
 
+// Remembers where jr/jalr last went, so the JIT can jump straight to the compiled block
+// without going through the dispatcher.  Direct mapped on the target address.
+struct JitIndirectTarget {
+	u32 em_address;
+	const u8 *entry;
+};
+
+struct JitIndirectTargetStats {
+	u32 hits;
+	u32 misses;
+	u32 fills;
+	u32 invalidations;
+};
+
+// This is global (not per cache) so the generated code can reach it with a simple address.
+extern JitIndirectTargetStats jitIndirectTargetStats;
+
 class JitBlockCache {
 public:
 	JitBlockCache(MIPSState *mips_, CodeBlock *codeBlock);
@@ -135,7 +152,18 @@ public:
 
 	int GetNumBlocks() const { return num_blocks_; }
 
+	enum {
+		INDIRECT_TARGET_CACHE_SIZE = 4096,
+		// Target addresses are word aligned, so this picks the index already shifted left by 2.
+		INDIRECT_TARGET_INDEX_MASK = (INDIRECT_TARGET_CACHE_SIZE - 1) << 2,
+	};
+
+	JitIndirectTarget *GetIndirectTargetCache() { return indirectTargets_; }
+	void ClearIndirectTargets();
+
 private:
+	void InvalidateIndirectTarget(u32 em_address);
+
 	void LinkBlockExits(int i);
 	void LinkBlock(int i);
 	void UnlinkBlock(int i);
@@ -145,6 +173,7 @@ private:
 	MIPSState *mips_;
 	CodeBlock *codeBlock_;
 	JitBlock *blocks_;
+	JitIndirectTarget *indirectTargets_;
 	std::vector<int> proxyBlockIndices_;
 
 	int num_blocks_;
@@ -69,6 +69,8 @@ namespace MIPSComp {
 		int numInstructions;
 		bool compiling;	// TODO: get rid of this in favor of using analysis results to determine end of block
 		JitBlock *curBlock;
+		// Table index of the replacement function being compiled, for its slow path.
+		int replacementIndex;
 
 		// VFPU prefix magic
 		bool startDefaultPrefix;
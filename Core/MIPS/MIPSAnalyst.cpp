@@ -15,8 +15,11 @@
 // Official git repository and contact information can be found at
 // https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
 
-#include <map>
-#include <set>
+#include <algorithm>
+#include <unordered_set>
+#include "base/timeutil.h"
+#include "native/thread/thread.h"
+#include "native/thread/threadutil.h"
 #include "ext/cityhash/city.h"
 #include "Common/FileUtil.h"
 #include "Core/Config.h"
@@ -36,11 +39,6 @@ using namespace MIPSCodeUtils;
 // Not in a namespace because MSVC's debugger doesn't like it
 static std::vector<MIPSAnalyst::AnalyzedFunction> functions;
 
-// TODO: Try multimap instead
-// One function can appear in multiple copies in memory, and they will all have 
-// the same hash and should all be replaced if possible.
-static std::map<u64, std::vector<MIPSAnalyst::AnalyzedFunction*>> hashToFunction;
-
 struct HashMapFunc {
 	char name[64];
 	u64 hash;
@@ -49,12 +47,46 @@ struct HashMapFunc {
 	bool operator < (const HashMapFunc &other) const {
 		return hash < other.hash || (hash == other.hash && size < other.size);
 	}
+
+	bool operator == (const HashMapFunc &other) const {
+		return hash == other.hash && size == other.size;
+	}
 };
 
-static std::set<HashMapFunc> hashMap;
+struct HashMapFuncHash {
+	size_t operator()(const HashMapFunc &f) const {
+		return (size_t)(f.hash ^ ((u64)f.size << 32));
+	}
+};
+
+// One function can appear in multiple copies in memory, and they will all have
+// the same hash and should all be replaced if possible.  Keyed on hash and size.
+static std::unordered_set<HashMapFunc, HashMapFuncHash> hashMap;
+// Whether hashMap has anything the file doesn't.
+static bool hashMapDirty = false;
+static bool hashMapLoaded = false;
 
 static std::string hashmapFileName;
 
+// A module's functions, found on the emu thread and hashed on a worker.
+// The results are published in order, on the emu thread, by FinishFunctionScans().
+// That happens at fixed guest points (before a module starts), never just because the
+// worker is done, since replacements change what the game runs and how long it takes.
+struct FunctionScanJob {
+	u32 startAddr;
+	u32 endAddr;
+	bool insertSymbols;
+	std::vector<MIPSAnalyst::AnalyzedFunction> funcs;
+	// A copy of the code, since memory may change (or get jitted) while we hash.
+	u32 codeStart;
+	std::vector<u32> code;
+	std::thread *thread;
+	double scanSeconds;
+	double hashSeconds;
+};
+
+static std::vector<FunctionScanJob *> pendingScans;
+
 #define MIPSTABLE_IMM_MASK 0xFC000000
 
 namespace MIPSAnalyst {
@@ -221,19 +253,21 @@ namespace MIPSAnalyst {
 		return results;
 	}
 	
-	void Reset()	{
-		functions.clear();
-		hashToFunction.clear();
+	static void DiscardFunctionScans() {
+		for (size_t i = 0; i < pendingScans.size(); ++i) {
+			pendingScans[i]->thread->join();
+			delete pendingScans[i]->thread;
+			delete pendingScans[i];
+		}
+		pendingScans.clear();
 	}
 
-	void UpdateHashToFunctionMap() {
-		hashToFunction.clear();
-		for (auto iter = functions.begin(); iter != functions.end(); iter++) {
-			AnalyzedFunction &f = *iter;
-			if (f.hasHash && f.size > 16) {
-				hashToFunction[f.hash].push_back(&f);
-			}
-		}
+	void Reset()	{
+		// The memory these were scanned from is going away, don't write replacements into it.
+		DiscardFunctionScans();
+		functions.clear();
+		// Reload on the next scan, so each game starts from the file.
+		hashMapLoaded = false;
 	}
 
 	// Look forwards to find if a register is used again in this block.
@@ -261,36 +295,55 @@ namespace MIPSAnalyst {
 		return true;
 	}
 
-	void HashFunctions() {
-		std::vector<u32> buffer;
+	// code holds the function's instructions, with replacements resolved.
+	static void HashFunctionCode(AnalyzedFunction &f, const u32 *code, std::vector<u32> &buffer) {
+		// This is unfortunate.  In case of emuhacks or relocs, we have to make a copy.
+		buffer.resize((f.end - f.start + 4) / 4);
+		for (size_t pos = 0; pos < buffer.size(); ++pos) {
+			u32 validbits = 0xFFFFFFFF;
+			MIPSOpcode instr = MIPSOpcode(code[pos]);
+			if (MIPS_IS_EMUHACK(instr)) {
+				f.hasHash = false;
+				return;
+			}
 
-		for (auto iter = functions.begin(), end = functions.end(); iter != end; iter++) {
-			AnalyzedFunction &f = *iter;
+			MIPSInfo flags = MIPSGetInfo(instr);
+			if (flags & IN_IMM16)
+				validbits &= ~0xFFFF;
+			if (flags & IN_IMM26)
+				validbits &= ~0x03FFFFFF;
+			buffer[pos] = instr & validbits;
+		}
 
-			// This is unfortunate.  In case of emuhacks or relocs, we have to make a copy.
-			buffer.resize((f.end - f.start + 4) / 4);
-			size_t pos = 0;
-			for (u32 addr = f.start; addr <= f.end; addr += 4) {
-				u32 validbits = 0xFFFFFFFF;
-				MIPSOpcode instr = Memory::Read_Instruction(addr, true);
-				if (MIPS_IS_EMUHACK(instr)) {
-					f.hasHash = false;
-					goto skip;
-				}
+		f.hash = CityHash64((const char *) &buffer[0], buffer.size() * sizeof(u32));
+		f.hasHash = true;
+	}
 
-				MIPSInfo flags = MIPSGetInfo(instr);
-				if (flags & IN_IMM16)
-					validbits &= ~0xFFFF;
-				if (flags & IN_IMM26)
-					validbits &= ~0x03FFFFFF;
-				buffer[pos++] = instr & validbits;
-			}
+	static void HashFunctionInMemory(AnalyzedFunction &f) {
+		std::vector<u32> code;
+		for (u32 addr = f.start; addr <= f.end; addr += 4) {
+			code.push_back(Memory::Read_Instruction(addr, true).encoding);
+		}
+		std::vector<u32> buffer;
+		HashFunctionCode(f, &code[0], buffer);
+	}
 
-			f.hash = CityHash64((const char *) &buffer[0], buffer.size() * sizeof(u32));
-			f.hasHash = true;
-skip:
-			;
+	static void HashScanJob(FunctionScanJob *job) {
+		setCurrentThreadName("FuncScanThread");
+
+		time_update();
+		double startTime = real_time_now();
+		std::vector<u32> buffer;
+		for (auto iter = job->funcs.begin(), end = job->funcs.end(); iter != end; ++iter) {
+			AnalyzedFunction &f = *iter;
+			if (f.start < job->codeStart || f.end < f.start || (f.end - job->codeStart) / 4 >= job->code.size()) {
+				f.hasHash = false;
+				continue;
+			}
+			HashFunctionCode(f, &job->code[(f.start - job->codeStart) / 4], buffer);
 		}
+		time_update();
+		job->hashSeconds = real_time_now() - startTime;
 	}
 
 	static const char *DefaultFunctionName(char buffer[256], u32 startAddr) {
@@ -374,9 +427,14 @@ skip:
 		return furthestJumpbackAddr;
 	}
 
-	void ReplaceFunctions();
+	static void PublishFunctionScan(FunctionScanJob *job);
 
 	void ScanForFunctions(u32 startAddr, u32 endAddr, bool insertSymbols) {
+		time_update();
+		double startTime = real_time_now();
+
+		// Only this module's functions are scanned, hashed and replaced.
+		const size_t firstNew = functions.size();
 		AnalyzedFunction currentFunction = {startAddr};
 
 		u32 furthestBranch = 0;
@@ -483,30 +541,156 @@ skip:
 		currentFunction.end = addr + 4;
 		functions.push_back(currentFunction);
 
-		for (auto iter = functions.begin(); iter != functions.end(); iter++) {
+		u32 codeStart = 0xFFFFFFFF, codeEnd = 0;
+		for (auto iter = functions.begin() + firstNew; iter != functions.end(); iter++) {
 			iter->size = iter->end - iter->start + 4;
 			if (insertSymbols) {
 				char temp[256];
 				symbolMap.AddFunction(DefaultFunctionName(temp, iter->start), iter->start, iter->end - iter->start + 4);
 			}
+			if (iter->end >= iter->start) {
+				codeStart = std::min(codeStart, iter->start);
+				codeEnd = std::max(codeEnd, iter->end);
+			}
 		}
 
-		HashFunctions();
+		// Hand the new functions to a worker, they're published once hashed.
+		FunctionScanJob *job = new FunctionScanJob();
+		job->startAddr = startAddr;
+		job->endAddr = endAddr;
+		job->insertSymbols = insertSymbols;
+		job->funcs.assign(functions.begin() + firstNew, functions.end());
+		functions.resize(firstNew);
+		job->codeStart = codeStart;
+		if (codeStart <= codeEnd) {
+			job->code.reserve((codeEnd - codeStart) / 4 + 1);
+			for (u32 addr = codeStart; addr <= codeEnd; addr += 4) {
+				job->code.push_back(Memory::Read_Instruction(addr, true).encoding);
+			}
+		}
+		time_update();
+		job->scanSeconds = real_time_now() - startTime;
 
-		std::string hashMapFilename = GetSysDirectory(DIRECTORY_SYSTEM) + "knownfuncs.ini";
-		if (g_Config.bFuncHashMap) {
-			LoadHashMap(hashMapFilename);
-			StoreHashMap(hashMapFilename);
-			if (insertSymbols) {
-				ApplyHashMap();
+		if (g_Config.bFuncHashMap && !hashMapLoaded) {
+			LoadHashMap(GetSysDirectory(DIRECTORY_SYSTEM) + "knownfuncs.ini");
+		}
+
+		job->thread = new std::thread(&HashScanJob, job);
+		pendingScans.push_back(job);
+	}
+
+	// zlib's uncompress() is linked into many games, but built differently in each, so no one hash finds it.
+	// Instead, recognize what it does: fill a z_stream on the stack from its arguments (next_in = source,
+	// avail_in = sourceLen, next_out = dest), inflateInit_(&stream, version, sizeof(z_stream)), and then
+	// inflate(&stream, Z_FINISH).  Once found, its hash is added to the hash map, and stored with it.
+	static bool LooksLikeZlibUncompress(const AnalyzedFunction &f) {
+		if (f.size < 64 || f.size > 512) {
+			return false;
+		}
+
+		int calls = 0;
+		bool streamSize = false, finish = false;
+		int nextIn = -1, availIn = -1, nextOut = -1;
+		for (u32 addr = f.start; addr <= f.end; addr += 4) {
+			MIPSOpcode op = Memory::Read_Instruction(addr, true);
+			MIPSGPReg rs = MIPS_GET_RS(op);
+			MIPSGPReg rt = MIPS_GET_RT(op);
+			int imm = (s16)(op & 0xFFFF);
+			switch (MIPS_GET_OP(op)) {
+			case 3:  // jal
+				++calls;
+				break;
+			case 9:  // addiu
+			case 13: // ori
+				if (rs == MIPS_REG_ZERO && rt == MIPS_REG_A2 && imm == 56) {
+					streamSize = true;
+				} else if (rs == MIPS_REG_ZERO && rt == MIPS_REG_A1 && imm == 4) {
+					finish = true;
+				}
+				break;
+			case 43: // sw
+				if (rs == MIPS_REG_SP && rt == MIPS_REG_A2) {
+					nextIn = imm;
+				} else if (rs == MIPS_REG_SP && rt == MIPS_REG_A3) {
+					availIn = imm;
+				} else if (rs == MIPS_REG_SP && rt == MIPS_REG_A0) {
+					nextOut = imm;
+				}
+				break;
 			}
-			if (g_Config.bFuncHashMap) {
-				ReplaceFunctions();
+		}
+
+		// inflateInit_, inflate, and inflateEnd (called on both the error and success paths in newer zlibs.)
+		return calls >= 3 && calls <= 4 && streamSize && finish && nextIn >= 0 && availIn == nextIn + 4 && nextOut == nextIn + 12;
+	}
+
+	static void PublishFunctionScan(FunctionScanJob *job) {
+		time_update();
+		double startTime = real_time_now();
+
+		const size_t firstNew = functions.size();
+		functions.insert(functions.end(), job->funcs.begin(), job->funcs.end());
+
+		int named = 0, replaced = 0;
+		if (g_Config.bFuncHashMap) {
+			for (size_t i = firstNew; i < functions.size(); ++i) {
+				AnalyzedFunction &f = functions[i];
+				if (!f.hasHash || f.size <= 16) {
+					continue;
+				}
+				const char *name = LookupHash(f.hash, f.size);
+				if (!name && LooksLikeZlibUncompress(f)) {
+					HashMapFunc mf = { "uncompress", f.hash, f.size };
+					hashMap.insert(mf);
+					hashMapDirty = true;
+					name = "uncompress";
+				}
+				if (!name) {
+					continue;
+				}
+
+				if (job->insertSymbols) {
+					strncpy(f.name, name, sizeof(f.name) - 1);
+					std::string existingLabel = symbolMap.GetLabelString(f.start);
+					char defaultLabel[256];
+					// If it was renamed, keep it.  Only change the name if it's still the default.
+					if (existingLabel.empty() || !strcmp(existingLabel.c_str(), DefaultFunctionName(defaultLabel, f.start))) {
+						symbolMap.SetLabelName(name, f.start);
+					}
+					++named;
+				}
+
+				// The module may already be running, and this may already be jitted.
+				if (MIPS_IS_RUNBLOCK(Memory::Read_U32(f.start))) {
+					currentMIPS->InvalidateICache(f.start, 4);
+				}
+				if (WriteReplaceInstruction(f.start, f.hash, f.size)) {
+					++replaced;
+				}
 			}
 		}
+
+		time_update();
+		INFO_LOG(LOADER, "Scanned %08x-%08x: %d functions, %d named, %d replaced (scan %0.1f ms, hash %0.1f ms, publish %0.1f ms)",
+			job->startAddr, job->endAddr, (int)job->funcs.size(), named, replaced,
+			job->scanSeconds * 1000.0, job->hashSeconds * 1000.0, (real_time_now() - startTime) * 1000.0);
+	}
+
+	void FinishFunctionScans() {
+		// Publish in order, so later modules' functions stay after earlier ones.
+		for (size_t i = 0; i < pendingScans.size(); ++i) {
+			FunctionScanJob *job = pendingScans[i];
+			job->thread->join();
+			delete job->thread;
+			PublishFunctionScan(job);
+			delete job;
+		}
+		pendingScans.clear();
 	}
 
 	void RegisterFunction(u32 startAddr, u32 size, const char *name) {
+		FinishFunctionScans();
+
 		// Check if we have this already
 		for (auto iter = functions.begin(); iter != functions.end(); iter++) {
 			if (iter->start == startAddr) {
@@ -517,7 +701,9 @@ skip:
 					strncpy(hfun.name, name, 64);
 					hfun.name[63] = 0;
 					hfun.size = size;
-					hashMap.insert(hfun);
+					if (hashMap.insert(hfun).second) {
+						hashMapDirty = true;
+					}
 					return;
 				} else if (!iter->hasHash || size == 0) {
 					ERROR_LOG(HLE, "%s: %08x %08x : match but no hash (%i) or no size", name, startAddr, size, iter->hasHash);
@@ -532,9 +718,9 @@ skip:
 		fun.isStraightLeaf = false;  // dunno really
 		strncpy(fun.name, name, 64);
 		fun.name[63] = 0;
+		fun.size = size;
+		HashFunctionInMemory(fun);
 		functions.push_back(fun);
-
-		HashFunctions();
 	}
 
 	void ForgetFunctions(u32 startAddr, u32 endAddr) {
@@ -542,6 +728,8 @@ skip:
 		// the easy way of saving a hashmap by unloading and loading a game. I added
 		// an alternative way.
 
+		FinishFunctionScans();
+
 		// TODO: speedup
 		auto iter = functions.begin();
 		while (iter != functions.end()) {
@@ -552,13 +740,6 @@ skip:
 			}
 		}
 
-		// TODO: Also wipe them from hash->function map
-	}
-
-	void ReplaceFunctions() {
-		for (size_t i = 0; i < functions.size(); i++) {
-			WriteReplaceInstruction(functions[i].start, functions[i].hash, functions[i].size);
-		}
 	}
 
 	void UpdateHashMap() {
@@ -576,15 +757,17 @@ skip:
 
 			HashMapFunc mf = { "", f.hash, f.size };
 			strncpy(mf.name, name.c_str(), sizeof(mf.name) - 1);
-			hashMap.insert(mf);
+			if (hashMap.insert(mf).second) {
+				hashMapDirty = true;
+			}
 		}
 	}
 
 	const char *LookupHash(u64 hash, int funcsize) {
-		for (auto it = hashMap.begin(), end = hashMap.end(); it != end; ++it) {
-			if (it->hash == hash && it->size == funcsize) {
-				return it->name;
-			}
+		HashMapFunc key = { "", hash, (u32)funcsize };
+		auto it = hashMap.find(key);
+		if (it != hashMap.end()) {
+			return it->name;
 		}
 		return 0;
 	}
@@ -600,55 +783,66 @@ skip:
 		if (filename.empty())
 			filename = hashmapFileName;
 
+		FinishFunctionScans();
 		UpdateHashMap();
-		if (hashMap.empty()) {
+		// Only write when something changed, or it's a new file.
+		if (hashMap.empty() || (!hashMapDirty && filename == hashmapFileName)) {
 			return;
 		}
 
+		// Keep the file sorted, so it diffs nicely.
+		std::vector<HashMapFunc> sorted(hashMap.begin(), hashMap.end());
+		std::sort(sorted.begin(), sorted.end());
+
 		FILE *file = File::OpenCFile(filename, "wt");
 		if (!file) {
 			WARN_LOG(LOADER, "Could not store hash map: %s", filename.c_str());
 			return;
 		}
 
-		for (auto it = hashMap.begin(), end = hashMap.end(); it != end; ++it) {
+		bool success = true;
+		for (auto it = sorted.begin(), end = sorted.end(); it != end; ++it) {
 			const HashMapFunc &mf = *it;
 			if (fprintf(file, "%016llx:%d = %s\n", mf.hash, mf.size, mf.name) <= 0) {
 				WARN_LOG(LOADER, "Could not store hash map: %s", filename.c_str());
+				success = false;
 				break;
 			}
 		}
 		fclose(file);
+		if (success && filename == hashmapFileName) {
+			hashMapDirty = false;
+		}
 	}
 
 	void ApplyHashMap() {
-		UpdateHashToFunctionMap();
+		FinishFunctionScans();
 
-		for (auto mf = hashMap.begin(), end = hashMap.end(); mf != end; ++mf) {
-			auto iter = hashToFunction.find(mf->hash);
-			if (iter == hashToFunction.end()) {
+		for (auto iter = functions.begin(), end = functions.end(); iter != end; ++iter) {
+			AnalyzedFunction &f = *iter;
+			if (!f.hasHash || f.size <= 16) {
+				continue;
+			}
+			const char *name = LookupHash(f.hash, f.size);
+			if (!name) {
 				continue;
 			}
 
 			// Yay, found a function.
+			strncpy(f.name, name, sizeof(f.name) - 1);
 
-			for (unsigned int i = 0; i < iter->second.size(); i++) {
-				AnalyzedFunction &f = *(iter->second[i]);
-				if (f.hash == mf->hash && f.size == mf->size) {
-					strncpy(f.name, mf->name, sizeof(mf->name) - 1);
-
-					std::string existingLabel = symbolMap.GetLabelString(f.start);
-					char defaultLabel[256];
-					// If it was renamed, keep it.  Only change the name if it's still the default.
-					if (existingLabel.empty() || !strcmp(existingLabel.c_str(), DefaultFunctionName(defaultLabel, f.start))) {
-						symbolMap.SetLabelName(mf->name, f.start);
-					}
-				}
+			std::string existingLabel = symbolMap.GetLabelString(f.start);
+			char defaultLabel[256];
+			// If it was renamed, keep it.  Only change the name if it's still the default.
+			if (existingLabel.empty() || !strcmp(existingLabel.c_str(), DefaultFunctionName(defaultLabel, f.start))) {
+				symbolMap.SetLabelName(name, f.start);
 			}
 		}
 	}
 
 	void LoadHashMap(std::string filename) {
+		// Even if it's missing, don't keep trying on every module load.
+		hashMapLoaded = true;
 		FILE *file = File::OpenCFile(filename, "rt");
 		if (!file) {
 			WARN_LOG(LOADER, "Could not load hash map: %s", filename.c_str());
@@ -101,7 +101,11 @@ namespace MIPSAnalyst
 	// If we have loaded symbols from the elf, we'll register functions as they are touched
 	// so that we don't just dump them all in the cache.
 	void RegisterFunction(u32 startAddr, u32 size, const char *name);
+	// Finds the functions, then hashes and replaces them on a worker.  See FinishFunctionScans().
 	void ScanForFunctions(u32 startAddr, u32 endAddr, bool insertSymbols);
+	// Waits for and publishes pending scans (names, replacements.)  Must be called on the emu
+	// thread at a fixed guest point, like right before a module starts, so runs are repeatable.
+	void FinishFunctionScans();
 	void ForgetFunctions(u32 startAddr, u32 endAddr);
 	void CompileLeafs();
 
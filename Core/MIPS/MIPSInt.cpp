@@ -1020,8 +1020,8 @@ namespace MIPSInt
 		// It's a replacement func!
 		int index = op.encoding & 0xFFFFFF;
 		const ReplacementTableEntry *entry = GetReplacementFunc(index);
-		if (entry) {
-			entry->replaceFunc();
+		if (entry && entry->replaceFunc) {
+			CallReplacementFunc(index);
 		} else {
 			ERROR_LOG(CPU, "Bad replacement function index %i", index);
 		}	
@@ -145,4 +145,44 @@ void AsmRoutineManager::Generate(MIPSState *mips, MIPSComp::Jit *jit)
 	breakpointBailout = GetCodePtr();
 	ABI_PopAllCalleeSavedRegsAndAdjustStack();
 	RET();
+
+	// Jumped to by jr/jalr when the indirect target cache misses and downcount is not negative.
+	// Like dispatcherNoCheck, but also puts the block it finds into the cache.
+	dispatcherFillIndirect = GetCodePtr();
+		ADD(32, M(&jitIndirectTargetStats.misses), Imm8(1));
+		MOV(32, R(ECX), M(&mips->pc));
+#ifdef _M_IX86
+		MOV(32, R(EAX), R(ECX));
+		AND(32, R(EAX), Imm32(Memory::MEMVIEW32_MASK));
+		MOV(32, R(EAX), MDisp(EAX, (u32)Memory::base));
+#elif _M_X64
+		MOV(32, R(EAX), MComplex(RBX, RCX, SCALE_1, 0));
+#endif
+		MOV(32, R(EDX), R(EAX));
+		AND(32, R(EDX), Imm32(MIPS_JITBLOCK_MASK));
+		CMP(32, R(EDX), Imm32(MIPS_EMUHACK_OPCODE));
+		// Not compiled yet, we'll fill it in next time around.
+		J_CC(CC_NZ, dispatcherNoCheck, true);
+
+		AND(32, R(EAX), Imm32(MIPS_EMUHACK_VALUE_MASK));
+#ifdef _M_IX86
+		ADD(32, R(EAX), ImmPtr(jit->GetBasePtr()));
+#elif _M_X64
+		ADD(64, R(RAX), R(R15));
+#endif
+
+		MOV(32, R(EDX), R(ECX));
+		AND(32, R(EDX), Imm32(JitBlockCache::INDIRECT_TARGET_INDEX_MASK));
+#ifdef _M_IX86
+		MOV(32, R(ESI), ImmPtr(jit->GetBlockCache()->GetIndirectTargetCache()));
+		LEA(32, EDX, MComplex(ESI, EDX, SCALE_2, 0));
+		MOV(32, MDisp(EDX, offsetof(JitIndirectTarget, entry)), R(EAX));
+#elif _M_X64
+		MOV(64, R(RSI), ImmPtr(jit->GetBlockCache()->GetIndirectTargetCache()));
+		LEA(64, RDX, MComplex(RSI, RDX, SCALE_4, 0));
+		MOV(64, MDisp(RDX, offsetof(JitIndirectTarget, entry)), R(RAX));
+#endif
+		MOV(32, MDisp(EDX, offsetof(JitIndirectTarget, em_address)), R(ECX));
+		ADD(32, M(&jitIndirectTargetStats.fills), Imm8(1));
+		JMPptr(R(EAX));
 }
\ No newline at end of file
@@ -56,6 +56,7 @@ public:
 	const u8 *dispatcher;
 	const u8 *dispatcherCheckCoreState;
 	const u8 *dispatcherNoCheck;
+	const u8 *dispatcherFillIndirect;
 
 	const u8 *breakpointBailout;
 };
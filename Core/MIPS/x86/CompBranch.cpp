@@ -682,10 +682,25 @@ void Jit::Comp_Syscall(MIPSOpcode op)
 	WriteDowncount(offset);
 	js.downcountAmount = -offset;
 
-	// Skip the CallSyscall where possible.
-	void *quickFunc = GetQuickSyscallFunc(op);
-	if (quickFunc)
-		ABI_CallFunctionP(quickFunc, (void *)GetSyscallInfo(op));
+	// Skip the CallSyscall where possible, and call this syscall's HLE function directly.
+	SyscallDispatch dispatch;
+	if (GetSyscallDispatch(op, &dispatch))
+	{
+		if (!dispatch.idle)
+			ABI_CallFunction(&hleBeginSyscall);
+		FixupBranch skip;
+		if (dispatch.checkFlags)
+		{
+			ABI_CallFunctionC(&hleCheckSyscallFlags, dispatch.index);
+			TEST(32, R(EAX), R(EAX));
+			skip = J_CC(CC_Z, true);
+		}
+		ABI_CallFunction(dispatch.func);
+		if (dispatch.checkFlags)
+			SetJumpTarget(skip);
+		if (!dispatch.idle)
+			ABI_CallFunctionC(&hleEndSyscall, dispatch.index);
+	}
 	else
 		ABI_CallFunctionC(&CallSyscall, op.encoding);
 
@@ -16,13 +16,34 @@
 // https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
 
 #include "Core/MemMap.h"
+#include "Core/MemDirty.h"
+#include "Core/HLE/ReplaceTables.h"
 #include "Core/MIPS/JitCommon/JitCommon.h"
 #include "Core/MIPS/x86/RegCache.h"
 
 static const u64 MEMORY_ALIGNED16(ssNoSignMask[2]) = {0x7FFFFFFF7FFFFFFFULL, 0x7FFFFFFF7FFFFFFFULL};
 
+// The top byte of each matrix data command written by dl_write_matrix, by matrix type.
+static const u32 MEMORY_ALIGNED16(dlMatrixTopBytes[4][4]) = {
+	{0x3F000000, 0x3F000000, 0x3F000000, 0x3F000000},
+	{0x3D000000, 0x3D000000, 0x3D000000, 0x3D000000},
+	{0x3B000000, 0x3B000000, 0x3B000000, 0x3B000000},
+	{0x41000000, 0x41000000, 0x41000000, 0x41000000},
+};
+
 namespace MIPSComp {
 
+// Copies and fills up to this size are done inline, larger ones call the C version.
+static const u32 REPLACE_INLINE_MAX = 64;
+
+static OpArg RAMArg(X64Reg reg, s32 offset) {
+#ifdef _M_IX86
+	return MDisp(reg, (u32)Memory::base + offset);
+#else
+	return MComplex(RBX, reg, SCALE_1, offset);
+#endif
+}
+
 int Jit::Replace_fabsf() {
 	fpr.SpillLock(0, 12);
 	fpr.MapReg(0, MAP_DIRTY | MAP_NOINIT);
@@ -32,4 +53,340 @@ int Jit::Replace_fabsf() {
 	return 4;  // Number of instructions in the MIPS function
 }
 
+void Jit::ReplaceCheckRAM(X64Reg reg, u32 size, std::vector<FixupBranch> &slow) {
+	CMP(32, R(reg), Imm32(PSP_GetKernelMemoryBase()));
+	slow.push_back(J_CC(CC_B, true));
+	CMP(32, R(reg), Imm32(PSP_GetUserMemoryEnd() - size));
+	slow.push_back(J_CC(CC_A, true));
+}
+
+void Jit::ReplaceMarkDirtyPage(X64Reg addr, X64Reg temp) {
+	SHR(32, R(addr), Imm8(Memory::DIRTY_PAGE_SHIFT));
+#ifdef _M_IX86
+	MOV(8, MDisp(addr, (u32)Memory::dirtyPages), Imm8(Memory::DIRTY_ALL));
+#else
+	MOV(64, R(temp), ImmPtr(Memory::dirtyPages));
+	MOV(8, MComplex(temp, addr, SCALE_1, 0), Imm8(Memory::DIRTY_ALL));
+#endif
+}
+
+void Jit::ReplaceSlowPath(std::vector<FixupBranch> &slow, int cycles) {
+	FixupBranch skip = J(true);
+	for (size_t i = 0; i < slow.size(); ++i) {
+		SetJumpTarget(slow[i]);
+	}
+	// The C version returns all its cycles, the caller already counts the fixed part.
+	ABI_CallFunctionC(&CallReplacementFunc, js.replacementIndex);
+	if (cycles != 0) {
+		SUB(32, R(EAX), Imm32(cycles));
+	}
+	SUB(32, M(&mips_->downcount), R(EAX));
+	SetJumpTarget(skip);
+}
+
+// Also used for memmove: every byte is loaded before any are stored, so overlap is fine.
+int Jit::Replace_memcpy() {
+	FlushAll();
+	std::vector<FixupBranch> slow;
+	MOV(32, R(EAX), M(&mips_->r[MIPS_REG_A0]));
+	MOV(32, R(EDX), M(&mips_->r[MIPS_REG_A1]));
+	MOV(32, R(ECX), M(&mips_->r[MIPS_REG_A2]));
+	MOV(32, M(&mips_->r[MIPS_REG_V0]), R(EAX));
+
+	TEST(32, R(ECX), R(ECX));
+	FixupBranch empty = J_CC(CC_Z, true);
+	CMP(32, R(ECX), Imm32(REPLACE_INLINE_MAX));
+	slow.push_back(J_CC(CC_A, true));
+	CMP(32, R(ECX), Imm8(4));
+	slow.push_back(J_CC(CC_B, true));
+	ReplaceCheckRAM(EAX, REPLACE_INLINE_MAX, slow);
+	ReplaceCheckRAM(EDX, REPLACE_INLINE_MAX, slow);
+
+	// Copy the start and the end, overlapping in the middle.  EDX ends up past the source.
+	CMP(32, R(ECX), Imm8(8));
+	FixupBranch under8 = J_CC(CC_B, true);
+	CMP(32, R(ECX), Imm8(16));
+	FixupBranch under16 = J_CC(CC_B, true);
+	CMP(32, R(ECX), Imm8(32));
+	FixupBranch under32 = J_CC(CC_B, true);
+
+	MOVDQU(XMM0, RAMArg(EDX, 0));
+	MOVDQU(XMM1, RAMArg(EDX, 16));
+	ADD(32, R(EDX), R(ECX));
+	MOVDQU(XMM2, RAMArg(EDX, -32));
+	MOVDQU(XMM3, RAMArg(EDX, -16));
+	MOVDQU(RAMArg(EAX, 0), XMM0);
+	MOVDQU(RAMArg(EAX, 16), XMM1);
+	ADD(32, R(EAX), R(ECX));
+	MOVDQU(RAMArg(EAX, -32), XMM2);
+	MOVDQU(RAMArg(EAX, -16), XMM3);
+	FixupBranch done32 = J(true);
+
+	SetJumpTarget(under32);
+	MOVDQU(XMM0, RAMArg(EDX, 0));
+	ADD(32, R(EDX), R(ECX));
+	MOVDQU(XMM1, RAMArg(EDX, -16));
+	MOVDQU(RAMArg(EAX, 0), XMM0);
+	ADD(32, R(EAX), R(ECX));
+	MOVDQU(RAMArg(EAX, -16), XMM1);
+	FixupBranch done16 = J(true);
+
+	SetJumpTarget(under16);
+	MOVQ_xmm(XMM0, RAMArg(EDX, 0));
+	ADD(32, R(EDX), R(ECX));
+	MOVQ_xmm(XMM1, RAMArg(EDX, -8));
+	MOVQ_xmm(RAMArg(EAX, 0), XMM0);
+	ADD(32, R(EAX), R(ECX));
+	MOVQ_xmm(RAMArg(EAX, -8), XMM1);
+	FixupBranch done8 = J(true);
+
+	SetJumpTarget(under8);
+	MOVD_xmm(XMM0, RAMArg(EDX, 0));
+	ADD(32, R(EDX), R(ECX));
+	MOVD_xmm(XMM1, RAMArg(EDX, -4));
+	MOVD_xmm(RAMArg(EAX, 0), XMM0);
+	ADD(32, R(EAX), R(ECX));
+	MOVD_xmm(RAMArg(EAX, -4), XMM1);
+
+	SetJumpTarget(done32);
+	SetJumpTarget(done16);
+	SetJumpTarget(done8);
+	// EAX is now past the end of the destination.
+	MOV(32, R(EDX), R(ECX));
+	SHR(32, R(EDX), Imm8(2));
+	SUB(32, M(&mips_->downcount), R(EDX));
+	if (Memory::IsDirtyTracking()) {
+		// At most two pages, since it's small.
+		LEA(32, EDX, MDisp(EAX, -1));
+		SUB(32, R(EAX), R(ECX));
+		ReplaceMarkDirtyPage(EDX, ECX);
+		ReplaceMarkDirtyPage(EAX, ECX);
+	}
+	SetJumpTarget(empty);
+
+	ReplaceSlowPath(slow, 10);
+	return 10;
+}
+
+int Jit::Replace_memset() {
+	FlushAll();
+	std::vector<FixupBranch> slow;
+	MOV(32, R(EAX), M(&mips_->r[MIPS_REG_A0]));
+	MOV(32, R(ECX), M(&mips_->r[MIPS_REG_A1]));
+	MOV(32, R(EDX), M(&mips_->r[MIPS_REG_A2]));
+	MOV(32, M(&mips_->r[MIPS_REG_V0]), R(EAX));
+
+	TEST(32, R(EDX), R(EDX));
+	FixupBranch empty = J_CC(CC_Z, true);
+	CMP(32, R(EDX), Imm32(REPLACE_INLINE_MAX));
+	slow.push_back(J_CC(CC_A, true));
+	CMP(32, R(EDX), Imm8(4));
+	slow.push_back(J_CC(CC_B, true));
+	ReplaceCheckRAM(EAX, REPLACE_INLINE_MAX, slow);
+
+	// Spread the byte across all of XMM0.
+	MOVZX(32, 8, ECX, R(ECX));
+	IMUL(32, ECX, R(ECX), Imm32(0x01010101));
+	MOVD_xmm(XMM0, R(ECX));
+	SHUFPS(XMM0, R(XMM0), 0);
+
+	// Like memcpy, fill the start and the end, overlapping in the middle.
+	CMP(32, R(EDX), Imm8(8));
+	FixupBranch under8 = J_CC(CC_B, true);
+	CMP(32, R(EDX), Imm8(16));
+	FixupBranch under16 = J_CC(CC_B, true);
+	CMP(32, R(EDX), Imm8(32));
+	FixupBranch under32 = J_CC(CC_B, true);
+
+	MOVDQU(RAMArg(EAX, 0), XMM0);
+	MOVDQU(RAMArg(EAX, 16), XMM0);
+	ADD(32, R(EAX), R(EDX));
+	MOVDQU(RAMArg(EAX, -32), XMM0);
+	MOVDQU(RAMArg(EAX, -16), XMM0);
+	FixupBranch done32 = J(true);
+
+	SetJumpTarget(under32);
+	MOVDQU(RAMArg(EAX, 0), XMM0);
+	ADD(32, R(EAX), R(EDX));
+	MOVDQU(RAMArg(EAX, -16), XMM0);
+	FixupBranch done16 = J(true);
+
+	SetJumpTarget(under16);
+	MOVQ_xmm(RAMArg(EAX, 0), XMM0);
+	ADD(32, R(EAX), R(EDX));
+	MOVQ_xmm(RAMArg(EAX, -8), XMM0);
+	FixupBranch done8 = J(true);
+
+	SetJumpTarget(under8);
+	MOV(32, RAMArg(EAX, 0), R(ECX));
+	ADD(32, R(EAX), R(EDX));
+	MOV(32, RAMArg(EAX, -4), R(ECX));
+
+	SetJumpTarget(done32);
+	SetJumpTarget(done16);
+	SetJumpTarget(done8);
+	MOV(32, R(ECX), R(EDX));
+	SHR(32, R(ECX), Imm8(2));
+	SUB(32, M(&mips_->downcount), R(ECX));
+	if (Memory::IsDirtyTracking()) {
+		SUB(32, R(EAX), R(EDX));
+		LEA(32, EDX, MComplex(EAX, EDX, SCALE_1, -1));
+		ReplaceMarkDirtyPage(EDX, ECX);
+		ReplaceMarkDirtyPage(EAX, ECX);
+	}
+	SetJumpTarget(empty);
+
+	ReplaceSlowPath(slow, 10);
+	return 10;
+}
+
+int Jit::Replace_strlen() {
+	FlushAll();
+	std::vector<FixupBranch> slow;
+	MOV(32, R(EAX), M(&mips_->r[MIPS_REG_A0]));
+	MOV(32, R(EDX), R(EAX));
+	CMP(32, R(EAX), Imm32(PSP_GetKernelMemoryBase()));
+	slow.push_back(J_CC(CC_B, true));
+	PXOR(XMM1, R(XMM1));
+
+	// 16 bytes at a time.  Reading past the terminator is fine, as long as it's still RAM.
+	const u8 *loopStart = GetCodePtr();
+	CMP(32, R(EAX), Imm32(PSP_GetUserMemoryEnd() - 16));
+	slow.push_back(J_CC(CC_A, true));
+	MOVDQU(XMM0, RAMArg(EAX, 0));
+	PCMPEQB(XMM0, R(XMM1));
+	PMOVMSKB(ECX, R(XMM0));
+	ADD(32, R(EAX), Imm8(16));
+	TEST(32, R(ECX), R(ECX));
+	J_CC(CC_Z, loopStart);
+
+	BSF(32, ECX, R(ECX));
+	LEA(32, EAX, MComplex(EAX, ECX, SCALE_1, -16));
+	SUB(32, R(EAX), R(EDX));
+	MOV(32, M(&mips_->r[MIPS_REG_V0]), R(EAX));
+	SUB(32, M(&mips_->downcount), R(EAX));
+
+	ReplaceSlowPath(slow, 4);
+	return 4;
+}
+
+int Jit::Replace_strcmp() {
+	FlushAll();
+	std::vector<FixupBranch> slow;
+	MOV(32, R(EAX), M(&mips_->r[MIPS_REG_A0]));
+	MOV(32, R(EDX), M(&mips_->r[MIPS_REG_A1]));
+	CMP(32, R(EAX), Imm32(PSP_GetKernelMemoryBase()));
+	slow.push_back(J_CC(CC_B, true));
+	CMP(32, R(EDX), Imm32(PSP_GetKernelMemoryBase()));
+	slow.push_back(J_CC(CC_B, true));
+	PXOR(XMM3, R(XMM3));
+
+	const u8 *loopStart = GetCodePtr();
+	CMP(32, R(EAX), Imm32(PSP_GetUserMemoryEnd() - 16));
+	slow.push_back(J_CC(CC_A, true));
+	CMP(32, R(EDX), Imm32(PSP_GetUserMemoryEnd() - 16));
+	slow.push_back(J_CC(CC_A, true));
+	MOVDQU(XMM0, RAMArg(EAX, 0));
+	MOVDQU(XMM1, RAMArg(EDX, 0));
+	MOVAPS(XMM2, R(XMM0));
+	PCMPEQB(XMM2, R(XMM3));
+	PCMPEQB(XMM0, R(XMM1));
+	// Bits set for bytes that match and aren't the terminator, so we stop on any clear bit.
+	PANDN(XMM2, R(XMM0));
+	PMOVMSKB(ECX, R(XMM2));
+	XOR(32, R(ECX), Imm32(0xFFFF));
+	FixupBranch found = J_CC(CC_NZ);
+	ADD(32, R(EAX), Imm8(16));
+	ADD(32, R(EDX), Imm8(16));
+	JMP(loopStart, true);
+
+	SetJumpTarget(found);
+	BSF(32, ECX, R(ECX));
+	ADD(32, R(EAX), R(ECX));
+	ADD(32, R(EDX), R(ECX));
+	// Charge 10 + i / 4 like the C version, where i is how far in the mismatch is.
+	MOV(32, R(ECX), R(EAX));
+	SUB(32, R(ECX), M(&mips_->r[MIPS_REG_A0]));
+	SHR(32, R(ECX), Imm8(2));
+	SUB(32, M(&mips_->downcount), R(ECX));
+	// Like the PSP's libc, the difference of the first mismatching bytes.
+	MOVZX(32, 8, EAX, RAMArg(EAX, 0));
+	MOVZX(32, 8, EDX, RAMArg(EDX, 0));
+	SUB(32, R(EAX), R(EDX));
+	MOV(32, M(&mips_->r[MIPS_REG_V0]), R(EAX));
+
+	ReplaceSlowPath(slow, 10);
+	return 10;
+}
+
+// a0 = display list struct, the write pointer is the third word
+// a1 = matrix type
+// a2 = source matrix
+int Jit::Replace_dl_write_matrix() {
+	// Only worth it when the matrix type is known, which it almost always is at the jal.
+	const bool knownType = gpr.IsImm(MIPS_REG_A1) && gpr.GetImm(MIPS_REG_A1) <= 3;
+	const u32 type = knownType ? gpr.GetImm(MIPS_REG_A1) : 0;
+	FlushAll();
+	std::vector<FixupBranch> slow;
+	if (!knownType) {
+		ABI_CallFunctionC(&CallReplacementFunc, js.replacementIndex);
+		SUB(32, R(EAX), Imm32(60));
+		SUB(32, M(&mips_->downcount), R(EAX));
+		return 60;
+	}
+
+	static const u32 matrixCommands[4] = {0x3E000000, 0x3C000000, 0x3A000000, 0x40000000};
+	const int count = type == 0 ? 16 : 12;
+	const int size = (1 + count) * 4;
+
+	MOV(32, R(EAX), M(&mips_->r[MIPS_REG_A0]));
+	MOV(32, R(EDX), M(&mips_->r[MIPS_REG_A2]));
+	ReplaceCheckRAM(EAX, 12, slow);
+	ReplaceCheckRAM(EDX, 64, slow);
+	MOV(32, R(ECX), RAMArg(EAX, 8));
+	ReplaceCheckRAM(ECX, size, slow);
+
+	MOV(32, RAMArg(ECX, 0), Imm32(matrixCommands[type]));
+	MOVDQU(XMM0, RAMArg(EDX, 0));
+	MOVDQU(XMM1, RAMArg(EDX, 16));
+	MOVDQU(XMM2, RAMArg(EDX, 32));
+	MOVDQU(XMM3, RAMArg(EDX, 48));
+	PSRLD(XMM0, 8);
+	PSRLD(XMM1, 8);
+	PSRLD(XMM2, 8);
+	PSRLD(XMM3, 8);
+	POR(XMM0, M(&dlMatrixTopBytes[type]));
+	POR(XMM1, M(&dlMatrixTopBytes[type]));
+	POR(XMM2, M(&dlMatrixTopBytes[type]));
+	POR(XMM3, M(&dlMatrixTopBytes[type]));
+	if (count == 16) {
+		MOVDQU(RAMArg(ECX, 4), XMM0);
+		MOVDQU(RAMArg(ECX, 20), XMM1);
+		MOVDQU(RAMArg(ECX, 36), XMM2);
+		MOVDQU(RAMArg(ECX, 52), XMM3);
+	} else {
+		// 4x3, so each store overlaps the previous one's unused fourth word.
+		MOVDQU(RAMArg(ECX, 4), XMM0);
+		MOVDQU(RAMArg(ECX, 16), XMM1);
+		MOVDQU(RAMArg(ECX, 28), XMM2);
+		MOVQ_xmm(RAMArg(ECX, 40), XMM3);
+		PSRLDQ(XMM3, 8);
+		MOVD_xmm(RAMArg(ECX, 48), XMM3);
+	}
+
+	LEA(32, EDX, MDisp(ECX, size));
+	MOV(32, RAMArg(EAX, 8), R(EDX));
+	MOV(32, M(&mips_->r[MIPS_REG_V0]), R(EDX));
+	if (Memory::IsDirtyTracking()) {
+		ADD(32, R(EAX), Imm8(8));
+		ReplaceMarkDirtyPage(EAX, EDX);
+		LEA(32, EDX, MDisp(ECX, size - 1));
+		ReplaceMarkDirtyPage(EDX, EAX);
+		ReplaceMarkDirtyPage(ECX, EAX);
+	}
+
+	ReplaceSlowPath(slow, 60);
+	return 60;
+}
+
 }
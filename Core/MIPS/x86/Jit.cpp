@@ -32,6 +32,7 @@
 #include "Core/MIPS/MIPSInt.h"
 #include "Core/MIPS/MIPSTables.h"
 #include "Core/HLE/ReplaceTables.h"
+#include "Core/MemDirty.h"
 
 #include "RegCache.h"
 #include "Jit.h"
@@ -137,6 +138,8 @@ JitOptions::JitOptions()
 	continueBranches = false;
 	continueJumps = false;
 	continueMaxInstructions = 300;
+	indirectTargetCache = true;
+	inlineReplacements = g_Config.bInlineReplacements;
 }
 
 #ifdef _MSC_VER
@@ -431,8 +434,11 @@ bool Jit::ReplaceJalTo(u32 dest) {
 		return false;
 	}
 
+	js.replacementIndex = index;
+	const bool useJitFunc = entry->jitReplaceFunc && (jo.inlineReplacements || !entry->replaceFunc);
+
 	// Warning - this might be bad if the code at the destination changes...
-	if (entry->flags & REPFLAG_ALLOWINLINE) {
+	if (useJitFunc && (entry->flags & REPFLAG_ALLOWINLINE)) {
 		// Jackpot! Just do it, no flushing. The code will be entirely inlined.
 
 		// First, compile the delay slot. It's unconditional so no issues.
@@ -446,6 +452,31 @@ bool Jit::ReplaceJalTo(u32 dest) {
 
 		// Add a trigger so that if the inlined code changes, we invalidate this block.
 		// TODO: Correctly determine the size of this block.
+		blocks.ProxyBlock(js.blockStart, dest, 4, GetCodePtr());
+		return true;
+	} else if (useJitFunc) {
+		// Also inline, but these flush and may call the C version for anything unusual.
+		gpr.SetImm(MIPS_REG_RA, js.compilerPC + 8);
+		CompileDelaySlot(DELAYSLOT_NICE);
+		MIPSReplaceFunc repl = entry->jitReplaceFunc;
+		int cycles = (this->*repl)();
+		js.downcountAmount += cycles;
+		js.compilerPC += 4;
+		// No writing exits, keep going!
+
+		blocks.ProxyBlock(js.blockStart, dest, 4, GetCodePtr());
+		return true;
+	} else if (entry->replaceFunc) {
+		// Call the C implementation right here, rather than exiting to the replaced function
+		// and then back to RA.  It only touches registers the ABI lets it clobber.
+		gpr.SetImm(MIPS_REG_RA, js.compilerPC + 8);
+		CompileDelaySlot(DELAYSLOT_NICE);
+		FlushAll();
+		ABI_CallFunctionC(&CallReplacementFunc, index);
+		SUB(32, M(&currentMIPS->downcount), R(EAX));
+		js.compilerPC += 4;
+		// No writing exits, keep going!
+
 		blocks.ProxyBlock(js.blockStart, dest, 4, GetCodePtr());
 		return true;
 	} else {
@@ -468,8 +499,10 @@ void Jit::Comp_ReplacementFunc(MIPSOpcode op)
 		return;
 	}
 
+	js.replacementIndex = index;
+
 	// JIT goes first.
-	if (entry->jitReplaceFunc) {
+	if (entry->jitReplaceFunc && (jo.inlineReplacements || !entry->replaceFunc)) {
 		MIPSReplaceFunc repl = entry->jitReplaceFunc;
 		int cycles = (this->*repl)();
 		FlushAll();
@@ -482,12 +515,12 @@ void Jit::Comp_ReplacementFunc(MIPSOpcode op)
 
 		// Standard function call, nothing fancy.
 		// The function returns the number of cycles it took in EAX.
-		ABI_CallFunction(entry->replaceFunc);
+		ABI_CallFunctionC(&CallReplacementFunc, index);
 		// Alternatively, we could inline it here, instead of calling out, if it's a function
 		// we can emit.
 
 		MOV(32, R(ECX), M(&currentMIPS->r[MIPS_REG_RA]));
-		SUB(32, M(&currentMIPS->downcount - 1), R(EAX));
+		SUB(32, M(&currentMIPS->downcount), R(EAX));
 		js.downcountAmount = 1;  // we just subtracted most of it
 		WriteExitDestInReg(ECX);
 
@@ -613,6 +646,34 @@ void Jit::WriteExitDestInReg(X64Reg reg)
 		SUB(32, M(&currentMIPS->downcount), Imm32(0));
 		J_CC(CC_NE, asm_.dispatcher, true);
 	}
+	else if (jo.indirectTargetCache)
+	{
+		// The dispatcher handles running out of downcount, flags are still from WriteDowncount().
+		FixupBranch outOfCycles = J_CC(CC_S, true);
+
+		// Everything is flushed at this point, but we must not clobber the target.
+		_dbg_assert_msg_(JIT, reg != EDX, "Indirect target can't be in EDX");
+		const X64Reg tableReg = reg == EAX ? ECX : EAX;
+		MOV(32, R(EDX), R(reg));
+		AND(32, R(EDX), Imm32(JitBlockCache::INDIRECT_TARGET_INDEX_MASK));
+#ifdef _M_X64
+		MOV(64, R(tableReg), ImmPtr(blocks.GetIndirectTargetCache()));
+		const int scale = SCALE_4;
+#else
+		MOV(32, R(tableReg), ImmPtr(blocks.GetIndirectTargetCache()));
+		const int scale = SCALE_2;
+#endif
+		CMP(32, MComplex(tableReg, EDX, scale, offsetof(JitIndirectTarget, em_address)), R(reg));
+		FixupBranch miss = J_CC(CC_NE);
+		ADD(32, M(&jitIndirectTargetStats.hits), Imm8(1));
+		JMPptr(MComplex(tableReg, EDX, scale, offsetof(JitIndirectTarget, entry)));
+
+		SetJumpTarget(miss);
+		JMP(asm_.dispatcherFillIndirect, true);
+
+		SetJumpTarget(outOfCycles);
+		JMP(asm_.dispatcher, true);
+	}
 	else
 		JMP(asm_.dispatcher, true);
 }
@@ -627,6 +688,21 @@ void Jit::WriteSyscallExit()
 	JMP(asm_.dispatcherCheckCoreState, true);
 }
 
+// The condition to skip the breakpoint, i.e. when the (unsigned) comparison is false.
+static CCFlags InvertedBreakPointCC(BreakPointCondOp op)
+{
+	switch (op)
+	{
+	case BREAKCOND_EQUAL: return CC_NE;
+	case BREAKCOND_NOTEQUAL: return CC_E;
+	case BREAKCOND_LESS: return CC_AE;
+	case BREAKCOND_LESSEQUAL: return CC_A;
+	case BREAKCOND_GREATER: return CC_BE;
+	case BREAKCOND_GREATEREQUAL: return CC_B;
+	}
+	return CC_NE;
+}
+
 bool Jit::CheckJitBreakpoint(u32 addr, int downcountOffset)
 {
 	if (CBreakPoints::IsAddressBreakPoint(addr))
@@ -634,6 +710,16 @@ bool Jit::CheckJitBreakpoint(u32 addr, int downcountOffset)
 		SAVE_FLAGS;
 		FlushAll();
 		MOV(32, M(&mips_->pc), Imm32(js.compilerPC));
+
+		// Simple conditions are tested inline, so we only call out when the breakpoint may be hit.
+		const BreakPointCond *cond = CBreakPoints::GetBreakPointCondition(addr);
+		bool inlineCond = cond != NULL && cond->compiled;
+		FixupBranch condNotMet;
+		if (inlineCond)
+		{
+			CMP(32, M(&mips_->r[cond->compiledReg]), Imm32(cond->compiledValue));
+			condNotMet = J_CC(InvertedBreakPointCC(cond->compiledOp));
+		}
 		ABI_CallFunction(&JitBreakpoint);
 
 		// If 0, the conditional breakpoint wasn't taken.
@@ -644,6 +730,8 @@ bool Jit::CheckJitBreakpoint(u32 addr, int downcountOffset)
 		LOAD_FLAGS;
 		JMP(asm_.dispatcherCheckCoreState, true);
 		SetJumpTarget(skip);
+		if (inlineCond)
+			SetJumpTarget(condNotMet);
 
 		LOAD_FLAGS;
 
@@ -654,10 +742,10 @@ bool Jit::CheckJitBreakpoint(u32 addr, int downcountOffset)
 }
 
 Jit::JitSafeMem::JitSafeMem(Jit *jit, MIPSGPReg raddr, s32 offset, u32 alignMask)
-	: jit_(jit), raddr_(raddr), offset_(offset), needsCheck_(false), needsSkip_(false), alignMask_(alignMask)
+	: jit_(jit), raddr_(raddr), offset_(offset), needsCheck_(false), needsSkip_(false), needsDirty_(false), alignMask_(alignMask)
 {
 	// This makes it more instructions, so let's play it safe and say we need a far jump.
-	far_ = !g_Config.bIgnoreBadMemAccess || !CBreakPoints::GetMemChecks().empty();
+	far_ = !g_Config.bIgnoreBadMemAccess || CBreakPoints::HasMemChecks();
 	if (jit_->gpr.IsImm(raddr_))
 		iaddr_ = jit_->gpr.GetImm(raddr_) + offset_;
 	else
@@ -681,6 +769,11 @@ bool Jit::JitSafeMem::PrepareWrite(OpArg &dest, int size)
 		if (ImmValid())
 		{
 			MemCheckImm(MEM_WRITE);
+			if (Memory::IsDirtyTracking())
+			{
+				u32 page = ((iaddr_ & alignMask_) & 0x3FFFFFFF) >> Memory::DIRTY_PAGE_SHIFT;
+				jit_->MOV(8, M(&Memory::dirtyPages[page]), Imm8(Memory::DIRTY_ALL));
+			}
 
 #ifdef _M_IX86
 			dest = M(Memory::base + (iaddr_ & Memory::MEMVIEW32_MASK & alignMask_));
@@ -694,7 +787,11 @@ bool Jit::JitSafeMem::PrepareWrite(OpArg &dest, int size)
 	}
 	// Otherwise, we always can do the write (conditionally.)
 	else
+	{
 		dest = PrepareMemoryOpArg(MEM_WRITE);
+		// The page is marked after the caller's write, when we're done with the address.
+		needsDirty_ = Memory::IsDirtyTracking();
+	}
 	return true;
 }
 
@@ -816,8 +913,28 @@ void Jit::JitSafeMem::PrepareSlowAccess()
 	jit_->SetJumpTarget(tooLow);
 }
 
+void Jit::JitSafeMem::MarkDirtyAsm()
+{
+	needsDirty_ = false;
+
+	// Only EAX may be clobbered (it may even be xaddr_), and RCX on x64, which isn't regcached.
+	jit_->LEA(32, EAX, MDisp(xaddr_, offset_));
+	jit_->SHR(32, R(EAX), Imm8(Memory::DIRTY_PAGE_SHIFT));
+	jit_->AND(32, R(EAX), Imm32(Memory::DIRTY_PAGE_COUNT - 1));
+#ifdef _M_IX86
+	jit_->MOV(8, MDisp(EAX, (u32)Memory::dirtyPages), Imm8(Memory::DIRTY_ALL));
+#else
+	jit_->MOV(64, R(RCX), ImmPtr(Memory::dirtyPages));
+	jit_->MOV(8, MComplex(RCX, EAX, SCALE_1, 0), Imm8(Memory::DIRTY_ALL));
+#endif
+}
+
 bool Jit::JitSafeMem::PrepareSlowWrite()
 {
+	// Still in the fast path, right after the write.
+	if (needsDirty_)
+		MarkDirtyAsm();
+
 	// If it's immediate, we only need a slow write on invalid.
 	if (iaddr_ != (u32) -1)
 		return !fast_ && !ImmValid();
@@ -905,6 +1022,8 @@ bool Jit::JitSafeMem::ImmValid()
 
 void Jit::JitSafeMem::Finish()
 {
+	if (needsDirty_)
+		MarkDirtyAsm();
 	// Memory::Read_U32/etc. may have tripped coreState.
 	if (needsCheck_ && !g_Config.bIgnoreBadMemAccess)
 		jit_->js.afterOp |= JitState::AFTER_CORE_STATE;
@@ -936,43 +1055,28 @@ void Jit::JitSafeMem::MemCheckImm(ReadType type)
 
 void Jit::JitSafeMem::MemCheckAsm(ReadType type)
 {
-	const auto memchecks = CBreakPoints::GetMemCheckRanges();
-	bool possible = false;
-	for (auto it = memchecks.begin(), end = memchecks.end(); it != end; ++it)
+	bool possible = CBreakPoints::HasMemChecks(type == MEM_WRITE);
+	if (possible)
 	{
-		if (!(it->cond & MEMCHECK_READ) && type == MEM_READ)
-			continue;
-		if (!(it->cond & MEMCHECK_WRITE) && type == MEM_WRITE)
-			continue;
-
-		possible = true;
-
-		FixupBranch skipNext, skipNextRange;
-		if (it->end != 0)
-		{
-			jit_->CMP(32, R(xaddr_), Imm32(it->start - offset_ - size_));
-			skipNext = jit_->J_CC(CC_BE);
-			jit_->CMP(32, R(xaddr_), Imm32(it->end - offset_));
-			skipNextRange = jit_->J_CC(CC_AE);
-		}
-		else
-		{
-			jit_->CMP(32, R(xaddr_), Imm32(it->start - offset_));
-			skipNext = jit_->J_CC(CC_NE);
-		}
-
+		// Test the page bitmap inline, so the cost doesn't grow with the number of memchecks.
+		// Only accesses to a watched page call JitMemCheck(), which does the exact range check.
 		// Keep the stack 16-byte aligned, just PUSH/POP 4 times.
 		for (int i = 0; i < 4; ++i)
 			jit_->PUSH(xaddr_);
+		jit_->ADD(32, R(xaddr_), Imm32(offset_));
+		jit_->SHR(32, R(xaddr_), Imm8(CBreakPoints::MEMCHECK_PAGE_SHIFT));
+		jit_->AND(32, R(xaddr_), Imm32(CBreakPoints::MEMCHECK_PAGE_MASK));
+		jit_->BT(32, M(CBreakPoints::GetMemCheckPages(type == MEM_WRITE)), R(xaddr_));
+		FixupBranch notWatched = jit_->J_CC(CC_NC);
+
+		jit_->MOV(32, R(xaddr_), MatR(ESP));
 		jit_->MOV(32, M(&jit_->mips_->pc), Imm32(jit_->js.compilerPC));
 		jit_->ADD(32, R(xaddr_), Imm32(offset_));
 		jit_->CallProtectedFunction(&JitMemCheck, R(xaddr_), size_, type == MEM_WRITE ? 1 : 0);
+
+		jit_->SetJumpTarget(notWatched);
 		for (int i = 0; i < 4; ++i)
 			jit_->POP(xaddr_);
-
-		jit_->SetJumpTarget(skipNext);
-		if (it->end != 0)
-			jit_->SetJumpTarget(skipNextRange);
 	}
 
 	if (possible)
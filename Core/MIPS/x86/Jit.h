@@ -46,6 +46,9 @@ struct JitOptions
 	bool continueBranches;
 	bool continueJumps;
 	int continueMaxInstructions;
+	bool indirectTargetCache;
+	// Use the jit's own versions of replaced functions that also have a C version.
+	bool inlineReplacements;
 };
 
 // TODO: Hmm, humongous.
@@ -144,6 +147,11 @@ public:
 	void Comp_DoNothing(MIPSOpcode op);
 
 	int Replace_fabsf();
+	// These flush, do small or simple cases inline, and call the C version for the rest.
+	int Replace_memcpy();
+	int Replace_memset();
+	int Replace_strlen();
+	int Replace_strcmp();
 	int Replace_dl_write_matrix();
 
 	void ApplyPrefixST(u8 *vregs, u32 prefix, VectorSize sz);
@@ -216,6 +224,12 @@ private:
 	void CompITypeMemUnpairedLRInner(MIPSOpcode op, X64Reg shiftReg);
 	void CompBranchExits(CCFlags cc, u32 targetAddr, u32 notTakenAddr, bool delaySlotIsNice, bool likely, bool andLink);
 
+	// For the replacements in CompReplace.cpp.
+	void ReplaceCheckRAM(X64Reg reg, u32 size, std::vector<FixupBranch> &slow);
+	// Clobbers addr, and temp on x64.
+	void ReplaceMarkDirtyPage(X64Reg addr, X64Reg temp);
+	void ReplaceSlowPath(std::vector<FixupBranch> &slow, int cycles);
+
 	void CompFPTriArith(MIPSOpcode op, void (XEmitter::*arith)(X64Reg reg, OpArg), bool orderMatters);
 	void CompFPComp(int lhs, int rhs, u8 compare, bool allowNaN = false);
 
@@ -316,6 +330,7 @@ private:
 		void PrepareSlowAccess();
 		void MemCheckImm(ReadType type);
 		void MemCheckAsm(ReadType type);
+		void MarkDirtyAsm();
 		bool ImmValid();
 
 		Jit *jit_;
@@ -324,6 +339,7 @@ private:
 		int size_;
 		bool needsCheck_;
 		bool needsSkip_;
+		bool needsDirty_;
 		bool far_;
 		bool fast_;
 		u32 alignMask_;
@@ -0,0 +1,185 @@
+// Copyright (c) 2012- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#include <cstring>
+
+#include "Common/Atomics.h"
+#include "Core/MemDirty.h"
+#include "Core/MemMap.h"
+
+namespace Memory
+{
+
+// Aligned so a consumer can clear its bit with an atomic op on the containing word.
+MEMORY_ALIGNED16(u8 dirtyPages[DIRTY_PAGE_COUNT]);
+
+enum {
+	RAM_FIRST_PAGE = 0x08000000 >> DIRTY_PAGE_SHIFT,
+	// Enough for the largest RAM size.
+	RAM_MAX_PAGES = 0x04000000 >> DIRTY_PAGE_SHIFT,
+};
+
+// The generation each RAM page was last stamped with by each consumer, after being written.
+static u32 pageGenerations[DIRTY_CONSUMER_COUNT][RAM_MAX_PAGES];
+static u32 currentGenerations[DIRTY_CONSUMER_COUNT];
+static bool dirtyTracking = false;
+static DirtyStats stats[DIRTY_CONSUMER_COUNT];
+
+// Returns false if any of the range is outside RAM.
+static bool GetRAMPages(u32 address, u32 size, u32 &first, u32 &last) {
+	address &= 0x3FFFFFFF;
+	if (address < PSP_GetKernelMemoryBase() || size > g_MemorySize || address - PSP_GetKernelMemoryBase() > g_MemorySize - size) {
+		return false;
+	}
+	first = address >> DIRTY_PAGE_SHIFT;
+	last = (address + size - 1) >> DIRTY_PAGE_SHIFT;
+	return true;
+}
+
+static bool PtrToAddress(const void *ptr, u32 &address) {
+	uintptr_t offset = (uintptr_t)ptr - (uintptr_t)base;
+	if (ptr == NULL || offset >= 0x40000000) {
+		return false;
+	}
+	address = (u32)offset;
+	return true;
+}
+
+void MarkDirtyRange(const u32 address, const u32 size) {
+	if (size == 0) {
+		return;
+	}
+	const u32 first = (address & 0x3FFFFFFF) >> DIRTY_PAGE_SHIFT;
+	const u32 last = ((address + size - 1) & 0x3FFFFFFF) >> DIRTY_PAGE_SHIFT;
+	if (first <= last) {
+		memset(dirtyPages + first, DIRTY_ALL, last - first + 1);
+	} else {
+		// Wrapped around the view, unlikely but cheap to get right.
+		memset(dirtyPages + first, DIRTY_ALL, DIRTY_PAGE_COUNT - first);
+		memset(dirtyPages, DIRTY_ALL, last + 1);
+	}
+}
+
+void MarkDirtyPtr(const void *ptr, const u32 size) {
+	u32 address;
+	if (PtrToAddress(ptr, address)) {
+		MarkDirtyRange(address, size);
+	}
+}
+
+void MarkAllDirty() {
+	memset(dirtyPages + RAM_FIRST_PAGE, DIRTY_ALL, RAM_MAX_PAGES);
+}
+
+void SetDirtyTracking(bool enable) {
+	if (enable && !dirtyTracking) {
+		// Whatever happened while off wasn't tracked.
+		MarkAllDirty();
+	}
+	dirtyTracking = enable;
+}
+
+bool IsDirtyTracking() {
+	return dirtyTracking;
+}
+
+// Writers may store the byte at any time, so this must not be a plain read and clear.
+static void ClearDirtyBit(u32 page, u8 bit) {
+	volatile u32 &word = *(volatile u32 *)&dirtyPages[page & ~3];
+	Common::AtomicAnd(word, ~((u32)bit << ((page & 3) * 8)));
+}
+
+u32 NextDirtyGeneration(DirtyConsumer consumer) {
+	// 0 means never stamped.
+	if (++currentGenerations[consumer] == 0) {
+		memset(pageGenerations[consumer], 0, sizeof(pageGenerations[consumer]));
+		MarkAllDirty();
+		++currentGenerations[consumer];
+	}
+	return currentGenerations[consumer];
+}
+
+void StampDirtyRange(DirtyConsumer consumer, const u32 address, const u32 size, u32 generation) {
+	u32 first, last;
+	if (!dirtyTracking || size == 0 || !GetRAMPages(address, size, first, last)) {
+		return;
+	}
+	const u8 bit = 1 << consumer;
+	for (u32 page = first; page <= last; ++page) {
+		if (dirtyPages[page] & bit) {
+			// Clear first, so a write racing with this is seen next time.
+			ClearDirtyBit(page, bit);
+			pageGenerations[consumer][page - RAM_FIRST_PAGE] = generation;
+		}
+	}
+}
+
+void StampDirtyPtr(DirtyConsumer consumer, const void *ptr, const u32 size, u32 generation) {
+	u32 address;
+	if (PtrToAddress(ptr, address)) {
+		StampDirtyRange(consumer, address, size, generation);
+	}
+}
+
+bool HasRangeChanged(DirtyConsumer consumer, const u32 address, const u32 size, u32 since) {
+	u32 first, last;
+	if (!dirtyTracking || since == 0) {
+		return true;
+	}
+	if (size == 0) {
+		return false;
+	}
+	if (!GetRAMPages(address, size, first, last)) {
+		return true;
+	}
+	const u8 bit = 1 << consumer;
+	const u32 *generations = pageGenerations[consumer];
+	for (u32 page = first; page <= last; ++page) {
+		if ((dirtyPages[page] & bit) || generations[page - RAM_FIRST_PAGE] > since) {
+			return true;
+		}
+	}
+	return false;
+}
+
+bool HasPtrRangeChanged(DirtyConsumer consumer, const void *ptr, const u32 size, u32 since) {
+	u32 address;
+	if (!PtrToAddress(ptr, address)) {
+		return true;
+	}
+	return HasRangeChanged(consumer, address, size, since);
+}
+
+void NoteDirtyCheck(DirtyConsumer consumer, u32 bytes, bool skipped) {
+	DirtyStats &s = stats[consumer];
+	s.checks++;
+	s.bytesChecked += bytes;
+	if (skipped) {
+		s.skips++;
+		s.bytesSkipped += bytes;
+	}
+}
+
+const DirtyStats &GetDirtyStats(DirtyConsumer consumer) {
+	return stats[consumer];
+}
+
+void ResetDirtyStats() {
+	memset(stats, 0, sizeof(stats));
+}
+
+}  // namespace Memory
@@ -0,0 +1,90 @@
+// Copyright (c) 2012- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#pragma once
+
+#include "Common/CommonTypes.h"
+
+// Tracks which pages of RAM were written, so that things that hash or compare RAM (rewind,
+// the texture cache, vertex caching) can skip pages that haven't changed.
+//
+// Writers just set a byte per page, which is cheap enough for the jit to do inline.
+// Each consumer owns one bit of that byte and its own generations, so consumers on
+// different threads (rewind on the emu thread, caches on the GPU thread) never clear
+// each other's state.  Consumers remember a generation, and ask whether a range changed
+// since then.  Only RAM is trusted: VRAM and the scratchpad always report as changed.
+//
+// Anything writing to RAM through a host pointer must mark it, or consumers may miss the change.
+namespace Memory
+{
+
+enum DirtyConsumer {
+	DIRTY_REWIND,
+	DIRTY_TEXTURES,
+	DIRTY_VERTICES,
+
+	DIRTY_CONSUMER_COUNT,
+};
+
+enum {
+	// What writers store, every consumer's bit.
+	DIRTY_ALL = (1 << DIRTY_CONSUMER_COUNT) - 1,
+
+	DIRTY_PAGE_SHIFT = 12,
+	DIRTY_PAGE_SIZE = 1 << DIRTY_PAGE_SHIFT,
+	// Covers the whole 0x3FFFFFFF view, so marking never needs a range check.
+	DIRTY_PAGE_COUNT = 0x40000000 >> DIRTY_PAGE_SHIFT,
+};
+
+extern u8 dirtyPages[DIRTY_PAGE_COUNT];
+
+inline void MarkDirty(const u32 address) {
+	dirtyPages[(address & 0x3FFFFFFF) >> DIRTY_PAGE_SHIFT] = DIRTY_ALL;
+}
+
+void MarkDirtyRange(const u32 address, const u32 size);
+// For writes through a pointer from GetPointer().
+void MarkDirtyPtr(const void *ptr, const u32 size);
+void MarkAllDirty();
+
+struct DirtyStats {
+	// Times a consumer asked whether it could skip work.
+	u64 checks;
+	u64 skips;
+	u64 bytesChecked;
+	// Bytes not hashed or compared, because they hadn't changed.
+	u64 bytesSkipped;
+};
+
+// Only takes effect for code compiled afterward, so set it before the jit starts.
+void SetDirtyTracking(bool enable);
+bool IsDirtyTracking();
+
+// Returns a new generation, to stamp ranges with right before hashing or comparing them.
+// A consumer must only call these from one thread.
+u32 NextDirtyGeneration(DirtyConsumer consumer);
+void StampDirtyRange(DirtyConsumer consumer, const u32 address, const u32 size, u32 generation);
+void StampDirtyPtr(DirtyConsumer consumer, const void *ptr, const u32 size, u32 generation);
+// True if any page in the range may have been written since it was stamped with since.
+bool HasRangeChanged(DirtyConsumer consumer, const u32 address, const u32 size, u32 since);
+bool HasPtrRangeChanged(DirtyConsumer consumer, const void *ptr, const u32 size, u32 since);
+
+void NoteDirtyCheck(DirtyConsumer consumer, u32 bytes, bool skipped);
+const DirtyStats &GetDirtyStats(DirtyConsumer consumer);
+void ResetDirtyStats();
+
+}  // namespace Memory
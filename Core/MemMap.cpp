@@ -32,6 +32,7 @@
 #include "Core/Debugger/Breakpoints.h"
 #include "Core/Config.h"
 #include "Core/HLE/ReplaceTables.h"
+#include "Core/MemSnapshot.h"
 
 namespace Memory {
 
@@ -121,11 +122,13 @@ void Init()
 	}
 	base = MemoryMap_Setup(views, num_views, flags, &g_arena);
 
+	MarkAllDirty();
+
 	INFO_LOG(MEMMAP, "Memory system initialized. RAM at %p (mirror at 0 @ %p, uncached @ %p)",
 		m_pRAM, m_pPhysicalRAM, m_pUncachedRAM);
 }
 
-void DoState(PointerWrap &p)
+void DoState(PointerWrap &p, bool includeContents, u8 **ramPos)
 {
 	auto s = p.Section("Memory", 1, 2);
 	if (!s)
@@ -148,6 +151,13 @@ void DoState(PointerWrap &p)
 		}
 	}
 
+	if (!includeContents)
+		return;
+
+	if (ramPos)
+		*ramPos = *p.ptr;
+	if (p.mode == p.MODE_READ)
+		MarkAllDirty();
 	p.DoArray(GetPointer(PSP_GetKernelMemoryBase()), g_MemorySize);
 	p.DoMarker("RAM");
 
@@ -157,8 +167,38 @@ void DoState(PointerWrap &p)
 	p.DoMarker("ScratchPad");
 }
 
+int GetMappedSpans(MappedSpan *spans, int maxSpans)
+{
+	int count = 0;
+	for (int i = 0; i < num_views; i++)
+	{
+		if (views[i].size == 0)
+			continue;
+
+		u8 *ptrs[2] = { views[i].out_ptr_low ? *views[i].out_ptr_low : NULL, *views[i].out_ptr };
+		for (int j = 0; j < 2; j++)
+		{
+			if (ptrs[j] == NULL)
+				continue;
+			// In 32-bit, mirrors often share the same view.
+			bool found = false;
+			for (int k = 0; k < count; k++)
+				found = found || spans[k].ptr == ptrs[j];
+			if (found || count >= maxSpans)
+				continue;
+
+			spans[count].ptr = ptrs[j];
+			spans[count].address = views[i].virtual_address & 0x0FFFFFFF;
+			spans[count].size = views[i].size;
+			count++;
+		}
+	}
+	return count;
+}
+
 void Shutdown()
 {
+	EndWriteTracking();
 	u32 flags = 0;
 	MemoryMap_Shutdown(views, num_views, flags, &g_arena);
 	g_arena.ReleaseSpace();
@@ -238,7 +278,8 @@ Opcode Read_Opcode_JIT(u32 address)
 // We assume that _Address is cached
 void Write_Opcode_JIT(const u32 _Address, const Opcode _Value)
 {
-	Memory::WriteUnchecked_U32(_Value.encoding, _Address);
+	// Emuhacks aren't really a change to memory, so don't mark the page dirty.
+	*(u32_le *)GetPointerUnchecked(_Address) = _Value.encoding;
 }
 
 void Memset(const u32 _Address, const u8 _iValue, const u32 _iLength)
@@ -246,6 +287,7 @@ void Memset(const u32 _Address, const u8 _iValue, const u32 _iLength)
 	u8 *ptr = GetPointer(_Address);
 	if (ptr != NULL) {
 		memset(ptr, _iValue, _iLength);
+		MarkDirtyRange(_Address, _iLength);
 	}
 	else
 	{
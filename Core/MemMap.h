@@ -23,6 +23,7 @@
 #include "Common/Common.h"
 #include "Common/CommonTypes.h"
 #include "HDRemaster.h"
+#include "Core/MemDirty.h"
 
 // PPSSPP is very aggressive about trying to do memory accesses directly, for speed.
 // This can be a problem when debugging though, as stray memory reads and writes will
@@ -104,9 +105,22 @@ enum
 // Init and Shutdown
 void Init();
 void Shutdown();
-void DoState(PointerWrap &p);
+// Without contents, only the layout is saved (for MemSnapshot, which keeps the contents itself.)
+// ramPos, if set, receives where RAM starts in the state.
+void DoState(PointerWrap &p, bool includeContents = true, u8 **ramPos = NULL);
 void Clear();
 
+// A host mapping of emulated memory.  There are several per region, one for each mirror.
+struct MappedSpan {
+	u8 *ptr;
+	// Address of ptr[0], without mirror bits.
+	u32 address;
+	u32 size;
+};
+
+// Each distinct mapping once, for code that changes page protection.  Returns the count.
+int GetMappedSpans(MappedSpan *spans, int maxSpans);
+
 struct Opcode {
 	Opcode() {
 	}
@@ -193,6 +207,7 @@ inline u8 ReadUnchecked_U8(const u32 address) {
 }
 
 inline void WriteUnchecked_U32(u32 data, u32 address) {
+	MarkDirty(address);
 #if defined(_M_IX86) || defined(_M_ARM32) || defined (_XBOX)
 	*(u32_le *)(base + (address & MEMVIEW32_MASK)) = data;
 #else
@@ -201,6 +216,7 @@ inline void WriteUnchecked_U32(u32 data, u32 address) {
 }
 
 inline void WriteUnchecked_U16(u16 data, u32 address) {
+	MarkDirty(address);
 #if defined(_M_IX86) || defined(_M_ARM32) || defined (_XBOX)
 	*(u16_le *)(base + (address & MEMVIEW32_MASK)) = data;
 #else
@@ -209,6 +225,7 @@ inline void WriteUnchecked_U16(u16 data, u32 address) {
 }
 
 inline void WriteUnchecked_U8(u8 data, u32 address) {
+	MarkDirty(address);
 #if defined(_M_IX86) || defined(_M_ARM32) || defined (_XBOX)
 	(*(u8 *)(base + (address & MEMVIEW32_MASK))) = data;
 #else
@@ -257,6 +274,7 @@ inline void Memcpy(const u32 to_address, const void *from_data, const u32 len)
 	u8 *to = GetPointer(to_address);
 	if (to) {
 		memcpy(to, from_data, len);
+		MarkDirtyRange(to_address, len);
 	}
 	// if not, GetPointer will log.
 }
@@ -323,8 +341,16 @@ struct PSPPointer
 {
 	u32_le ptr;
 
+	// The accessors can't tell reads from writes, so they mark the T they hand out dirty.
+	inline void MarkDirty(u32 address) const
+	{
+		Memory::MarkDirty(address);
+		Memory::MarkDirty(address + sizeof(T) - 1);
+	}
+
 	inline T &operator*() const
 	{
+		MarkDirty(ptr);
 #if defined(_M_IX86) || defined(_M_ARM32) || defined (_XBOX)
 		return *(T *)(Memory::base + (ptr & Memory::MEMVIEW32_MASK));
 #else
@@ -334,6 +360,7 @@ struct PSPPointer
 
 	inline T &operator[](int i) const
 	{
+		MarkDirty(ptr + i * sizeof(T));
 #if defined(_M_IX86) || defined(_M_ARM32) || defined (_XBOX)
 		return *((T *)(Memory::base + (ptr & Memory::MEMVIEW32_MASK)) + i);
 #else
@@ -343,6 +370,7 @@ struct PSPPointer
 
 	inline T *operator->() const
 	{
+		MarkDirty(ptr);
 #if defined(_M_IX86) || defined(_M_ARM32) || defined (_XBOX)
 		return (T *)(Memory::base + (ptr & Memory::MEMVIEW32_MASK));
 #else
@@ -412,6 +440,7 @@ struct PSPPointer
 
 	inline operator T*()
 	{
+		MarkDirty(ptr);
 #if defined(_M_IX86) || defined(_M_ARM32) || defined (_XBOX)
 		return (T *)(Memory::base + (ptr & Memory::MEMVIEW32_MASK));
 #else
@@ -115,6 +115,7 @@ inline void WriteToHardware(u32 address, const T data)
 
 	if ((address & 0x3E000000) == 0x08000000) {
 		*(T*)GetPointerUnchecked(address) = data;
+		MarkDirty(address);
 	}
 	else if ((address & 0x3F800000) == 0x04000000) {
 		*(T*)&m_pVRAM[address & VRAM_MASK] = data;
@@ -124,6 +125,7 @@ inline void WriteToHardware(u32 address, const T data)
 	}
 	else if ((address & 0x3F000000) >= 0x08000000 && (address & 0x3F000000) < 0x08000000 + g_MemorySize) {
 		*(T*)GetPointerUnchecked(address) = data;
+		MarkDirty(address);
 	}
 	else
 	{
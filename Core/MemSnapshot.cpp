@@ -0,0 +1,415 @@
+// Copyright (c) 2012- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#include <atomic>
+#include <cstring>
+
+#include "Common/Common.h"
+#include "Common/MemoryUtil.h"
+#include "Common/StdMutex.h"
+#include "Core/MemMap.h"
+#include "Core/MemSnapshot.h"
+
+#if !defined(_WIN32) && !defined(__SYMBIAN32__) && !defined(IOS)
+#define MEMSNAPSHOT_WRITE_TRACKING
+#include <signal.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace Memory {
+
+static const u32 SNAPSHOT_PAGE_SIZE = 4096;
+
+struct SnapshotPage {
+	u8 data[SNAPSHOT_PAGE_SIZE];
+};
+
+enum {
+	PAGE_CLEAN = 0,
+	// Written to since the last capture.
+	PAGE_WRITTEN = 1,
+	// Not tracked yet, so it has to be compared.
+	PAGE_UNKNOWN = 2,
+};
+
+// One host mapping of a run of snapshot pages.  Each page has one per mirror.
+struct TrackedSpan {
+	u8 *ptr;
+	u32 firstPage;
+	u32 pageCount;
+};
+
+static SnapshotStats stats;
+// Bumped from the fault handler, on whichever thread wrote.
+static std::atomic<u32> writeFaults;
+// What memory held at the last capture or restore.  While tracking, exact for clean pages.
+static std::vector<std::shared_ptr<SnapshotPage> > syncedPages;
+// Other threads (like the GPU) write to memory too, so their faults may change these anytime.
+// The handler unprotects before marking a page written, and captures mark clean before
+// protecting, so a write is never missed.
+static std::vector<std::atomic<u8> > pageStates;
+static std::vector<u8> captureStates;
+static std::vector<TrackedSpan> trackedSpans;
+static std::atomic<bool> tracking(false);
+// Held during captures, restores, and host writes, so a page isn't protected mid read().
+static std::recursive_mutex trackingLock;
+
+// Held by every snapshot, so tracking can end once none are left.
+struct SnapshotTracking {
+	~SnapshotTracking();
+};
+static std::weak_ptr<SnapshotTracking> snapshotTracking;
+
+static u32 RegionPages(int region) {
+	switch (region) {
+	case 0: return SCRATCHPAD_SIZE / SNAPSHOT_PAGE_SIZE;
+	case 1: return VRAM_SIZE / SNAPSHOT_PAGE_SIZE;
+	default: return g_MemorySize / SNAPSHOT_PAGE_SIZE;
+	}
+}
+
+static u32 RegionAddress(int region) {
+	switch (region) {
+	case 0: return 0x00010000;
+	case 1: return 0x04000000;
+	default: return PSP_GetKernelMemoryBase();
+	}
+}
+
+static u32 TotalPages() {
+	return RegionPages(0) + RegionPages(1) + RegionPages(2);
+}
+
+static u8 *PagePointer(u32 page) {
+	for (int region = 0; region < 2; ++region) {
+		if (page < RegionPages(region)) {
+			return GetPointerUnchecked(RegionAddress(region) + page * SNAPSHOT_PAGE_SIZE);
+		}
+		page -= RegionPages(region);
+	}
+	return GetPointerUnchecked(RegionAddress(2) + page * SNAPSHOT_PAGE_SIZE);
+}
+
+#ifdef MEMSNAPSHOT_WRITE_TRACKING
+static bool handlerInstalled = false;
+static struct sigaction prevSegvAction;
+static struct sigaction prevBusAction;
+#endif
+
+static void ProtectPages(u32 first, u32 count, bool writable) {
+	const u32 last = first + count;
+	for (size_t i = 0; i < trackedSpans.size(); ++i) {
+		const TrackedSpan &span = trackedSpans[i];
+		const u32 start = std::max(first, span.firstPage);
+		const u32 end = std::min(last, span.firstPage + span.pageCount);
+		if (start >= end) {
+			continue;
+		}
+
+		u8 *ptr = span.ptr + (start - span.firstPage) * SNAPSHOT_PAGE_SIZE;
+		if (writable) {
+			UnWriteProtectMemory(ptr, (end - start) * SNAPSHOT_PAGE_SIZE);
+		} else {
+			WriteProtectMemory(ptr, (end - start) * SNAPSHOT_PAGE_SIZE);
+		}
+	}
+}
+
+// Calls func(firstPage, count) for each run of snapshot pages that [ptr, ptr + size) covers.
+template <typename F>
+static void ForEachHostRange(const u8 *ptr, size_t size, F func) {
+	for (size_t i = 0; i < trackedSpans.size(); ++i) {
+		const TrackedSpan &span = trackedSpans[i];
+		const u8 *spanEnd = span.ptr + span.pageCount * SNAPSHOT_PAGE_SIZE;
+		const u8 *start = std::max(ptr, (const u8 *)span.ptr);
+		const u8 *end = std::min(ptr + size, spanEnd);
+		if (start >= end) {
+			continue;
+		}
+
+		const u32 firstPage = span.firstPage + (u32)((start - span.ptr) / SNAPSHOT_PAGE_SIZE);
+		const u32 lastPage = span.firstPage + (u32)((end - 1 - span.ptr) / SNAPSHOT_PAGE_SIZE);
+		func(firstPage, lastPage - firstPage + 1);
+	}
+}
+
+#ifdef MEMSNAPSHOT_WRITE_TRACKING
+static void WriteFaultHandler(int sig, siginfo_t *info, void *context) {
+	bool handled = false;
+	if (tracking) {
+		ForEachHostRange((const u8 *)info->si_addr, 1, [&](u32 page, u32 count) {
+			ProtectPages(page, 1, true);
+			pageStates[page] = PAGE_WRITTEN;
+			handled = true;
+		});
+	}
+	if (handled) {
+		writeFaults++;
+		return;
+	}
+
+	// Not ours.  Pass it on, or crash like we would have without the handler.
+	const struct sigaction &prev = sig == SIGSEGV ? prevSegvAction : prevBusAction;
+	if (prev.sa_flags & SA_SIGINFO) {
+		prev.sa_sigaction(sig, info, context);
+	} else if (prev.sa_handler != SIG_DFL && prev.sa_handler != SIG_IGN) {
+		prev.sa_handler(sig);
+	} else {
+		signal(sig, SIG_DFL);
+	}
+}
+#endif
+
+bool BeginWriteTracking() {
+#ifdef MEMSNAPSHOT_WRITE_TRACKING
+	std::lock_guard<std::recursive_mutex> guard(trackingLock);
+	if (tracking) {
+		return true;
+	}
+	if (base == NULL || sysconf(_SC_PAGESIZE) != SNAPSHOT_PAGE_SIZE) {
+		return false;
+	}
+
+	MappedSpan spans[32];
+	int count = GetMappedSpans(spans, (int)(sizeof(spans) / sizeof(spans[0])));
+	trackedSpans.clear();
+	u32 regionPage = 0;
+	for (int region = 0; region < 3; ++region) {
+		const u32 regionStart = RegionAddress(region);
+		const u32 regionEnd = regionStart + RegionPages(region) * SNAPSHOT_PAGE_SIZE;
+		for (int i = 0; i < count; ++i) {
+			const u32 start = std::max(spans[i].address, regionStart);
+			const u32 end = std::min(spans[i].address + spans[i].size, regionEnd);
+			if (start >= end) {
+				continue;
+			}
+
+			TrackedSpan span;
+			span.ptr = spans[i].ptr + (start - spans[i].address);
+			span.firstPage = regionPage + (start - regionStart) / SNAPSHOT_PAGE_SIZE;
+			span.pageCount = (end - start) / SNAPSHOT_PAGE_SIZE;
+			trackedSpans.push_back(span);
+		}
+		regionPage += RegionPages(region);
+	}
+
+	// Whatever was captured before isn't known to match anymore.
+	std::vector<std::atomic<u8> > states(TotalPages());
+	for (size_t i = 0; i < states.size(); ++i) {
+		states[i] = PAGE_UNKNOWN;
+	}
+	pageStates.swap(states);
+
+	if (!handlerInstalled) {
+		struct sigaction action;
+		memset(&action, 0, sizeof(action));
+		action.sa_sigaction = &WriteFaultHandler;
+		action.sa_flags = SA_SIGINFO;
+		sigemptyset(&action.sa_mask);
+		sigaction(SIGSEGV, &action, &prevSegvAction);
+		// Some platforms (like Mac OS X) raise this instead for protection faults.
+		sigaction(SIGBUS, &action, &prevBusAction);
+		handlerInstalled = true;
+	}
+
+	tracking = true;
+	INFO_LOG(MEMMAP, "Tracking writes to %d pages across %d mappings", (int)pageStates.size(), (int)trackedSpans.size());
+	return true;
+#else
+	return false;
+#endif
+}
+
+void EndWriteTracking() {
+	std::lock_guard<std::recursive_mutex> guard(trackingLock);
+	if (!tracking) {
+		return;
+	}
+
+	// Unprotect first, so nothing faults while the handler is ignoring faults.
+	ProtectPages(0, (u32)pageStates.size(), true);
+	tracking = false;
+	trackedSpans.clear();
+	pageStates.clear();
+	syncedPages.clear();
+}
+
+bool IsWriteTracking() {
+	return tracking;
+}
+
+SnapshotTracking::~SnapshotTracking() {
+	std::lock_guard<std::recursive_mutex> guard(trackingLock);
+	// The last snapshot is gone, so stop faulting on writes, and drop the pages kept to share.
+	EndWriteTracking();
+	syncedPages.clear();
+}
+
+bool CaptureSnapshot(Snapshot &snapshot) {
+	std::lock_guard<std::recursive_mutex> guard(trackingLock);
+	if (base == NULL) {
+		return false;
+	}
+	std::shared_ptr<SnapshotTracking> snapshotRef = snapshotTracking.lock();
+	if (!snapshotRef) {
+		snapshotRef = std::make_shared<SnapshotTracking>();
+		snapshotTracking = snapshotRef;
+	}
+	if (!tracking) {
+		BeginWriteTracking();
+	}
+
+	const u32 total = TotalPages();
+	if (syncedPages.size() != total) {
+		syncedPages.clear();
+		syncedPages.resize(total);
+	}
+	captureStates.resize(total);
+
+	for (u32 page = 0; page < total; ) {
+		if (tracking && pageStates[page] == PAGE_CLEAN) {
+			stats.pagesShared++;
+			++page;
+			continue;
+		}
+
+		u32 end = page + 1;
+		if (tracking) {
+			while (end < total && pageStates[end] != PAGE_CLEAN) {
+				++end;
+			}
+			// Protect before copying, so any write that sneaks in after is caught next time.
+			for (u32 i = page; i < end; ++i) {
+				captureStates[i] = pageStates[i].exchange(PAGE_CLEAN);
+			}
+			ProtectPages(page, end - page, false);
+		} else {
+			end = total;
+			memset(&captureStates[page], PAGE_UNKNOWN, end - page);
+		}
+
+		for (u32 i = page; i < end; ++i) {
+			const u8 *live = PagePointer(i);
+			std::shared_ptr<SnapshotPage> &synced = syncedPages[i];
+			if (captureStates[i] == PAGE_UNKNOWN && synced && memcmp(synced->data, live, SNAPSHOT_PAGE_SIZE) == 0) {
+				stats.pagesShared++;
+				continue;
+			}
+
+			// Never modify a page in place, other snapshots may share it.
+			synced = std::make_shared<SnapshotPage>();
+			memcpy(synced->data, live, SNAPSHOT_PAGE_SIZE);
+			stats.pagesCopied++;
+		}
+		page = end;
+	}
+
+	snapshot.pages_ = syncedPages;
+	snapshot.tracking_ = snapshotRef;
+	stats.captures++;
+	return true;
+}
+
+bool RestoreSnapshot(const Snapshot &snapshot) {
+	std::lock_guard<std::recursive_mutex> guard(trackingLock);
+	const u32 total = TotalPages();
+	if (base == NULL || snapshot.pages_.size() != total) {
+		return false;
+	}
+	if (syncedPages.size() != total) {
+		syncedPages.clear();
+		syncedPages.resize(total);
+	}
+
+	// Without tracking, there's no telling what changed, so everything is copied.
+	auto needsRestore = [&](u32 page) {
+		return !tracking || pageStates[page] != PAGE_CLEAN || syncedPages[page] != snapshot.pages_[page];
+	};
+
+	for (u32 page = 0; page < total; ) {
+		if (!needsRestore(page)) {
+			++page;
+			continue;
+		}
+
+		u32 end = page + 1;
+		while (end < total && needsRestore(end)) {
+			++end;
+		}
+
+		if (tracking) {
+			ProtectPages(page, end - page, true);
+		}
+		for (u32 i = page; i < end; ++i) {
+			memcpy(PagePointer(i), snapshot.pages_[i]->data, SNAPSHOT_PAGE_SIZE);
+			MarkDirtyPtr(PagePointer(i), SNAPSHOT_PAGE_SIZE);
+			syncedPages[i] = snapshot.pages_[i];
+			stats.pagesRestored++;
+		}
+		if (tracking) {
+			for (u32 i = page; i < end; ++i) {
+				pageStates[i] = PAGE_CLEAN;
+			}
+			ProtectPages(page, end - page, false);
+			// Another thread may have written after the copy, but before the protect.
+			for (u32 i = page; i < end; ++i) {
+				if (memcmp(PagePointer(i), snapshot.pages_[i]->data, SNAPSHOT_PAGE_SIZE) != 0) {
+					pageStates[i] = PAGE_WRITTEN;
+				}
+			}
+		}
+		page = end;
+	}
+
+	stats.restores++;
+	return true;
+}
+
+HostWriteGuard::HostWriteGuard(const u8 *ptr, size_t size) : locked_(false) {
+	MarkDirtyPtr(ptr, (u32)size);
+	if (!tracking || size == 0) {
+		return;
+	}
+
+	trackingLock.lock();
+	locked_ = true;
+	ForEachHostRange(ptr, size, [&](u32 page, u32 count) {
+		for (u32 i = page; i < page + count; ++i) {
+			pageStates[i] = PAGE_WRITTEN;
+		}
+		ProtectPages(page, count, true);
+	});
+}
+
+HostWriteGuard::~HostWriteGuard() {
+	if (locked_) {
+		trackingLock.unlock();
+	}
+}
+
+const SnapshotStats &GetSnapshotStats() {
+	stats.writeFaults = writeFaults;
+	return stats;
+}
+
+void ResetSnapshotStats() {
+	memset(&stats, 0, sizeof(stats));
+	writeFaults = 0;
+}
+
+}  // namespace Memory
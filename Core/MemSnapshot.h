@@ -0,0 +1,86 @@
+// Copyright (c) 2012- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "Common/CommonTypes.h"
+
+namespace Memory {
+
+struct SnapshotPage;
+struct SnapshotTracking;
+
+// The contents of RAM, VRAM, and the scratchpad, page by page.
+// Unchanged pages are shared with other snapshots, so copying one is cheap, and only
+// pages that differ take up space.  Write tracking stops once the last one is cleared.
+class Snapshot {
+public:
+	bool IsEmpty() const { return pages_.empty(); }
+	void Clear() { pages_.clear(); tracking_.reset(); }
+	size_t PageCount() const { return pages_.size(); }
+
+private:
+	friend bool CaptureSnapshot(Snapshot &snapshot);
+	friend bool RestoreSnapshot(const Snapshot &snapshot);
+
+	std::vector<std::shared_ptr<SnapshotPage> > pages_;
+	std::shared_ptr<SnapshotTracking> tracking_;
+};
+
+struct SnapshotStats {
+	u64 captures;
+	u64 restores;
+	// Pages copied from memory when capturing.
+	u64 pagesCopied;
+	// Pages captured by reference, because they hadn't changed.
+	u64 pagesShared;
+	// Pages copied back into memory when restoring.
+	u64 pagesRestored;
+	// First writes to a page after a capture or restore.
+	u64 writeFaults;
+};
+
+// While write tracking, pages are write protected after each capture, and the first write to
+// each one is noted, so the next capture only copies what changed.  Otherwise, every page is
+// compared instead.  Capturing starts tracking, where supported, and it ends when no snapshots
+// are left.
+bool BeginWriteTracking();
+void EndWriteTracking();
+bool IsWriteTracking();
+
+bool CaptureSnapshot(Snapshot &snapshot);
+bool RestoreSnapshot(const Snapshot &snapshot);
+
+// The OS reports an error for read() or recv() into a protected page rather than faulting.
+// So hold one of these while handing emulated memory to the OS to write into.
+// It also marks the range for MemDirty.
+class HostWriteGuard {
+public:
+	HostWriteGuard(const u8 *ptr, size_t size);
+	~HostWriteGuard();
+
+private:
+	bool locked_;
+};
+
+const SnapshotStats &GetSnapshotStats();
+void ResetSnapshotStats();
+
+}  // namespace Memory
@@ -29,6 +29,7 @@
 #include "Core/Core.h"
 #include "Core/CoreTiming.h"
 #include "Core/Host.h"
+#include "Core/InputMovie.h"
 #include "Core/System.h"
 #include "Core/FileSystems/MetaFileSystem.h"
 #include "Core/ELF/ParamSFO.h"
@@ -45,7 +46,16 @@ namespace SaveState
 {
 	struct SaveStart
 	{
+		SaveStart(Memory::Snapshot *memSnapshot = NULL, u8 **ramPos = NULL) : memSnapshot_(memSnapshot), ramPos_(ramPos) {}
 		void DoState(PointerWrap &p);
+
+	private:
+		void DoMemoryState(PointerWrap &p);
+
+		// When set, memory contents go here instead of into the state.
+		Memory::Snapshot *memSnapshot_;
+		// When set, receives where RAM starts in the state.
+		u8 **ramPos_;
 	};
 
 	enum OperationType
@@ -77,14 +87,41 @@ namespace SaveState
 		return CChunkFileReader::SavePtr(&data[0], state);
 	}
 
+	// Also returns where RAM is in the state, for rewind.
+	static CChunkFileReader::Error SaveToRam(std::vector<u8> &data, size_t &ramOffset) {
+		u8 *ramPos = NULL;
+		SaveStart state(NULL, &ramPos);
+		size_t sz = CChunkFileReader::MeasurePtr(state);
+		if (data.size() < sz)
+			data.resize(sz);
+		CChunkFileReader::Error err = CChunkFileReader::SavePtr(&data[0], state);
+		ramOffset = ramPos - &data[0];
+		return err;
+	}
+
 	CChunkFileReader::Error LoadFromRam(std::vector<u8> &data) {
 		SaveStart state;
 		return CChunkFileReader::LoadPtr(&data[0], state);
 	}
 
+	CChunkFileReader::Error SaveToSnapshot(Snapshot &snapshot) {
+		SaveStart state(&snapshot.memory);
+		size_t sz = CChunkFileReader::MeasurePtr(state);
+		if (snapshot.state.size() < sz)
+			snapshot.state.resize(sz);
+		return CChunkFileReader::SavePtr(&snapshot.state[0], state);
+	}
+
+	CChunkFileReader::Error LoadFromSnapshot(Snapshot &snapshot) {
+		if (snapshot.state.empty())
+			return CChunkFileReader::ERROR_BAD_FILE;
+		SaveStart state(&snapshot.memory);
+		return CChunkFileReader::LoadPtr(&snapshot.state[0], state);
+	}
+
 	struct StateRingbuffer
 	{
-		StateRingbuffer(int size) : first_(0), next_(0), size_(size), base_(-1)
+		StateRingbuffer(int size) : first_(0), next_(0), size_(size), base_(-1), baseRamOffset_(0), baseGeneration_(0)
 		{
 			states_.resize(size);
 			baseMapping_.resize(size);
@@ -99,20 +136,25 @@ namespace SaveState
 			static std::vector<u8> buffer;
 			std::vector<u8> *compressBuffer = &buffer;
 			CChunkFileReader::Error err;
+			size_t ramOffset;
 
 			if (base_ == -1 || ++baseUsage_ > BASE_USAGE_INTERVAL)
 			{
 				base_ = (base_ + 1) % ARRAY_SIZE(bases_);
 				baseUsage_ = 0;
-				err = SaveToRam(bases_[base_]);
+				// From here on, RAM pages not written since still match the new base.
+				baseGeneration_ = Memory::NextDirtyGeneration(Memory::DIRTY_REWIND);
+				Memory::StampDirtyRange(Memory::DIRTY_REWIND, PSP_GetKernelMemoryBase(), Memory::g_MemorySize, baseGeneration_);
+				err = SaveToRam(bases_[base_], ramOffset);
+				baseRamOffset_ = ramOffset;
 				// Let's not bother savestating twice.
 				compressBuffer = &bases_[base_];
 			}
 			else
-				err = SaveToRam(buffer);
+				err = SaveToRam(buffer, ramOffset);
 
 			if (err == CChunkFileReader::ERROR_NONE)
-				Compress(states_[n], *compressBuffer, bases_[base_]);
+				Compress(states_[n], *compressBuffer, bases_[base_], ramOffset);
 			else
 				states_[n].clear();
 			baseMapping_[n] = base_;
@@ -134,12 +176,28 @@ namespace SaveState
 			return LoadFromRam(buffer);
 		}
 
-		void Compress(std::vector<u8> &result, const std::vector<u8> &state, const std::vector<u8> &base)
+		void Compress(std::vector<u8> &result, const std::vector<u8> &state, const std::vector<u8> &base, size_t ramOffset)
 		{
+			// If RAM is at the same place as in the base, unwritten pages can't differ from it.
+			const bool ramMatchesBase = ramOffset == baseRamOffset_ && Memory::IsDirtyTracking();
+			const size_t ramEnd = ramOffset + Memory::g_MemorySize;
+
 			result.clear();
 			for (size_t i = 0; i < state.size(); i += BLOCK_SIZE)
 			{
 				int blockSize = std::min(BLOCK_SIZE, (int)(state.size() - i));
+				if (ramMatchesBase && i >= ramOffset && i + blockSize <= ramEnd && i + blockSize <= base.size())
+				{
+					u32 address = PSP_GetKernelMemoryBase() + (u32)(i - ramOffset);
+					bool skip = !Memory::HasRangeChanged(Memory::DIRTY_REWIND, address, blockSize, baseGeneration_);
+					Memory::NoteDirtyCheck(Memory::DIRTY_REWIND, blockSize, skip);
+					if (skip)
+					{
+						result.push_back(0);
+						continue;
+					}
+				}
+
 				if (i + blockSize > base.size() || memcmp(&state[i], &base[i], blockSize) != 0)
 				{
 					result.push_back(1);
@@ -198,6 +256,8 @@ namespace SaveState
 		std::vector<int> baseMapping_;
 		int base_;
 		int baseUsage_;
+		size_t baseRamOffset_;
+		u32 baseGeneration_;
 	};
 
 	static bool needsProcess = false;
@@ -227,11 +287,11 @@ namespace SaveState
 		{
 			auto blocks = MIPSComp::jit->GetBlockCache();
 			auto saved = blocks->SaveAndClearEmuHackOps();
-			Memory::DoState(p);
+			DoMemoryState(p);
 			blocks->RestoreSavedEmuHackOps(saved);
 		}
 		else
-			Memory::DoState(p);
+			DoMemoryState(p);
 
 		MemoryStick_DoState(p);
 		currentMIPS->DoState(p);
@@ -241,6 +301,24 @@ namespace SaveState
 		pspFileSystem.DoState(p);
 	}
 
+	void SaveStart::DoMemoryState(PointerWrap &p)
+	{
+		if (!memSnapshot_)
+		{
+			Memory::DoState(p, true, ramPos_);
+			return;
+		}
+
+		Memory::DoState(p, false);
+		bool success = true;
+		if (p.mode == p.MODE_WRITE)
+			success = Memory::CaptureSnapshot(*memSnapshot_);
+		else if (p.mode == p.MODE_READ)
+			success = Memory::RestoreSnapshot(*memSnapshot_);
+		if (!success)
+			p.SetError(p.ERROR_FAILURE);
+	}
+
 	void Enqueue(SaveState::Operation op)
 	{
 		std::lock_guard<std::recursive_mutex> guard(mutex);
@@ -535,6 +613,10 @@ namespace SaveState
 				break;
 			}
 
+			// The movie's input wouldn't line up with the loaded state.
+			if (callbackResult && (op.type == SAVESTATE_LOAD || op.type == SAVESTATE_REWIND) && InputMovie::IsActive())
+				InputMovie::Stop();
+
 			if (op.callback)
 				op.callback(callbackResult, op.cbUserData);
 		}
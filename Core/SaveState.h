@@ -15,9 +15,12 @@
 // Official git repository and contact information can be found at
 // https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
 
+#pragma once
+
 #include <string>
 
 #include "ChunkFile.h"
+#include "Core/MemSnapshot.h"
 
 namespace SaveState
 {
@@ -52,6 +55,16 @@ namespace SaveState
 	CChunkFileReader::Error SaveToRam(std::vector<u8> &state);
 	CChunkFileReader::Error LoadFromRam(std::vector<u8> &state);
 
+	// Like the above, but memory is kept as pages shared between snapshots, so saving only
+	// copies what changed since the last save, and loading only what differs.  Cheap to copy,
+	// which is a handy way to fork a session.  Only lives in RAM, never written to disk.
+	struct Snapshot {
+		Memory::Snapshot memory;
+		std::vector<u8> state;
+	};
+	CChunkFileReader::Error SaveToSnapshot(Snapshot &snapshot);
+	CChunkFileReader::Error LoadFromSnapshot(Snapshot &snapshot);
+
 	// For testing / automated tests.  Runs a save state verification pass (async.)
 	// Warning: callback will be called on a different thread.
 	void Verify(Callback callback = 0, void *cbUserData = 0);
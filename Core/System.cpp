@@ -22,6 +22,8 @@
 #include <codecvt>
 #endif
 
+#include <ctime>
+
 #include "native/thread/thread.h"
 #include "native/thread/threadutil.h"
 #include "native/base/mutex.h"
@@ -34,6 +36,7 @@
 #include "Core/MIPS/JitCommon/JitCommon.h"
 
 #include "Core/Host.h"
+#include "Core/InputMovie.h"
 #include "Core/System.h"
 #include "Core/PSPMixer.h"
 #include "Core/HLE/HLE.h"
@@ -50,6 +53,7 @@
 #include "Core/PSPLoaders.h"
 #include "Core/ELF/ParamSFO.h"
 #include "Core/SaveState.h"
+#include "Common/FileUtil.h"
 #include "Common/LogManager.h"
 
 #include "GPU/GPUState.h"
@@ -157,10 +161,27 @@ void CPU_WaitStatus(condition_variable &cond, bool (*pred)()) {
 
 void CPU_Shutdown();
 
+static std::string InputMovieFilename() {
+	char timestamp[32];
+	time_t now = time(NULL);
+	strftime(timestamp, sizeof(timestamp), "%Y%m%d-%H%M%S", localtime(&now));
+
+	const std::string dir = GetSysDirectory(DIRECTORY_SYSTEM) + "MOVIES/";
+	File::CreateFullPath(dir);
+	return dir + g_paramSFO.GetValueString("DISC_ID") + "_" + timestamp + ".ppmv";
+}
+
 void CPU_Init() {
 	coreState = CORE_POWERUP;
 	currentMIPS = &mipsr4k;
 
+	// Movies play from boot, so this has to be ready before anything is set up.
+	if (!coreParameter.inputMoviePlay.empty() && !InputMovie::StartPlayback(coreParameter.inputMoviePlay, &coreParameter.errorString)) {
+		coreParameter.fileToStart = "";
+		CPU_SetState(CPU_THREAD_NOT_RUNNING);
+		return;
+	}
+
 	// Default memory settings
 	// Seems to be the safest place currently..
 	if (g_Config.iPSPModel == PSP_MODEL_FAT)
@@ -189,6 +210,12 @@ void CPU_Init() {
 	}
 
 	Memory::Init();
+	// Only the interpreter and the x86 jit mark their stores.
+	bool trackDirty = g_Config.bTrackDirtyPages;
+#if !defined(_M_IX86) && !defined(_M_X64)
+	trackDirty = trackDirty && coreParameter.cpuCore == CPU_INTERPRETER;
+#endif
+	Memory::SetDirtyTracking(trackDirty);
 	mipsr4k.Reset();
 
 	host->AttemptLoadSymbolMap();
@@ -217,6 +244,16 @@ void CPU_Init() {
 		g_Config.AddRecent(filename);
 	}
 
+	if (coreParameter.inputMoviePlay.empty()) {
+		if (!coreParameter.inputMovieRecord.empty()) {
+			InputMovie::StartRecording(coreParameter.inputMovieRecord);
+		} else if (g_Config.bRecordInputMovie && !coreParameter.headLess) {
+			InputMovie::StartRecording(InputMovieFilename());
+		}
+	}
+	// The game hasn't run yet, so this is still boot as far as it knows.
+	InputMovie::Begin();
+
 	coreState = coreParameter.startPaused ? CORE_STEPPING : CORE_RUNNING;
 }
 
@@ -226,6 +263,7 @@ void CPU_Shutdown() {
 	}
 
 	Replacement_Shutdown();
+	InputMovie::Stop();
 
 	CoreTiming::Shutdown();
 	__KernelShutdown();
@@ -14,17 +14,46 @@
 
 // Official git repository and contact information can be found at
 // https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
-
 #pragma once
 
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <vector>
+
 #include "native/base/mutex.h"
+#include "native/base/timeutil.h"
 #include "Core/System.h"
 #include "Core/CoreTiming.h"
-#include <deque>
 
+struct ThreadEventQueueStats {
+	// Events scheduled, not counting syncs.
+	u32 events;
+	// Times a producer found the consumer asleep and had to signal it.
+	u32 wakeups;
+	// Events that didn't fit in the ring and went through the locked fallback.
+	u32 overflows;
+	// SyncThread() calls, and the time spent waiting in them.
+	u32 syncs;
+	double syncSeconds;
+	// Time since the stats were last reset.
+	double seconds;
+};
+
+// Events go through a fixed size ring that any thread can push to without locking.  Only one
+// thread (the event loop) ever pops.  The lock is only taken to sleep and wake up, so a busy
+// queue drains a whole batch of events per wakeup instead of signalling on every push.
 template <typename B, typename Event, typename EventType, EventType EVENT_INVALID, EventType EVENT_SYNC, EventType EVENT_FINISH>
 struct ThreadEventQueue : public B {
-	ThreadEventQueue() : threadEnabled_(false), eventsRunning_(false), eventsHaveRun_(false) {
+	ThreadEventQueue() : threadEnabled_(false), eventsRunning_(false), eventsHaveRun_(false), ring_(RING_SIZE, Event(EVENT_INVALID)), ringSeq_(RING_SIZE) {
+		for (size_t i = 0; i < RING_SIZE; ++i) {
+			ringSeq_[i] = i;
+		}
+		pushPos_ = 0;
+		popPos_ = 0;
+		overflowing_ = false;
+		consumerWaiting_ = false;
+		ResetQueueStats();
 	}
 
 	void SetThreadEnabled(bool threadEnabled) {
@@ -36,9 +65,25 @@ struct ThreadEventQueue : public B {
 	}
 
 	void ScheduleEvent(Event ev) {
-		{
+		if (EventType(ev) != EVENT_SYNC) {
+			statEvents_++;
+		}
+
+		// Once anything has overflowed, keep using the overflow until it drains, to stay in order.
+		if (overflowing_ || !TryPush(ev)) {
 			lock_guard guard(eventsLock_);
-			events_.push_back(ev);
+			if (overflowing_ || !TryPush(ev)) {
+				overflow_.push_back(ev);
+				overflowing_ = true;
+				statOverflows_++;
+			}
+		}
+
+		// Pairs with the fence in WaitForEvents(), so either we see the consumer waiting, or it sees our event.
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if (consumerWaiting_.load(std::memory_order_relaxed)) {
+			lock_guard guard(eventsLock_);
+			statWakeups_++;
 			eventsWait_.notify_one();
 		}
 
@@ -48,8 +93,13 @@ struct ThreadEventQueue : public B {
 	}
 
 	bool HasEvents() {
-		lock_guard guard(eventsLock_);
-		return !events_.empty();
+		if (overflowing_) {
+			return true;
+		}
+		// Read the pop side first, so a stale value can only claim events that are gone, never miss any.
+		// A pushed event counts as soon as its slot is claimed, even if it isn't written yet.
+		const size_t popped = popPos_.load();
+		return pushPos_.load() != popped;
 	}
 
 	void NotifyDrain() {
@@ -57,26 +107,43 @@ struct ThreadEventQueue : public B {
 		eventsDrain_.notify_one();
 	}
 
+	// Only the event loop thread may call this.
 	Event GetNextEvent() {
-		lock_guard guard(eventsLock_);
-		if (events_.empty()) {
-			NotifyDrain();
-			return EVENT_INVALID;
+		Event ev(EVENT_INVALID);
+		if (TryPop(ev)) {
+			return ev;
+		}
+
+		if (overflowing_) {
+			lock_guard guard(eventsLock_);
+			// Anything pushed to the ring before the overflow started must come first.
+			if (TryPop(ev)) {
+				return ev;
+			}
+			if (!overflow_.empty()) {
+				ev = overflow_.front();
+				overflow_.pop_front();
+				if (overflow_.empty()) {
+					overflowing_ = false;
+				}
+				return ev;
+			}
+			overflowing_ = false;
 		}
 
-		Event ev = events_.front();
-		events_.pop_front();
-		return ev;
+		NotifyDrain();
+		return EVENT_INVALID;
 	}
 
 	void RunEventsUntil(u64 globalticks) {
-		lock_guard guard(eventsLock_);
-		eventsRunning_ = true;
-		eventsHaveRun_ = true;
+		{
+			lock_guard guard(eventsLock_);
+			eventsRunning_ = true;
+			eventsHaveRun_ = true;
+		}
 
 		do {
 			for (Event ev = GetNextEvent(); EventType(ev) != EVENT_INVALID; ev = GetNextEvent()) {
-				eventsLock_.unlock();
 				switch (EventType(ev)) {
 				case EVENT_FINISH:
 					// Stop waiting.
@@ -89,7 +156,6 @@ struct ThreadEventQueue : public B {
 				default:
 					ProcessEvent(ev);
 				}
-				eventsLock_.lock();
 			}
 
 			// Quit the loop if the queue is drained and coreState has tripped, or threading is disabled.
@@ -97,14 +163,12 @@ struct ThreadEventQueue : public B {
 				break;
 			}
 
-			// coreState changes won't wake us, so recheck periodically.
-			if (!HasEvents()) {
-				eventsWait_.wait(eventsLock_);
-			}
+			WaitForEvents();
 		} while (CoreTiming::GetTicks() < globalticks);
 
+		lock_guard guard(eventsLock_);
 		// This will force the waiter to check coreState, even if we didn't actually drain.
-		NotifyDrain();
+		eventsDrain_.notify_one();
 		eventsRunning_ = false;
 	}
 
@@ -120,12 +184,15 @@ struct ThreadEventQueue : public B {
 		}
 
 		lock_guard guard(eventsLock_);
+		const double start = real_time_now();
 		// While processing the last event, HasEvents() will be false even while not done.
 		// So we schedule a nothing event and wait for that to finish.
 		ScheduleEvent(EVENT_SYNC);
 		while (HasEvents() && (eventsRunning_ || !eventsHaveRun_) && (force || coreState == CORE_RUNNING)) {
 			eventsDrain_.wait(eventsLock_);
 		}
+		statSyncs_++;
+		statSyncSeconds_ += real_time_now() - start;
 	}
 
 	void FinishEventLoop() {
@@ -138,15 +205,108 @@ struct ThreadEventQueue : public B {
 		}
 	}
 
+	void GetQueueStats(ThreadEventQueueStats &stats, bool reset) {
+		lock_guard guard(eventsLock_);
+		stats.events = statEvents_;
+		stats.wakeups = statWakeups_;
+		stats.overflows = statOverflows_;
+		stats.syncs = statSyncs_;
+		stats.syncSeconds = statSyncSeconds_;
+		stats.seconds = real_time_now() - statStart_;
+		if (reset) {
+			ResetQueueStats();
+		}
+	}
+
+	void ResetQueueStats() {
+		lock_guard guard(eventsLock_);
+		statEvents_ = 0;
+		statWakeups_ = 0;
+		statOverflows_ = 0;
+		statSyncs_ = 0;
+		statSyncSeconds_ = 0.0;
+		statStart_ = real_time_now();
+	}
+
 protected:
 	virtual void ProcessEvent(Event ev) = 0;
 	virtual bool ShouldExitEventLoop() = 0;
 
 private:
+	// Must be a power of 2.  Big enough that the GPU thread falling a frame behind doesn't overflow.
+	enum {
+		RING_SIZE = 1024,
+		RING_MASK = RING_SIZE - 1,
+	};
+
+	// Bounded MPMC ring (as in Vyukov's queue): each cell's sequence says whose turn it is.
+	// pos means free for the pusher at pos, pos + 1 means full for the popper at pos.
+	bool TryPush(const Event &ev) {
+		size_t pos = pushPos_.load(std::memory_order_relaxed);
+		while (true) {
+			const size_t seq = ringSeq_[pos & RING_MASK].load(std::memory_order_acquire);
+			const ptrdiff_t diff = (ptrdiff_t)seq - (ptrdiff_t)pos;
+			if (diff == 0) {
+				if (pushPos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+					break;
+				}
+			} else if (diff < 0) {
+				// Full.
+				return false;
+			} else {
+				pos = pushPos_.load(std::memory_order_relaxed);
+			}
+		}
+
+		ring_[pos & RING_MASK] = ev;
+		ringSeq_[pos & RING_MASK].store(pos + 1, std::memory_order_release);
+		return true;
+	}
+
+	bool TryPop(Event &ev) {
+		const size_t pos = popPos_.load(std::memory_order_relaxed);
+		if (ringSeq_[pos & RING_MASK].load(std::memory_order_acquire) != pos + 1) {
+			return false;
+		}
+
+		ev = ring_[pos & RING_MASK];
+		popPos_.store(pos + 1);
+		ringSeq_[pos & RING_MASK].store(pos + RING_SIZE, std::memory_order_release);
+		return true;
+	}
+
+	void WaitForEvents() {
+		lock_guard guard(eventsLock_);
+		consumerWaiting_.store(true, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		// coreState changes won't wake us, so recheck periodically.
+		if (!HasEvents()) {
+			eventsWait_.wait(eventsLock_);
+		}
+		consumerWaiting_.store(false, std::memory_order_relaxed);
+	}
+
 	bool threadEnabled_;
 	bool eventsRunning_;
 	bool eventsHaveRun_;
-	std::deque<Event> events_;
+
+	std::vector<Event> ring_;
+	std::vector<std::atomic<size_t> > ringSeq_;
+	std::atomic<size_t> pushPos_;
+	std::atomic<size_t> popPos_;
+	std::atomic<bool> consumerWaiting_;
+	// Protected by eventsLock_, only used when the ring is full.
+	std::deque<Event> overflow_;
+	std::atomic<bool> overflowing_;
+
+	std::atomic<u32> statEvents_;
+	// Protected by eventsLock_.
+	u32 statWakeups_;
+	u32 statOverflows_;
+	u32 statSyncs_;
+	double statSyncSeconds_;
+	double statStart_;
+
 	recursive_mutex eventsLock_;
 	condition_variable eventsWait_;
 	condition_variable eventsDrain_;
@@ -0,0 +1,436 @@
+// Copyright (c) 2012- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <vector>
+
+#include "base/mutex.h"
+#include "Common/FileUtil.h"
+#include "Common/Log.h"
+#include "Core/MemMap.h"
+#include "ext/xxhash.h"
+#include "GPU/ge_constants.h"
+#include "GPU/GPUInterface.h"
+#include "GPU/GPUState.h"
+#include "GPU/Common/GPUDebugInterface.h"
+#include "GPU/Common/TextureDecoder.h"
+#include "GPU/Common/VertexDecoderCommon.h"
+#include "GPU/Debugger/Record.h"
+
+namespace GPURecord {
+
+// File layout: CaptureHeader, the starting GPUgstate, commandCount Commands, then dataSize bytes they point into.
+// Like savestates, this is in host byte order and not meant to be portable between versions.
+static const char CAPTURE_MAGIC[8] = { 'P', 'P', 'S', 'S', 'P', 'P', 'G', 'E' };
+static const u32 CAPTURE_VERSION = 1;
+
+enum CommandType {
+	// u32 GE ops, to run in order.
+	COMMAND_OPS = 1,
+	// A u32 address followed by the bytes to write there.
+	COMMAND_MEMORY = 2,
+};
+
+#pragma pack(push, 1)
+struct CaptureHeader {
+	char magic[8];
+	u32 version;
+	u32 gstateSize;
+	u32 commandCount;
+	u32 dataSize;
+	u32 displayFramebuf;
+	u32 displayStride;
+	u32 displayFormat;
+	u32 vertexAddr;
+	u32 indexAddr;
+};
+
+struct Command {
+	u32 type;
+	u32 size;
+	u32 ptr;
+};
+#pragma pack(pop)
+
+struct MemoryWrite {
+	u32 size;
+	u32 hash;
+};
+
+static recursive_mutex recordLock;
+static std::string pendingFilename;
+static std::string captureFilename;
+static bool active = false;
+
+static CaptureHeader header;
+static GPUgstate startState;
+static std::vector<Command> commands;
+static std::vector<u8> pushbuf;
+// Last bytes captured at each address, so unchanged data is only stored once.
+static std::map<u32, MemoryWrite> lastWrites;
+
+static bool replayLoaded = false;
+
+static void EmitOp(u32 op) {
+	if (commands.empty() || commands.back().type != COMMAND_OPS || commands.back().ptr + commands.back().size != pushbuf.size()) {
+		Command cmd = { COMMAND_OPS, 0, (u32)pushbuf.size() };
+		commands.push_back(cmd);
+	}
+
+	pushbuf.resize(pushbuf.size() + sizeof(op));
+	memcpy(&pushbuf[pushbuf.size() - sizeof(op)], &op, sizeof(op));
+	commands.back().size += sizeof(op);
+}
+
+static void EmitMemory(u32 addr, u32 size) {
+	if (size == 0 || !Memory::IsValidAddress(addr) || !Memory::IsValidAddress(addr + size - 1)) {
+		return;
+	}
+
+	const u8 *data = Memory::GetPointerUnchecked(addr);
+	const u32 hash = XXH32(data, size, 0x6A9E1C3D);
+	auto last = lastWrites.find(addr);
+	if (last != lastWrites.end() && last->second.size == size && last->second.hash == hash) {
+		return;
+	}
+	MemoryWrite &write = lastWrites[addr];
+	write.size = size;
+	write.hash = hash;
+
+	Command cmd = { COMMAND_MEMORY, (u32)sizeof(addr) + size, (u32)pushbuf.size() };
+	commands.push_back(cmd);
+	pushbuf.resize(pushbuf.size() + sizeof(addr) + size);
+	memcpy(&pushbuf[cmd.ptr], &addr, sizeof(addr));
+	memcpy(&pushbuf[cmd.ptr + sizeof(addr)], data, size);
+}
+
+static u32 AlignUp(u32 size, u32 align) {
+	return align == 0 ? size : (size + align - 1) & ~(align - 1);
+}
+
+// The size in PSP memory of one vertex, same rules as the vertex decoders.
+static u32 VertexSize(u32 vertType) {
+	static const u8 tcsize[4] = {0,2,4,8}, tcalign[4] = {0,1,2,4};
+	static const u8 colsize[8] = {0,0,0,0,2,2,2,4}, colalign[8] = {0,0,0,0,2,2,2,4};
+	static const u8 nrmsize[4] = {0,3,6,12}, nrmalign[4] = {0,1,2,4};
+	static const u8 possize[4] = {0,3,6,12}, posalign[4] = {0,1,2,4};
+	static const u8 wtsize[4] = {0,1,2,4}, wtalign[4] = {0,1,2,4};
+
+	const int tc = vertType & GE_VTYPE_TC_MASK;
+	const int col = (vertType & GE_VTYPE_COL_MASK) >> 2;
+	const int nrm = (vertType & GE_VTYPE_NRM_MASK) >> 5;
+	const int pos = (vertType & GE_VTYPE_POS_MASK) >> 7;
+	const int weighttype = (vertType & GE_VTYPE_WEIGHT_MASK) >> 9;
+	const int nweights = ((vertType & GE_VTYPE_WEIGHTCOUNT_MASK) >> GE_VTYPE_WEIGHTCOUNT_SHIFT) + 1;
+	const int morphcount = ((vertType & GE_VTYPE_MORPHCOUNT_MASK) >> GE_VTYPE_MORPHCOUNT_SHIFT) + 1;
+
+	u32 size = wtsize[weighttype] * nweights;
+	u32 biggest = wtalign[weighttype];
+	if (tc) {
+		size = AlignUp(size, tcalign[tc]) + tcsize[tc];
+		biggest = std::max(biggest, (u32)tcalign[tc]);
+	}
+	if (col) {
+		size = AlignUp(size, colalign[col]) + colsize[col];
+		biggest = std::max(biggest, (u32)colalign[col]);
+	}
+	if (nrm) {
+		size = AlignUp(size, nrmalign[nrm]) + nrmsize[nrm];
+		biggest = std::max(biggest, (u32)nrmalign[nrm]);
+	}
+	size = AlignUp(size, posalign[pos]) + possize[pos];
+	biggest = std::max(biggest, (u32)posalign[pos]);
+
+	return AlignUp(size, biggest) * morphcount;
+}
+
+static void CaptureTextures() {
+	const GETextureFormat format = gstate.getTextureFormat();
+	const u32 bpp = textureBitsPerPixel[format];
+	if (bpp == 0) {
+		return;
+	}
+
+	const int maxLevel = (gstate.texmode >> 16) & 7;
+	for (int level = 0; level <= maxLevel; ++level) {
+		const u32 addr = gstate.getTextureAddress(level);
+		const u32 bufw = GetTextureBufw(level, addr, format);
+		EmitMemory(addr, bufw * gstate.getTextureHeight(level) * bpp / 8);
+	}
+}
+
+static void CaptureDraw(u32 op) {
+	const u32 cmd = op >> 24;
+	const int count = cmd == GE_CMD_PRIM ? (op & 0xFFFF) : (op & 0xFF) * ((op >> 8) & 0xFF);
+	if (count == 0) {
+		return;
+	}
+
+	const u32 vertType = gstate.vertType;
+	const u32 idx = vertType & GE_VTYPE_IDX_MASK;
+	u16 lowerBound = 0;
+	u16 upperBound = count - 1;
+	if (idx != GE_VTYPE_IDX_NONE) {
+		const u32 indexSize = idx == GE_VTYPE_IDX_16BIT ? 2 : 1;
+		if (!Memory::IsValidAddress(gstate_c.indexAddr) || !Memory::IsValidAddress(gstate_c.indexAddr + count * indexSize - 1)) {
+			return;
+		}
+		GetIndexBounds(Memory::GetPointerUnchecked(gstate_c.indexAddr), count, vertType, &lowerBound, &upperBound);
+		EmitMemory(gstate_c.indexAddr, count * indexSize);
+	}
+	EmitMemory(gstate_c.vertexAddr, (upperBound + 1) * VertexSize(vertType));
+
+	if (gstate.isTextureMapEnabled() && !gstate.isModeClear()) {
+		CaptureTextures();
+	}
+}
+
+static void CaptureTransfer() {
+	const u32 bpp = gstate.getTransferBpp();
+	const u32 stride = gstate.getTransferSrcStride();
+	const u32 start = gstate.getTransferSrcAddress() + (gstate.getTransferSrcY() * stride + gstate.getTransferSrcX()) * bpp;
+	const u32 size = ((gstate.getTransferHeight() - 1) * stride + gstate.getTransferWidth()) * bpp;
+	EmitMemory(start, size);
+}
+
+static void BeginCapture() {
+	captureFilename = pendingFilename;
+	pendingFilename.clear();
+
+	commands.clear();
+	pushbuf.clear();
+	lastWrites.clear();
+
+	memcpy(&startState, &gstate, sizeof(startState));
+	memset(&header, 0, sizeof(header));
+	header.vertexAddr = gstate_c.vertexAddr;
+	header.indexAddr = gstate_c.indexAddr;
+
+	// The CLUT may have been loaded in an earlier frame, so load it again at the start.
+	if (gstate.getClutLoadBytes() != 0) {
+		EmitMemory(gstate.getClutAddress(), gstate.getClutLoadBytes());
+		EmitOp(gstate.cmdmem[GE_CMD_LOADCLUT]);
+	}
+
+	active = true;
+	NOTICE_LOG(G3D, "Capturing the next frame to %s", captureFilename.c_str());
+}
+
+static void FinishCapture(u32 displayFramebuf, u32 displayStride, int displayFormat) {
+	active = false;
+
+	memcpy(header.magic, CAPTURE_MAGIC, sizeof(header.magic));
+	header.version = CAPTURE_VERSION;
+	header.gstateSize = sizeof(GPUgstate);
+	header.commandCount = (u32)commands.size();
+	header.dataSize = (u32)pushbuf.size();
+	header.displayFramebuf = displayFramebuf;
+	header.displayStride = displayStride;
+	header.displayFormat = displayFormat;
+
+	FILE *f = File::OpenCFile(captureFilename, "wb");
+	bool success = f != NULL;
+	if (success) {
+		success = fwrite(&header, sizeof(header), 1, f) == 1;
+		success = success && fwrite(&startState, sizeof(startState), 1, f) == 1;
+		success = success && (commands.empty() || fwrite(&commands[0], sizeof(Command), commands.size(), f) == commands.size());
+		success = success && (pushbuf.empty() || fwrite(&pushbuf[0], 1, pushbuf.size(), f) == pushbuf.size());
+		fclose(f);
+	}
+
+	if (success) {
+		NOTICE_LOG(G3D, "Wrote GE capture to %s: %d commands, %d bytes of data", captureFilename.c_str(), (int)commands.size(), (int)pushbuf.size());
+	} else {
+		ERROR_LOG(G3D, "Unable to write GE capture to %s", captureFilename.c_str());
+	}
+
+	commands.clear();
+	pushbuf.clear();
+	lastWrites.clear();
+}
+
+void Activate(const std::string &filename) {
+	lock_guard guard(recordLock);
+	pendingFilename = filename;
+}
+
+bool IsActive() {
+	return active;
+}
+
+void NotifyCommand(u32 op) {
+	if (!active) {
+		return;
+	}
+
+	const u32 cmd = op >> 24;
+	switch (cmd) {
+	case GE_CMD_VADDR:
+	case GE_CMD_IADDR:
+		{
+			// The base and offset don't survive flattening the lists, so store the final address.
+			const u32 addr = gstate_c.getRelativeAddress(op & 0x00FFFFFF);
+			EmitOp((GE_CMD_BASE << 24) | ((addr >> 8) & 0x000F0000));
+			EmitOp((cmd << 24) | (addr & 0x00FFFFFF));
+		}
+		break;
+
+	// Control flow has already happened by the time we see the op, so the capture is one flat list.
+	case GE_CMD_BASE:
+	case GE_CMD_ORIGIN:
+	case GE_CMD_OFFSETADDR:
+	case GE_CMD_JUMP:
+	case GE_CMD_BJUMP:
+	case GE_CMD_BOUNDINGBOX:
+	case GE_CMD_CALL:
+	case GE_CMD_RET:
+	case GE_CMD_SIGNAL:
+	case GE_CMD_FINISH:
+	case GE_CMD_END:
+		break;
+
+	case GE_CMD_PRIM:
+	case GE_CMD_BEZIER:
+	case GE_CMD_SPLINE:
+		CaptureDraw(op);
+		EmitOp(op);
+		break;
+
+	case GE_CMD_LOADCLUT:
+		EmitMemory(gstate.getClutAddress(), gstate.getClutLoadBytes());
+		EmitOp(op);
+		break;
+
+	case GE_CMD_TRANSFERSTART:
+		CaptureTransfer();
+		EmitOp(op);
+		break;
+
+	default:
+		EmitOp(op);
+		break;
+	}
+}
+
+void NotifyBeginFrame(u32 displayFramebuf, u32 displayStride, int displayFormat) {
+	lock_guard guard(recordLock);
+	if (!active && pendingFilename.empty()) {
+		return;
+	}
+
+	// Lists run on the GPU thread, make sure the previous frame is entirely done.
+	// This is called during a flip, when coreState isn't CORE_RUNNING, so force it.
+	gpu->SyncThread(true);
+	if (active) {
+		FinishCapture(displayFramebuf, displayStride, displayFormat);
+	}
+	if (!pendingFilename.empty()) {
+		BeginCapture();
+	}
+}
+
+bool LoadCapture(const std::string &filename) {
+	UnloadCapture();
+
+	FILE *f = File::OpenCFile(filename, "rb");
+	if (!f) {
+		ERROR_LOG(G3D, "Unable to open GE capture %s", filename.c_str());
+		return false;
+	}
+
+	bool success = fread(&header, sizeof(header), 1, f) == 1;
+	if (success && (memcmp(header.magic, CAPTURE_MAGIC, sizeof(header.magic)) != 0 || header.version != CAPTURE_VERSION || header.gstateSize != sizeof(GPUgstate))) {
+		ERROR_LOG(G3D, "GE capture %s is not a compatible capture (version %d)", filename.c_str(), header.version);
+		fclose(f);
+		return false;
+	}
+	success = success && fread(&startState, sizeof(startState), 1, f) == 1;
+	if (success) {
+		commands.resize(header.commandCount);
+		pushbuf.resize(header.dataSize);
+		success = commands.empty() || fread(&commands[0], sizeof(Command), commands.size(), f) == commands.size();
+		success = success && (pushbuf.empty() || fread(&pushbuf[0], 1, pushbuf.size(), f) == pushbuf.size());
+	}
+	fclose(f);
+
+	for (size_t i = 0; success && i < commands.size(); ++i) {
+		success = commands[i].ptr <= pushbuf.size() && commands[i].size <= pushbuf.size() - commands[i].ptr;
+	}
+	if (!success) {
+		ERROR_LOG(G3D, "GE capture %s is truncated or corrupt", filename.c_str());
+		UnloadCapture();
+		return false;
+	}
+
+	replayLoaded = true;
+	return true;
+}
+
+bool ReplayCapture() {
+	if (!replayLoaded) {
+		return false;
+	}
+
+	memcpy(&gstate, &startState, sizeof(gstate));
+	gstate_c.vertexAddr = header.vertexAddr;
+	gstate_c.indexAddr = header.indexAddr;
+	gstate_c.offsetAddr = 0;
+	gpu->ReapplyGfxState();
+
+	for (size_t i = 0; i < commands.size(); ++i) {
+		const Command &cmd = commands[i];
+		const u8 *data = &pushbuf[0] + cmd.ptr;
+		switch (cmd.type) {
+		case COMMAND_OPS:
+			for (u32 pos = 0; pos + sizeof(u32) <= cmd.size; pos += sizeof(u32)) {
+				u32 op;
+				memcpy(&op, data + pos, sizeof(op));
+				gpuDebug->SetCmdValue(op);
+			}
+			break;
+
+		case COMMAND_MEMORY:
+			if (cmd.size > sizeof(u32)) {
+				u32 addr;
+				memcpy(&addr, data, sizeof(addr));
+				const u32 size = cmd.size - sizeof(addr);
+				if (Memory::IsValidAddress(addr) && Memory::IsValidAddress(addr + size - 1)) {
+					memcpy(Memory::GetPointerUnchecked(addr), data + sizeof(addr), size);
+				}
+			}
+			break;
+
+		default:
+			ERROR_LOG(G3D, "Unknown GE capture command type %d", cmd.type);
+			break;
+		}
+	}
+
+	gpu->SetDisplayFramebuffer(header.displayFramebuf, header.displayStride, (GEBufferFormat)header.displayFormat);
+	gpu->CopyDisplayToOutput();
+	return true;
+}
+
+void UnloadCapture() {
+	replayLoaded = false;
+	commands.clear();
+	pushbuf.clear();
+}
+
+};
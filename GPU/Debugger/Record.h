@@ -0,0 +1,41 @@
+// Copyright (c) 2012- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#pragma once
+
+#include <string>
+
+#include "Common/CommonTypes.h"
+
+// Captures one frame of GE commands, along with the vertex, index, texture, CLUT and transfer
+// memory they read, so it can be replayed on any backend without the game.
+namespace GPURecord {
+	// Starts capturing at the next frame, and writes filename when that frame ends.
+	void Activate(const std::string &filename);
+	bool IsActive();
+
+	// Called from the GPU's (slow) run loop, after gstate is updated but before the op executes.
+	void NotifyCommand(u32 op);
+	// Called between frames with the framebuffer being displayed.
+	void NotifyBeginFrame(u32 displayFramebuf, u32 displayStride, int displayFormat);
+
+	// Memory and the gpu must already be initialized to replay.
+	bool LoadCapture(const std::string &filename);
+	// Runs the whole captured frame once, ending with CopyDisplayToOutput().
+	bool ReplayCapture();
+	void UnloadCapture();
+};
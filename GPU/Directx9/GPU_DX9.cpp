@@ -42,13 +42,6 @@
 
 namespace DX9 {
 
-enum {
-	FLAG_FLUSHBEFORE = 1,
-	FLAG_FLUSHBEFOREONCHANGE = 2,
-	FLAG_EXECUTE = 4,  // needs to actually be executed. unused for now.
-	FLAG_EXECUTEONCHANGE = 8,  // unused for now. not sure if checking for this will be more expensive than doing it.
-};
-
 struct CommandTableEntry {
 	u8 cmd;
 	u8 flags;
@@ -377,8 +370,10 @@ DIRECTX9_GPU::DIRECTX9_GPU()
 
 	// Sanity check commandFlags table - no dupes please
 	std::set<u8> dupeCheck;
-	commandFlags_ = new u8[256];
-	memset(commandFlags_, 0, 256 * sizeof(bool));
+	for (int i = 0; i < 256; i++) {
+		cmdInfo_[i].flags = 0;
+		cmdInfo_[i].func = NULL;
+	}
 	for (size_t i = 0; i < ARRAY_SIZE(commandTable); i++) {
 		u8 cmd = commandTable[i].cmd;
 		if (dupeCheck.find(cmd) != dupeCheck.end()) {
@@ -386,7 +381,11 @@ DIRECTX9_GPU::DIRECTX9_GPU()
 		} else {
 			dupeCheck.insert(cmd);
 		}
-		commandFlags_[cmd] |= commandTable[i].flags;
+		cmdInfo_[cmd].flags |= commandTable[i].flags;
+		// The fast loop here has only ever executed FLAG_EXECUTE commands.
+		if (commandTable[i].flags & FLAG_EXECUTE) {
+			cmdInfo_[cmd].func = &GPUCommon::ExecuteOp;
+		}
 	}
 	// Find commands missing from the table.
 	for (int i = 0; i < 0xEF; i++) {
@@ -402,7 +401,6 @@ DIRECTX9_GPU::~DIRECTX9_GPU() {
 	framebufferManager_.DestroyAllFBOs();
 	shaderManager_->ClearCache(true);
 	delete shaderManager_;
-	delete [] commandFlags_;
 }
 
 // Needs to be called on GPU thread, not reporting thread.
@@ -528,25 +526,6 @@ void DIRECTX9_GPU::CopyDisplayToOutputInternal() {
 	gstate_c.textureChanged = true;
 }
 
-// Maybe should write this in ASM...
-void DIRECTX9_GPU::FastRunLoop(DisplayList &list) {
-	for (; downcount > 0; --downcount) {
-		u32 op = Memory::ReadUnchecked_U32(list.pc);
-		u32 cmd = op >> 24;
-		u8 cmdFlags = commandFlags_[cmd];
-		u32 diff = op ^ gstate.cmdmem[cmd];
-		// Inlined CheckFlushOp here to get rid of the dumpThisFrame_ check.
-		if ((cmdFlags & FLAG_FLUSHBEFORE) || (diff && (cmdFlags & FLAG_FLUSHBEFOREONCHANGE))) {
-			transformDraw_.Flush();
-		}		
-		gstate.cmdmem[cmd] = op;
-		if (cmdFlags & FLAG_EXECUTE)
-		ExecuteOp(op, diff);
-
-		list.pc += 4;
-	}
-}
-
 void DIRECTX9_GPU::ProcessEvent(GPUEvent ev) {
 	switch (ev.type) {
 	case GPU_EVENT_INIT_CLEAR:
@@ -571,7 +550,7 @@ void DIRECTX9_GPU::ProcessEvent(GPUEvent ev) {
 }
 
 inline void DIRECTX9_GPU::CheckFlushOp(int cmd, u32 diff) {
-	u8 cmdFlags = commandFlags_[cmd];
+	u8 cmdFlags = cmdInfo_[cmd].flags;
 	if ((cmdFlags & FLAG_FLUSHBEFORE) || (diff && (cmdFlags & FLAG_FLUSHBEFOREONCHANGE))) {
 		if (dumpThisFrame_) {
 			NOTICE_LOG(G3D, "================ FLUSH ================");
@@ -1327,6 +1306,7 @@ void DIRECTX9_GPU::DoBlockTransfer() {
 		u8 *dst = Memory::GetPointerUnchecked(dstBasePtr + ((y + dstY) * dstStride + dstX) * bpp);
 		memcpy(dst, src, width * bpp);
 	}
+	Memory::MarkDirtyRange(dstBasePtr + (dstY * dstStride + dstX) * bpp, height * dstStride * bpp);
 
 	// TODO: Notify all overlapping FBOs that they need to reload.
 
@@ -68,13 +68,12 @@ public:
 	std::vector<FramebufferInfo> GetFramebufferList();
 
 protected:
-	virtual void FastRunLoop(DisplayList &list);
 	virtual void ProcessEvent(GPUEvent ev);
-
-private:
-	void Flush() {
+	virtual void Flush() {
 		transformDraw_.Flush();
 	}
+
+private:
 	void DoBlockTransfer();
 	void ApplyDrawState(int prim);
 	void CheckFlushOp(int cmd, u32 diff);
@@ -89,8 +88,6 @@ private:
 	TransformDrawEngineDX9 transformDraw_;
 	ShaderManagerDX9 *shaderManager_;
 
-	u8 *commandFlags_;
-
 	bool resized_;
 	int lastVsync_;
 
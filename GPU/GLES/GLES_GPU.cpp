@@ -41,17 +41,11 @@
 #include "Core/HLE/sceKernelInterrupt.h"
 #include "Core/HLE/sceGe.h"
 
-enum {
-	FLAG_FLUSHBEFORE = 1,
-	FLAG_FLUSHBEFOREONCHANGE = 2,
-	FLAG_EXECUTE = 4,  // needs to actually be executed. unused for now.
-	FLAG_EXECUTEONCHANGE = 8,  // unused for now. not sure if checking for this will be more expensive than doing it.
-	FLAG_ANY_EXECUTE = 4 | 8,
-};
-
 struct CommandTableEntry {
 	u8 cmd;
 	u8 flags;
+	// Optional.  Commands with an execute flag and no handler go to ExecuteOpInternal().
+	GLES_GPU::CmdFunc func;
 };
 
 static const CommandTableEntry commandTable[] = {
@@ -300,13 +294,13 @@ static const CommandTableEntry commandTable[] = {
 	// From Common. No flushing but definitely need execute.
 	{GE_CMD_OFFSETADDR, FLAG_EXECUTE},
 	{GE_CMD_ORIGIN, FLAG_EXECUTE},  // Really?
-	{GE_CMD_PRIM, FLAG_EXECUTE},
+	{GE_CMD_PRIM, FLAG_EXECUTE, &GLES_GPU::Execute_Prim},
 	{GE_CMD_JUMP, FLAG_EXECUTE},
 	{GE_CMD_CALL, FLAG_EXECUTE},
 	{GE_CMD_RET, FLAG_EXECUTE},
 	{GE_CMD_END, FLAG_EXECUTE},  // Flush?
-	{GE_CMD_VADDR, FLAG_EXECUTE},
-	{GE_CMD_IADDR, FLAG_EXECUTE},
+	{GE_CMD_VADDR, FLAG_EXECUTE, &GLES_GPU::Execute_Vaddr},
+	{GE_CMD_IADDR, FLAG_EXECUTE, &GLES_GPU::Execute_Iaddr},
 	{GE_CMD_BJUMP, FLAG_EXECUTE},  // EXECUTE
 	{GE_CMD_BOUNDINGBOX, FLAG_EXECUTE}, // + FLUSHBEFORE when we implement
 
@@ -406,8 +400,10 @@ GLES_GPU::GLES_GPU()
 
 	// Sanity check commandFlags table - no dupes please
 	std::set<u8> dupeCheck;
-	commandFlags_ = new u8[256];
-	memset(commandFlags_, 0, 256 * sizeof(bool));
+	for (int i = 0; i < 256; i++) {
+		cmdInfo_[i].flags = 0;
+		cmdInfo_[i].func = NULL;
+	}
 	for (size_t i = 0; i < ARRAY_SIZE(commandTable); i++) {
 		u8 cmd = commandTable[i].cmd;
 		if (dupeCheck.find(cmd) != dupeCheck.end()) {
@@ -415,7 +411,12 @@ GLES_GPU::GLES_GPU()
 		} else {
 			dupeCheck.insert(cmd);
 		}
-		commandFlags_[cmd] |= commandTable[i].flags;
+		cmdInfo_[cmd].flags |= commandTable[i].flags;
+		if (commandTable[i].func) {
+			cmdInfo_[cmd].func = static_cast<GPUCommon::CmdFunc>(commandTable[i].func);
+		} else if (commandTable[i].flags & FLAG_ANY_EXECUTE) {
+			cmdInfo_[cmd].func = static_cast<GPUCommon::CmdFunc>(&GLES_GPU::ExecuteOpInternal);
+		}
 	}
 	// Find commands missing from the table.
 	for (int i = 0; i < 0xEF; i++) {
@@ -428,14 +429,14 @@ GLES_GPU::GLES_GPU()
 	// the tex scale/offset into the vertices anyway.
 
 	if (g_Config.bPrescaleUV) {
-		commandFlags_[GE_CMD_TEXSCALEU] &= ~FLAG_FLUSHBEFOREONCHANGE;
-		commandFlags_[GE_CMD_TEXSCALEV] &= ~FLAG_FLUSHBEFOREONCHANGE;
-		commandFlags_[GE_CMD_TEXOFFSETU] &= ~FLAG_FLUSHBEFOREONCHANGE;
-		commandFlags_[GE_CMD_TEXOFFSETV] &= ~FLAG_FLUSHBEFOREONCHANGE;
+		cmdInfo_[GE_CMD_TEXSCALEU].flags &= ~FLAG_FLUSHBEFOREONCHANGE;
+		cmdInfo_[GE_CMD_TEXSCALEV].flags &= ~FLAG_FLUSHBEFOREONCHANGE;
+		cmdInfo_[GE_CMD_TEXOFFSETU].flags &= ~FLAG_FLUSHBEFOREONCHANGE;
+		cmdInfo_[GE_CMD_TEXOFFSETV].flags &= ~FLAG_FLUSHBEFOREONCHANGE;
 	}
 
 	if (g_Config.bSoftwareSkinning) {
-		commandFlags_[GE_CMD_VERTEXTYPE] &= ~FLAG_FLUSHBEFOREONCHANGE;
+		cmdInfo_[GE_CMD_VERTEXTYPE].flags &= ~FLAG_FLUSHBEFOREONCHANGE;
 	}
 
 	BuildReportingInfo();
@@ -445,7 +446,6 @@ GLES_GPU::~GLES_GPU() {
 	framebufferManager_.DestroyAllFBOs();
 	shaderManager_->ClearCache(true);
 	delete shaderManager_;
-	delete [] commandFlags_;
 }
 
 // Let's avoid passing nulls into snprintf().
@@ -605,27 +605,6 @@ void GLES_GPU::CopyDisplayToOutputInternal() {
 	gstate_c.textureChanged = true;
 }
 
-// Maybe should write this in ASM...
-void GLES_GPU::FastRunLoop(DisplayList &list) {
-	const u8 *commandFlags = commandFlags_;
-	for (; downcount > 0; --downcount) {
-		// We know that display list PCs have the upper nibble == 0 - no need to mask the pointer
-		const u32 op = *(const u32 *)(Memory::base + list.pc);
-		const u32 cmd = op >> 24;
-		const u8 cmdFlags = commandFlags[cmd];      // If we stashed the cmdFlags in the top bits of the cmdmem, we could get away with one table lookup instead of two
-		const u32 diff = op ^ gstate.cmdmem[cmd];
-		// Inlined CheckFlushOp here to get rid of the dumpThisFrame_ check.
-		if ((cmdFlags & FLAG_FLUSHBEFORE) || (diff && (cmdFlags & FLAG_FLUSHBEFOREONCHANGE))) {
-			transformDraw_.Flush();
-		}
-		gstate.cmdmem[cmd] = op;  // TODO: no need to write if diff==0...
-		if (cmdFlags & FLAG_ANY_EXECUTE) {  // (cmdFlags & FLAG_EXECUTE) || (diff && (cmdFlags & FLAG_EXECUTEONCHANGE))) {
-			ExecuteOpInternal(op, diff);
-		}
-		list.pc += 4;
-	}
-}
-
 void GLES_GPU::ProcessEvent(GPUEvent ev) {
 	switch (ev.type) {
 	case GPU_EVENT_INIT_CLEAR:
@@ -650,7 +629,7 @@ void GLES_GPU::ProcessEvent(GPUEvent ev) {
 }
 
 inline void GLES_GPU::CheckFlushOp(int cmd, u32 diff) {
-	u8 cmdFlags = commandFlags_[cmd];
+	u8 cmdFlags = cmdInfo_[cmd].flags;
 	if ((cmdFlags & FLAG_FLUSHBEFORE) || (diff && (cmdFlags & FLAG_FLUSHBEFOREONCHANGE))) {
 		if (dumpThisFrame_) {
 			NOTICE_LOG(G3D, "================ FLUSH ================");
@@ -667,6 +646,119 @@ void GLES_GPU::ExecuteOp(u32 op, u32 diff) {
 	return ExecuteOpInternal(op, diff);
 }
 
+void GLES_GPU::DrawPrim(u32 data) {
+	// This drives all drawing. All other state we just buffer up, then we apply it only
+	// when it's time to draw. As most PSP games set state redundantly ALL THE TIME, this is a huge optimization.
+
+	u32 count = data & 0xFFFF;
+	GEPrimitiveType prim = static_cast<GEPrimitiveType>(data >> 16);
+	
+	if (count == 0)
+		return;
+		
+	// Discard AA lines as we can't do anything that makes sense with these anyway. The SW plugin might, though.
+
+	if (gstate.isAntiAliasEnabled()) {
+		// Discard AA lines in DOA
+		if (prim == GE_PRIM_LINE_STRIP)
+			return;
+		// Discard AA lines in Summon Night 5 
+		if ((prim == GE_PRIM_LINES) && gstate.isSkinningEnabled())
+			return;
+	}
+
+	// This also make skipping drawing very effective.
+	framebufferManager_.SetRenderFrameBuffer();
+	if (gstate_c.skipDrawReason & (SKIPDRAW_SKIPFRAME | SKIPDRAW_NON_DISPLAYED_FB))	{
+		transformDraw_.SetupVertexDecoder(gstate.vertType);
+		// Rough estimate, not sure what's correct.
+		int vertexCost = transformDraw_.EstimatePerVertexCost();
+		cyclesExecuted += vertexCost * count;
+		return;
+	}
+
+	if (!Memory::IsValidAddress(gstate_c.vertexAddr)) {
+		ERROR_LOG_REPORT(G3D, "Bad vertex address %08x!", gstate_c.vertexAddr);
+		return;
+	}
+
+	// TODO: Split this so that we can collect sequences of primitives, can greatly speed things up
+	// on platforms where draw calls are expensive like mobile and D3D
+	void *verts = Memory::GetPointerUnchecked(gstate_c.vertexAddr);
+	void *inds = 0;
+	if ((gstate.vertType & GE_VTYPE_IDX_MASK) != GE_VTYPE_IDX_NONE) {
+		if (!Memory::IsValidAddress(gstate_c.indexAddr)) {
+			ERROR_LOG_REPORT(G3D, "Bad index address %08x!", gstate_c.indexAddr);
+			return;
+		}
+		inds = Memory::GetPointerUnchecked(gstate_c.indexAddr);
+	}
+
+#ifndef USING_GLES2
+	if (prim > GE_PRIM_RECTANGLES) {
+		ERROR_LOG_REPORT_ONCE(reportPrim, G3D, "Unexpected prim type: %d", prim);
+	}
+#endif
+
+	int bytesRead;
+	transformDraw_.SubmitPrim(verts, inds, prim, count, gstate.vertType, &bytesRead);
+
+	int vertexCost = transformDraw_.EstimatePerVertexCost();
+	gpuStats.vertexGPUCycles += vertexCost * count;
+	cyclesExecuted += vertexCost * count;
+
+	// After drawing, we advance the vertexAddr (when non indexed) or indexAddr (when indexed).
+	// Some games rely on this, they don't bother reloading VADDR and IADDR.
+	// Q: Are these changed reflected in the real registers? Needs testing.
+	if (inds) {
+		int indexSize = 1;
+		if ((gstate.vertType & GE_VTYPE_IDX_MASK) == GE_VTYPE_IDX_16BIT)
+			indexSize = 2;
+		gstate_c.indexAddr += count * indexSize;
+	} else {
+		gstate_c.vertexAddr += bytesRead;
+	}
+}
+
+void GLES_GPU::Execute_Prim(u32 op, u32 diff) {
+	DrawPrim(op & 0xFFFFFF);
+
+	// Games usually draw several prims in a row, with only VADDR/IADDR or redundant state between.
+	// None of that needs a flush, so handle it here instead of going back through the run loop.
+	// The run loop still counts the PRIM itself, so it must be left at least one.
+	const int remaining = downcount - 1;
+	u32 pc = currentList->pc + 4;
+	int consumed = 0;
+	while (consumed < remaining) {
+		const u32 next = Memory::ReadUnchecked_U32(pc);
+		const u32 cmd = next >> 24;
+		const u8 flags = cmdInfo_[cmd].flags;
+		if (cmd == GE_CMD_PRIM) {
+			DrawPrim(next & 0xFFFFFF);
+		} else if (cmd == GE_CMD_VADDR) {
+			gstate_c.vertexAddr = gstate_c.getRelativeAddress(next & 0xFFFFFF);
+		} else if (cmd == GE_CMD_IADDR) {
+			gstate_c.indexAddr = gstate_c.getRelativeAddress(next & 0xFFFFFF);
+		} else if (flags != 0 && (flags != FLAG_FLUSHBEFOREONCHANGE || next != gstate.cmdmem[cmd])) {
+			break;
+		}
+		gstate.cmdmem[cmd] = next;
+		pc += 4;
+		consumed++;
+	}
+
+	currentList->pc += consumed * 4;
+	downcount -= consumed;
+}
+
+void GLES_GPU::Execute_Vaddr(u32 op, u32 diff) {
+	gstate_c.vertexAddr = gstate_c.getRelativeAddress(op & 0xFFFFFF);
+}
+
+void GLES_GPU::Execute_Iaddr(u32 op, u32 diff) {
+	gstate_c.indexAddr = gstate_c.getRelativeAddress(op & 0xFFFFFF);
+}
+
 void GLES_GPU::ExecuteOpInternal(u32 op, u32 diff) {
 	u32 cmd = op >> 24;
 	u32 data = op & 0xFFFFFF;
@@ -685,79 +777,7 @@ void GLES_GPU::ExecuteOpInternal(u32 op, u32 diff) {
 		break;
 
 	case GE_CMD_PRIM:
-		{
-			// This drives all drawing. All other state we just buffer up, then we apply it only
-			// when it's time to draw. As most PSP games set state redundantly ALL THE TIME, this is a huge optimization.
-
-			u32 count = data & 0xFFFF;
-			GEPrimitiveType prim = static_cast<GEPrimitiveType>(data >> 16);
-			
-			if (count == 0)
-				break;
-				
-			// Discard AA lines as we can't do anything that makes sense with these anyway. The SW plugin might, though.
-
-			if (gstate.isAntiAliasEnabled()) {
-				// Discard AA lines in DOA
-				if (prim == GE_PRIM_LINE_STRIP)
-					break;
-				// Discard AA lines in Summon Night 5 
-				if ((prim == GE_PRIM_LINES) && gstate.isSkinningEnabled())
-					break;
-			}
-
-			// This also make skipping drawing very effective.
-			framebufferManager_.SetRenderFrameBuffer();
-			if (gstate_c.skipDrawReason & (SKIPDRAW_SKIPFRAME | SKIPDRAW_NON_DISPLAYED_FB))	{
-				transformDraw_.SetupVertexDecoder(gstate.vertType);
-				// Rough estimate, not sure what's correct.
-				int vertexCost = transformDraw_.EstimatePerVertexCost();
-				cyclesExecuted += vertexCost * count;
-				return;
-			}
-
-			if (!Memory::IsValidAddress(gstate_c.vertexAddr)) {
-				ERROR_LOG_REPORT(G3D, "Bad vertex address %08x!", gstate_c.vertexAddr);
-				break;
-			}
-
-			// TODO: Split this so that we can collect sequences of primitives, can greatly speed things up
-			// on platforms where draw calls are expensive like mobile and D3D
-			void *verts = Memory::GetPointerUnchecked(gstate_c.vertexAddr);
-			void *inds = 0;
-			if ((gstate.vertType & GE_VTYPE_IDX_MASK) != GE_VTYPE_IDX_NONE) {
-				if (!Memory::IsValidAddress(gstate_c.indexAddr)) {
-					ERROR_LOG_REPORT(G3D, "Bad index address %08x!", gstate_c.indexAddr);
-					break;
-				}
-				inds = Memory::GetPointerUnchecked(gstate_c.indexAddr);
-			}
-
-#ifndef USING_GLES2
-			if (prim > GE_PRIM_RECTANGLES) {
-				ERROR_LOG_REPORT_ONCE(reportPrim, G3D, "Unexpected prim type: %d", prim);
-			}
-#endif
-
-			int bytesRead;
-			transformDraw_.SubmitPrim(verts, inds, prim, count, gstate.vertType, &bytesRead);
-
-			int vertexCost = transformDraw_.EstimatePerVertexCost();
-			gpuStats.vertexGPUCycles += vertexCost * count;
-			cyclesExecuted += vertexCost * count;
-
-			// After drawing, we advance the vertexAddr (when non indexed) or indexAddr (when indexed).
-			// Some games rely on this, they don't bother reloading VADDR and IADDR.
-			// Q: Are these changed reflected in the real registers? Needs testing.
-			if (inds) {
-				int indexSize = 1;
-				if ((gstate.vertType & GE_VTYPE_IDX_MASK) == GE_VTYPE_IDX_16BIT)
-					indexSize = 2;
-				gstate_c.indexAddr += count * indexSize;
-			} else {
-				gstate_c.vertexAddr += bytesRead;
-			}
-		}
+		DrawPrim(data);
 		break;
 
 	// The arrow and other rotary items in Puzbob are bezier patches, strangely enough.
@@ -1578,6 +1598,7 @@ void GLES_GPU::DoBlockTransfer() {
 		u8 *dst = Memory::GetPointerUnchecked(dstLineStartAddr);
 		memcpy(dst, src, width * bpp);
 	}
+	Memory::MarkDirtyRange(dstBasePtr + (dstY * dstStride + dstX) * bpp, height * dstStride * bpp);
 
 	// TODO: Notify all overlapping FBOs that they need to reload.
 	framebufferManager_.NotifyBlockTransfer(dstBasePtr, srcBasePtr);
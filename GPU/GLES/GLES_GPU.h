@@ -33,6 +33,8 @@ class LinkedShader;
 
 class GLES_GPU : public GPUCommon {
 public:
+	typedef void (GLES_GPU::*CmdFunc)(u32 op, u32 diff);
+
 	GLES_GPU();
 	~GLES_GPU();
 	virtual void InitClear();
@@ -75,14 +77,19 @@ public:
 
 	virtual bool DescribeCodePtr(const u8 *ptr, std::string &name);
 
+	// Command handlers for the fast run loop, see the command table.
+	void Execute_Prim(u32 op, u32 diff);
+	void Execute_Vaddr(u32 op, u32 diff);
+	void Execute_Iaddr(u32 op, u32 diff);
+
 protected:
-	virtual void FastRunLoop(DisplayList &list);
 	virtual void ProcessEvent(GPUEvent ev);
-
-private:
-	void Flush() {
+	virtual void Flush() {
 		transformDraw_.Flush();
 	}
+
+private:
+	void DrawPrim(u32 data);
 	void DoBlockTransfer();
 	void ApplyDrawState(int prim);
 	void CheckFlushOp(int cmd, u32 diff);
@@ -97,8 +104,6 @@ private:
 	TransformDrawEngine transformDraw_;
 	ShaderManager *shaderManager_;
 
-	u8 *commandFlags_;
-
 	bool resized_;
 	int lastVsync_;
 
@@ -708,6 +708,16 @@ static inline u32 QuickTexHash(u32 addr, int bufw, int w, int h, GETextureFormat
 	return DoQuickTexHash(checkp, sizeInRAM);
 }
 
+// Like QuickTexHash, but also returns the dirty generation the hash is good for.
+static inline u32 QuickTexHashStamped(u32 addr, int bufw, int w, int h, GETextureFormat format, u32 &generation) {
+	if (Memory::IsDirtyTracking()) {
+		const u32 sizeInRAM = (textureBitsPerPixel[format] * bufw * h) / 8;
+		generation = Memory::NextDirtyGeneration(Memory::DIRTY_TEXTURES);
+		Memory::StampDirtyRange(Memory::DIRTY_TEXTURES, addr, sizeInRAM, generation);
+	}
+	return QuickTexHash(addr, bufw, w, h, format);
+}
+
 inline bool TextureCache::TexCacheEntry::Matches(u16 dim2, u8 format2, int maxLevel2) {
 	return dim == dim2 && format == format2 && maxLevel == maxLevel2;
 }
@@ -902,6 +912,7 @@ void TextureCache::SetTexture(bool force) {
 
 	u32 texhash = MiniHash((const u32 *)Memory::GetPointer(texaddr));
 	u32 fullhash = 0;
+	u32 fullhashGeneration = 0;
 
 	TexCache::iterator iter = cache.find(cachekey);
 	TexCacheEntry *entry = NULL;
@@ -963,13 +974,27 @@ void TextureCache::SetTexture(bool force) {
 
 			bool hashFail = false;
 			if (texhash != entry->hash) {
-				fullhash = QuickTexHash(texaddr, bufw, w, h, format);
+				fullhash = QuickTexHashStamped(texaddr, bufw, w, h, format, fullhashGeneration);
 				hashFail = true;
 				rehash = false;
 			}
 
 			if (rehash && (entry->status & TexCacheEntry::STATUS_MASK) != TexCacheEntry::STATUS_RELIABLE) {
-				fullhash = QuickTexHash(texaddr, bufw, w, h, format);
+				if (Memory::IsDirtyTracking()) {
+					const u32 sizeInRAM = (textureBitsPerPixel[format] * bufw * h) / 8;
+					const bool unchanged = !Memory::HasRangeChanged(Memory::DIRTY_TEXTURES, texaddr, sizeInRAM, entry->dirtyGeneration);
+					Memory::NoteDirtyCheck(Memory::DIRTY_TEXTURES, sizeInRAM, unchanged);
+					// Nothing in it was written since the last hash, so it would match.
+					if (unchanged) {
+						fullhash = entry->fullhash;
+					}
+				}
+				if (fullhash == 0) {
+					fullhash = QuickTexHashStamped(texaddr, bufw, w, h, format, fullhashGeneration);
+					if (fullhash == entry->fullhash) {
+						entry->dirtyGeneration = fullhashGeneration;
+					}
+				}
 				if (fullhash != entry->fullhash) {
 					hashFail = true;
 				} else if ((entry->status & TexCacheEntry::STATUS_MASK) == TexCacheEntry::STATUS_UNRELIABLE && entry->numFrames > TexCacheEntry::FRAMES_REGAIN_TRUST) {
@@ -1080,7 +1105,8 @@ void TextureCache::SetTexture(bool force) {
 	// to avoid excessive clearing caused by cache invalidations.
 	entry->sizeInRAM = (textureBitsPerPixel[format] * bufw * h / 2) / 8;
 
-	entry->fullhash = fullhash == 0 ? QuickTexHash(texaddr, bufw, w, h, format) : fullhash;
+	entry->fullhash = fullhash == 0 ? QuickTexHashStamped(texaddr, bufw, w, h, format, fullhashGeneration) : fullhash;
+	entry->dirtyGeneration = fullhashGeneration;
 	entry->cluthash = cluthash;
 
 	entry->status &= ~TexCacheEntry::STATUS_ALPHA_MASK;
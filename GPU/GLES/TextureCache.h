@@ -105,6 +105,8 @@ private:
 		u32 texture;  //GLuint
 		int invalidHint;
 		u32 fullhash;
+		// When fullhash was taken, for Memory::HasRangeChanged().
+		u32 dirtyGeneration;
 		u32 cluthash;
 		int maxLevel;
 		float lodBias;
@@ -456,11 +456,81 @@ u32 TransformDrawEngine::ComputeHash() {
 			i = lastMatch;
 		}
 	}
+	fullhash += ComputeUVHash();
+
+	return fullhash;
+}
+
+u32 TransformDrawEngine::ComputeUVHash() {
 	if (uvScale) {
-		fullhash += XXH32(&uvScale[0], sizeof(uvScale[0]) * numDrawCalls, 0x0123e658);
+		return XXH32(&uvScale[0], sizeof(uvScale[0]) * numDrawCalls, 0x0123e658);
 	}
+	return 0;
+}
 
-	return fullhash;
+// The RAM that ComputeHash() reads, as pointers into memory.
+int TransformDrawEngine::GetHashRanges(HashRange *ranges) {
+	int count = 0;
+	int vertexSize = dec_->VertexSize();
+	int indexSize = (dec_->VertexType() & GE_VTYPE_IDX_MASK) == GE_VTYPE_IDX_16BIT ? 2 : 1;
+
+	for (int i = 0; i < numDrawCalls; i++) {
+		const DeferredDrawCall &dc = drawCalls[i];
+		if (!dc.inds) {
+			ranges[count].ptr = dc.verts;
+			ranges[count++].size = vertexSize * dc.vertexCount;
+		} else {
+			// Same bounds as ComputeHash(), but of the raw vertices.
+			int indexLowerBound = dc.indexLowerBound, indexUpperBound = dc.indexUpperBound;
+			int j = i + 1;
+			int lastMatch = i;
+			while (j < numDrawCalls) {
+				if (drawCalls[j].verts != dc.verts)
+					break;
+				indexLowerBound = std::min(indexLowerBound, (int)drawCalls[j].indexLowerBound);
+				indexUpperBound = std::max(indexUpperBound, (int)drawCalls[j].indexUpperBound);
+				lastMatch = j;
+				j++;
+			}
+			ranges[count].ptr = (const u8 *)dc.verts + vertexSize * indexLowerBound;
+			ranges[count++].size = vertexSize * (indexUpperBound - indexLowerBound + 1);
+			ranges[count].ptr = dc.inds;
+			ranges[count++].size = indexSize * dc.vertexCount;
+			i = lastMatch;
+		}
+	}
+	return count;
+}
+
+u32 TransformDrawEngine::ComputeHashIfChanged(VertexArrayInfo *vai) {
+	if (!Memory::IsDirtyTracking()) {
+		return ComputeHash();
+	}
+
+	HashRange ranges[MAX_DEFERRED_DRAW_CALLS * 2];
+	const int count = GetHashRanges(ranges);
+	const u32 uvHash = ComputeUVHash();
+
+	bool changed = vai->dirtyGeneration == 0 || uvHash != vai->uvHash;
+	u32 bytes = 0;
+	for (int i = 0; i < count; ++i) {
+		bytes += ranges[i].size;
+		if (!changed && Memory::HasPtrRangeChanged(Memory::DIRTY_VERTICES, ranges[i].ptr, ranges[i].size, vai->dirtyGeneration)) {
+			changed = true;
+		}
+	}
+	Memory::NoteDirtyCheck(Memory::DIRTY_VERTICES, bytes, !changed);
+	if (!changed) {
+		return vai->hash;
+	}
+
+	const u32 generation = Memory::NextDirtyGeneration(Memory::DIRTY_VERTICES);
+	for (int i = 0; i < count; ++i) {
+		Memory::StampDirtyPtr(Memory::DIRTY_VERTICES, ranges[i].ptr, ranges[i].size, generation);
+	}
+	vai->dirtyGeneration = generation;
+	vai->uvHash = uvHash;
+	return ComputeHash();
 }
 
 u32 TransformDrawEngine::ComputeFastDCID() {
@@ -555,7 +625,7 @@ void TransformDrawEngine::DoFlush() {
 			case VertexArrayInfo::VAI_NEW:
 				{
 					// Haven't seen this one before.
-					u32 dataHash = ComputeHash();
+					u32 dataHash = ComputeHashIfChanged(vai);
 					vai->hash = dataHash;
 					vai->status = VertexArrayInfo::VAI_HASHING;
 					vai->drawsUntilNextFullHash = 0;
@@ -575,7 +645,7 @@ void TransformDrawEngine::DoFlush() {
 						vai->numFrames++;
 					}
 					if (vai->drawsUntilNextFullHash == 0) {
-						u32 newHash = ComputeHash();
+						u32 newHash = ComputeHashIfChanged(vai);
 						if (newHash != vai->hash) {
 							vai->status = VertexArrayInfo::VAI_UNRELIABLE;
 							if (vai->vbo) {
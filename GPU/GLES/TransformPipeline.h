@@ -57,6 +57,8 @@ public:
 		lastFrame = gpuStats.numFlips;
 		numVerts = 0;
 		drawsUntilNextFullHash = 0;
+		dirtyGeneration = 0;
+		uvHash = 0;
 	}
 	~VertexArrayInfo();
 
@@ -85,6 +87,10 @@ public:
 	int numFrames;
 	int lastFrame;  // So that we can forget.
 	u16 drawsUntilNextFullHash;
+
+	// When hash was taken, for Memory::HasRangeChanged(), and the part of it from uv scales.
+	u32 dirtyGeneration;
+	u32 uvHash;
 };
 
 // Handles transform, lighting and drawing.
@@ -149,6 +155,14 @@ private:
 	// drawcall ID
 	u32 ComputeFastDCID();
 	u32 ComputeHash();  // Reads deferred vertex data.
+	// Same result, but skips hashing if none of the vertex data was written since vai's last hash.
+	u32 ComputeHashIfChanged(VertexArrayInfo *vai);
+	u32 ComputeUVHash();
+	struct HashRange {
+		const void *ptr;
+		u32 size;
+	};
+	int GetHashRanges(HashRange *ranges);
 
 	VertexDecoder *GetVertexDecoder(u32 vtype);
 
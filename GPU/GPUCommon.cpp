@@ -13,11 +13,16 @@
 #include "Core/HLE/sceKernelMemory.h"
 #include "Core/HLE/sceKernelInterrupt.h"
 #include "Core/HLE/sceGe.h"
+#include "GPU/Debugger/Record.h"
 
 GPUCommon::GPUCommon() :
 	dumpNextFrame_(false),
 	dumpThisFrame_(false)
 {
+	for (int i = 0; i < 256; ++i) {
+		cmdInfo_[i].flags = FLAG_EXECUTE;
+		cmdInfo_[i].func = &GPUCommon::ExecuteOp;
+	}
 	Reinitialize();
 	SetThreadEnabled(g_Config.bSeparateCPUThread);
 }
@@ -447,12 +452,9 @@ u32 GPUCommon::Break(int mode) {
 }
 
 bool GPUCommon::InterpretList(DisplayList &list) {
-	// Initialized to avoid a race condition with bShowDebugStats changing.
-	double start = 0.0;
-	if (g_Config.bShowDebugStats) {
-		time_update();
-		start = time_now_d();
-	}
+	// Always timed, the per-frame timing history (and headless CSV) needs it too.
+	time_update();
+	double start = time_now_d();
 
 	easy_guard guard(listLock);
 
@@ -483,7 +485,7 @@ bool GPUCommon::InterpretList(DisplayList &list) {
 	guard.unlock();
 
 	const bool useDebugger = host->GPUDebuggingActive();
-	const bool useFastRunLoop = !dumpThisFrame_ && !useDebugger;
+	const bool useFastRunLoop = !dumpThisFrame_ && !useDebugger && !GPURecord::IsActive();
 	while (gpuState == GPUSTATE_RUNNING) {
 		{
 			easy_guard innerGuard(listLock);
@@ -517,16 +519,43 @@ bool GPUCommon::InterpretList(DisplayList &list) {
 
 	list.offsetAddr = gstate_c.offsetAddr;
 
-	if (g_Config.bShowDebugStats) {
-		time_update();
-		gpuStats.msProcessingDisplayLists += time_now_d() - start;
-	}
+	time_update();
+	const double listSeconds = time_now_d() - start;
+	gpuStats.msProcessingDisplayLists += listSeconds;
+	gpuTotalSecondsProcessingDisplayLists += listSeconds;
 	return gpuState == GPUSTATE_DONE || gpuState == GPUSTATE_ERROR;
 }
 
+void GPUCommon::FastRunLoop(DisplayList &list) {
+	const CommandInfo *cmdInfo = cmdInfo_;
+	for (; downcount > 0; --downcount) {
+		// We know that display list PCs have the upper nibble == 0 - no need to mask the pointer
+		const u32 op = *(const u32 *)(Memory::base + list.pc);
+		const u32 cmd = op >> 24;
+		const CommandInfo &info = cmdInfo[cmd];
+		const u32 diff = op ^ gstate.cmdmem[cmd];
+		// Plain state (most commands, in most lists) only needs the cmdmem write.
+		if (info.flags == 0) {
+			gstate.cmdmem[cmd] = op;
+			list.pc += 4;
+			continue;
+		}
+
+		if ((info.flags & FLAG_FLUSHBEFORE) || (diff && (info.flags & FLAG_FLUSHBEFOREONCHANGE))) {
+			Flush();
+		}
+		gstate.cmdmem[cmd] = op;
+		if (info.func) {
+			(this->*info.func)(op, diff);
+		}
+		list.pc += 4;
+	}
+}
+
 void GPUCommon::SlowRunLoop(DisplayList &list)
 {
 	const bool dumpThisFrame = dumpThisFrame_;
+	const bool recording = GPURecord::IsActive();
 	while (downcount > 0)
 	{
 		host->GPUNotifyCommand(list.pc);
@@ -547,6 +576,9 @@ void GPUCommon::SlowRunLoop(DisplayList &list)
 			NOTICE_LOG(G3D, "%s", temp);
 		}
 		gstate.cmdmem[cmd] = op;
+		if (recording) {
+			GPURecord::NotifyCommand(op);
+		}
 
 		ExecuteOp(op, diff);
 
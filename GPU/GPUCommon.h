@@ -12,11 +12,22 @@
 #include <xmmintrin.h>
 #endif
 
+enum {
+	FLAG_FLUSHBEFORE = 1,
+	FLAG_FLUSHBEFOREONCHANGE = 2,
+	FLAG_EXECUTE = 4,  // needs to actually be executed.
+	FLAG_EXECUTEONCHANGE = 8,  // not checked, the handler checks diff itself.
+	FLAG_ANY_EXECUTE = 4 | 8,
+};
+
 typedef ThreadEventQueue<GPUInterface, GPUEvent, GPUEventType, GPU_EVENT_INVALID, GPU_EVENT_SYNC_THREAD, GPU_EVENT_FINISH_EVENT_LOOP> GPUThreadEventQueue;
 
 class GPUCommon : public GPUThreadEventQueue, public GPUDebugInterface
 {
 public:
+	// Backends can cast their own member functions to this, they're called with this as the backend.
+	typedef void (GPUCommon::*CmdFunc)(u32 op, u32 diff);
+
 	GPUCommon();
 	virtual ~GPUCommon() {}
 	virtual void Reinitialize();
@@ -78,8 +89,10 @@ public:
 	}
 
 protected:
-	// To avoid virtual calls to PreExecuteOp().
-	virtual void FastRunLoop(DisplayList &list) = 0;
+	// To avoid virtual calls to PreExecuteOp().  Dispatches through cmdInfo_.
+	virtual void FastRunLoop(DisplayList &list);
+	// Called by FastRunLoop() for commands flagged FLAG_FLUSHBEFORE(ONCHANGE).
+	virtual void Flush() {}
 	void SlowRunLoop(DisplayList &list);
 	void UpdatePC(u32 currentPC, u32 newPC = 0);
 	void UpdateState(GPUState state);
@@ -128,6 +141,17 @@ protected:
 	bool dumpThisFrame_;
 	bool interruptsEnabled_;
 
+	struct CommandInfo {
+		u8 flags;
+		// NULL means nothing to execute, only the flush (if any) and the cmdmem write.
+		// Always NULL when flags is 0.
+		CmdFunc func;
+	};
+
+	// Flags and handler for each command, together so the fast loop only does one lookup.
+	// By default, everything goes to ExecuteOp().  Backends with flush flags overwrite this.
+	CommandInfo cmdInfo_[256];
+
 private:
 	// For CPU/GPU sync.
 #ifdef ANDROID
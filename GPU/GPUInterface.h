@@ -25,6 +25,7 @@
 #include "Core/HLE/sceGe.h"
 
 class PointerWrap;
+struct ThreadEventQueueStats;
 
 enum DisplayListStatus {
 	// The list has been completed
@@ -233,6 +234,8 @@ public:
 	virtual void ReapplyGfxState() = 0;
 	virtual void SyncThread(bool force = false) = 0;
 	virtual void SyncBeginFrame() = 0;
+	// Stats for the event queue between the CPU and GPU threads.
+	virtual void GetQueueStats(ThreadEventQueueStats &stats, bool reset) = 0;
 	virtual u64  GetTickEstimate() = 0;
 	virtual void DoState(PointerWrap &p) = 0;
 
@@ -43,6 +43,7 @@ GPUStateCache MEMORY_ALIGNED16(gstate_c);
 GPUInterface *gpu;
 GPUDebugInterface *gpuDebug;
 GPUStatistics gpuStats;
+double gpuTotalSecondsProcessingDisplayLists;
 
 template <typename T>
 static void SetGPU(T *obj) {
@@ -540,6 +540,9 @@ extern GPUStateCache gstate_c;
 extern GPUInterface *gpu;
 extern GPUDebugInterface *gpuDebug;
 extern GPUStatistics gpuStats;
+// Same as gpuStats.msProcessingDisplayLists, but never reset by ResetFrame(), for per frame timing.
+// Kept outside GPUStatistics since that is savestated as is.
+extern double gpuTotalSecondsProcessingDisplayLists;
 
 inline u32 GPUStateCache::getRelativeAddress(u32 data) const {
 	u32 baseExtended = ((gstate.base & 0x000F0000) << 8) | data;
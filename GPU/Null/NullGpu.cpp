@@ -26,19 +26,6 @@
 NullGPU::NullGPU() { }
 NullGPU::~NullGPU() { }
 
-void NullGPU::FastRunLoop(DisplayList &list) {
-	for (; downcount > 0; --downcount) {
-		u32 op = Memory::ReadUnchecked_U32(list.pc);
-		u32 cmd = op >> 24;
-
-		u32 diff = op ^ gstate.cmdmem[cmd];
-		gstate.cmdmem[cmd] = op;
-		ExecuteOp(op, diff);
-
-		list.pc += 4;
-	}
-}
-
 void NullGPU::ExecuteOp(u32 op, u32 diff) {
 	u32 cmd = op >> 24;
 	u32 data = op & 0xFFFFFF;
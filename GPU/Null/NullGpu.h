@@ -49,7 +49,4 @@ public:
 	virtual bool FramebufferReallyDirty() {
 		return !(gstate_c.skipDrawReason & SKIPDRAW_SKIPFRAME);
 	}
-
-protected:
-	virtual void FastRunLoop(DisplayList &list);
 };
@@ -309,19 +309,6 @@ void SoftGPU::ProcessEvent(GPUEvent ev) {
 	}
 }
 
-void SoftGPU::FastRunLoop(DisplayList &list) {
-	for (; downcount > 0; --downcount) {
-		u32 op = Memory::ReadUnchecked_U32(list.pc);
-		u32 cmd = op >> 24;
-
-		u32 diff = op ^ gstate.cmdmem[cmd];
-		gstate.cmdmem[cmd] = op;
-		ExecuteOp(op, diff);
-
-		list.pc += 4;
-	}
-}
-
 int EstimatePerVertexCost() {
 	// TODO: This is transform cost, also account for rasterization cost somehow... although it probably
 	// runs in parallel with transform.
@@ -619,6 +606,7 @@ void SoftGPU::ExecuteOp(u32 op, u32 diff)
 				u8 *dst = Memory::GetPointer(dstBasePtr + ((y + dstY) * dstStride + dstX) * bpp);
 				memcpy(dst, src, width * bpp);
 			}
+			Memory::MarkDirtyRange(dstBasePtr + (dstY * dstStride + dstX) * bpp, height * dstStride * bpp);
 
 #ifndef USING_GLES2
 			CBreakPoints::ExecMemCheck(srcBasePtr + (srcY * srcStride + srcX) * bpp, false, height * srcStride * bpp, currentMIPS->pc);
@@ -84,7 +84,6 @@ public:
 	bool GetCurrentSimpleVertices(int count, std::vector<GPUDebugVertex> &vertices, std::vector<u16> &indices);
 
 protected:
-	virtual void FastRunLoop(DisplayList &list);
 	virtual void ProcessEvent(GPUEvent ev);
 	void CopyToCurrentFboFromDisplayRam(int srcwidth, int srcheight);
 
@@ -0,0 +1,884 @@
+// Copyright (c) 2012- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+// A small stand-in for the pro adhoc server (see Core/HLE/proAdhoc.h for the client side.)
+// It speaks the same protocol, keeps everything in memory, and runs one poll() loop for all
+// clients, so several PPSSPP instances on one machine can be pointed at localhost.
+// With --bench=N it also runs N fake clients against itself and reports latency and throughput.
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+typedef unsigned char u8;
+typedef unsigned short u16;
+typedef unsigned int u32;
+typedef unsigned long long u64;
+
+#define PACK __attribute__((packed))
+
+enum {
+	OPCODE_PING = 0,
+	OPCODE_LOGIN = 1,
+	OPCODE_CONNECT = 2,
+	OPCODE_DISCONNECT = 3,
+	OPCODE_SCAN = 4,
+	OPCODE_SCAN_COMPLETE = 5,
+	OPCODE_CONNECT_BSSID = 6,
+	OPCODE_CHAT = 7,
+};
+
+enum {
+	ETHER_ADDR_LEN = 6,
+	GROUPNAME_LEN = 8,
+	NICKNAME_LEN = 128,
+	PRODUCT_CODE_LEN = 9,
+	CHAT_LEN = 64,
+};
+
+// These match the packets in Core/HLE/proAdhoc.h.
+struct LoginPacketC2S {
+	u8 opcode;
+	u8 mac[ETHER_ADDR_LEN];
+	char name[NICKNAME_LEN];
+	char game[PRODUCT_CODE_LEN];
+} PACK;
+
+struct ConnectPacketC2S {
+	u8 opcode;
+	char group[GROUPNAME_LEN];
+} PACK;
+
+struct ChatPacketC2S {
+	u8 opcode;
+	char message[CHAT_LEN];
+} PACK;
+
+struct ConnectPacketS2C {
+	u8 opcode;
+	char name[NICKNAME_LEN];
+	u8 mac[ETHER_ADDR_LEN];
+	u32 ip;
+} PACK;
+
+struct DisconnectPacketS2C {
+	u8 opcode;
+	u32 ip;
+} PACK;
+
+struct ScanPacketS2C {
+	u8 opcode;
+	char group[GROUPNAME_LEN];
+	u8 mac[ETHER_ADDR_LEN];
+} PACK;
+
+struct ConnectBSSIDPacketS2C {
+	u8 opcode;
+	u8 mac[ETHER_ADDR_LEN];
+} PACK;
+
+struct ChatPacketS2C {
+	ChatPacketC2S base;
+	char name[NICKNAME_LEN];
+} PACK;
+
+static const int DEFAULT_PORT = 27312;
+// Clients ping every 100ms, so this is very generous.
+static const double USER_TIMEOUT = 15.0;
+
+static double now() {
+	timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+static void setNonBlocking(int fd) {
+	fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+}
+
+static void setNoDelay(int fd) {
+	int one = 1;
+	setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+}
+
+static std::string ipToString(u32 ip) {
+	in_addr addr;
+	addr.s_addr = ip;
+	return inet_ntoa(addr);
+}
+
+// Users are sessions, keyed by connection: ip:port tells apart several on one address.
+static std::string sessionToString(u32 ip, u16 port) {
+	char buf[32];
+	snprintf(buf, sizeof(buf), "%s:%d", ipToString(ip).c_str(), (int)ntohs(port));
+	return buf;
+}
+
+class AdhocServer {
+public:
+	AdhocServer() : listenfd_(-1), running_(false), packetsIn_(0), packetsOut_(0) {}
+	~AdhocServer() { Shutdown(); }
+
+	bool Listen(const char *bindAddr, int port);
+	// Runs until Stop() is called.
+	void Run();
+	void Stop() { running_ = false; }
+	void Shutdown();
+
+	int GetPort() const { return port_; }
+	u64 GetPacketsIn() const { return packetsIn_; }
+	u64 GetPacketsOut() const { return packetsOut_; }
+
+private:
+	struct User {
+		int fd;
+		u32 ip;
+		// Source port, network order.
+		u16 port;
+		bool loggedIn;
+		u8 mac[ETHER_ADDR_LEN];
+		char name[NICKNAME_LEN];
+		std::string game;
+		// Empty when not in a group.
+		std::string group;
+		double lastRecv;
+		std::vector<u8> rx;
+		std::vector<u8> tx;
+	};
+
+	struct Group {
+		// The creator, whose MAC is the BSSID.
+		u8 hostMac[ETHER_ADDR_LEN];
+		std::vector<int> members;
+	};
+
+	struct Game {
+		std::map<std::string, Group> groups;
+		int users;
+	};
+
+	void Accept();
+	void ReadFrom(User &user);
+	void Flush(User &user);
+	void Send(User &user, const void *data, size_t size);
+	// Returns the bytes used, 0 if more are needed, or -1 to drop the user.
+	int HandlePacket(User &user, const u8 *data, size_t size);
+	void Login(User &user, const LoginPacketC2S &packet);
+	void JoinGroup(User &user, const ConnectPacketC2S &packet);
+	void LeaveGroup(User &user);
+	void Scan(User &user);
+	void Chat(User &user, const ChatPacketC2S &packet);
+	void Logout(int fd);
+
+	int listenfd_;
+	int port_;
+	std::atomic<bool> running_;
+	std::unordered_map<int, User> users_;
+	std::unordered_map<std::string, Game> games_;
+	std::vector<int> dropped_;
+	u64 packetsIn_;
+	u64 packetsOut_;
+};
+
+bool AdhocServer::Listen(const char *bindAddr, int port) {
+	listenfd_ = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	if (listenfd_ < 0) {
+		perror("socket");
+		return false;
+	}
+
+	int one = 1;
+	setsockopt(listenfd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+	sockaddr_in addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(port);
+	addr.sin_addr.s_addr = inet_addr(bindAddr);
+	if (bind(listenfd_, (sockaddr *)&addr, sizeof(addr)) != 0 || listen(listenfd_, 64) != 0) {
+		perror("bind");
+		close(listenfd_);
+		listenfd_ = -1;
+		return false;
+	}
+
+	socklen_t addrlen = sizeof(addr);
+	getsockname(listenfd_, (sockaddr *)&addr, &addrlen);
+	port_ = ntohs(addr.sin_port);
+	setNonBlocking(listenfd_);
+	return true;
+}
+
+void AdhocServer::Run() {
+	running_ = true;
+	std::vector<pollfd> fds;
+	std::vector<int> fdUsers;
+	double lastTimeoutCheck = now();
+
+	while (running_) {
+		fds.clear();
+		fdUsers.clear();
+		pollfd listener = { listenfd_, POLLIN, 0 };
+		fds.push_back(listener);
+		for (auto it = users_.begin(), end = users_.end(); it != end; ++it) {
+			pollfd pfd = { it->first, (short)(POLLIN | (it->second.tx.empty() ? 0 : POLLOUT)), 0 };
+			fds.push_back(pfd);
+			fdUsers.push_back(it->first);
+		}
+
+		// Wake up now and then, to drop users that stopped pinging (and to notice Stop().)
+		int ready = poll(&fds[0], fds.size(), 250);
+		if (ready < 0 && errno != EINTR) {
+			perror("poll");
+			break;
+		}
+
+		if (fds[0].revents & POLLIN) {
+			Accept();
+		}
+		for (size_t i = 1; i < fds.size(); ++i) {
+			auto it = users_.find(fdUsers[i - 1]);
+			if (it == users_.end()) {
+				continue;
+			}
+			if (fds[i].revents & (POLLIN | POLLERR | POLLHUP)) {
+				ReadFrom(it->second);
+			}
+			if (fds[i].revents & POLLOUT) {
+				Flush(it->second);
+			}
+		}
+
+		double t = now();
+		if (t - lastTimeoutCheck >= 1.0) {
+			lastTimeoutCheck = t;
+			for (auto it = users_.begin(), end = users_.end(); it != end; ++it) {
+				if (t - it->second.lastRecv > USER_TIMEOUT) {
+					printf("Timed out %s (%s)\n", it->second.name, sessionToString(it->second.ip, it->second.port).c_str());
+					dropped_.push_back(it->first);
+				}
+			}
+		}
+
+		// Dropping can queue more packets to others, so send those right away too.
+		for (size_t i = 0; i < dropped_.size(); ++i) {
+			Logout(dropped_[i]);
+		}
+		dropped_.clear();
+		for (auto it = users_.begin(), end = users_.end(); it != end; ++it) {
+			if (!it->second.tx.empty()) {
+				Flush(it->second);
+			}
+		}
+	}
+}
+
+void AdhocServer::Shutdown() {
+	for (auto it = users_.begin(), end = users_.end(); it != end; ++it) {
+		close(it->first);
+	}
+	users_.clear();
+	games_.clear();
+	if (listenfd_ >= 0) {
+		close(listenfd_);
+		listenfd_ = -1;
+	}
+}
+
+void AdhocServer::Accept() {
+	while (true) {
+		sockaddr_in addr;
+		socklen_t addrlen = sizeof(addr);
+		int fd = accept(listenfd_, (sockaddr *)&addr, &addrlen);
+		if (fd < 0) {
+			return;
+		}
+		setNonBlocking(fd);
+		setNoDelay(fd);
+
+		User &user = users_[fd];
+		user.fd = fd;
+		user.ip = addr.sin_addr.s_addr;
+		user.port = addr.sin_port;
+		user.loggedIn = false;
+		memset(user.mac, 0, sizeof(user.mac));
+		memset(user.name, 0, sizeof(user.name));
+		user.lastRecv = now();
+	}
+}
+
+void AdhocServer::ReadFrom(User &user) {
+	u8 buffer[4096];
+	while (true) {
+		ssize_t received = recv(user.fd, buffer, sizeof(buffer), 0);
+		if (received == 0 || (received < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+			dropped_.push_back(user.fd);
+			return;
+		}
+		if (received < 0) {
+			break;
+		}
+		user.rx.insert(user.rx.end(), buffer, buffer + received);
+	}
+
+	user.lastRecv = now();
+	size_t pos = 0;
+	while (pos < user.rx.size()) {
+		int used = HandlePacket(user, &user.rx[pos], user.rx.size() - pos);
+		if (used < 0) {
+			dropped_.push_back(user.fd);
+			return;
+		}
+		if (used == 0) {
+			break;
+		}
+		packetsIn_++;
+		pos += used;
+	}
+	user.rx.erase(user.rx.begin(), user.rx.begin() + pos);
+}
+
+void AdhocServer::Flush(User &user) {
+	while (!user.tx.empty()) {
+		ssize_t sent = send(user.fd, &user.tx[0], user.tx.size(), MSG_NOSIGNAL);
+		if (sent <= 0) {
+			if (sent < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+				dropped_.push_back(user.fd);
+			}
+			return;
+		}
+		user.tx.erase(user.tx.begin(), user.tx.begin() + sent);
+	}
+}
+
+void AdhocServer::Send(User &user, const void *data, size_t size) {
+	const u8 *bytes = (const u8 *)data;
+	user.tx.insert(user.tx.end(), bytes, bytes + size);
+	packetsOut_++;
+}
+
+int AdhocServer::HandlePacket(User &user, const u8 *data, size_t size) {
+	// Only a login is allowed until logged in.
+	if (!user.loggedIn && data[0] != OPCODE_LOGIN) {
+		return -1;
+	}
+
+	switch (data[0]) {
+	case OPCODE_PING:
+		return 1;
+
+	case OPCODE_LOGIN:
+		if (size < sizeof(LoginPacketC2S)) {
+			return 0;
+		}
+		if (user.loggedIn) {
+			return -1;
+		}
+		Login(user, *(const LoginPacketC2S *)data);
+		return sizeof(LoginPacketC2S);
+
+	case OPCODE_CONNECT:
+		if (size < sizeof(ConnectPacketC2S)) {
+			return 0;
+		}
+		JoinGroup(user, *(const ConnectPacketC2S *)data);
+		return sizeof(ConnectPacketC2S);
+
+	case OPCODE_DISCONNECT:
+		LeaveGroup(user);
+		return 1;
+
+	case OPCODE_SCAN:
+		Scan(user);
+		return 1;
+
+	case OPCODE_CHAT:
+		if (size < sizeof(ChatPacketC2S)) {
+			return 0;
+		}
+		Chat(user, *(const ChatPacketC2S *)data);
+		return sizeof(ChatPacketC2S);
+
+	default:
+		printf("Unknown opcode %d from %s, dropping\n", data[0], sessionToString(user.ip, user.port).c_str());
+		return -1;
+	}
+}
+
+void AdhocServer::Login(User &user, const LoginPacketC2S &packet) {
+	user.loggedIn = true;
+	memcpy(user.mac, packet.mac, sizeof(user.mac));
+	memcpy(user.name, packet.name, sizeof(user.name));
+	user.name[NICKNAME_LEN - 1] = '\0';
+	user.game.assign(packet.game, strnlen(packet.game, PRODUCT_CODE_LEN));
+	games_[user.game].users++;
+
+	// Peers only know each other by address, so two sessions on one address can't reach each other.
+	for (auto it = users_.begin(), end = users_.end(); it != end; ++it) {
+		const User &other = it->second;
+		if (other.fd != user.fd && other.loggedIn && other.ip == user.ip) {
+			printf("Warning: %s and %s share an address, peers can't tell them apart (same MAC on one machine?)\n", sessionToString(user.ip, user.port).c_str(), sessionToString(other.ip, other.port).c_str());
+			break;
+		}
+	}
+	printf("%s (%s) logged in to %s\n", user.name, sessionToString(user.ip, user.port).c_str(), user.game.c_str());
+}
+
+void AdhocServer::JoinGroup(User &user, const ConnectPacketC2S &packet) {
+	std::string groupName(packet.group, strnlen(packet.group, GROUPNAME_LEN));
+	if (!user.group.empty()) {
+		if (user.group == groupName) {
+			return;
+		}
+		LeaveGroup(user);
+	}
+
+	Game &game = games_[user.game];
+	auto found = game.groups.find(groupName);
+	if (found == game.groups.end()) {
+		found = game.groups.insert(std::make_pair(groupName, Group())).first;
+		memcpy(found->second.hostMac, user.mac, sizeof(user.mac));
+	}
+	Group &group = found->second;
+
+	// Introduce everyone to each other.
+	ConnectPacketS2C toOthers;
+	toOthers.opcode = OPCODE_CONNECT;
+	memcpy(toOthers.name, user.name, sizeof(toOthers.name));
+	memcpy(toOthers.mac, user.mac, sizeof(toOthers.mac));
+	toOthers.ip = user.ip;
+	for (size_t i = 0; i < group.members.size(); ++i) {
+		User &member = users_[group.members[i]];
+		Send(member, &toOthers, sizeof(toOthers));
+
+		ConnectPacketS2C toUser;
+		toUser.opcode = OPCODE_CONNECT;
+		memcpy(toUser.name, member.name, sizeof(toUser.name));
+		memcpy(toUser.mac, member.mac, sizeof(toUser.mac));
+		toUser.ip = member.ip;
+		Send(user, &toUser, sizeof(toUser));
+	}
+
+	group.members.push_back(user.fd);
+	user.group = groupName;
+
+	ConnectBSSIDPacketS2C bssid;
+	bssid.opcode = OPCODE_CONNECT_BSSID;
+	memcpy(bssid.mac, group.hostMac, sizeof(bssid.mac));
+	Send(user, &bssid, sizeof(bssid));
+}
+
+void AdhocServer::LeaveGroup(User &user) {
+	if (user.group.empty()) {
+		return;
+	}
+
+	Game &game = games_[user.game];
+	auto found = game.groups.find(user.group);
+	user.group.clear();
+	if (found == game.groups.end()) {
+		return;
+	}
+
+	Group &group = found->second;
+	group.members.erase(std::remove(group.members.begin(), group.members.end(), user.fd), group.members.end());
+
+	DisconnectPacketS2C packet;
+	packet.opcode = OPCODE_DISCONNECT;
+	packet.ip = user.ip;
+	for (size_t i = 0; i < group.members.size(); ++i) {
+		Send(users_[group.members[i]], &packet, sizeof(packet));
+	}
+
+	if (group.members.empty()) {
+		game.groups.erase(found);
+	}
+}
+
+void AdhocServer::Scan(User &user) {
+	Game &game = games_[user.game];
+	for (auto it = game.groups.begin(), end = game.groups.end(); it != end; ++it) {
+		ScanPacketS2C packet;
+		packet.opcode = OPCODE_SCAN;
+		memset(packet.group, 0, sizeof(packet.group));
+		memcpy(packet.group, it->first.data(), std::min(it->first.size(), sizeof(packet.group)));
+		memcpy(packet.mac, it->second.hostMac, sizeof(packet.mac));
+		Send(user, &packet, sizeof(packet));
+	}
+
+	u8 complete = OPCODE_SCAN_COMPLETE;
+	Send(user, &complete, 1);
+}
+
+void AdhocServer::Chat(User &user, const ChatPacketC2S &packet) {
+	if (user.group.empty()) {
+		return;
+	}
+
+	ChatPacketS2C out;
+	out.base = packet;
+	out.base.message[CHAT_LEN - 1] = '\0';
+	memcpy(out.name, user.name, sizeof(out.name));
+
+	Group &group = games_[user.game].groups[user.group];
+	for (size_t i = 0; i < group.members.size(); ++i) {
+		if (group.members[i] != user.fd) {
+			Send(users_[group.members[i]], &out, sizeof(out));
+		}
+	}
+}
+
+void AdhocServer::Logout(int fd) {
+	auto it = users_.find(fd);
+	if (it == users_.end()) {
+		return;
+	}
+
+	User &user = it->second;
+	if (user.loggedIn) {
+		LeaveGroup(user);
+		Game &game = games_[user.game];
+		if (--game.users <= 0) {
+			games_.erase(user.game);
+		}
+		printf("%s (%s) logged out\n", user.name, sessionToString(user.ip, user.port).c_str());
+	}
+
+	close(fd);
+	users_.erase(it);
+}
+
+// Fake clients for --bench.  Each one binds its own 127.0.0.x address, since peers are told
+// apart by IP, just like separate PPSSPP instances would need to be.
+class BenchClient {
+public:
+	BenchClient() : connects_(0), disconnects_(0), chats_(0), bssid_(false), fd_(-1) {}
+	~BenchClient() { if (fd_ >= 0) close(fd_); }
+
+	bool Connect(int index, int port);
+	void Login(int index);
+	void Join(const char *group);
+	void Leave();
+	void SendChat(const char *message);
+	// Reads and counts whatever has arrived, waiting up to timeoutMs for something.
+	void Pump(int timeoutMs);
+
+	int fd() const { return fd_; }
+	int connects_;
+	int disconnects_;
+	int chats_;
+	bool bssid_;
+
+private:
+	void SendAll(const void *data, size_t size);
+
+	int fd_;
+	std::vector<u8> rx_;
+};
+
+bool BenchClient::Connect(int index, int port) {
+	fd_ = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	sockaddr_in local;
+	memset(&local, 0, sizeof(local));
+	local.sin_family = AF_INET;
+	local.sin_addr.s_addr = htonl(0x7F000002 + index);
+	if (bind(fd_, (sockaddr *)&local, sizeof(local)) != 0) {
+		perror("bind (bench client)");
+		return false;
+	}
+
+	sockaddr_in server;
+	memset(&server, 0, sizeof(server));
+	server.sin_family = AF_INET;
+	server.sin_port = htons(port);
+	server.sin_addr.s_addr = htonl(0x7F000001);
+	if (connect(fd_, (sockaddr *)&server, sizeof(server)) != 0) {
+		perror("connect (bench client)");
+		return false;
+	}
+	setNoDelay(fd_);
+	setNonBlocking(fd_);
+	return true;
+}
+
+void BenchClient::SendAll(const void *data, size_t size) {
+	const u8 *bytes = (const u8 *)data;
+	while (size > 0) {
+		ssize_t sent = send(fd_, bytes, size, MSG_NOSIGNAL);
+		if (sent < 0) {
+			if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+				return;
+			}
+			// The server isn't keeping up, let it (and our own reads) catch up.
+			Pump(1);
+			continue;
+		}
+		bytes += sent;
+		size -= sent;
+	}
+}
+
+void BenchClient::Login(int index) {
+	LoginPacketC2S packet;
+	memset(&packet, 0, sizeof(packet));
+	packet.opcode = OPCODE_LOGIN;
+	packet.mac[0] = 0x02;
+	packet.mac[4] = (u8)(index >> 8);
+	packet.mac[5] = (u8)index;
+	snprintf(packet.name, sizeof(packet.name), "Bench%d", index);
+	memcpy(packet.game, "ULUS00000", PRODUCT_CODE_LEN);
+	SendAll(&packet, sizeof(packet));
+}
+
+void BenchClient::Join(const char *group) {
+	ConnectPacketC2S packet;
+	memset(&packet, 0, sizeof(packet));
+	packet.opcode = OPCODE_CONNECT;
+	// Not null terminated when it's the full 8 characters.
+	memcpy(packet.group, group, std::min(strlen(group), sizeof(packet.group)));
+	SendAll(&packet, sizeof(packet));
+}
+
+void BenchClient::Leave() {
+	u8 opcode = OPCODE_DISCONNECT;
+	SendAll(&opcode, 1);
+}
+
+void BenchClient::SendChat(const char *message) {
+	ChatPacketC2S packet;
+	memset(&packet, 0, sizeof(packet));
+	packet.opcode = OPCODE_CHAT;
+	strncpy(packet.message, message, sizeof(packet.message) - 1);
+	SendAll(&packet, sizeof(packet));
+}
+
+void BenchClient::Pump(int timeoutMs) {
+	pollfd pfd = { fd_, POLLIN, 0 };
+	if (poll(&pfd, 1, timeoutMs) <= 0) {
+		return;
+	}
+
+	u8 buffer[65536];
+	ssize_t received;
+	while ((received = recv(fd_, buffer, sizeof(buffer), 0)) > 0) {
+		rx_.insert(rx_.end(), buffer, buffer + received);
+	}
+
+	size_t pos = 0;
+	while (pos < rx_.size()) {
+		size_t size = 0;
+		switch (rx_[pos]) {
+		case OPCODE_CONNECT: size = sizeof(ConnectPacketS2C); break;
+		case OPCODE_DISCONNECT: size = sizeof(DisconnectPacketS2C); break;
+		case OPCODE_SCAN: size = sizeof(ScanPacketS2C); break;
+		case OPCODE_SCAN_COMPLETE: size = 1; break;
+		case OPCODE_CONNECT_BSSID: size = sizeof(ConnectBSSIDPacketS2C); break;
+		case OPCODE_CHAT: size = sizeof(ChatPacketS2C); break;
+		default: size = 1; break;
+		}
+		if (rx_.size() - pos < size) {
+			break;
+		}
+		switch (rx_[pos]) {
+		case OPCODE_CONNECT: connects_++; break;
+		case OPCODE_DISCONNECT: disconnects_++; break;
+		case OPCODE_CONNECT_BSSID: bssid_ = true; break;
+		case OPCODE_CHAT: chats_++; break;
+		}
+		pos += size;
+	}
+	rx_.erase(rx_.begin(), rx_.begin() + pos);
+}
+
+template <typename F>
+static bool PumpUntil(std::vector<BenchClient *> &clients, F done, double timeout) {
+	double start = now();
+	while (now() - start < timeout) {
+		bool all = true;
+		for (size_t i = 0; i < clients.size(); ++i) {
+			if (!done(*clients[i])) {
+				clients[i]->Pump(1);
+				all = all && done(*clients[i]);
+			}
+		}
+		if (all) {
+			return true;
+		}
+	}
+	return false;
+}
+
+static int RunBenchmark(int count, int chatRounds) {
+	AdhocServer server;
+	if (!server.Listen("127.0.0.1", 0)) {
+		return 1;
+	}
+	std::thread serverThread(&AdhocServer::Run, &server);
+
+	std::vector<BenchClient *> clients;
+	bool ok = true;
+	for (int i = 0; i < count && ok; ++i) {
+		clients.push_back(new BenchClient());
+		ok = clients.back()->Connect(i, server.GetPort());
+		if (ok) {
+			clients.back()->Login(i);
+		}
+	}
+
+	if (ok) {
+		// Join one at a time, so each join's latency includes telling everyone already there.
+		double joinTotal = 0.0, joinMax = 0.0;
+		double start = now();
+		for (int i = 0; i < count && ok; ++i) {
+			double joinStart = now();
+			clients[i]->Join("BENCH");
+			std::vector<BenchClient *> joined(clients.begin(), clients.begin() + i + 1);
+			ok = PumpUntil(joined, [&](BenchClient &c) { return c.bssid_ && c.connects_ >= i; }, 10.0);
+			double joinTime = now() - joinStart;
+			joinTotal += joinTime;
+			joinMax = std::max(joinMax, joinTime);
+		}
+		double joinElapsed = now() - start;
+		if (ok) {
+			printf("Join: %d clients in %0.3f s, latency avg %0.3f ms, max %0.3f ms\n", count, joinElapsed, joinTotal * 1000.0 / count, joinMax * 1000.0);
+		}
+
+		// Everyone chats at once, and everyone receives everyone else's.
+		if (ok && count > 1) {
+			start = now();
+			char message[CHAT_LEN];
+			for (int round = 0; round < chatRounds; ++round) {
+				snprintf(message, sizeof(message), "Round %d", round);
+				for (int i = 0; i < count; ++i) {
+					clients[i]->SendChat(message);
+				}
+				for (int i = 0; i < count; ++i) {
+					clients[i]->Pump(0);
+				}
+			}
+			const int expected = chatRounds * (count - 1);
+			ok = PumpUntil(clients, [&](BenchClient &c) { return c.chats_ >= expected; }, 30.0);
+			double elapsed = now() - start;
+			u64 delivered = (u64)expected * count;
+			if (ok) {
+				printf("Chat: %d rounds, %llu messages delivered in %0.3f s, %0.0f messages/s\n", chatRounds, delivered, elapsed, elapsed > 0.0 ? delivered / elapsed : 0.0);
+			}
+		}
+
+		// And leave, the last one should hear about everyone else.
+		if (ok) {
+			start = now();
+			for (int i = 0; i < count - 1; ++i) {
+				clients[i]->Leave();
+			}
+			std::vector<BenchClient *> last(1, clients[count - 1]);
+			ok = PumpUntil(last, [&](BenchClient &c) { return c.disconnects_ >= count - 1; }, 10.0);
+			if (ok) {
+				printf("Leave: %d clients in %0.3f ms\n", count - 1, (now() - start) * 1000.0);
+			}
+		}
+
+		if (!ok) {
+			fprintf(stderr, "Benchmark timed out waiting for the server\n");
+		}
+	}
+
+	for (size_t i = 0; i < clients.size(); ++i) {
+		delete clients[i];
+	}
+	server.Stop();
+	serverThread.join();
+	printf("Server handled %llu packets in, %llu packets out\n", server.GetPacketsIn(), server.GetPacketsOut());
+	return ok ? 0 : 1;
+}
+
+static void printUsage(const char *progname) {
+	fprintf(stderr, "PPSSPP adhoc server stand-in\n\n");
+	fprintf(stderr, "Usage: %s [options]\n\n", progname);
+	fprintf(stderr, "  --bind=ADDR        address to listen on (default 127.0.0.1)\n");
+	fprintf(stderr, "  --port=N           port to listen on (default %d)\n", DEFAULT_PORT);
+	fprintf(stderr, "  --bench=N          run N fake clients against a private server and report timings\n");
+	fprintf(stderr, "  --bench-rounds=N   chat rounds for --bench (default 100)\n");
+}
+
+static AdhocServer *mainServer = NULL;
+
+static void onSignal(int) {
+	if (mainServer) {
+		mainServer->Stop();
+	}
+}
+
+int main(int argc, const char *argv[]) {
+	const char *bindAddr = "127.0.0.1";
+	int port = DEFAULT_PORT;
+	int benchCount = 0;
+	int benchRounds = 100;
+
+	for (int i = 1; i < argc; ++i) {
+		if (!strncmp(argv[i], "--bind=", strlen("--bind=")))
+			bindAddr = argv[i] + strlen("--bind=");
+		else if (!strncmp(argv[i], "--port=", strlen("--port=")))
+			port = atoi(argv[i] + strlen("--port="));
+		else if (!strncmp(argv[i], "--bench=", strlen("--bench=")))
+			benchCount = std::max(atoi(argv[i] + strlen("--bench=")), 1);
+		else if (!strncmp(argv[i], "--bench-rounds=", strlen("--bench-rounds=")))
+			benchRounds = std::max(atoi(argv[i] + strlen("--bench-rounds=")), 1);
+		else {
+			printUsage(argv[0]);
+			return 1;
+		}
+	}
+
+	signal(SIGPIPE, SIG_IGN);
+
+	if (benchCount) {
+		return RunBenchmark(benchCount, benchRounds);
+	}
+
+	AdhocServer server;
+	if (!server.Listen(bindAddr, port)) {
+		return 1;
+	}
+	mainServer = &server;
+	signal(SIGINT, &onSignal);
+	signal(SIGTERM, &onSignal);
+
+	printf("Listening on %s:%d\n", bindAddr, server.GetPort());
+	server.Run();
+	mainServer = NULL;
+	return 0;
+}
@@ -564,12 +564,16 @@ void EmuScreen::render() {
 	if (PSP_CoreParameter().freezeNext) {
 		PSP_CoreParameter().frozen = true;
 		PSP_CoreParameter().freezeNext = false;
-		SaveState::SaveToRam(freezeState_);
+		SaveState::SaveToSnapshot(freezeState_);
 	} else if (PSP_CoreParameter().frozen) {
-		if (CChunkFileReader::ERROR_NONE != SaveState::LoadFromRam(freezeState_)) {
+		// Only what changed since last frame gets restored.
+		if (CChunkFileReader::ERROR_NONE != SaveState::LoadFromSnapshot(freezeState_)) {
 			ERROR_LOG(HLE, "Failed to load freeze state. Unfreezing.");
 			PSP_CoreParameter().frozen = false;
 		}
+	} else if (!freezeState_.memory.IsEmpty()) {
+		// Unfrozen, so let go of it, which also stops write tracking memory.
+		freezeState_ = SaveState::Snapshot();
 	}
 
 	// Reapply the graphics state of the PSP
@@ -24,6 +24,7 @@
 #include "ui/screen.h"
 #include "ui/ui_screen.h"
 #include "Common/KeyMap.h"
+#include "Core/SaveState.h"
 
 struct AxisInput;
 
@@ -74,5 +75,5 @@ private:
 	bool virtKeys[VIRTKEY_COUNT];
 
 	// In-memory save state used for freezeFrame, which is useful for debugging.
-	std::vector<u8> freezeState_;
+	SaveState::Snapshot freezeState_;
 };
@@ -2,17 +2,37 @@
 // See headless.txt.
 // To build on non-windows systems, just run CMake in the SDL directory, it will build both a normal ppsspp and the headless version.
 
+#include <algorithm>
 #include <cstdio>
 #include <cstdlib>
+#include <functional>
 #include <limits>
+#include <vector>
+
+#include "zlib.h"
 
 #include "Common/FileUtil.h"
 #include "Core/Config.h"
 #include "Core/Core.h"
 #include "Core/CoreTiming.h"
+#include "Core/CwCheat.h"
+#include "Core/InputMovie.h"
+#include "Core/Debugger/SamplingProfiler.h"
 #include "Core/System.h"
+#include "Core/HLE/HLE.h"
+#include "Core/HLE/sceDeflt.h"
+#include "Core/HLE/sceDisplay.h"
+#include "Core/HLE/sceKernel.h"
+#include "Core/HLE/sceKernelEventFlag.h"
+#include "Core/HLE/sceKernelMutex.h"
+#include "Core/HLE/sceKernelSemaphore.h"
 #include "Core/HLE/sceUtility.h"
 #include "Core/Host.h"
+#include "Core/MemMap.h"
+#include "Core/MemSnapshot.h"
+#include "GPU/GPUState.h"
+#include "GPU/GPUInterface.h"
+#include "GPU/Debugger/Record.h"
 #include "Log.h"
 #include "LogManager.h"
 #include "base/NativeApp.h"
@@ -83,7 +103,8 @@ void printUsage(const char *progname, const char *reason)
 		fprintf(stderr, "Error: %s\n\n", reason);
 	fprintf(stderr, "PPSSPP Headless\n");
 	fprintf(stderr, "This is primarily meant as a non-interactive test tool.\n\n");
-	fprintf(stderr, "Usage: %s file.elf... [options]\n\n", progname);
+	fprintf(stderr, "Usage: %s file.elf... [options]\n", progname);
+	fprintf(stderr, "       %s --replay=capture.ppge [options]\n\n", progname);
 	fprintf(stderr, "Options:\n");
 	fprintf(stderr, "  -m, --mount umd.cso   mount iso on umd:\n");
 	fprintf(stderr, "  -l, --log             full log output, not just emulated printfs\n");
@@ -96,6 +117,22 @@ void printUsage(const char *progname, const char *reason)
 	}
 #endif
 	fprintf(stderr, "  --timeout=SECONDS     abort test it if takes longer than SECONDS\n");
+	fprintf(stderr, "  --profile=FILE        sample guest functions, write folded stacks to FILE\n");
+	fprintf(stderr, "  --profile-interval=US emulated microseconds between samples (default 100)\n");
+	fprintf(stderr, "  --gecapture=FILE      capture one frame of GE commands and memory to FILE\n");
+	fprintf(stderr, "  --gecapture-frame=N   frame to capture (default 1)\n");
+	fprintf(stderr, "  --frametimes=FILE     write per-frame timing (last 1024 flips) as CSV\n");
+	fprintf(stderr, "  --replay=FILE         replay a GE capture instead of running executables\n");
+	fprintf(stderr, "  --replay-count=N      times to replay it (default 100)\n");
+	fprintf(stderr, "  --bench-ge=N          run a synthetic display list N times and report GE throughput\n");
+	fprintf(stderr, "  --bench-inflate=N     inflate a synthetic zlib stream N times and report throughput\n");
+	fprintf(stderr, "  --bench-cheats=N      compile a large synthetic cheat file and run it N times\n");
+	fprintf(stderr, "  --bench-snapshot=N    time memory snapshots with increasing dirty pages, N times each\n");
+	fprintf(stderr, "  --bench-kernel=N      boot the first executable, then run N uncontended mutex/sema/event flag ops\n");
+	fprintf(stderr, "  --bench-syscalls=N    boot the first executable, then dispatch N cheap syscalls each way\n");
+	fprintf(stderr, "  --movie=FILE          replay an input movie on the first executable, report speed and desyncs\n");
+	fprintf(stderr, "  --record-movie=FILE   record an input movie, with state hashes, of the run\n");
+	fprintf(stderr, "  --bench-replace       with --movie, replay once with C replacements, then jit inlined ones\n");
 
 	fprintf(stderr, "  -v, --verbose         show the full passed/failed result\n");
 	fprintf(stderr, "  -i                    use the interpreter\n");
@@ -117,7 +154,464 @@ static HeadlessHost * getHost(GPUCore gpuCore) {
 	}
 }
 
-bool RunAutoTest(HeadlessHost *headlessHost, CoreParameter &coreParameter, bool autoCompare, bool verbose, double timeout)
+static void PrintProfileSummary()
+{
+	std::vector<SamplingProfiler::FunctionStats> functions = SamplingProfiler::GetFunctionStats();
+	u64 totalCycles = 0;
+	for (size_t i = 0; i < functions.size(); ++i)
+		totalCycles += functions[i].selfCycles;
+	if (totalCycles == 0)
+		return;
+
+	fprintf(stderr, "Profile: %d samples\n", SamplingProfiler::GetSampleCount());
+	fprintf(stderr, "  self%%   total  function\n");
+	for (size_t i = 0; i < functions.size() && i < 20; ++i)
+	{
+		const SamplingProfiler::FunctionStats &func = functions[i];
+		fprintf(stderr, "  %5.1f%%  %6d  %s (%08x)\n", func.selfCycles * 100.0 / totalCycles, func.totalSamples, func.name.c_str(), func.entry);
+	}
+}
+
+bool RunGECaptureReplay(HeadlessHost *headlessHost, CoreParameter &coreParameter, const char *filename, int count)
+{
+	PSP_CoreParameter() = coreParameter;
+	// Captures may come from games using the extra memory.
+	Memory::g_MemorySize = Memory::RAM_DOUBLE_SIZE;
+	Memory::Init();
+	InitGfxState();
+
+	bool success = GPU_Init() && GPURecord::LoadCapture(filename);
+	if (success)
+	{
+		gpu->InitClear();
+
+		// The first run fills the texture cache and such, don't count it.
+		GPURecord::ReplayCapture();
+		headlessHost->SwapBuffers();
+
+		time_update();
+		double start = real_time_now();
+		for (int i = 0; i < count; ++i)
+		{
+			GPURecord::ReplayCapture();
+			headlessHost->SwapBuffers();
+		}
+		double elapsed = real_time_now() - start;
+		printf("%s: %d frames in %0.3f s, %0.3f ms/frame\n", filename, count, elapsed, elapsed * 1000.0 / count);
+	}
+	else
+		fprintf(stderr, "Failed to replay %s\n", filename);
+
+	GPURecord::UnloadCapture();
+	GPU_Shutdown();
+	ShutdownGfxState();
+	Memory::Shutdown();
+	return success;
+}
+
+static void WriteGEOp(u32 &addr, GECommand cmd, u32 data)
+{
+	Memory::Write_U32((cmd << 24) | (data & 0xFFFFFF), addr);
+	addr += 4;
+}
+
+// Builds a list that looks roughly like a game's: lots of (often redundant) state, matrices, and short draws.
+static u32 BuildGEBenchmarkList(u32 start, u32 vertices)
+{
+	u32 pc = start;
+	WriteGEOp(pc, GE_CMD_BASE, (vertices >> 8) & 0x000F0000);
+	for (int draw = 0; draw < 512; ++draw)
+	{
+		WriteGEOp(pc, GE_CMD_TEXADDR0, (draw / 4) * 0x1000);
+		WriteGEOp(pc, GE_CMD_TEXBUFWIDTH0, 0x100);
+		WriteGEOp(pc, GE_CMD_TEXSIZE0, 0x808);
+		WriteGEOp(pc, GE_CMD_TEXFORMAT, GE_TFMT_8888);
+		WriteGEOp(pc, GE_CMD_TEXFUNC, 0);
+		WriteGEOp(pc, GE_CMD_ALPHABLENDENABLE, draw & 1);
+		WriteGEOp(pc, GE_CMD_BLENDMODE, 0x2);
+		WriteGEOp(pc, GE_CMD_ZTESTENABLE, 1);
+		WriteGEOp(pc, GE_CMD_CULL, 0);
+		WriteGEOp(pc, GE_CMD_WORLDMATRIXNUMBER, 0);
+		for (int i = 0; i < 12; ++i)
+			WriteGEOp(pc, GE_CMD_WORLDMATRIXDATA, (i % 4) == (i / 4) ? 0x3F8000 : 0);
+		WriteGEOp(pc, GE_CMD_VERTEXTYPE, GE_VTYPE_TC_16BIT | GE_VTYPE_POS_FLOAT | GE_VTYPE_THROUGH);
+		WriteGEOp(pc, GE_CMD_VADDR, vertices & 0xFFFFFF);
+		WriteGEOp(pc, GE_CMD_PRIM, (GE_PRIM_TRIANGLE_STRIP << 16) | 4);
+		WriteGEOp(pc, GE_CMD_VADDR, vertices & 0xFFFFFF);
+		WriteGEOp(pc, GE_CMD_PRIM, (GE_PRIM_RECTANGLES << 16) | 2);
+	}
+	return pc;
+}
+
+bool RunGEBenchmark(HeadlessHost *headlessHost, CoreParameter &coreParameter, int count)
+{
+	PSP_CoreParameter() = coreParameter;
+	Memory::Init();
+	InitGfxState();
+
+	bool success = GPU_Init();
+	if (success)
+	{
+		gpu->InitClear();
+
+		const u32 start = PSP_GetUserMemoryBase();
+		// The vertex data is all zero, which is fine for timing.
+		const u32 vertices = start + 0x00100000;
+		Memory::Memset(vertices, 0, 0x1000);
+		const u32 end = BuildGEBenchmarkList(start, vertices);
+
+		DisplayList list;
+		memset(&list, 0, sizeof(list));
+		list.state = PSP_GE_DL_STATE_RUNNING;
+
+		time_update();
+		double startTime = real_time_now();
+		for (int i = 0; i < count; ++i)
+		{
+			// Stalling at the end avoids END/FINISH, which would need the kernel.
+			list.pc = start;
+			list.stall = end;
+			gpu->InterpretList(list);
+		}
+		double elapsed = real_time_now() - startTime;
+
+		u64 commands = (u64)count * ((end - start) / 4);
+		printf("GE benchmark: %d lists, %lld commands in %0.3f s, %0.1f M commands/s\n", count, (long long)commands, elapsed, elapsed > 0.0 ? commands / elapsed / 1000000.0 : 0.0);
+	}
+	else
+		fprintf(stderr, "Failed to initialize the GPU for the GE benchmark\n");
+
+	GPU_Shutdown();
+	ShutdownGfxState();
+	Memory::Shutdown();
+	return success;
+}
+
+bool RunInflateBenchmark(HeadlessHost *headlessHost, CoreParameter &coreParameter, int count)
+{
+	PSP_CoreParameter() = coreParameter;
+	Memory::Init();
+
+	// Something like game data: runs of structure and some noise, 4 MB of it.
+	const u32 size = 0x00400000;
+	std::vector<u8> data(size);
+	u32 seed = 1;
+	for (u32 i = 0; i < size; ++i)
+	{
+		seed = seed * 1103515245 + 12345;
+		data[i] = (i & 0x40) ? (u8)(i >> 3) : (u8)(seed >> 24);
+	}
+
+	uLongf compressedSize = compressBound(size);
+	std::vector<u8> compressed(compressedSize);
+	bool success = compress2(&compressed[0], &compressedSize, &data[0], size, Z_BEST_COMPRESSION) == Z_OK;
+	if (success)
+	{
+		const u32 src = PSP_GetUserMemoryBase();
+		const u32 dst = src + 0x00800000;
+		Memory::Memcpy(src, &compressed[0], (u32)compressedSize);
+
+		ResetDeflateStats();
+		for (int i = 0; i < count && success; ++i)
+			success = DeflateDecompressMemory(dst, size, src, (u32)compressedSize, DEFLATE_FORMAT_ZLIB, NULL) == (int)size;
+		success = success && memcmp(Memory::GetPointer(dst), &data[0], size) == 0;
+
+		DeflateStats stats;
+		GetDeflateStats(stats);
+		if (success)
+			printf("Inflate benchmark: %d x %0.2f MB -> %0.2f MB in %0.3f s, %0.1f MB/s\n", count, compressedSize / 1048576.0, size / 1048576.0, stats.seconds, stats.seconds > 0.0 ? stats.bytesOut / stats.seconds / 1048576.0 : 0.0);
+		else
+			fprintf(stderr, "Inflate benchmark: output didn't match\n");
+	}
+	else
+		fprintf(stderr, "Failed to compress data for the inflate benchmark\n");
+
+	Memory::Shutdown();
+	return success;
+}
+
+bool RunCheatBenchmark(HeadlessHost *headlessHost, CoreParameter &coreParameter, int count)
+{
+	PSP_CoreParameter() = coreParameter;
+	Memory::Init();
+
+	// A big cheat file, mostly simple writes with some of the multi-line codes mixed in.
+	const int cheats = 2000;
+	std::vector<std::string> lines;
+	char temp[256];
+	for (int i = 0; i < cheats; ++i)
+	{
+		const u32 offset = (i * 0x40) & 0x000FFFFF;
+		snprintf(temp, sizeof(temp), "_C1 Cheat %d", i);
+		lines.push_back(temp);
+		snprintf(temp, sizeof(temp), "_L 0x2%07X 0x%08X", offset, i);
+		lines.push_back(temp);
+		snprintf(temp, sizeof(temp), "_L 0x1%07X 0x0000%04X", offset + 4, i & 0xFFFF);
+		lines.push_back(temp);
+		switch (i & 3)
+		{
+		case 0:
+			snprintf(temp, sizeof(temp), "_L 0x4%07X 0x00040001", offset + 8);
+			lines.push_back(temp);
+			lines.push_back("_L 0x00000000 0x00000001");
+			break;
+		case 1:
+			snprintf(temp, sizeof(temp), "_L 0xE1010000 0x0%07X", offset);
+			lines.push_back(temp);
+			snprintf(temp, sizeof(temp), "_L 0x0%07X 0x00000001", offset + 8);
+			lines.push_back(temp);
+			break;
+		case 2:
+			snprintf(temp, sizeof(temp), "_L 0x7%07X 0x00000001", offset + 8);
+			lines.push_back(temp);
+			break;
+		default:
+			snprintf(temp, sizeof(temp), "_L 0x3100000A 0x0%07X", offset + 12);
+			lines.push_back(temp);
+			break;
+		}
+	}
+
+	CWCheatEngine engine;
+	time_update();
+	double startTime = real_time_now();
+	engine.CreateCodeList(lines);
+	time_update();
+	double compileTime = real_time_now() - startTime;
+
+	startTime = real_time_now();
+	for (int i = 0; i < count; ++i)
+		engine.Run();
+	time_update();
+	double elapsed = real_time_now() - startTime;
+
+	u64 operations = (u64)count * engine.GetNumOperations();
+	printf("Cheat benchmark: compiled %d lines in %0.3f ms, %d runs in %0.3f s, %0.1f M ops/s\n", (int)lines.size(), compileTime * 1000.0, count, elapsed, elapsed > 0.0 ? operations / elapsed / 1000000.0 : 0.0);
+
+	Memory::Shutdown();
+	return true;
+}
+
+static double BenchmarkNow()
+{
+	time_update();
+	return real_time_now();
+}
+
+// Prints how fast count iterations of calls calls each went, since startTime.
+static void PrintBenchmarkRate(const char *benchmark, const char *name, int count, int calls, double startTime)
+{
+	double elapsed = BenchmarkNow() - startTime;
+	printf("%s benchmark: %-34s %d x %d calls in %0.3f s, %0.2f M calls/s\n", benchmark, name, count, calls, elapsed, elapsed > 0.0 ? (double)count * calls / elapsed / 1000000.0 : 0.0);
+}
+
+// Boots the first executable, runs the benchmark against the live kernel, and shuts down again.
+static bool RunBootedBenchmark(HeadlessHost *headlessHost, CoreParameter &coreParameter, const std::function<bool()> &benchmark)
+{
+	std::string error_string;
+	if (!PSP_Init(coreParameter, &error_string)) {
+		fprintf(stderr, "Failed to start %s. Error: %s\n", coreParameter.fileToStart.c_str(), error_string.c_str());
+		return false;
+	}
+	host->BootDone();
+
+	bool success = benchmark();
+
+	PSP_Shutdown();
+	headlessHost->FlushDebugOutput();
+	return success;
+}
+
+// Only needs RAM, nothing is booted.
+bool RunSnapshotBenchmark(HeadlessHost *headlessHost, CoreParameter &coreParameter, int count)
+{
+	PSP_CoreParameter() = coreParameter;
+	Memory::g_MemorySize = Memory::RAM_NORMAL_SIZE;
+	Memory::Init();
+
+	const u32 ramBase = PSP_GetKernelMemoryBase();
+	const u32 ramPages = Memory::g_MemorySize / 4096;
+	for (u32 i = 0; i < Memory::g_MemorySize; i += 4)
+		Memory::WriteUnchecked_U32(i, ramBase + i);
+
+	Memory::Snapshot first;
+	double startTime = BenchmarkNow();
+	Memory::CaptureSnapshot(first);
+	printf("Snapshot benchmark: first capture %0.3f ms, write tracking %s\n", (BenchmarkNow() - startTime) * 1000.0, Memory::IsWriteTracking() ? "on" : "off");
+
+	startTime = BenchmarkNow();
+	std::vector<u8> full;
+	for (int i = 0; i < count; ++i)
+		full.assign(Memory::GetPointer(ramBase), Memory::GetPointer(ramBase) + Memory::g_MemorySize);
+	printf("Snapshot benchmark: full RAM copy %0.3f ms\n", (BenchmarkNow() - startTime) * 1000.0 / count);
+
+	printf("%12s %14s %14s\n", "dirty pages", "capture ms", "restore ms");
+	const u32 dirtyCounts[] = { 0, 16, 64, 256, 1024, 4096, ramPages };
+	for (size_t c = 0; c < sizeof(dirtyCounts) / sizeof(dirtyCounts[0]); ++c)
+	{
+		const u32 dirty = std::min(dirtyCounts[c], ramPages);
+		double captureTime = 0.0, restoreTime = 0.0;
+		for (int i = 0; i < count; ++i)
+		{
+			Memory::Snapshot before, after;
+			Memory::CaptureSnapshot(before);
+			// Spread out, so runs of pages don't make it look better than it is.
+			for (u32 p = 0; p < dirty; ++p)
+			{
+				const u32 addr = ramBase + ((p * 2654435761U) % ramPages) * 4096;
+				Memory::WriteUnchecked_U32(Memory::ReadUnchecked_U32(addr) + 1, addr);
+			}
+
+			startTime = BenchmarkNow();
+			Memory::CaptureSnapshot(after);
+			captureTime += BenchmarkNow() - startTime;
+			Memory::RestoreSnapshot(before);
+			restoreTime += BenchmarkNow() - startTime;
+		}
+		printf("%12d %14.3f %14.3f\n", dirty, captureTime * 1000.0 / count, (restoreTime - captureTime) * 1000.0 / count);
+	}
+
+	const Memory::SnapshotStats &stats = Memory::GetSnapshotStats();
+	printf("Snapshot benchmark: %llu pages copied, %llu shared, %llu restored, %llu write faults\n", stats.pagesCopied, stats.pagesShared, stats.pagesRestored, stats.writeFaults);
+
+	Memory::Shutdown();
+	return true;
+}
+
+// The HLE functions are called directly, from the main thread of the booted executable.
+bool RunKernelBenchmark(HeadlessHost *headlessHost, CoreParameter &coreParameter, int count)
+{
+	return RunBootedBenchmark(headlessHost, coreParameter, [&]() {
+		SceUID mutex = sceKernelCreateMutex("bench", 0, 0, 0);
+		SceUID sema = sceKernelCreateSema("bench", 0, 0, 1, 0);
+		SceUID flag = sceKernelCreateEventFlag("bench", 0, 0, 0);
+		bool success = mutex > 0 && sema > 0 && flag > 0;
+
+		double startTime = BenchmarkNow();
+		for (int i = 0; i < count && success; ++i)
+			success = sceKernelLockMutex(mutex, 1, 0) == 0 && sceKernelUnlockMutex(mutex, 1) == 0;
+		PrintBenchmarkRate("Kernel", "mutex lock/unlock", count, 2, startTime);
+
+		startTime = BenchmarkNow();
+		for (int i = 0; i < count && success; ++i)
+			success = sceKernelSignalSema(sema, 1) == 0 && sceKernelPollSema(sema, 1) == 0;
+		PrintBenchmarkRate("Kernel", "sema signal/poll", count, 2, startTime);
+
+		startTime = BenchmarkNow();
+		for (int i = 0; i < count && success; ++i)
+			success = sceKernelSetEventFlag(flag, 1) == 0 && sceKernelPollEventFlag(flag, 1, 0x20 /* WAITCLEAR */, 0) == 0;
+		PrintBenchmarkRate("Kernel", "event flag set/poll", count, 2, startTime);
+
+		if (!success)
+			fprintf(stderr, "Kernel benchmark: an operation failed\n");
+
+		sceKernelDeleteMutex(mutex);
+		sceKernelDeleteSema(sema);
+		sceKernelDeleteEventFlag(flag);
+		return success;
+	});
+}
+
+// Dispatches like the interpreter (by op) and like the jit (straight to the HLE function.)
+bool RunSyscallBenchmark(HeadlessHost *headlessHost, CoreParameter &coreParameter, int count)
+{
+	return RunBootedBenchmark(headlessHost, coreParameter, [&]() {
+		struct {
+			const char *name;
+			u32 nid;
+		} syscalls[] = {
+			{"sceKernelGetSystemTimeLow", 0x369ED59D},
+			// Has HLE_NOT_IN_INTERRUPT.
+			{"sceKernelGetThreadId", 0x293B45B8},
+		};
+
+		bool success = true;
+		for (size_t i = 0; i < ARRAY_SIZE(syscalls) && success; ++i) {
+			const MIPSOpcode op = MIPSOpcode(GetSyscallOp("ThreadManForUser", syscalls[i].nid));
+			SyscallDispatch dispatch;
+			success = GetSyscallDispatch(op, &dispatch);
+			if (!success)
+				break;
+
+			std::string name = std::string(syscalls[i].name) + " by op";
+			hleCollectSyscallStats();
+			double startTime = BenchmarkNow();
+			for (int j = 0; j < count; ++j)
+				CallSyscall(op);
+			PrintBenchmarkRate("Syscall", name.c_str(), count, 1, startTime);
+
+			// The same sequence the jit emits at the call site.
+			name = std::string(syscalls[i].name) + " direct";
+			startTime = BenchmarkNow();
+			for (int j = 0; j < count; ++j) {
+				hleBeginSyscall();
+				if (!dispatch.checkFlags || hleCheckSyscallFlags(dispatch.index))
+					dispatch.func();
+				hleEndSyscall(dispatch.index);
+			}
+			PrintBenchmarkRate("Syscall", name.c_str(), count, 1, startTime);
+
+			const u64 counted = hleGetSyscallCount();
+			hleCollectSyscallStats();
+			printf("Syscall benchmark: stats counted %llu calls, %0.3f s inside syscalls\n", (unsigned long long)counted, kernelStats.msInSyscalls);
+			success = counted == (u64)count * 2;
+		}
+
+		if (!success)
+			fprintf(stderr, "Syscall benchmark: a syscall could not be dispatched or counted\n");
+		return success;
+	});
+}
+
+bool RunMovieReplay(HeadlessHost *headlessHost, CoreParameter &coreParameter, const char *filename, double timeout, const char *frameTimesFilename)
+{
+	coreParameter.inputMoviePlay = filename;
+	std::string error_string;
+	if (!PSP_Init(coreParameter, &error_string)) {
+		fprintf(stderr, "Failed to start %s. Error: %s\n", coreParameter.fileToStart.c_str(), error_string.c_str());
+		coreParameter.inputMoviePlay.clear();
+		return false;
+	}
+	host->BootDone();
+
+	time_update();
+	double startTime = real_time_now();
+	coreState = CORE_RUNNING;
+	while (coreState == CORE_RUNNING && !InputMovie::IsFinished())
+	{
+		PSP_RunLoopFor(usToCycles(1000000 / 60));
+		if (coreState == CORE_NEXTFRAME) {
+			coreState = CORE_RUNNING;
+			headlessHost->SwapBuffers();
+		}
+		time_update();
+		if (real_time_now() - startTime > timeout) {
+			fprintf(stderr, "Movie %s: timed out\n", filename);
+			break;
+		}
+	}
+	time_update();
+	double elapsed = real_time_now() - startTime;
+
+	if (frameTimesFilename)
+		__DisplayWriteFrameTimingCSV(frameTimesFilename);
+	// Copied, since shutdown ends the movie.
+	const InputMovie::Stats stats = InputMovie::GetStats();
+	PSP_Shutdown();
+	coreParameter.inputMoviePlay.clear();
+	headlessHost->FlushDebugOutput();
+
+	// A vblank is 1/59.94 s of emulated time.
+	printf("Movie %s: %d of %d frames in %0.3f s, %0.1f frames/s, %0.2fx full speed\n", filename, stats.frames, stats.totalFrames, elapsed, elapsed > 0.0 ? stats.frames / elapsed : 0.0, elapsed > 0.0 ? stats.frames / elapsed / 59.94 : 0.0);
+	if (stats.desyncs != 0)
+		printf("Movie %s: desynced at frame %d, %d of %d hashes didn't match\n", filename, stats.firstDesyncFrame, stats.desyncs, stats.hashesChecked);
+	else
+		printf("Movie %s: all %d hashes matched\n", filename, stats.hashesChecked);
+
+	return stats.desyncs == 0 && stats.frames >= stats.totalFrames;
+}
+
+bool RunAutoTest(HeadlessHost *headlessHost, CoreParameter &coreParameter, bool autoCompare, bool verbose, double timeout, const char *profileFilename, int profileInterval, const char *captureFilename, int captureFrame, const char *frameTimesFilename)
 {
 	if (teamCityMode) {
 		// Kinda ugly, trying to guesstimate the test name from filename...
@@ -150,6 +644,16 @@ bool RunAutoTest(HeadlessHost *headlessHost, CoreParameter &coreParameter, bool
 	static double deadline;
 	deadline = time_now() + timeout;
 
+	if (profileFilename)
+	{
+		SamplingProfiler::Reset();
+		SamplingProfiler::Start((int)usToCycles(profileInterval));
+	}
+
+	int frames = 0;
+	if (captureFilename && captureFrame <= 0)
+		GPURecord::Activate(captureFilename);
+
 	coreState = CORE_RUNNING;
 	while (coreState == CORE_RUNNING)
 	{
@@ -160,6 +664,8 @@ bool RunAutoTest(HeadlessHost *headlessHost, CoreParameter &coreParameter, bool
 		if (coreState == CORE_NEXTFRAME) {
 			coreState = CORE_RUNNING;
 			headlessHost->SwapBuffers();
+			if (captureFilename && ++frames == captureFrame)
+				GPURecord::Activate(captureFilename);
 		}
 		time_update();
 		if (time_now_d() > deadline) {
@@ -173,6 +679,17 @@ bool RunAutoTest(HeadlessHost *headlessHost, CoreParameter &coreParameter, bool
 		}
 	}
 
+	// Symbols are gone after shutdown, so write the profile out first.
+	if (profileFilename)
+	{
+		SamplingProfiler::Stop();
+		SamplingProfiler::WriteFoldedStacks(profileFilename);
+		PrintProfileSummary();
+	}
+
+	if (frameTimesFilename)
+		__DisplayWriteFrameTimingCSV(frameTimesFilename);
+
 	PSP_Shutdown();
 
 	headlessHost->FlushDebugOutput();
@@ -202,6 +719,22 @@ int main(int argc, const char* argv[])
 	std::vector<std::string> testFilenames;
 	const char *mountIso = 0;
 	const char *screenshotFilename = 0;
+	const char *profileFilename = 0;
+	int profileInterval = 100;
+	const char *captureFilename = 0;
+	int captureFrame = 1;
+	const char *frameTimesFilename = 0;
+	const char *replayFilename = 0;
+	int replayCount = 100;
+	int geBenchCount = 0;
+	int inflateBenchCount = 0;
+	int cheatBenchCount = 0;
+	int snapshotBenchCount = 0;
+	int kernelBenchCount = 0;
+	int syscallBenchCount = 0;
+	const char *movieFilename = 0;
+	const char *movieRecordFilename = 0;
+	bool benchReplace = false;
 	bool readMount = false;
 	float timeout = std::numeric_limits<float>::infinity();
 
@@ -249,6 +782,38 @@ int main(int argc, const char* argv[])
 			screenshotFilename = argv[i] + strlen("--screenshot=");
 		else if (!strncmp(argv[i], "--timeout=", strlen("--timeout=")) && strlen(argv[i]) > strlen("--timeout="))
 			timeout = strtod(argv[i] + strlen("--timeout="), NULL);
+		else if (!strncmp(argv[i], "--profile=", strlen("--profile=")) && strlen(argv[i]) > strlen("--profile="))
+			profileFilename = argv[i] + strlen("--profile=");
+		else if (!strncmp(argv[i], "--profile-interval=", strlen("--profile-interval=")) && strlen(argv[i]) > strlen("--profile-interval="))
+			profileInterval = atoi(argv[i] + strlen("--profile-interval="));
+		else if (!strncmp(argv[i], "--frametimes=", strlen("--frametimes=")) && strlen(argv[i]) > strlen("--frametimes="))
+			frameTimesFilename = argv[i] + strlen("--frametimes=");
+		else if (!strncmp(argv[i], "--gecapture=", strlen("--gecapture=")) && strlen(argv[i]) > strlen("--gecapture="))
+			captureFilename = argv[i] + strlen("--gecapture=");
+		else if (!strncmp(argv[i], "--gecapture-frame=", strlen("--gecapture-frame=")) && strlen(argv[i]) > strlen("--gecapture-frame="))
+			captureFrame = atoi(argv[i] + strlen("--gecapture-frame="));
+		else if (!strncmp(argv[i], "--replay=", strlen("--replay=")) && strlen(argv[i]) > strlen("--replay="))
+			replayFilename = argv[i] + strlen("--replay=");
+		else if (!strncmp(argv[i], "--replay-count=", strlen("--replay-count=")) && strlen(argv[i]) > strlen("--replay-count="))
+			replayCount = std::max(atoi(argv[i] + strlen("--replay-count=")), 1);
+		else if (!strncmp(argv[i], "--bench-ge=", strlen("--bench-ge=")) && strlen(argv[i]) > strlen("--bench-ge="))
+			geBenchCount = std::max(atoi(argv[i] + strlen("--bench-ge=")), 1);
+		else if (!strncmp(argv[i], "--bench-inflate=", strlen("--bench-inflate=")) && strlen(argv[i]) > strlen("--bench-inflate="))
+			inflateBenchCount = std::max(atoi(argv[i] + strlen("--bench-inflate=")), 1);
+		else if (!strncmp(argv[i], "--bench-cheats=", strlen("--bench-cheats=")) && strlen(argv[i]) > strlen("--bench-cheats="))
+			cheatBenchCount = std::max(atoi(argv[i] + strlen("--bench-cheats=")), 1);
+		else if (!strncmp(argv[i], "--bench-snapshot=", strlen("--bench-snapshot=")) && strlen(argv[i]) > strlen("--bench-snapshot="))
+			snapshotBenchCount = std::max(atoi(argv[i] + strlen("--bench-snapshot=")), 1);
+		else if (!strncmp(argv[i], "--bench-kernel=", strlen("--bench-kernel=")) && strlen(argv[i]) > strlen("--bench-kernel="))
+			kernelBenchCount = std::max(atoi(argv[i] + strlen("--bench-kernel=")), 1);
+		else if (!strncmp(argv[i], "--bench-syscalls=", strlen("--bench-syscalls=")) && strlen(argv[i]) > strlen("--bench-syscalls="))
+			syscallBenchCount = std::max(atoi(argv[i] + strlen("--bench-syscalls=")), 1);
+		else if (!strncmp(argv[i], "--movie=", strlen("--movie=")) && strlen(argv[i]) > strlen("--movie="))
+			movieFilename = argv[i] + strlen("--movie=");
+		else if (!strncmp(argv[i], "--record-movie=", strlen("--record-movie=")) && strlen(argv[i]) > strlen("--record-movie="))
+			movieRecordFilename = argv[i] + strlen("--record-movie=");
+		else if (!strcmp(argv[i], "--bench-replace"))
+			benchReplace = true;
 		else if (!strcmp(argv[i], "--teamcity"))
 			teamCityMode = true;
 		else if (!strcmp(argv[i], "--help") || !strcmp(argv[i], "-h"))
@@ -276,7 +841,7 @@ int main(int argc, const char* argv[])
 		printUsage(argv[0], "Missing argument after -m");
 		return 1;
 	}
-	if (testFilenames.empty())
+	if (testFilenames.empty() && !replayFilename && !geBenchCount && !inflateBenchCount && !cheatBenchCount && !snapshotBenchCount)
 	{
 		printUsage(argv[0], argc <= 1 ? NULL : "No executables specified");
 		return 1;
@@ -316,10 +881,13 @@ int main(int argc, const char* argv[])
 	coreParameter.pixelWidth = 480;
 	coreParameter.pixelHeight = 272;
 	coreParameter.unthrottle = true;
+	if (movieRecordFilename)
+		coreParameter.inputMovieRecord = movieRecordFilename;
 
 	g_Config.bEnableSound = false;
 	g_Config.bFirstRun = false;
 	g_Config.bIgnoreBadMemAccess = true;
+	g_Config.bInlineReplacements = true;
 	// Never report from tests.
 	g_Config.sReportHost = "";
 	g_Config.bAutoSaveSymbolMap = false;
@@ -368,6 +936,49 @@ int main(int argc, const char* argv[])
 	if (screenshotFilename != 0)
 		headlessHost->SetComparisonScreenshot(screenshotFilename);
 
+	if (replayFilename)
+		RunGECaptureReplay(headlessHost, coreParameter, replayFilename, replayCount);
+	if (geBenchCount)
+		RunGEBenchmark(headlessHost, coreParameter, geBenchCount);
+	if (inflateBenchCount)
+		RunInflateBenchmark(headlessHost, coreParameter, inflateBenchCount);
+	if (cheatBenchCount)
+		RunCheatBenchmark(headlessHost, coreParameter, cheatBenchCount);
+	if (snapshotBenchCount)
+		RunSnapshotBenchmark(headlessHost, coreParameter, snapshotBenchCount);
+
+	bool movieFailed = false;
+	if (movieFilename && !testFilenames.empty())
+	{
+		coreParameter.fileToStart = testFilenames[0];
+		if (benchReplace)
+		{
+			// Same input both times, so the difference is just the replacements.
+			g_Config.bFuncHashMap = true;
+			g_Config.bInlineReplacements = false;
+			printf("Replacements in C:\n");
+			movieFailed = !RunMovieReplay(headlessHost, coreParameter, movieFilename, timeout, NULL);
+			g_Config.bInlineReplacements = true;
+			printf("Replacements inlined by the jit:\n");
+		}
+		movieFailed = !RunMovieReplay(headlessHost, coreParameter, movieFilename, timeout, frameTimesFilename) || movieFailed;
+		testFilenames.clear();
+	}
+
+	if (kernelBenchCount && !testFilenames.empty())
+	{
+		coreParameter.fileToStart = testFilenames[0];
+		RunKernelBenchmark(headlessHost, coreParameter, kernelBenchCount);
+		testFilenames.clear();
+	}
+
+	if (syscallBenchCount && !testFilenames.empty())
+	{
+		coreParameter.fileToStart = testFilenames[0];
+		RunSyscallBenchmark(headlessHost, coreParameter, syscallBenchCount);
+		testFilenames.clear();
+	}
+
 	std::vector<std::string> failedTests;
 	std::vector<std::string> passedTests;
 	for (size_t i = 0; i < testFilenames.size(); ++i)
@@ -375,7 +986,7 @@ int main(int argc, const char* argv[])
 		coreParameter.fileToStart = testFilenames[i];
 		if (autoCompare)
 			printf("%s:\n", coreParameter.fileToStart.c_str());
-		bool passed = RunAutoTest(headlessHost, coreParameter, autoCompare, verbose, timeout);
+		bool passed = RunAutoTest(headlessHost, coreParameter, autoCompare, verbose, timeout, profileFilename, profileInterval, captureFilename, captureFrame, frameTimesFilename);
 		if (autoCompare)
 		{
 			std::string testName = GetTestName(coreParameter.fileToStart);
@@ -410,5 +1021,5 @@ int main(int argc, const char* argv[])
 	moncleanup();
 #endif
 
-	return 0;
+	return movieFailed ? 1 : 0;
 }
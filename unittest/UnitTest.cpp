@@ -25,17 +25,28 @@
 // Or just integrate with an existing testing framework.
 
 
+#include <algorithm>
 #include <cstdio>
 #include <cstdlib>
 #include <cmath>
+#include <cstring>
 #include <string>
+#include <vector>
 
 #include "base/NativeApp.h"
+#include "base/timeutil.h"
 #include "Common/ArmEmitter.h"
+#include "Common/FileUtil.h"
 #include "ext/disarm.h"
 #include "math/math_util.h"
 #include "util/text/parsers.h"
 #include "Core/Config.h"
+#include "Core/MemMap.h"
+#include "Core/FileSystems/ISOFileSystem.h"
+#include "Core/HW/ColorConvert.h"
+#include "Core/Font/PGF.h"
+#include "GPU/GPUState.h"
+#include "GPU/Null/NullGpu.h"
 
 #define EXPECT_TRUE(a) if (!(a)) { printf("%s:%i: Test Fail\n", __FUNCTION__, __LINE__); return false; }
 #define EXPECT_FALSE(a) if ((a)) { printf("%s:%i: Test Fail\n", __FUNCTION__, __LINE__); return false; }
@@ -313,6 +324,330 @@ bool TestParsers() {
 	return true;
 }
 
+// Checks that glyphs drawn from the decoded glyph cache match drawing them pixel by pixel, then
+// times a screenful of text in every pixel format, with and without the cache.
+bool TestFontGlyphCache() {
+	std::vector<u8> data;
+	FILE *f = File::OpenCFile("flash0/font/ltn0.pgf", "rb");
+	if (!f) {
+		printf("TestFontGlyphCache: flash0/font/ltn0.pgf not found, skipping\n");
+		return true;
+	}
+	data.resize((size_t)File::GetSize(f));
+	fread(&data[0], 1, data.size(), f);
+	fclose(f);
+
+	Memory::g_MemorySize = Memory::RAM_NORMAL_SIZE;
+	Memory::Init();
+	gpu = new NullGPU();
+
+	PGF pgf;
+	pgf.ReadPtr(&data[0], data.size());
+
+	GlyphImage image;
+	image.xPos64 = 0;
+	image.yPos64 = 0;
+	image.bufWidth = 512;
+	image.bufHeight = 272;
+	image.bufferPtr = 0x08800000;
+
+	static const FontPixelFormat formats[] = {
+		PSP_FONT_PIXELFORMAT_4, PSP_FONT_PIXELFORMAT_4_REV, PSP_FONT_PIXELFORMAT_8, PSP_FONT_PIXELFORMAT_24, PSP_FONT_PIXELFORMAT_32,
+	};
+	static const int bytesPerPixelx2[] = { 1, 1, 2, 6, 8 };
+
+	// The cached rows have to match what drawing each pixel separately gives, byte for byte.
+	// Odd positions cover nibble order, and the edges and clip rect cover clipping.
+	const u32 refBufferPtr = 0x08900000;
+	const u32 bufferBytes = image.bufWidth * image.bufHeight * 4;
+	GlyphImage refImage = image;
+	refImage.bufferPtr = refBufferPtr;
+	// x, y, then the clip rect.
+	static const int positions[][6] = {
+		{ 0, 0, 0, 0, 512, 272 },
+		{ 33, 17, 0, 0, 512, 272 },
+		{ -7, -5, 0, 0, 512, 272 },
+		{ 505, 265, 0, 0, 512, 272 },
+		{ 240, 130, 244, 133, 5, 7 },
+	};
+	static const int glyphTypes[] = { FONT_PGF_CHARGLYPH, FONT_PGF_SHADOWGLYPH };
+	bool matches = true;
+	for (size_t fmt = 0; fmt < sizeof(formats) / sizeof(formats[0]) && matches; ++fmt) {
+		pgf.ClearGlyphCache();
+		image.pixelFormat = formats[fmt];
+		image.bytesPerLine = image.bufWidth * bytesPerPixelx2[fmt] / 2;
+		refImage.pixelFormat = image.pixelFormat;
+		refImage.bytesPerLine = image.bytesPerLine;
+		// Not zero, so pixels that shouldn't be touched are noticed.
+		memset(Memory::GetPointer(image.bufferPtr), 0x5A, bufferBytes);
+		memset(Memory::GetPointer(refBufferPtr), 0x5A, bufferBytes);
+		for (size_t pos = 0; pos < sizeof(positions) / sizeof(positions[0]); ++pos) {
+			const int *p = positions[pos];
+			image.xPos64 = refImage.xPos64 = p[0] * 64;
+			image.yPos64 = refImage.yPos64 = p[1] * 64;
+			for (int c = 0x20; c < 0x7F; ++c) {
+				for (size_t type = 0; type < sizeof(glyphTypes) / sizeof(glyphTypes[0]); ++type) {
+					pgf.DrawCharacter(&image, p[2], p[3], p[4], p[5], c, '?', glyphTypes[type]);
+					pgf.DrawCharacterPerPixel(&refImage, p[2], p[3], p[4], p[5], c, '?', glyphTypes[type]);
+				}
+			}
+		}
+		if (memcmp(Memory::GetPointer(image.bufferPtr), Memory::GetPointer(refBufferPtr), bufferBytes) != 0) {
+			printf("TestFontGlyphCache: pixel format %d differs from drawing per pixel\n", (int)formats[fmt]);
+			matches = false;
+		}
+	}
+
+	const int passes = 20;
+
+	for (int cached = 0; cached < 2 && matches; ++cached) {
+		int glyphs = 0;
+		double start = real_time_now();
+		for (int pass = 0; pass < passes; ++pass) {
+			for (size_t fmt = 0; fmt < sizeof(formats) / sizeof(formats[0]); ++fmt) {
+				if (!cached)
+					pgf.ClearGlyphCache();
+				image.pixelFormat = formats[fmt];
+				image.bytesPerLine = image.bufWidth * bytesPerPixelx2[fmt] / 2;
+				for (int c = 0x20; c < 0x7F; ++c) {
+					image.xPos64 = ((c - 0x20) % 24) * 20 * 64;
+					image.yPos64 = ((c - 0x20) / 24) * 24 * 64;
+					pgf.DrawCharacter(&image, 0, 0, image.bufWidth, image.bufHeight, c, '?', FONT_PGF_CHARGLYPH);
+					pgf.DrawCharacter(&image, 0, 0, image.bufWidth, image.bufHeight, c, '?', FONT_PGF_SHADOWGLYPH);
+					glyphs += 2;
+				}
+			}
+		}
+		double elapsed = real_time_now() - start;
+		printf("TestFontGlyphCache: %s: %d glyphs in %0.3f ms, %0.0f glyphs/sec\n", cached ? "cached" : "decoding", glyphs, elapsed * 1000.0, glyphs / elapsed);
+	}
+
+	delete gpu;
+	gpu = 0;
+	Memory::Shutdown();
+	return matches;
+}
+
+// Builds a minimal ISO9660 image in memory: the root holds numDirs directories of numFiles files each.
+class SyntheticISOBlockDevice : public BlockDevice {
+public:
+	SyntheticISOBlockDevice(int numDirs, int numFiles) {
+		// Sectors 0-15 are the system area, 16 is the volume descriptor.
+		image_.resize(17 * 2048);
+
+		std::vector<std::string> rootNames;
+		std::vector<u32> rootSectors, rootSizes;
+		for (int d = 0; d < numDirs; ++d) {
+			char name[32];
+			std::vector<std::string> names;
+			for (int f = 0; f < numFiles; ++f) {
+				sprintf(name, "FILE%04d.BIN", f);
+				names.push_back(name);
+			}
+			u32 size;
+			rootSectors.push_back(WriteDirectory(names, std::vector<u32>(), std::vector<u32>(), &size));
+			rootSizes.push_back(size);
+			sprintf(name, "DIR%04d", d);
+			rootNames.push_back(name);
+		}
+
+		u32 rootSize;
+		u32 rootSector = WriteDirectory(rootNames, rootSectors, rootSizes, &rootSize);
+
+		u8 *desc = &image_[16 * 2048];
+		desc[0] = 1;
+		memcpy(desc + 1, "CD001", 5);
+		WriteRecord(desc + 156, "\0", 1, rootSector, rootSize, true);
+	}
+
+	bool ReadBlock(int blockNumber, u8 *outPtr) {
+		if ((size_t)(blockNumber + 1) * 2048 > image_.size())
+			return false;
+		memcpy(outPtr, &image_[blockNumber * 2048], 2048);
+		return true;
+	}
+	u32 GetNumBlocks() { return (u32)(image_.size() / 2048); }
+
+private:
+	static int WriteRecord(u8 *p, const char *name, int nameLen, u32 sector, u32 size, bool dir) {
+		int recordSize = (33 + nameLen + 1) & ~1;
+		memset(p, 0, recordSize);
+		p[0] = recordSize;
+		for (int i = 0; i < 4; ++i) {
+			p[2 + i] = (sector >> (i * 8)) & 0xFF;
+			p[9 - i] = (sector >> (i * 8)) & 0xFF;
+			p[10 + i] = (size >> (i * 8)) & 0xFF;
+			p[17 - i] = (size >> (i * 8)) & 0xFF;
+		}
+		p[25] = dir ? 2 : 0;
+		p[32] = nameLen;
+		memcpy(p + 33, name, nameLen);
+		return recordSize;
+	}
+
+	// Subdirectory sectors and sizes are given for directories, empty for files.
+	u32 WriteDirectory(const std::vector<std::string> &names, const std::vector<u32> &sectors, const std::vector<u32> &sizes, u32 *dirSize) {
+		const u32 start = (u32)(image_.size() / 2048);
+		size_t offset = image_.size();
+		image_.resize(image_.size() + 2048);
+		offset += WriteRecord(&image_[offset], "\0", 1, start, 0, true);
+		// The lookup doesn't follow "." and "..", so both can just point here.
+		offset += WriteRecord(&image_[offset], "\1", 1, start, 0, true);
+		for (size_t i = 0; i < names.size(); ++i) {
+			int recordSize = (33 + (int)names[i].size() + 1) & ~1;
+			if (offset % 2048 + recordSize > 2048) {
+				offset = image_.size();
+				image_.resize(image_.size() + 2048);
+			}
+			const bool dir = !sectors.empty();
+			offset += WriteRecord(&image_[offset], names[i].c_str(), (int)names[i].size(), dir ? sectors[i] : 0, dir ? sizes[i] : 0, dir);
+		}
+		*dirSize = (u32)(image_.size() - start * 2048);
+		return start;
+	}
+
+	std::vector<u8> image_;
+};
+
+bool TestISOPathIndex() {
+	const int numDirs = 64;
+	const int numFiles = 256;
+	SequentialHandleAllocator handles;
+	ISOFileSystem iso(&handles, new SyntheticISOBlockDevice(numDirs, numFiles));
+
+	EXPECT_TRUE(iso.GetFileInfo("/DIR0000/FILE0000.BIN").exists);
+	EXPECT_TRUE(iso.GetFileInfo("dir0063/file0255.bin").exists);
+	EXPECT_TRUE(iso.GetFileInfo("./Dir0010//File0020.Bin").exists);
+	EXPECT_TRUE(iso.GetFileInfo("/DIR0001/").exists);
+	EXPECT_FALSE(iso.GetFileInfo("/DIR0001//").exists);
+	EXPECT_FALSE(iso.GetFileInfo("//DIR0001").exists);
+	EXPECT_FALSE(iso.GetFileInfo("/DIR0000/FILE9999.BIN").exists);
+	EXPECT_FALSE(iso.GetFileInfo("/DIR0000/FILE0000.BIN/X").exists);
+	EXPECT_TRUE((int)iso.GetDirListing("/").size() == numDirs);
+	EXPECT_TRUE((int)iso.GetDirListing("/DIR0005").size() == numFiles);
+
+	const int passes = 4;
+	char path[64];
+	int found = 0;
+	double start = real_time_now();
+	for (int pass = 0; pass < passes; ++pass) {
+		for (int d = 0; d < numDirs; ++d) {
+			for (int f = 0; f < numFiles; ++f) {
+				sprintf(path, (f & 1) ? "/dir%04d/file%04d.bin" : "/DIR%04d/FILE%04d.BIN", d, f);
+				if (iso.GetFileInfo(path).exists)
+					found++;
+			}
+		}
+	}
+	double elapsed = real_time_now() - start;
+	EXPECT_TRUE(found == passes * numDirs * numFiles);
+	printf("TestISOPathIndex: %d lookups in %0.3f ms, %0.0f lookups/sec\n", found, elapsed * 1000.0, found / elapsed);
+
+	int listed = 0;
+	start = real_time_now();
+	for (int pass = 0; pass < passes * 16; ++pass) {
+		for (int d = 0; d < numDirs; ++d) {
+			sprintf(path, "/DIR%04d", d);
+			listed += (int)iso.GetDirListing(path).size();
+		}
+	}
+	elapsed = real_time_now() - start;
+	printf("TestISOPathIndex: %d directory listings in %0.3f ms, %0.0f entries/sec\n", passes * 16 * numDirs, elapsed * 1000.0, listed / elapsed);
+	return true;
+}
+
+static u32 ReferenceYCbCrToABGR(int y, int cb, int cr) {
+	cb = cb - 128;
+	cr = cr - 128;
+	int r = y + cr + (cr >> 2) + (cr >> 3) + (cr >> 5);
+	int g = y - ((cb >> 2) + (cb >> 4) + (cb >> 5)) - ((cr >> 1) + (cr >> 3) + (cr >> 4) + (cr >> 5));
+	int b = y + cb + (cb >> 1) + (cb >> 2) + (cb >> 6);
+	r = std::max(0, std::min(r, 255));
+	g = std::max(0, std::min(g, 255));
+	b = std::max(0, std::min(b, 255));
+	return 0xFF000000 | (b << 16) | (g << 8) | r;
+}
+
+bool TestColorConvert() {
+	// Every input, with a width that leaves a scalar tail.
+	u8 ys[260], cbs[65], crs[65];
+	u32 abgr[260];
+	for (int i = 0; i < 260; ++i)
+		ys[i] = (u8)i;
+	for (int cb = 0; cb < 256; ++cb) {
+		for (int cr = 0; cr < 256; ++cr) {
+			memset(cbs, cb, sizeof(cbs));
+			memset(crs, cr, sizeof(crs));
+			ConvertYCbCrToABGR8888(abgr, ys, cbs, crs, 260);
+			for (int i = 0; i < 260; ++i) {
+				EXPECT_TRUE(abgr[i] == ReferenceYCbCrToABGR(ys[i], cb, cr));
+			}
+		}
+	}
+
+	const int width = 480;
+	const int height = 272;
+	const int frames = 200;
+	std::vector<u8> y(width * height), cb(width * height / 4), cr(width * height / 4);
+	std::vector<u32> rgba(width * height), rgbaOut(512 * height);
+	std::vector<u16> out16(512 * height);
+	for (size_t i = 0; i < y.size(); ++i)
+		y[i] = (u8)(i * 7);
+	for (size_t i = 0; i < cb.size(); ++i) {
+		cb[i] = (u8)(i * 13);
+		cr[i] = (u8)(i * 29);
+	}
+	for (size_t i = 0; i < rgba.size(); ++i)
+		rgba[i] = (u32)i * 0x9E3779B1;
+
+	ConvertABGR8888ToBGR565(&out16[0], &rgba[0], width);
+	ConvertABGR8888ToABGR5551(&out16[width], &rgba[0], width);
+	ConvertABGR8888ToABGR4444(&out16[width * 2], &rgba[0], width);
+	for (int i = 0; i < width; ++i) {
+		const u32 px = rgba[i];
+		EXPECT_TRUE(out16[i] == (u16)(((px >> 3) & 0x001F) | ((px >> 5) & 0x07E0) | ((px >> 8) & 0xF800)));
+		EXPECT_TRUE(out16[width + i] == (u16)(((px >> 3) & 0x001F) | ((px >> 6) & 0x03E0) | ((px >> 9) & 0x7C00) | ((px >> 16) & 0x8000)));
+		EXPECT_TRUE(out16[width * 2 + i] == (u16)(((px >> 4) & 0x000F) | ((px >> 8) & 0x00F0) | ((px >> 12) & 0x0F00) | ((px >> 16) & 0xF000)));
+	}
+	CopyVideoImage((u8 *)&rgbaOut[0], 512, (const u8 *)&rgba[0], width, width, height, GE_FORMAT_8888);
+	EXPECT_TRUE(rgbaOut[512 * 3 + 5] == (rgba[width * 3 + 5] & 0x00FFFFFF));
+
+	const double megapixels = (double)width * height * frames / 1000000.0;
+	double start = real_time_now();
+	for (int f = 0; f < frames; ++f) {
+		for (int row = 0; row < height; ++row)
+			ConvertYCbCrToABGR8888(&rgba[row * width], &y[row * width], &cb[row * width / 4], &cr[row * width / 4], width);
+	}
+	printf("TestColorConvert: YCbCr -> 8888: %0.1f Mpixels/sec\n", megapixels / (real_time_now() - start));
+
+	static const char *const formatNames[] = { "565", "5551", "4444", "8888" };
+	for (int format = GE_FORMAT_565; format <= GE_FORMAT_4444; ++format) {
+		start = real_time_now();
+		for (int f = 0; f < frames; ++f) {
+			for (int row = 0; row < height; ++row) {
+				u16 *dst = &out16[row * 512];
+				const u32 *src = &rgba[row * width];
+				if (format == GE_FORMAT_565)
+					ConvertABGR8888ToBGR565(dst, src, width);
+				else if (format == GE_FORMAT_5551)
+					ConvertABGR8888ToABGR5551(dst, src, width);
+				else
+					ConvertABGR8888ToABGR4444(dst, src, width);
+			}
+		}
+		printf("TestColorConvert: 8888 -> %s: %0.1f Mpixels/sec\n", formatNames[format], megapixels / (real_time_now() - start));
+	}
+
+	for (int format = GE_FORMAT_565; format <= GE_FORMAT_8888; ++format) {
+		u8 *dst = format == GE_FORMAT_8888 ? (u8 *)&rgbaOut[0] : (u8 *)&out16[0];
+		start = real_time_now();
+		for (int f = 0; f < frames; ++f)
+			CopyVideoImage(dst, 512, (const u8 *)&rgba[0], width, width, height, (GEBufferFormat)format);
+		printf("TestColorConvert: video copy %s: %0.1f Mpixels/sec\n", formatNames[format], megapixels / (real_time_now() - start));
+	}
+	return true;
+}
+
 int main(int argc, const char *argv[])
 {
 	g_Config.bEnableLogging = true;
@@ -321,5 +656,8 @@ int main(int argc, const char *argv[])
 	//TestArmEmitter();
 	TestMathUtil();
 	TestParsers();
+	TestFontGlyphCache();
+	TestISOPathIndex();
+	TestColorConvert();
 	return 0;
 }